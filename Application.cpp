@@ -1,8 +1,23 @@
 #include "Application.h"
 
-Application::Application()
+#include <cmath>
+#include <iostream>
+
+#include "D3DEngine.h"
+#include "MeshLoader.h"
+#include "Profiler.h"
+
+Application::Application(std::filesystem::path meshPath, std::filesystem::path tracePath, bool animate)
     : m_hwnd(nullptr)
+    , m_meshPath(std::move(meshPath))
+    , m_tracePath(std::move(tracePath))
+    , m_animate(animate)
 {
+    if (!m_tracePath.empty())
+    {
+        Profiler::instance().setEnabled(true);
+    }
+
     WNDCLASSEX wc = {
         .cbSize = sizeof(WNDCLASSEX),
         .style = CS_HREDRAW | CS_VREDRAW,
@@ -32,6 +47,21 @@ Application::~Application()
     }
 
     UnregisterClass(className, GetModuleHandle(nullptr));
+
+    // after cleanup, which waits for the GPU and so records the last frames' GPU scopes
+    if (!m_tracePath.empty())
+    {
+        try
+        {
+            Profiler::instance().writeChromeTrace(m_tracePath);
+            std::cout << "Wrote trace with " << Profiler::instance().stats().eventCount << " events to "
+                << m_tracePath.string() << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
 }
 
 int Application::createWindow(int x, int y, int width, int height)
@@ -53,7 +83,20 @@ int Application::createWindow(int x, int y, int width, int height)
         return -1;
     }
 
-    m_engine = std::make_unique<D3DEngine>(hwnd);
+    Mesh mesh = Mesh::triangle();
+    if (!m_meshPath.empty())
+    {
+        ProfileScope scope("loadMesh");
+        MeshLoader loader;
+        mesh = loader.load(m_meshPath);
+        std::cout << "Loaded " << m_meshPath.string() << ": "
+            << loader.stats().vertexCount << " vertices, "
+            << loader.stats().triangleCount << " triangles in "
+            << loader.stats().loadTimeMs << " ms" << std::endl;
+    }
+
+    mesh.fitTransform(m_fitTransform);
+    m_engine = std::make_unique<D3DEngine>(hwnd, std::move(mesh));
 
     ShowWindow(hwnd, SW_SHOW);
     UpdateWindow(hwnd);
@@ -61,14 +104,55 @@ int Application::createWindow(int x, int y, int width, int height)
     return 0;
 }
 
-void Application::run()
+void Application::run(const RunLoopOptions& options)
+{
+    RunLoop loop(*m_engine, *this, options);
+    loop.run();
+}
+
+bool Application::pumpEvents()
 {
     MSG msg = {};
-    while (GetMessage(&msg, nullptr, 0, 0))
+    while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
     {
+        if (msg.message == WM_QUIT)
+        {
+            return false;
+        }
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
+
+    if (m_animate)
+    {
+        animateInstance();
+    }
+    return true;
+}
+
+void Application::animateInstance()
+{
+    // turn the fitted mesh around the vertical axis through its center, which the fit put at the origin
+    float angle = INSTANCE_ROTATION_SPEED * std::chrono::duration<float>(std::chrono::steady_clock::now() - m_startTime).count();
+    float c = std::cos(angle);
+    float s = std::sin(angle);
+    float rotation[3][3] = {
+        {c, 0.0f, s},
+        {0.0f, 1.0f, 0.0f},
+        {-s, 0.0f, c}
+    };
+    float transform[3][4] = {};
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                transform[row][col] += rotation[row][k] * m_fitTransform[k][col];
+            }
+        }
+    }
+    m_engine->setInstanceTransform(0, transform);
 }
 
 LRESULT Application::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
@@ -105,7 +189,8 @@ LRESULT Application::handleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         return 0;
 
     case WM_PAINT:
-        m_engine->render();
+        // the run loop renders continuously, the window only needs to stop asking
+        ValidateRect(m_hwnd, nullptr);
         return 0;
 
     default:
@@ -4,29 +4,55 @@
 #ifndef UNICODE
 #define UNICODE
 #endif
+// the Cpu* headers define min/max functions
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 
+#include <chrono>
+#include <filesystem>
 #include <memory>
-#include "D3DEngine.h"
+#include "Engine.h"
+#include "RunLoop.h"
 
-class Application
+// the Win32 window, one EventSource of the run loop
+class Application : public EventSource
 {
 public:
-    Application();
-    ~Application();
+    // an empty mesh path renders the default triangle. a trace path enables the profiler, the trace is
+    // written there when the application closes. animate turns the mesh around its vertical axis, which
+    // refits the TLAS every frame; without it the image matches CpuEngine's
+    explicit Application(std::filesystem::path meshPath = {}, std::filesystem::path tracePath = {}, bool animate = false);
+    ~Application() override;
 
     int createWindow(int x = CW_USEDEFAULT, int y = CW_USEDEFAULT, int width = 800, int height = 600);
 
-    void run();
+    // renders frames back-to-back (or at options.targetFrameRate) until the window is closed
+    void run(const RunLoopOptions& options = {});
+
+    // drains the message queue without blocking, then moves the instance if animating. the run loop calls it
+    // once before every frame
+    bool pumpEvents() override;
 
 private:
+    void animateInstance();
+
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
     LRESULT handleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
 
-    std::unique_ptr<D3DEngine> m_engine;
+    std::unique_ptr<Engine> m_engine;
     HWND m_hwnd;
+    std::filesystem::path m_meshPath;
+    std::filesystem::path m_tracePath;
+    bool m_animate;
+    // the engine's initial instance transform, the animation rotates it
+    float m_fitTransform[3][4] = {};
+    std::chrono::steady_clock::time_point m_startTime = std::chrono::steady_clock::now();
 
     const wchar_t* className = L"ApplicationWindowClass";
+    // radians per second the instance turns when animating
+    static constexpr float INSTANCE_ROTATION_SPEED = 0.5f;
 };
 
 #endif //APPLICATION_H
\ No newline at end of file
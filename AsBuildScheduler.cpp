@@ -0,0 +1,93 @@
+#include "AsBuildScheduler.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "ScratchAllocator.h"
+
+namespace
+{
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// share of the tighter budget a request takes
+double budgetShare(const AsBuildRequest& request, const AsBuildSchedulerOptions& options)
+{
+    double scratchShare = static_cast<double>(alignUp(request.scratchSize, SCRATCH_ALIGNMENT))
+        / static_cast<double>(std::max<uint64_t>(options.scratchBudget, 1));
+    double resultShare = static_cast<double>(request.resultSize)
+        / static_cast<double>(std::max<uint64_t>(options.resultBudget, 1));
+    return std::max(scratchShare, resultShare);
+}
+}
+
+AsBuildScheduler::AsBuildScheduler(const AsBuildSchedulerOptions& options)
+    : m_options(options)
+{
+}
+
+AsBuildPlan AsBuildScheduler::plan(std::span<const AsBuildRequest> requests) const
+{
+    std::vector<uint32_t> order(requests.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return budgetShare(requests[a], m_options) > budgetShare(requests[b], m_options);
+    });
+
+    AsBuildPlan plan;
+    for (uint32_t requestIndex : order)
+    {
+        const AsBuildRequest& request = requests[requestIndex];
+        uint64_t scratchSize = alignUp(std::max<uint64_t>(request.scratchSize, 1), SCRATCH_ALIGNMENT);
+        uint64_t compactedSize = m_options.compact && request.compactedSize > 0 ? request.compactedSize : request.resultSize;
+
+        auto fits = [&](const AsBuildBatch& batch) {
+            return batch.scratchSize + scratchSize <= m_options.scratchBudget
+                && batch.resultSize + request.resultSize <= m_options.resultBudget;
+        };
+        auto batch = std::find_if(plan.batches.begin(), plan.batches.end(), fits);
+        if (batch == plan.batches.end())
+        {
+            // also where a request over budget on its own ends up, alone in a new batch
+            if (scratchSize > m_options.scratchBudget || request.resultSize > m_options.resultBudget)
+            {
+                plan.stats.oversizedCount++;
+            }
+            batch = plan.batches.emplace(plan.batches.end());
+        }
+
+        batch->requests.push_back(requestIndex);
+        batch->scratchSize += scratchSize;
+        batch->resultSize += request.resultSize;
+        batch->compactedSize += compactedSize;
+    }
+
+    plan.stats.batchCount = static_cast<uint32_t>(plan.batches.size());
+    for (const AsBuildBatch& batch : plan.batches)
+    {
+        plan.stats.scratchCapacity = std::max(plan.stats.scratchCapacity, batch.scratchSize);
+    }
+
+    // batches run in order, each keeps only its compacted results once it is done
+    uint64_t retained = 0;
+    uint64_t peakResults = 0;
+    for (const AsBuildBatch& batch : plan.batches)
+    {
+        if (m_options.compact)
+        {
+            // the originals are still alive while they are copied into their compacted buffers
+            peakResults = std::max(peakResults, retained + batch.resultSize + batch.compactedSize);
+            retained += batch.compactedSize;
+        }
+        else
+        {
+            retained += batch.resultSize;
+            peakResults = std::max(peakResults, retained);
+        }
+    }
+    plan.stats.retainedSize = retained;
+    plan.stats.peakMemory = plan.stats.scratchCapacity + peakResults;
+    return plan;
+}
@@ -0,0 +1,76 @@
+#ifndef ASBUILDSCHEDULER_H
+#define ASBUILDSCHEDULER_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// sizes of one BLAS build, from D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO
+struct AsBuildRequest
+{
+    uint64_t scratchSize = 0;
+    uint64_t resultSize = 0;
+    // expected size after compaction, 0 = unknown, planned as resultSize
+    uint64_t compactedSize = 0;
+};
+
+struct AsBuildSchedulerOptions
+{
+    // scratch shared by the builds of one batch, they run concurrently and each needs its own range
+    uint64_t scratchBudget = 64ull << 20;
+    // uncompacted results of one batch, they only shrink once the batch has finished
+    uint64_t resultBudget = 256ull << 20;
+    bool compact = true;
+};
+
+// builds recorded back to back without barriers, followed by one UAV barrier (and compaction)
+struct AsBuildBatch
+{
+    std::vector<uint32_t> requests; // indices into the planned requests, in recording order
+    // scratch of all builds, each SCRATCH_ALIGNMENT aligned
+    uint64_t scratchSize = 0;
+    uint64_t resultSize = 0;
+    uint64_t compactedSize = 0;
+};
+
+struct AsBuildPlanStats
+{
+    uint32_t batchCount = 0;
+    // requests larger than a budget on their own, each got a batch of its own
+    uint32_t oversizedCount = 0;
+    // scratch buffer that fits every batch
+    uint64_t scratchCapacity = 0;
+    // results that stay alive after all batches
+    uint64_t retainedSize = 0;
+    // scratch plus every result alive at the worst point, during the last compaction copies of a batch
+    uint64_t peakMemory = 0;
+};
+
+struct AsBuildPlan
+{
+    std::vector<AsBuildBatch> batches;
+    AsBuildPlanStats stats;
+};
+
+// groups BLAS builds into batches under a scratch and result budget. a batch ends with a single barrier
+// instead of one per build, so its builds can overlap on the GPU. requests are placed largest first into the
+// first batch with room (first-fit decreasing), ties keep their order, so the same scene always gets the
+// same plan. D3DEngine records the batches from prebuild info sizes, CpuEngine::planBlasBuilds plans the same
+// scene from the CPU builder's memory
+class AsBuildScheduler
+{
+public:
+    explicit AsBuildScheduler(const AsBuildSchedulerOptions& options = {});
+
+    AsBuildPlan plan(std::span<const AsBuildRequest> requests) const;
+
+    const AsBuildSchedulerOptions& options() const
+    {
+        return m_options;
+    }
+
+private:
+    AsBuildSchedulerOptions m_options;
+};
+
+#endif //ASBUILDSCHEDULER_H
@@ -0,0 +1,32 @@
+#include "AsUpdatePolicy.h"
+
+AsUpdatePolicy::AsUpdatePolicy(const AsUpdatePolicyOptions& options)
+    : m_options(options)
+{
+}
+
+void AsUpdatePolicy::built(float cost)
+{
+    m_stats.buildCount++;
+    m_stats.updatesSinceBuild = 0;
+    m_stats.buildCost = cost;
+    m_stats.cost = cost;
+    m_rebuildPending = false;
+}
+
+bool AsUpdatePolicy::updated(float cost)
+{
+    m_stats.updateCount++;
+    m_stats.updatesSinceBuild++;
+    m_stats.cost = cost;
+
+    m_rebuildPending = costRatio() > m_options.maxCostRatio
+        || (m_options.maxUpdateCount > 0 && m_stats.updatesSinceBuild >= m_options.maxUpdateCount);
+    return m_rebuildPending;
+}
+
+float AsUpdatePolicy::costRatio() const
+{
+    // an empty structure cannot degrade
+    return m_stats.buildCost > 0.0f ? m_stats.cost / m_stats.buildCost : 1.0f;
+}
@@ -0,0 +1,56 @@
+#ifndef ASUPDATEPOLICY_H
+#define ASUPDATEPOLICY_H
+
+#include <cstdint>
+
+struct AsUpdatePolicyOptions
+{
+    // rebuild once an update leaves the SAH cost this many times above the cost right after the last build
+    float maxCostRatio = 1.5f;
+    // rebuild after this many updates in a row regardless of cost, 0 = no limit
+    uint32_t maxUpdateCount = 0;
+};
+
+struct AsUpdatePolicyStats
+{
+    uint32_t buildCount = 0;
+    uint32_t updateCount = 0;
+    // updates since the last build
+    uint32_t updatesSinceBuild = 0;
+    float buildCost = 0.0f;
+    float cost = 0.0f;
+};
+
+// decides between refitting an acceleration structure (D3D12 PERFORM_UPDATE, CpuBvhRefitter) and rebuilding
+// it. a refit keeps the topology chosen for the old primitive positions, so its SAH cost only grows as they
+// move; the policy compares that cost to the one the last build achieved
+class AsUpdatePolicy
+{
+public:
+    explicit AsUpdatePolicy(const AsUpdatePolicyOptions& options = {});
+
+    // cost of a fresh build
+    void built(float cost);
+    // cost after an update, returns true when the structure should be rebuilt next
+    bool updated(float cost);
+
+    bool rebuildPending() const
+    {
+        return m_rebuildPending;
+    }
+
+    // refit cost relative to the last build, 1 right after a build
+    float costRatio() const;
+
+    const AsUpdatePolicyStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    AsUpdatePolicyOptions m_options;
+    AsUpdatePolicyStats m_stats;
+    bool m_rebuildPending = false;
+};
+
+#endif //ASUPDATEPOLICY_H
@@ -0,0 +1,260 @@
+#include "CommandRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "Profiler.h"
+
+CommandRecorder::CommandRecorder(CommandListDevice& device, FrameQueue& queue, uint32_t workerCount)
+    : m_device(device)
+    , m_queue(queue)
+    , m_workerCount(workerCount == 0 ? std::max(1u, std::thread::hardware_concurrency()) : workerCount)
+{
+}
+
+uint32_t CommandRecorder::addJob(const char* name, std::function<void(const CommandJobContext&)> record)
+{
+    m_jobs.push_back({
+        .name = name,
+        .record = std::move(record)
+    });
+    return static_cast<uint32_t>(m_jobs.size() - 1);
+}
+
+void CommandRecorder::addDependency(uint32_t job, uint32_t dependency)
+{
+    if (job >= m_jobs.size() || dependency >= m_jobs.size())
+    {
+        throw std::out_of_range("Command job dependency refers to an unknown job.");
+    }
+    m_jobs[dependency].dependents.push_back(job);
+    m_jobs[job].dependencyCount++;
+}
+
+void CommandRecorder::submit(uint64_t fenceValue)
+{
+    if (m_jobs.empty())
+    {
+        return;
+    }
+    if (fenceValue <= m_queue.completedValue())
+    {
+        m_jobs.clear();
+        throw std::invalid_argument("The fence value of a submission must not have completed yet.");
+    }
+
+    std::vector<uint32_t> order;
+    try
+    {
+        order = sortJobs();
+    }
+    catch (...)
+    {
+        m_jobs.clear();
+        throw;
+    }
+
+    while (m_commandLists.size() < m_jobs.size())
+    {
+        m_commandLists.push_back(m_device.createCommandList());
+        m_stats.commandListCount++;
+    }
+
+    uint32_t workerCount = std::min(m_workerCount, static_cast<uint32_t>(m_jobs.size()));
+    std::vector<uint32_t> allocators;
+    allocators.reserve(workerCount);
+    std::chrono::high_resolution_clock::time_point start;
+    try
+    {
+        for (uint32_t worker = 0; worker < workerCount; ++worker)
+        {
+            allocators.push_back(acquireAllocator(fenceValue));
+        }
+        start = std::chrono::high_resolution_clock::now();
+        record(allocators);
+    }
+    catch (...)
+    {
+        // nothing was executed and the caller will not signal fenceValue, the allocators are free right away
+        releaseAllocators(allocators);
+        m_jobs.clear();
+        throw;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::vector<uint32_t> commandLists;
+    commandLists.reserve(order.size());
+    for (uint32_t job : order)
+    {
+        commandLists.push_back(m_commandLists[job]);
+    }
+    m_device.executeCommandLists(commandLists);
+
+    m_submissionOrder = std::move(order);
+    m_stats.submitCount++;
+    m_stats.jobCount += m_jobs.size();
+    m_stats.lastRecordMs = std::chrono::duration<double, std::milli>(end - start).count();
+    m_jobs.clear();
+}
+
+std::vector<uint32_t> CommandRecorder::sortJobs() const
+{
+    std::vector<uint32_t> remaining(m_jobs.size());
+    std::vector<uint32_t> order;
+    order.reserve(m_jobs.size());
+    for (uint32_t job = 0; job < m_jobs.size(); ++job)
+    {
+        remaining[job] = m_jobs[job].dependencyCount;
+        if (remaining[job] == 0)
+        {
+            order.push_back(job);
+        }
+    }
+
+    for (size_t next = 0; next < order.size(); ++next)
+    {
+        for (uint32_t dependent : m_jobs[order[next]].dependents)
+        {
+            if (--remaining[dependent] == 0)
+            {
+                order.push_back(dependent);
+            }
+        }
+    }
+
+    // the jobs on a cycle never become ready
+    if (order.size() != m_jobs.size())
+    {
+        throw std::logic_error("Command jobs have a dependency cycle.");
+    }
+    return order;
+}
+
+uint32_t CommandRecorder::acquireAllocator(uint64_t fenceValue)
+{
+    uint64_t completedValue = m_queue.completedValue();
+    for (PooledAllocator& pooled : m_allocators)
+    {
+        if (pooled.fenceValue <= completedValue)
+        {
+            m_device.resetAllocator(pooled.allocator);
+            pooled.fenceValue = fenceValue;
+            m_stats.allocatorReuseCount++;
+            return pooled.allocator;
+        }
+    }
+
+    m_allocators.push_back({
+        .allocator = m_device.createAllocator(),
+        .fenceValue = fenceValue
+    });
+    m_stats.allocatorCount++;
+    return m_allocators.back().allocator;
+}
+
+void CommandRecorder::releaseAllocators(const std::vector<uint32_t>& allocators)
+{
+    for (PooledAllocator& pooled : m_allocators)
+    {
+        if (std::find(allocators.begin(), allocators.end(), pooled.allocator) != allocators.end())
+        {
+            pooled.fenceValue = 0;
+        }
+    }
+}
+
+void CommandRecorder::record(const std::vector<uint32_t>& allocators)
+{
+    std::mutex mutex;
+    std::condition_variable readyCondition;
+    std::deque<uint32_t> ready;
+    std::vector<uint32_t> remaining(m_jobs.size());
+    for (uint32_t job = 0; job < m_jobs.size(); ++job)
+    {
+        remaining[job] = m_jobs[job].dependencyCount;
+        if (remaining[job] == 0)
+        {
+            ready.push_back(job);
+        }
+    }
+    size_t unfinished = m_jobs.size();
+    std::exception_ptr failure;
+
+    auto workerMain = [&](uint32_t worker) {
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            // the graph has no cycle, so while jobs are unfinished one is ready or being recorded
+            readyCondition.wait(lock, [&] { return !ready.empty() || unfinished == 0 || failure; });
+            if (ready.empty() || failure)
+            {
+                return;
+            }
+            uint32_t job = ready.front();
+            ready.pop_front();
+            lock.unlock();
+
+            std::exception_ptr jobFailure;
+            uint32_t commandList = m_commandLists[job];
+            try
+            {
+                m_device.beginCommandList(commandList, allocators[worker]);
+                try
+                {
+                    ProfileScope scope(m_jobs[job].name);
+                    m_jobs[job].record({.commandList = commandList, .worker = worker});
+                }
+                catch (...)
+                {
+                    // an open list would keep the worker's allocator from recording the next one
+                    m_device.closeCommandList(commandList);
+                    throw;
+                }
+                m_device.closeCommandList(commandList);
+            }
+            catch (...)
+            {
+                jobFailure = std::current_exception();
+            }
+
+            lock.lock();
+            if (jobFailure && !failure)
+            {
+                failure = jobFailure;
+            }
+            unfinished--;
+            for (uint32_t dependent : m_jobs[job].dependents)
+            {
+                if (--remaining[dependent] == 0)
+                {
+                    ready.push_back(dependent);
+                }
+            }
+            readyCondition.notify_all();
+        }
+    };
+
+    // the calling thread is worker 0
+    std::vector<std::thread> threads;
+    threads.reserve(allocators.size() - 1);
+    for (uint32_t worker = 1; worker < allocators.size(); ++worker)
+    {
+        threads.emplace_back(workerMain, worker);
+    }
+    workerMain(0);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+}
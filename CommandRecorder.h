@@ -0,0 +1,127 @@
+#ifndef COMMANDRECORDER_H
+#define COMMANDRECORDER_H
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "FramePacer.h"
+
+// command allocators and command lists of one queue, behind handles so the job scheduling and pooling of
+// CommandRecorder run without a device. begin, close and whatever the jobs record are called from worker
+// threads, each on its own list and allocator; everything else only from the thread calling submit
+class CommandListDevice
+{
+public:
+    virtual ~CommandListDevice() = default;
+
+    virtual uint32_t createAllocator() = 0;
+    // the GPU has finished every list recorded from allocator
+    virtual void resetAllocator(uint32_t allocator) = 0;
+    // created closed
+    virtual uint32_t createCommandList() = 0;
+    // only one list of an allocator is open at a time
+    virtual void beginCommandList(uint32_t commandList, uint32_t allocator) = 0;
+    virtual void closeCommandList(uint32_t commandList) = 0;
+    // one submission, the lists run in order
+    virtual void executeCommandLists(std::span<const uint32_t> commandLists) = 0;
+};
+
+// what a job records into
+struct CommandJobContext
+{
+    uint32_t commandList;
+    uint32_t worker;
+};
+
+struct CommandRecorderStats
+{
+    uint64_t submitCount = 0;
+    uint64_t jobCount = 0;
+    // allocators are only created while every pooled one is still in use by the GPU
+    uint32_t allocatorCount = 0;
+    uint64_t allocatorReuseCount = 0;
+    uint32_t commandListCount = 0;
+    double lastRecordMs = 0.0;
+};
+
+// records setup work on worker threads and submits it as one ExecuteCommandLists. every job gets a command list
+// of its own, every worker records its jobs into one allocator from a pool that is recycled by fence value.
+// a job starts recording once its dependencies have been recorded, so it can use what they set up on the CPU,
+// and its list runs after theirs on the GPU; the barriers for that are the job's to record
+class CommandRecorder
+{
+public:
+    // workerCount 0 = hardware concurrency
+    CommandRecorder(CommandListDevice& device, FrameQueue& queue, uint32_t workerCount = 0);
+
+    CommandRecorder(const CommandRecorder&) = delete;
+    CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+    // name is a string literal, the profiler scope of the job. returns the job for addDependency
+    uint32_t addJob(const char* name, std::function<void(const CommandJobContext&)> record);
+    // job records after dependency and its list is submitted after dependency's
+    void addDependency(uint32_t job, uint32_t dependency);
+
+    // records the jobs added since the last submit and executes their lists. the caller signals fenceValue on the
+    // queue right after, the allocators are reused once it completed. throws before recording anything when
+    // the dependencies have a cycle, and rethrows the first exception of a job after closing every list; the
+    // lists are not executed then and the allocators go back to the pool without waiting for fenceValue
+    void submit(uint64_t fenceValue);
+
+    // jobs of the last submit in the order their lists were executed
+    const std::vector<uint32_t>& submissionOrder() const
+    {
+        return m_submissionOrder;
+    }
+
+    uint32_t workerCount() const
+    {
+        return m_workerCount;
+    }
+
+    const CommandRecorderStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    struct Job
+    {
+        const char* name;
+        std::function<void(const CommandJobContext&)> record;
+        std::vector<uint32_t> dependents = {};
+        uint32_t dependencyCount = 0;
+    };
+
+    struct PooledAllocator
+    {
+        uint32_t allocator;
+        // signaled after the last submission that recorded into the allocator
+        uint64_t fenceValue;
+    };
+
+    // Kahn's algorithm, jobs in the order they become ready
+    std::vector<uint32_t> sortJobs() const;
+    // an allocator the GPU is done with, or a new one. it is marked as used until fenceValue
+    uint32_t acquireAllocator(uint64_t fenceValue);
+    // allocators of a submission that failed before executing, reusable by the next one
+    void releaseAllocators(const std::vector<uint32_t>& allocators);
+    // allocators[w] is the allocator of worker w
+    void record(const std::vector<uint32_t>& allocators);
+
+    CommandListDevice& m_device;
+    FrameQueue& m_queue;
+    uint32_t m_workerCount;
+
+    std::vector<Job> m_jobs;
+    std::vector<PooledAllocator> m_allocators;
+    // job i of a submission records into m_commandLists[i]
+    std::vector<uint32_t> m_commandLists;
+    std::vector<uint32_t> m_submissionOrder;
+
+    CommandRecorderStats m_stats;
+};
+
+#endif //COMMANDRECORDER_H
@@ -0,0 +1,211 @@
+#include "CpuBlas.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+CpuBlas::CpuBlas(std::span<const CpuGeometryDesc> geometries, const CpuBvhBuildOptions& options)
+    : m_options(options)
+    , m_updatePolicy(options.updatePolicy)
+{
+    build(geometries);
+}
+
+CpuBlas::CpuBlas(std::span<const CpuBvhNode> nodes, std::span<const CpuTriangle> triangles)
+    : m_nodes(nodes)
+    , m_triangles(triangles)
+{
+    m_buildStats.nodeCount = static_cast<uint32_t>(nodes.size());
+}
+
+void CpuBlas::build(std::span<const CpuGeometryDesc> geometries)
+{
+    size_t totalTriangles = 0;
+    for (const auto& geometry : geometries)
+    {
+        totalTriangles += geometry.triangleCount();
+    }
+
+    std::vector<CpuTriangle> triangles;
+    std::vector<CpuAabb> primBounds;
+    triangles.reserve(totalTriangles);
+    primBounds.reserve(totalTriangles);
+    for (uint32_t geometryIndex = 0; geometryIndex < geometries.size(); ++geometryIndex)
+    {
+        const CpuGeometryDesc& geometry = geometries[geometryIndex];
+        uint32_t triangleCount = geometry.triangleCount();
+        for (uint32_t primitiveIndex = 0; primitiveIndex < triangleCount; ++primitiveIndex)
+        {
+            CpuTriangle triangle = {};
+            triangle.primitiveIndex = primitiveIndex;
+            triangle.geometryIndex = geometryIndex;
+            geometry.triangle(primitiveIndex, triangle.v0, triangle.v1, triangle.v2);
+            triangles.push_back(triangle);
+
+            CpuAabb bounds;
+            bounds.grow(triangle.v0);
+            bounds.grow(triangle.v1);
+            bounds.grow(triangle.v2);
+            primBounds.push_back(bounds);
+        }
+    }
+
+    // only spatial splits look at the triangles themselves
+    std::vector<Float3> triangleVertices;
+    if (m_options.preference == CpuBvhBuildPreference::HighQuality)
+    {
+        triangleVertices.reserve(triangles.size() * 3);
+        for (const CpuTriangle& triangle : triangles)
+        {
+            triangleVertices.insert(triangleVertices.end(), {triangle.v0, triangle.v1, triangle.v2});
+        }
+    }
+
+    m_bvh = buildBvh(primBounds, m_options, m_buildStats, triangleVertices);
+    m_updatePolicy.built(m_buildStats.sahCost);
+
+    m_triangleStorage.clear();
+    m_triangleStorage.reserve(m_bvh.primIndices.size());
+    for (uint32_t prim : m_bvh.primIndices)
+    {
+        m_triangleStorage.push_back(triangles[prim]);
+    }
+
+    // leaves now index m_triangles directly
+    m_bvh.primIndices.clear();
+    m_bvh.primIndices.shrink_to_fit();
+
+    m_nodes = m_bvh.nodes;
+    m_triangles = m_triangleStorage;
+}
+
+bool CpuBlas::update(std::span<const CpuGeometryDesc> geometries)
+{
+    if (m_compressedBvh || m_triangles.data() != m_triangleStorage.data())
+    {
+        throw std::logic_error("Only an uncompressed BLAS built from geometries can be updated.");
+    }
+
+    // spatial splits duplicate triangles and clip them to their leaves, a refit cannot keep either
+    if (m_options.preference == CpuBvhBuildPreference::HighQuality)
+    {
+        build(geometries);
+        return true;
+    }
+
+    size_t totalTriangles = 0;
+    for (const auto& geometry : geometries)
+    {
+        totalTriangles += geometry.triangleCount();
+    }
+    if (totalTriangles != m_triangleStorage.size())
+    {
+        throw std::invalid_argument("BLAS update changes the triangle count.");
+    }
+
+    CpuBvhRefitter refitter(m_options);
+    refitter.refit(m_bvh.nodes, [&](uint32_t first, uint32_t count) {
+        CpuAabb bounds;
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            CpuTriangle& triangle = m_triangleStorage[i];
+            geometries[triangle.geometryIndex].triangle(triangle.primitiveIndex, triangle.v0, triangle.v1, triangle.v2);
+            bounds.grow(triangle.v0);
+            bounds.grow(triangle.v1);
+            bounds.grow(triangle.v2);
+        }
+        return bounds;
+    });
+    m_refitStats = refitter.stats();
+
+    if (!m_updatePolicy.updated(m_refitStats.sahCost))
+    {
+        return false;
+    }
+    build(geometries);
+    return true;
+}
+
+bool CpuBlas::intersect(
+    const CpuRay& ray,
+    CpuHit& hit,
+    CpuCullMode cull,
+    bool acceptFirstHit,
+    CpuTraversalStats* stats
+) const
+{
+    CpuRay clipped = ray;
+    clipped.tMax = std::min(ray.tMax, hit.t);
+
+    bool found = false;
+    auto leafFn = [&](uint32_t first, uint32_t count, float tMax) {
+        clipped.tMax = tMax;
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            const CpuTriangle& triangle = m_triangles[i];
+            float t;
+            Float2 barycentrics;
+            countTriangleTest(stats);
+            if (intersectTriangle(clipped, triangle.v0, triangle.v1, triangle.v2, t, barycentrics, cull)
+                && isCloserHit(t, hit.instanceIndex, triangle.geometryIndex, triangle.primitiveIndex, hit))
+            {
+                clipped.tMax = t;
+                hit.t = t;
+                hit.barycentrics = barycentrics;
+                hit.primitiveIndex = triangle.primitiveIndex;
+                hit.geometryIndex = triangle.geometryIndex;
+                found = true;
+                if (acceptFirstHit)
+                {
+                    return -1.0f;
+                }
+            }
+        }
+        return clipped.tMax;
+    };
+
+    if (m_compressedBvh)
+    {
+        m_compressedBvh->traverse(clipped, leafFn, stats);
+    }
+    else
+    {
+        traverseBvh(m_nodes, clipped, leafFn, stats);
+    }
+
+    return found;
+}
+
+CpuAabb CpuBlas::bounds() const
+{
+    if (m_compressedBvh)
+    {
+        return m_compressedBvh->bounds();
+    }
+    return m_nodes.empty() ? CpuAabb{} : m_nodes[0].bounds();
+}
+
+void CpuBlas::compress()
+{
+    if (m_compressedBvh)
+    {
+        return;
+    }
+
+    m_compressedBvh.emplace(m_nodes);
+    m_nodes = {};
+    m_bvh.nodes.clear();
+    m_bvh.nodes.shrink_to_fit();
+}
+
+size_t CpuBlas::buildScratchSize(uint32_t triangleCount)
+{
+    size_t perTriangle = sizeof(CpuTriangle) + sizeof(CpuAabb) + sizeof(Float3) + sizeof(uint32_t);
+    size_t nodeCount = triangleCount > 0 ? static_cast<size_t>(triangleCount) * 2 - 1 : 0;
+    return triangleCount * perTriangle + nodeCount * sizeof(CpuBvhNode);
+}
+
+size_t CpuBlas::memoryUsage() const
+{
+    size_t nodeMemory = m_compressedBvh ? m_compressedBvh->memoryUsage() : m_nodes.size() * sizeof(CpuBvhNode);
+    return nodeMemory + m_triangles.size() * sizeof(CpuTriangle);
+}
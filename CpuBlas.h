@@ -0,0 +1,125 @@
+#ifndef CPUBLAS_H
+#define CPUBLAS_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "AsUpdatePolicy.h"
+#include "CpuBvhBuilder.h"
+#include "CpuBvhRefitter.h"
+#include "CpuCompressedBvh.h"
+#include "CpuGeometry.h"
+
+struct CpuTriangle
+{
+    Float3 v0;
+    Float3 v1;
+    Float3 v2;
+    uint32_t primitiveIndex;
+    uint32_t geometryIndex;
+};
+
+// CPU counterpart of a D3D12 bottom-level acceleration structure over triangle geometries
+class CpuBlas
+{
+public:
+    explicit CpuBlas(std::span<const CpuGeometryDesc> geometries, const CpuBvhBuildOptions& options = {});
+
+    // prebuilt BVH and leaf-ordered triangles owned by the caller, e.g. a mapped scene file.
+    // nothing is copied, the storage has to outlive the BLAS
+    CpuBlas(std::span<const CpuBvhNode> nodes, std::span<const CpuTriangle> triangles);
+
+    // the views point into the owned vectors, which keep their storage when moved
+    CpuBlas(const CpuBlas&) = delete;
+    CpuBlas& operator=(const CpuBlas&) = delete;
+    CpuBlas(CpuBlas&&) = default;
+    CpuBlas& operator=(CpuBlas&&) = default;
+
+    // closest hit against hit.t, updates hit and returns true when a closer triangle was found. a triangle at
+    // exactly hit.t wins by isCloserHit() with hit.instanceIndex as its instance.
+    // with acceptFirstHit the search ends at the first accepted triangle. stats, when given, receives the
+    // BVH nodes and triangles visited (see CpuTraversalStats.h)
+    bool intersect(
+        const CpuRay& ray,
+        CpuHit& hit,
+        CpuCullMode cull = CpuCullMode::None,
+        bool acceptFirstHit = false,
+        CpuTraversalStats* stats = nullptr
+    ) const;
+
+    CpuAabb bounds() const;
+
+    // PERFORM_UPDATE: geometries are the ones the BLAS was built from, with moved vertices. refits the BVH in
+    // parallel and rebuilds it instead once the refit SAH cost passes the update policy, returns true then.
+    // a HighQuality BLAS is always rebuilt. a compressed BLAS or one over external data cannot be updated
+    bool update(std::span<const CpuGeometryDesc> geometries);
+
+    const AsUpdatePolicy& updatePolicy() const
+    {
+        return m_updatePolicy;
+    }
+
+    // stats of the last refit
+    const CpuBvhRefitStats& refitStats() const
+    {
+        return m_refitStats;
+    }
+
+    // replaces the BVH with its quantized form and frees the original nodes. traversal then visits a few
+    // more nodes and decodes boxes on the way, and nodes() is empty, so only the scalar kernel can trace it
+    void compress();
+
+    bool isCompressed() const
+    {
+        return m_compressedBvh.has_value();
+    }
+
+    uint32_t triangleCount() const
+    {
+        return static_cast<uint32_t>(m_triangles.size());
+    }
+
+    size_t memoryUsage() const;
+
+    // peak temporary memory of building a BLAS over triangleCount triangles: the staged triangles and
+    // their bounds, the builder's centroids and indices, and the node array before it is trimmed
+    static size_t buildScratchSize(uint32_t triangleCount);
+
+    // empty once compressed
+    std::span<const CpuBvhNode> nodes() const
+    {
+        return m_nodes;
+    }
+
+    const CpuBvhBuildStats& buildStats() const
+    {
+        return m_buildStats;
+    }
+
+    // stored in BVH leaf order so a leaf reads one contiguous range
+    std::span<const CpuTriangle> triangles() const
+    {
+        return m_triangles;
+    }
+
+private:
+    void build(std::span<const CpuGeometryDesc> geometries);
+
+    CpuBvhBuildOptions m_options;
+    AsUpdatePolicy m_updatePolicy;
+    CpuBvhRefitStats m_refitStats;
+
+    // owned storage, empty for a BLAS over external data
+    CpuBvh m_bvh;
+    std::vector<CpuTriangle> m_triangleStorage;
+
+    std::optional<CpuCompressedBvh> m_compressedBvh;
+
+    CpuBvhBuildStats m_buildStats;
+    std::span<const CpuBvhNode> m_nodes;
+    std::span<const CpuTriangle> m_triangles;
+};
+
+#endif //CPUBLAS_H
@@ -0,0 +1,228 @@
+#ifndef CPUBVH_H
+#define CPUBVH_H
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "CpuMath.h"
+#include "CpuRay.h"
+#include "CpuTraversalStats.h"
+
+struct CpuAabb
+{
+    Float3 min = {
+        std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::infinity()
+    };
+    Float3 max = {
+        -std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity()
+    };
+
+    void grow(const Float3& p)
+    {
+        min = ::min(min, p);
+        max = ::max(max, p);
+    }
+
+    void grow(const CpuAabb& other)
+    {
+        min = ::min(min, other.min);
+        max = ::max(max, other.max);
+    }
+
+    bool valid() const
+    {
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+
+    Float3 centroid() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    float surfaceArea() const
+    {
+        if (!valid())
+        {
+            return 0.0f;
+        }
+        Float3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+// 32 bytes, two nodes per cache line. children of an inner node are stored as an adjacent pair
+struct CpuBvhNode
+{
+    Float3 boundsMin;
+    uint32_t leftOrFirst; // inner: index of the left child (right child is leftOrFirst + 1), leaf: first primitive
+    Float3 boundsMax;
+    uint32_t primCount; // 0 for inner nodes
+
+    bool isLeaf() const
+    {
+        return primCount != 0;
+    }
+
+    CpuAabb bounds() const
+    {
+        return {boundsMin, boundsMax};
+    }
+};
+static_assert(sizeof(CpuBvhNode) == 32);
+
+// slab test, returns the entry distance or +inf on a miss
+inline float intersectAabb(
+    const Float3& boundsMin,
+    const Float3& boundsMax,
+    const Float3& origin,
+    const Float3& invDirection,
+    float tMin,
+    float tMax
+)
+{
+    Float3 t0 = (boundsMin - origin) * invDirection;
+    Float3 t1 = (boundsMax - origin) * invDirection;
+
+    // accumulator first so a NaN from 0 * inf is ignored
+    float tNear = std::max(tMin, std::min(t0.x, t1.x));
+    tNear = std::max(tNear, std::min(t0.y, t1.y));
+    tNear = std::max(tNear, std::min(t0.z, t1.z));
+    float tFar = std::min(tMax, std::max(t0.x, t1.x));
+    tFar = std::min(tFar, std::max(t0.y, t1.y));
+    tFar = std::min(tFar, std::max(t0.z, t1.z));
+
+    return tNear <= tFar ? tNear : std::numeric_limits<float>::infinity();
+}
+
+inline Float3 reciprocal(const Float3& v)
+{
+    return {1.0f / v.x, 1.0f / v.y, 1.0f / v.z};
+}
+
+struct CpuBvhBuildStats
+{
+    double buildTimeMs = 0.0;
+    uint32_t nodeCount = 0;
+    uint32_t leafCount = 0;
+    uint32_t maxDepth = 0;
+    // leaf references, more than the primitive count once spatial splits duplicate primitives
+    uint32_t referenceCount = 0;
+    uint32_t spatialSplitCount = 0;
+    float sahCost = 0.0f;
+};
+
+// builders never go deeper, so a fixed traversal stack is enough
+constexpr uint32_t CPU_BVH_MAX_DEPTH = 64;
+
+// calls leafFn(firstPrim, primCount, tMax) for every leaf the ray reaches in front-to-back order,
+// leafFn returns the (possibly shortened) tMax, or a negative value to stop.
+// nodes may live anywhere, e.g. in a mapped scene file. stats counts the nodes and the stack depth
+template <typename LeafFn>
+void traverseBvh(std::span<const CpuBvhNode> nodes, const CpuRay& ray, LeafFn&& leafFn, CpuTraversalStats* stats = nullptr)
+{
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    Float3 invDirection = reciprocal(ray.direction);
+    float tMax = ray.tMax;
+    if (intersectAabb(nodes[0].boundsMin, nodes[0].boundsMax, ray.origin, invDirection, ray.tMin, tMax)
+        == std::numeric_limits<float>::infinity())
+    {
+        return;
+    }
+
+    struct StackEntry
+    {
+        uint32_t nodeIndex;
+        float tEntry;
+    };
+    StackEntry stack[CPU_BVH_MAX_DEPTH];
+    uint32_t stackSize = 0;
+    uint32_t nodeIndex = 0;
+
+    while (true)
+    {
+        const CpuBvhNode& node = nodes[nodeIndex];
+        countNodeVisit(stats);
+        if (node.isLeaf())
+        {
+            tMax = leafFn(node.leftOrFirst, node.primCount, tMax);
+            if (tMax < 0.0f)
+            {
+                return;
+            }
+        }
+        else
+        {
+            const CpuBvhNode& left = nodes[node.leftOrFirst];
+            const CpuBvhNode& right = nodes[node.leftOrFirst + 1];
+            float tLeft = intersectAabb(left.boundsMin, left.boundsMax, ray.origin, invDirection, ray.tMin, tMax);
+            float tRight = intersectAabb(right.boundsMin, right.boundsMax, ray.origin, invDirection, ray.tMin, tMax);
+
+            bool hitLeft = tLeft != std::numeric_limits<float>::infinity();
+            bool hitRight = tRight != std::numeric_limits<float>::infinity();
+            if (hitLeft && hitRight)
+            {
+                if (tLeft <= tRight)
+                {
+                    stack[stackSize++] = {node.leftOrFirst + 1, tRight};
+                    nodeIndex = node.leftOrFirst;
+                }
+                else
+                {
+                    stack[stackSize++] = {node.leftOrFirst, tLeft};
+                    nodeIndex = node.leftOrFirst + 1;
+                }
+                countStackDepth(stats, stackSize);
+                continue;
+            }
+            if (hitLeft || hitRight)
+            {
+                nodeIndex = hitLeft ? node.leftOrFirst : node.leftOrFirst + 1;
+                continue;
+            }
+        }
+
+        // pop, skipping subtrees that are now behind the closest hit
+        do
+        {
+            if (stackSize == 0)
+            {
+                return;
+            }
+            --stackSize;
+        }
+        while (stack[stackSize].tEntry > tMax);
+        nodeIndex = stack[stackSize].nodeIndex;
+    }
+}
+
+class CpuBvh
+{
+public:
+    static constexpr uint32_t MAX_DEPTH = CPU_BVH_MAX_DEPTH;
+
+    std::vector<CpuBvhNode> nodes;
+    std::vector<uint32_t> primIndices; // leaf ranges index into this, which indexes the builder input
+
+    // expected cost of a random ray that hits the root, relative to one primitive test
+    float sahCost(float traversalCost = 1.0f, float intersectionCost = 1.0f) const;
+
+    // see traverseBvh
+    template <typename LeafFn>
+    void traverse(const CpuRay& ray, LeafFn&& leafFn, CpuTraversalStats* stats = nullptr) const
+    {
+        traverseBvh(nodes, ray, std::forward<LeafFn>(leafFn), stats);
+    }
+};
+
+#endif //CPUBVH_H
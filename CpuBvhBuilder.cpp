@@ -0,0 +1,280 @@
+#include "CpuBvhBuilder.h"
+
+#include "CpuLbvhBuilder.h"
+#include "CpuSbvhBuilder.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+constexpr uint32_t MAX_BIN_COUNT = 64;
+
+struct Bin
+{
+    CpuAabb bounds;
+    uint32_t count = 0;
+};
+
+void atomicMax(std::atomic<uint32_t>& target, uint32_t value)
+{
+    uint32_t current = target.load(std::memory_order_relaxed);
+    while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+}
+
+float CpuBvh::sahCost(float traversalCost, float intersectionCost) const
+{
+    if (nodes.empty())
+    {
+        return 0.0f;
+    }
+
+    float rootArea = nodes[0].bounds().surfaceArea();
+    if (rootArea <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    float cost = 0.0f;
+    for (const auto& node : nodes)
+    {
+        float area = node.bounds().surfaceArea();
+        cost += node.isLeaf() ? area * intersectionCost * node.primCount : area * traversalCost;
+    }
+    return cost / rootArea;
+}
+
+CpuBvhBuilder::CpuBvhBuilder(const CpuBvhBuildOptions& options)
+    : m_options(options)
+{
+    m_options.maxLeafSize = std::max(1u, m_options.maxLeafSize);
+    m_options.binCount = std::clamp(m_options.binCount, 2u, MAX_BIN_COUNT);
+    if (m_options.threadCount == 0)
+    {
+        m_options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+CpuBvh CpuBvhBuilder::build(std::span<const CpuAabb> primBounds)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    m_primBounds = primBounds;
+    uint32_t primCount = static_cast<uint32_t>(primBounds.size());
+
+    m_centroids.resize(primCount);
+    m_primIndices.resize(primCount);
+    for (uint32_t i = 0; i < primCount; ++i)
+    {
+        m_centroids[i] = primBounds[i].centroid();
+    }
+    std::iota(m_primIndices.begin(), m_primIndices.end(), 0u);
+
+    m_nodeCount = 0;
+    m_leafCount = 0;
+    m_maxDepth = 0;
+    m_activeTasks = 0;
+
+    if (primCount > 0)
+    {
+        // a binary tree with single-primitive leaves is the upper bound
+        m_nodes.resize(primCount * 2 - 1);
+        m_nodeCount = 1;
+        buildNode(0, 0, primCount, 0);
+    }
+
+    CpuBvh bvh;
+    m_nodes.resize(m_nodeCount);
+    bvh.nodes = std::move(m_nodes);
+    bvh.primIndices = std::move(m_primIndices);
+    m_centroids.clear();
+    m_centroids.shrink_to_fit();
+    m_primBounds = {};
+
+    m_stats.nodeCount = static_cast<uint32_t>(bvh.nodes.size());
+    m_stats.leafCount = m_leafCount;
+    m_stats.maxDepth = m_maxDepth;
+    m_stats.referenceCount = static_cast<uint32_t>(bvh.primIndices.size());
+    m_stats.sahCost = bvh.sahCost(m_options.traversalCost, m_options.intersectionCost);
+    m_stats.buildTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return bvh;
+}
+
+void CpuBvhBuilder::makeLeaf(CpuBvhNode& node, uint32_t begin, uint32_t end)
+{
+    node.leftOrFirst = begin;
+    node.primCount = end - begin;
+    m_leafCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CpuBvhBuilder::buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth)
+{
+    CpuBvhNode& node = m_nodes[nodeIndex];
+    atomicMax(m_maxDepth, depth);
+
+    CpuAabb bounds;
+    CpuAabb centroidBounds;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        bounds.grow(m_primBounds[m_primIndices[i]]);
+        centroidBounds.grow(m_centroids[m_primIndices[i]]);
+    }
+    node.boundsMin = bounds.min;
+    node.boundsMax = bounds.max;
+
+    uint32_t count = end - begin;
+    if (count <= 1 || depth + 1 >= CpuBvh::MAX_DEPTH)
+    {
+        makeLeaf(node, begin, end);
+        return;
+    }
+
+    // find the cheapest bin boundary over all three axes
+    float bestCost = std::numeric_limits<float>::infinity();
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    float parentArea = bounds.surfaceArea();
+    uint32_t binCount = m_options.binCount;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+
+        std::array<Bin, MAX_BIN_COUNT> bins = {};
+        float scale = static_cast<float>(binCount) / extent;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            uint32_t prim = m_primIndices[i];
+            uint32_t binIndex = std::min(
+                binCount - 1,
+                static_cast<uint32_t>((m_centroids[prim][axis] - centroidBounds.min[axis]) * scale)
+            );
+            bins[binIndex].count++;
+            bins[binIndex].bounds.grow(m_primBounds[prim]);
+        }
+
+        std::array<float, MAX_BIN_COUNT> rightArea = {};
+        std::array<uint32_t, MAX_BIN_COUNT> rightCount = {};
+        CpuAabb accumulated;
+        uint32_t accumulatedCount = 0;
+        for (uint32_t i = binCount - 1; i > 0; --i)
+        {
+            accumulated.grow(bins[i].bounds);
+            accumulatedCount += bins[i].count;
+            rightArea[i] = accumulated.surfaceArea();
+            rightCount[i] = accumulatedCount;
+        }
+
+        accumulated = {};
+        accumulatedCount = 0;
+        for (uint32_t i = 1; i < binCount; ++i)
+        {
+            accumulated.grow(bins[i - 1].bounds);
+            accumulatedCount += bins[i - 1].count;
+            if (accumulatedCount == 0 || rightCount[i] == 0)
+            {
+                continue;
+            }
+
+            float cost = m_options.traversalCost + m_options.intersectionCost
+                * (accumulated.surfaceArea() * accumulatedCount + rightArea[i] * rightCount[i]) / parentArea;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    float leafCost = m_options.intersectionCost * count;
+    if (count <= m_options.maxLeafSize && (bestAxis < 0 || bestCost >= leafCost))
+    {
+        makeLeaf(node, begin, end);
+        return;
+    }
+
+    // without a usable axis every centroid coincides and the primitives are split in index order
+    uint32_t mid = begin + count / 2;
+    if (bestAxis >= 0)
+    {
+        float scale = static_cast<float>(binCount) / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+        float axisMin = centroidBounds.min[bestAxis];
+        auto first = m_primIndices.begin() + begin;
+        auto split = std::partition(first, m_primIndices.begin() + end, [&](uint32_t prim) {
+            uint32_t binIndex = std::min(binCount - 1, static_cast<uint32_t>((m_centroids[prim][bestAxis] - axisMin) * scale));
+            return binIndex < bestSplit;
+        });
+        mid = static_cast<uint32_t>(split - m_primIndices.begin());
+        if (mid == begin || mid == end)
+        {
+            mid = begin + count / 2;
+        }
+    }
+
+    uint32_t leftIndex = m_nodeCount.fetch_add(2, std::memory_order_relaxed);
+    node.leftOrFirst = leftIndex;
+    node.primCount = 0;
+
+    bool spawn = false;
+    if (count >= m_options.parallelThreshold)
+    {
+        spawn = m_activeTasks.fetch_add(1, std::memory_order_relaxed) + 1 < m_options.threadCount;
+        if (!spawn)
+        {
+            m_activeTasks.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (spawn)
+    {
+        std::thread worker(&CpuBvhBuilder::buildNode, this, leftIndex, begin, mid, depth + 1);
+        buildNode(leftIndex + 1, mid, end, depth + 1);
+        worker.join();
+        m_activeTasks.fetch_sub(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        buildNode(leftIndex, begin, mid, depth + 1);
+        buildNode(leftIndex + 1, mid, end, depth + 1);
+    }
+}
+
+CpuBvh buildBvh(
+    std::span<const CpuAabb> primBounds,
+    const CpuBvhBuildOptions& options,
+    CpuBvhBuildStats& stats,
+    std::span<const Float3> triangleVertices
+)
+{
+    if (options.preference == CpuBvhBuildPreference::FastBuild)
+    {
+        CpuLbvhBuilder builder(options);
+        CpuBvh bvh = builder.build(primBounds);
+        stats = builder.stats();
+        return bvh;
+    }
+    if (options.preference == CpuBvhBuildPreference::HighQuality && !triangleVertices.empty())
+    {
+        CpuSbvhBuilder builder(options);
+        CpuBvh bvh = builder.build(triangleVertices);
+        stats = builder.stats();
+        return bvh;
+    }
+
+    CpuBvhBuilder builder(options);
+    CpuBvh bvh = builder.build(primBounds);
+    stats = builder.stats();
+    return bvh;
+}
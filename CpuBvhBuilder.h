@@ -0,0 +1,78 @@
+#ifndef CPUBVHBUILDER_H
+#define CPUBVHBUILDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "AsUpdatePolicy.h"
+#include "CpuBvh.h"
+
+// D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE / PREFER_FAST_BUILD
+enum class CpuBvhBuildPreference
+{
+    FastTrace, // binned SAH, CpuBvhBuilder
+    FastBuild, // linear BVH over Morton codes, CpuLbvhBuilder
+    HighQuality // binned SAH with spatial splits, CpuSbvhBuilder. for static geometry built once, offline
+};
+
+struct CpuBvhBuildOptions
+{
+    uint32_t maxLeafSize = 4;
+    uint32_t binCount = 16;
+    float traversalCost = 1.0f;
+    float intersectionCost = 1.0f;
+    uint32_t parallelThreshold = 4096; // subtrees with fewer primitives are built on the current thread
+    uint32_t threadCount = 0; // 0 = hardware concurrency
+    CpuBvhBuildPreference preference = CpuBvhBuildPreference::FastTrace;
+    uint32_t mortonBits = 30; // FastBuild only: 30 (uint32 keys) or 63 (uint64 keys, for primitives crowded into few cells)
+    // HighQuality only: references may grow to this multiple of the primitive count
+    float spatialSplitGrowth = 1.3f;
+    // HighQuality only: spatial splits are tried where the object split children overlap by more than this
+    // fraction of the root surface area
+    float spatialSplitOverlap = 1e-5f;
+    AsUpdatePolicyOptions updatePolicy = {}; // when update() refits and when it rebuilds
+};
+
+// binned surface-area-heuristic builder (Wald 2007) over arbitrary primitive bounds
+class CpuBvhBuilder
+{
+public:
+    explicit CpuBvhBuilder(const CpuBvhBuildOptions& options = {});
+
+    CpuBvh build(std::span<const CpuAabb> primBounds);
+
+    const CpuBvhBuildStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    void buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth);
+    void makeLeaf(CpuBvhNode& node, uint32_t begin, uint32_t end);
+
+    CpuBvhBuildOptions m_options;
+    CpuBvhBuildStats m_stats;
+
+    std::span<const CpuAabb> m_primBounds;
+    std::vector<Float3> m_centroids;
+    std::vector<uint32_t> m_primIndices;
+    std::vector<CpuBvhNode> m_nodes;
+
+    std::atomic<uint32_t> m_nodeCount = 0;
+    std::atomic<uint32_t> m_leafCount = 0;
+    std::atomic<uint32_t> m_maxDepth = 0;
+    std::atomic<uint32_t> m_activeTasks = 0;
+};
+
+// builds with the builder options.preference selects, stats receives that builder's stats.
+// triangleVertices holds v0, v1, v2 of every primitive for HighQuality, without them it builds like FastTrace
+CpuBvh buildBvh(
+    std::span<const CpuAabb> primBounds,
+    const CpuBvhBuildOptions& options,
+    CpuBvhBuildStats& stats,
+    std::span<const Float3> triangleVertices = {}
+);
+
+#endif //CPUBVHBUILDER_H
@@ -0,0 +1,136 @@
+#include "CpuBvhRefitter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+// subtrees per worker, so one slow subtree does not leave the other workers idle
+constexpr uint32_t SUBTREES_PER_THREAD = 4;
+
+void setBounds(CpuBvhNode& node, const CpuAabb& bounds)
+{
+    node.boundsMin = bounds.min;
+    node.boundsMax = bounds.max;
+}
+}
+
+CpuBvhRefitter::CpuBvhRefitter(const CpuBvhBuildOptions& options)
+    : m_options(options)
+{
+    if (m_options.threadCount == 0)
+    {
+        m_options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+void CpuBvhRefitter::refit(std::span<CpuBvhNode> nodes, const LeafBoundsFn& leafBounds)
+{
+    auto start = std::chrono::steady_clock::now();
+    m_stats = {};
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    double cost = 0.0;
+    if (nodes.size() < m_options.parallelThreshold || m_options.threadCount == 1)
+    {
+        refitNode(nodes, 0, leafBounds, cost);
+    }
+    else
+    {
+        // expand the cut level by level until there are enough subtrees, parents stay above their children
+        std::vector<uint32_t> topNodes;
+        std::vector<uint32_t> subtrees = {0};
+        uint32_t targetCount = m_options.threadCount * SUBTREES_PER_THREAD;
+        while (subtrees.size() < targetCount)
+        {
+            std::vector<uint32_t> next;
+            for (uint32_t nodeIndex : subtrees)
+            {
+                if (nodes[nodeIndex].isLeaf())
+                {
+                    next.push_back(nodeIndex);
+                    continue;
+                }
+                topNodes.push_back(nodeIndex);
+                next.push_back(nodes[nodeIndex].leftOrFirst);
+                next.push_back(nodes[nodeIndex].leftOrFirst + 1);
+            }
+            if (next.size() == subtrees.size())
+            {
+                break;
+            }
+            subtrees = std::move(next);
+        }
+
+        // costs are summed in subtree order afterwards, so the result does not depend on scheduling
+        std::vector<double> subtreeCosts(subtrees.size(), 0.0);
+        std::atomic<uint32_t> nextSubtree = 0;
+        auto worker = [&] {
+            for (uint32_t i = nextSubtree.fetch_add(1); i < subtrees.size(); i = nextSubtree.fetch_add(1))
+            {
+                refitNode(nodes, subtrees[i], leafBounds, subtreeCosts[i]);
+            }
+        };
+
+        uint32_t threadCount = std::min<uint32_t>(m_options.threadCount, static_cast<uint32_t>(subtrees.size()));
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for (uint32_t i = 1; i < threadCount; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (double subtreeCost : subtreeCosts)
+        {
+            cost += subtreeCost;
+        }
+        for (auto it = topNodes.rbegin(); it != topNodes.rend(); ++it)
+        {
+            CpuBvhNode& node = nodes[*it];
+            CpuAabb bounds = nodes[node.leftOrFirst].bounds();
+            bounds.grow(nodes[node.leftOrFirst + 1].bounds());
+            setBounds(node, bounds);
+            cost += bounds.surfaceArea() * m_options.traversalCost;
+        }
+        m_stats.subtreeCount = static_cast<uint32_t>(subtrees.size());
+    }
+
+    // same normalization as CpuBvh::sahCost
+    float rootArea = nodes[0].bounds().surfaceArea();
+    m_stats.sahCost = rootArea > 0.0f ? static_cast<float>(cost / rootArea) : 0.0f;
+    m_stats.refitTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+CpuAabb CpuBvhRefitter::refitNode(
+    std::span<CpuBvhNode> nodes,
+    uint32_t nodeIndex,
+    const LeafBoundsFn& leafBounds,
+    double& cost
+) const
+{
+    CpuBvhNode& node = nodes[nodeIndex];
+    CpuAabb bounds;
+    if (node.isLeaf())
+    {
+        bounds = leafBounds(node.leftOrFirst, node.primCount);
+        cost += bounds.surfaceArea() * m_options.intersectionCost * node.primCount;
+    }
+    else
+    {
+        bounds = refitNode(nodes, node.leftOrFirst, leafBounds, cost);
+        bounds.grow(refitNode(nodes, node.leftOrFirst + 1, leafBounds, cost));
+        cost += bounds.surfaceArea() * m_options.traversalCost;
+    }
+    setBounds(node, bounds);
+    return bounds;
+}
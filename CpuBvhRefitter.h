@@ -0,0 +1,47 @@
+#ifndef CPUBVHREFITTER_H
+#define CPUBVHREFITTER_H
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "CpuBvhBuilder.h"
+
+struct CpuBvhRefitStats
+{
+    double refitTimeMs = 0.0;
+    // subtrees refit on worker threads, 0 when the BVH was small enough to refit on the calling thread
+    uint32_t subtreeCount = 0;
+    float sahCost = 0.0f;
+};
+
+// refits a BVH in place after its primitives moved: topology and leaf ranges stay, every box is recomputed
+// bottom-up. subtrees below a cut near the root are independent and refit in parallel, the few nodes above
+// the cut are refit afterwards on the calling thread. the SAH cost is accumulated on the way
+class CpuBvhRefitter
+{
+public:
+    // returns the bounds of the primitives [first, first + count) of a leaf after they moved, and may
+    // update whatever the leaf references. called from several threads at once for different leaves
+    using LeafBoundsFn = std::function<CpuAabb(uint32_t first, uint32_t count)>;
+
+    // uses traversalCost, intersectionCost, parallelThreshold and threadCount
+    explicit CpuBvhRefitter(const CpuBvhBuildOptions& options = {});
+
+    void refit(std::span<CpuBvhNode> nodes, const LeafBoundsFn& leafBounds);
+
+    const CpuBvhRefitStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    // refits the subtree at nodeIndex, adds the unnormalized SAH cost of its nodes to cost
+    CpuAabb refitNode(std::span<CpuBvhNode> nodes, uint32_t nodeIndex, const LeafBoundsFn& leafBounds, double& cost) const;
+
+    CpuBvhBuildOptions m_options;
+    CpuBvhRefitStats m_stats;
+};
+
+#endif //CPUBVHREFITTER_H
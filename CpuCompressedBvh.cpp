@@ -0,0 +1,93 @@
+#include "CpuCompressedBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+// smallest grid step whose decoded value is still <= value
+uint8_t quantizeMin(float parentMin, float parentMax, float value)
+{
+    float extent = parentMax - parentMin;
+    float scaled = extent > 0.0f ? (value - parentMin) / extent * 255.0f : 0.0f;
+    int q = std::clamp(static_cast<int>(std::floor(scaled)), 0, 255);
+    while (q > 0 && dequantize(parentMin, parentMax, static_cast<uint8_t>(q)) > value)
+    {
+        --q;
+    }
+    return static_cast<uint8_t>(q);
+}
+
+// largest grid step whose decoded value is still >= value
+uint8_t quantizeMax(float parentMin, float parentMax, float value)
+{
+    float extent = parentMax - parentMin;
+    float scaled = extent > 0.0f ? (value - parentMin) / extent * 255.0f : 0.0f;
+    int q = std::clamp(static_cast<int>(std::ceil(scaled)), 0, 255);
+    while (q < 255 && dequantize(parentMin, parentMax, static_cast<uint8_t>(q)) < value)
+    {
+        ++q;
+    }
+    return static_cast<uint8_t>(q);
+}
+
+void encodeNode(
+    std::span<const CpuBvhNode> nodes,
+    std::vector<CpuCompressedBvhNode>& compressed,
+    uint32_t nodeIndex,
+    const CpuAabb& decodedBounds
+)
+{
+    const CpuBvhNode& node = nodes[nodeIndex];
+    if (node.isLeaf())
+    {
+        return;
+    }
+
+    for (uint32_t child = node.leftOrFirst; child <= node.leftOrFirst + 1; ++child)
+    {
+        const CpuBvhNode& source = nodes[child];
+        CpuCompressedBvhNode& target = compressed[child];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            target.quantizedMin[axis] = quantizeMin(decodedBounds.min[axis], decodedBounds.max[axis], source.boundsMin[axis]);
+            target.quantizedMax[axis] = quantizeMax(decodedBounds.min[axis], decodedBounds.max[axis], source.boundsMax[axis]);
+        }
+        if (source.primCount > UINT16_MAX)
+        {
+            throw std::invalid_argument("BVH leaf too large to compress.");
+        }
+        target.primCount = static_cast<uint16_t>(source.primCount);
+        target.leftOrFirst = source.leftOrFirst;
+
+        // children are quantized against what traversal decodes, not the exact box
+        encodeNode(nodes, compressed, child, decodeBounds(decodedBounds, target));
+    }
+}
+}
+
+CpuCompressedBvh::CpuCompressedBvh(std::span<const CpuBvhNode> nodes)
+    : m_nodes(nodes.size())
+{
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    m_rootBounds = nodes[0].bounds();
+    CpuCompressedBvhNode& root = m_nodes[0];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        root.quantizedMin[axis] = 0;
+        root.quantizedMax[axis] = 255;
+    }
+    if (nodes[0].primCount > UINT16_MAX)
+    {
+        throw std::invalid_argument("BVH leaf too large to compress.");
+    }
+    root.primCount = static_cast<uint16_t>(nodes[0].primCount);
+    root.leftOrFirst = nodes[0].leftOrFirst;
+
+    encodeNode(nodes, m_nodes, 0, m_rootBounds);
+}
@@ -0,0 +1,164 @@
+#ifndef CPUCOMPRESSEDBVH_H
+#define CPUCOMPRESSEDBVH_H
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "CpuBvh.h"
+
+// 12 bytes instead of the 32 of CpuBvhNode. the box is stored as 8-bit offsets on a 255-step grid over
+// the parent's decoded box, rounded outwards so the decoded box always contains the original one
+struct CpuCompressedBvhNode
+{
+    uint8_t quantizedMin[3];
+    uint8_t quantizedMax[3];
+    uint16_t primCount; // 0 for inner nodes
+    uint32_t leftOrFirst; // same meaning as in CpuBvhNode
+};
+static_assert(sizeof(CpuCompressedBvhNode) == 12);
+
+inline float dequantize(float parentMin, float parentMax, uint8_t q)
+{
+    // the top step is the parent bound itself, so rounding in the scale cannot shrink a box
+    return q == 255 ? parentMax : parentMin + static_cast<float>(q) * ((parentMax - parentMin) * (1.0f / 255.0f));
+}
+
+inline CpuAabb decodeBounds(const CpuAabb& parent, const CpuCompressedBvhNode& node)
+{
+    return {
+        {
+            dequantize(parent.min.x, parent.max.x, node.quantizedMin[0]),
+            dequantize(parent.min.y, parent.max.y, node.quantizedMin[1]),
+            dequantize(parent.min.z, parent.max.z, node.quantizedMin[2])
+        },
+        {
+            dequantize(parent.min.x, parent.max.x, node.quantizedMax[0]),
+            dequantize(parent.min.y, parent.max.y, node.quantizedMax[1]),
+            dequantize(parent.min.z, parent.max.z, node.quantizedMax[2])
+        }
+    };
+}
+
+// quantized copy of a CpuBvh with the same topology and leaf ranges, so it traverses the same triangles.
+// decoded boxes are slightly larger than the originals, which costs some extra node visits
+class CpuCompressedBvh
+{
+public:
+    explicit CpuCompressedBvh(std::span<const CpuBvhNode> nodes);
+
+    // same contract as traverseBvh
+    template <typename LeafFn>
+    void traverse(const CpuRay& ray, LeafFn&& leafFn, CpuTraversalStats* stats = nullptr) const;
+
+    CpuAabb bounds() const
+    {
+        return m_rootBounds;
+    }
+
+    uint32_t nodeCount() const
+    {
+        return static_cast<uint32_t>(m_nodes.size());
+    }
+
+    size_t memoryUsage() const
+    {
+        return m_nodes.size() * sizeof(CpuCompressedBvhNode);
+    }
+
+private:
+    CpuAabb m_rootBounds;
+    std::vector<CpuCompressedBvhNode> m_nodes;
+};
+
+template <typename LeafFn>
+void CpuCompressedBvh::traverse(const CpuRay& ray, LeafFn&& leafFn, CpuTraversalStats* stats) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    Float3 invDirection = reciprocal(ray.direction);
+    float tMax = ray.tMax;
+    if (intersectAabb(m_rootBounds.min, m_rootBounds.max, ray.origin, invDirection, ray.tMin, tMax)
+        == std::numeric_limits<float>::infinity())
+    {
+        return;
+    }
+
+    // boxes are decoded top-down, so every stack entry carries the decoded box of its node
+    struct StackEntry
+    {
+        uint32_t nodeIndex;
+        float tEntry;
+        CpuAabb bounds;
+    };
+    StackEntry stack[CPU_BVH_MAX_DEPTH];
+    uint32_t stackSize = 0;
+    uint32_t nodeIndex = 0;
+    CpuAabb bounds = m_rootBounds;
+
+    while (true)
+    {
+        const CpuCompressedBvhNode& node = m_nodes[nodeIndex];
+        countNodeVisit(stats);
+        if (node.primCount != 0)
+        {
+            tMax = leafFn(node.leftOrFirst, node.primCount, tMax);
+            if (tMax < 0.0f)
+            {
+                return;
+            }
+        }
+        else
+        {
+            CpuAabb leftBounds = decodeBounds(bounds, m_nodes[node.leftOrFirst]);
+            CpuAabb rightBounds = decodeBounds(bounds, m_nodes[node.leftOrFirst + 1]);
+            float tLeft = intersectAabb(leftBounds.min, leftBounds.max, ray.origin, invDirection, ray.tMin, tMax);
+            float tRight = intersectAabb(rightBounds.min, rightBounds.max, ray.origin, invDirection, ray.tMin, tMax);
+
+            bool hitLeft = tLeft != std::numeric_limits<float>::infinity();
+            bool hitRight = tRight != std::numeric_limits<float>::infinity();
+            if (hitLeft && hitRight)
+            {
+                if (tLeft <= tRight)
+                {
+                    stack[stackSize++] = {node.leftOrFirst + 1, tRight, rightBounds};
+                    nodeIndex = node.leftOrFirst;
+                    bounds = leftBounds;
+                }
+                else
+                {
+                    stack[stackSize++] = {node.leftOrFirst, tLeft, leftBounds};
+                    nodeIndex = node.leftOrFirst + 1;
+                    bounds = rightBounds;
+                }
+                countStackDepth(stats, stackSize);
+                continue;
+            }
+            if (hitLeft || hitRight)
+            {
+                nodeIndex = hitLeft ? node.leftOrFirst : node.leftOrFirst + 1;
+                bounds = hitLeft ? leftBounds : rightBounds;
+                continue;
+            }
+        }
+
+        // pop, skipping subtrees that are now behind the closest hit
+        do
+        {
+            if (stackSize == 0)
+            {
+                return;
+            }
+            --stackSize;
+        }
+        while (stack[stackSize].tEntry > tMax);
+        nodeIndex = stack[stackSize].nodeIndex;
+        bounds = stack[stackSize].bounds;
+    }
+}
+
+#endif //CPUCOMPRESSEDBVH_H
@@ -0,0 +1,436 @@
+#include "CpuEngine.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Profiler.h"
+
+namespace
+{
+// the pixel RayGen writes for the result of its TraceRay
+uint32_t shadePixel(bool hasHit, const Float2& barycentrics)
+{
+    CpuPayload payload = {
+        .color = {0.0f, 0.0f, 0.0f, 1.0f}
+    };
+    if (hasHit)
+    {
+        closestHitShader(payload, barycentrics);
+    }
+    else
+    {
+        missShader(payload);
+    }
+    return packUnorm8(payload.color);
+}
+
+uint32_t heatmapValue(CpuRenderMode mode, const CpuTraversalStats& stats)
+{
+    switch (mode)
+    {
+    case CpuRenderMode::NodeHeatmap:
+        return stats.nodesVisited;
+    case CpuRenderMode::TriangleHeatmap:
+        return stats.trianglesTested;
+    case CpuRenderMode::InstanceHeatmap:
+        return stats.instanceTransitions;
+    case CpuRenderMode::StackDepthHeatmap:
+        return stats.maxStackDepth;
+    default:
+        return 0;
+    }
+}
+
+// blue, cyan, green, yellow, red for heat in [0, 1]
+Float4 heatmapColor(float heat)
+{
+    constexpr Float4 COLORS[] = {
+        {0.0f, 0.0f, 1.0f, 1.0f},
+        {0.0f, 1.0f, 1.0f, 1.0f},
+        {0.0f, 1.0f, 0.0f, 1.0f},
+        {1.0f, 1.0f, 0.0f, 1.0f},
+        {1.0f, 0.0f, 0.0f, 1.0f}
+    };
+    float position = std::clamp(heat, 0.0f, 1.0f) * 4.0f;
+    int index = std::min(static_cast<int>(position), 3);
+    float f = position - static_cast<float>(index);
+    const Float4& a = COLORS[index];
+    const Float4& b = COLORS[index + 1];
+    return {a.x + (b.x - a.x) * f, a.y + (b.y - a.y) * f, a.z + (b.z - a.z) * f, 1.0f};
+}
+}
+
+CpuEngine::CpuEngine(
+    uint32_t width,
+    uint32_t height,
+    Mesh mesh,
+    const CpuTileSchedulerOptions& schedulerOptions
+)
+    : m_width(width)
+    , m_height(height)
+    , m_tileWidth(schedulerOptions.tileWidth)
+    , m_tileHeight(schedulerOptions.tileHeight)
+    , m_scheduler(std::make_unique<CpuTileScheduler>(schedulerOptions))
+    , m_mesh(std::move(mesh))
+{
+    m_output.resize(static_cast<size_t>(m_width) * m_height);
+
+    setTraceKernel(selectTraceKernel());
+    createAS();
+}
+
+CpuEngine::CpuEngine(
+    uint32_t width,
+    uint32_t height,
+    std::unique_ptr<SceneFile> scene,
+    const CpuTileSchedulerOptions& schedulerOptions
+)
+    : m_width(width)
+    , m_height(height)
+    , m_tileWidth(schedulerOptions.tileWidth)
+    , m_tileHeight(schedulerOptions.tileHeight)
+    , m_scheduler(std::make_unique<CpuTileScheduler>(schedulerOptions))
+    , m_scene(std::move(scene))
+{
+    m_output.resize(static_cast<size_t>(m_width) * m_height);
+
+    setTraceKernel(selectTraceKernel());
+    createAS();
+}
+
+void CpuEngine::cleanup()
+{
+    m_tlas.reset();
+    m_instanceDescs.clear();
+    m_blas.reset();
+    m_scene.reset();
+    m_output.clear();
+    m_output.shrink_to_fit();
+    m_heatmapValues.clear();
+    m_heatmapValues.shrink_to_fit();
+    m_tileTraversalStats.clear();
+}
+
+size_t CpuEngine::compressBlas()
+{
+    if (!m_blas || m_blas->isCompressed())
+    {
+        return 0;
+    }
+
+    ProfileScope scope("compactBlas");
+    size_t uncompressed = m_blas->memoryUsage();
+    m_blas->compress();
+    // the TLAS instance caches the node pointer of the BLAS
+    createTlas();
+    return uncompressed - m_blas->memoryUsage();
+}
+
+AsBuildPlan CpuEngine::planBlasBuilds(const AsBuildSchedulerOptions& options) const
+{
+    std::vector<const CpuBlas*> blases;
+    if (m_scene)
+    {
+        for (uint32_t meshIndex = 0; meshIndex < m_scene->meshCount(); ++meshIndex)
+        {
+            blases.push_back(&m_scene->blas(meshIndex));
+        }
+    }
+    else if (m_blas)
+    {
+        blases.push_back(m_blas.get());
+    }
+
+    std::vector<AsBuildRequest> requests;
+    for (const CpuBlas* blas : blases)
+    {
+        requests.push_back({
+            .scratchSize = CpuBlas::buildScratchSize(blas->triangleCount()),
+            .resultSize = blas->memoryUsage()
+        });
+    }
+    return AsBuildScheduler(options).plan(requests);
+}
+
+void CpuEngine::setInstanceTransform(uint32_t instanceIndex, const float transform[3][4])
+{
+    if (instanceIndex >= m_instanceDescs.size())
+    {
+        throw std::out_of_range("Instance index out of range.");
+    }
+
+    std::copy_n(&transform[0][0], 12, &m_instanceDescs[instanceIndex].transform[0][0]);
+    m_tlasDirty = true;
+}
+
+void CpuEngine::updateMesh(std::span<const Float3> vertices)
+{
+    if (!m_blas)
+    {
+        throw std::logic_error("Scene file meshes cannot be updated.");
+    }
+    if (vertices.size() != m_mesh.vertices.size())
+    {
+        throw std::invalid_argument("Mesh update changes the vertex count.");
+    }
+
+    ProfileScope scope("updateBlas");
+    std::copy(vertices.begin(), vertices.end(), m_mesh.vertices.begin());
+    CpuGeometryDesc geometryDesc = meshGeometry();
+    m_blas->update(std::span(&geometryDesc, 1));
+    // the BLAS bounds changed, and a rebuild moved its nodes
+    m_tlasDirty = true;
+}
+
+void CpuEngine::setTraceKernel(CpuTraceKernel kernel)
+{
+    m_traceKernel = isTraceKernelSupported(kernel) ? kernel : CpuTraceKernel::Scalar;
+
+    // square-ish blocks keep the rays of a packet coherent
+    switch (packetWidth(m_traceKernel))
+    {
+    case 16:
+        m_blockWidth = 4;
+        m_blockHeight = 4;
+        break;
+    case 8:
+        m_blockWidth = 4;
+        m_blockHeight = 2;
+        break;
+    default:
+        m_blockWidth = 1;
+        m_blockHeight = 1;
+        break;
+    }
+
+    setTileSize(m_tileWidth, m_tileHeight);
+}
+
+void CpuEngine::setRenderMode(CpuRenderMode mode, uint32_t heatmapScale)
+{
+    if (mode != CpuRenderMode::Shaded && !CPU_TRAVERSAL_STATS_ENABLED)
+    {
+        throw std::logic_error("Heatmap render modes need a build with DXR_CPU_TRAVERSAL_STATS.");
+    }
+
+    m_renderMode = mode;
+    m_heatmapScale = heatmapScale;
+    if (mode == CpuRenderMode::Shaded)
+    {
+        m_heatmapValues.clear();
+        m_heatmapValues.shrink_to_fit();
+    }
+    else
+    {
+        m_heatmapValues.resize(static_cast<size_t>(m_width) * m_height);
+    }
+}
+
+void CpuEngine::setTileSize(uint32_t tileWidth, uint32_t tileHeight)
+{
+    m_tileWidth = tileWidth;
+    m_tileHeight = tileHeight;
+
+    auto roundUp = [](uint32_t value, uint32_t multiple) {
+        return std::max(1u, (value + multiple - 1) / multiple) * multiple;
+    };
+    m_scheduler->setTileSize(roundUp(tileWidth, m_blockWidth), roundUp(tileHeight, m_blockHeight));
+}
+
+void CpuEngine::render()
+{
+    // same stage names as D3DEngine, so traces of both backends line up
+    ProfileScope scope("render");
+    if (m_tlasDirty)
+    {
+        ProfileScope updateScope("updateTlas");
+        m_tlas->update(m_instanceDescs);
+        m_tlasDirty = false;
+    }
+
+    if constexpr (CPU_TRAVERSAL_STATS_ENABLED)
+    {
+        uint32_t tileGridHeight = (m_height + m_scheduler->tileHeight() - 1) / m_scheduler->tileHeight();
+        m_tileTraversalStats.assign(static_cast<size_t>(tileGridWidth()) * tileGridHeight, {});
+    }
+
+    {
+        ProfileScope dispatchScope("dispatchRays");
+        m_scheduler->dispatch(m_width, m_height, [this](const CpuTile& tile) {
+            ProfileScope tileScope("traceTile");
+            traceTile(tile);
+        });
+    }
+
+    if constexpr (CPU_TRAVERSAL_STATS_ENABLED)
+    {
+        m_traversalStats = {};
+        for (const CpuTraversalTotals& tileStats : m_tileTraversalStats)
+        {
+            m_traversalStats.add(tileStats);
+        }
+        if (m_renderMode != CpuRenderMode::Shaded)
+        {
+            writeHeatmap();
+        }
+    }
+}
+
+void CpuEngine::createAS()
+{
+    ProfileScope scope("createAS");
+    if (m_scene)
+    {
+        m_instanceDescs = m_scene->instanceDescs();
+        createTlas();
+        return;
+    }
+
+    CpuGeometryDesc geometryDesc = meshGeometry();
+
+    // same preference as the D3D12 path
+    CpuBvhBuildOptions options = {
+        .maxLeafSize = 4,
+        .threadCount = m_scheduler->threadCount(),
+        .preference = m_mesh.buildPreference
+    };
+    {
+        ProfileScope blasScope("buildBlas");
+        m_blas = std::make_unique<CpuBlas>(std::span(&geometryDesc, 1), options);
+    }
+
+    CpuInstanceDesc instanceDesc = {
+        .transform = {},
+        .instanceID = 0,
+        .instanceMask = 0xFF,
+        .instanceContributionToHitGroupIndex = 0,
+        .flags = CPU_INSTANCE_FLAG_NONE,
+        .accelerationStructure = m_blas.get()
+    };
+    // same fit as the D3D12 instance
+    m_mesh.fitTransform(instanceDesc.transform);
+    m_instanceDescs = {instanceDesc};
+    createTlas();
+}
+
+void CpuEngine::createTlas()
+{
+    ProfileScope scope("buildTlas");
+    m_tlas = std::make_unique<CpuTlas>(m_instanceDescs);
+    m_tlasDirty = false;
+}
+
+CpuGeometryDesc CpuEngine::meshGeometry() const
+{
+    return {
+        .indexFormat = CpuIndexFormat::Uint32,
+        .indexCount = static_cast<uint32_t>(m_mesh.indices.size()),
+        .vertexCount = static_cast<uint32_t>(m_mesh.vertices.size()),
+        .indexBuffer = m_mesh.indices.data(),
+        .vertexBuffer = m_mesh.vertices.data(),
+        .vertexStrideInBytes = sizeof(Float3)
+    };
+}
+
+void CpuEngine::traceTile(const CpuTile& tile)
+{
+    if constexpr (CPU_TRAVERSAL_STATS_ENABLED)
+    {
+        traceTileWithStats(tile);
+        return;
+    }
+
+    // tiles are whole blocks, except at the right and bottom edges of the image
+    for (uint32_t y = tile.y; y < tile.y + tile.height; y += m_blockHeight)
+    {
+        for (uint32_t x = tile.x; x < tile.x + tile.width; x += m_blockWidth)
+        {
+            traceBlock(x, y);
+        }
+    }
+}
+
+void CpuEngine::traceBlock(uint32_t x, uint32_t y)
+{
+    CpuRayPacket rays;
+    uint32_t activeMask = 0;
+    for (uint32_t lane = 0; lane < m_blockWidth * m_blockHeight; ++lane)
+    {
+        uint32_t px = x + lane % m_blockWidth;
+        uint32_t py = y + lane / m_blockWidth;
+        if (px < m_width && py < m_height)
+        {
+            rays.set(lane, rayGen(px, py, m_width, m_height));
+            activeMask |= 1u << lane;
+        }
+        else
+        {
+            rays.set(lane, rayGen(x, y, m_width, m_height));
+        }
+    }
+
+    CpuHitPacket hits;
+    traceRayPacket(m_traceKernel, *m_tlas, rays, activeMask, CPU_RAY_FLAG_NONE, 0xFF, hits);
+
+    for (uint32_t lane = 0; lane < m_blockWidth * m_blockHeight; ++lane)
+    {
+        if ((activeMask & (1u << lane)) == 0)
+        {
+            continue;
+        }
+
+        uint32_t px = x + lane % m_blockWidth;
+        uint32_t py = y + lane / m_blockWidth;
+        m_output[static_cast<size_t>(py) * m_width + px] = shadePixel(hits.hasHit(lane), {hits.u[lane], hits.v[lane]});
+    }
+}
+
+void CpuEngine::traceTileWithStats(const CpuTile& tile)
+{
+    bool heatmap = m_renderMode != CpuRenderMode::Shaded;
+    CpuTraversalTotals totals;
+    for (uint32_t y = tile.y; y < tile.y + tile.height; ++y)
+    {
+        for (uint32_t x = tile.x; x < tile.x + tile.width; ++x)
+        {
+            CpuHit hit;
+            CpuTraversalStats stats;
+            m_tlas->traceRay(rayGen(x, y, m_width, m_height), CPU_RAY_FLAG_NONE, 0xFF, hit, &stats);
+            totals.add(stats);
+
+            size_t pixel = static_cast<size_t>(y) * m_width + x;
+            if (heatmap)
+            {
+                m_heatmapValues[pixel] = heatmapValue(m_renderMode, stats);
+            }
+            else
+            {
+                m_output[pixel] = shadePixel(hit.hasHit(), hit.barycentrics);
+            }
+        }
+    }
+
+    // every tile has a slot of its own, so workers never write the same one
+    uint32_t tileIndex = tile.y / m_scheduler->tileHeight() * tileGridWidth() + tile.x / m_scheduler->tileWidth();
+    m_tileTraversalStats[tileIndex] = totals;
+}
+
+void CpuEngine::writeHeatmap()
+{
+    // a zero width or height image has no pixels, and no maximum to scale by
+    if (m_heatmapValues.empty())
+    {
+        return;
+    }
+
+    uint32_t scale = m_heatmapScale;
+    if (scale == 0)
+    {
+        scale = std::max(1u, *std::max_element(m_heatmapValues.begin(), m_heatmapValues.end()));
+    }
+    for (size_t pixel = 0; pixel < m_output.size(); ++pixel)
+    {
+        float heat = static_cast<float>(m_heatmapValues[pixel]) / static_cast<float>(scale);
+        m_output[pixel] = packUnorm8(heatmapColor(heat));
+    }
+}
@@ -0,0 +1,190 @@
+#ifndef CPUENGINE_H
+#define CPUENGINE_H
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "AsBuildScheduler.h"
+#include "Engine.h"
+#include "MeshLoader.h"
+#include "SceneFile.h"
+#include "CpuPacket.h"
+#include "CpuTlas.h"
+#include "CpuShaders.h"
+#include "CpuTileScheduler.h"
+#include "CpuTraversalStats.h"
+
+// what render() writes into the output image
+enum class CpuRenderMode
+{
+    Shaded, // the colors of the miss and closest hit shaders
+    // one CpuTraversalStats counter per pixel, from blue (0) to red (the heatmap scale)
+    NodeHeatmap,
+    TriangleHeatmap,
+    InstanceHeatmap,
+    StackDepthHeatmap
+};
+
+// reference backend: runs the RayGen/Miss/ClosestHit logic of shader.hlsl on the CPU
+class CpuEngine : public Engine
+{
+public:
+    CpuEngine(
+        uint32_t width,
+        uint32_t height,
+        Mesh mesh = Mesh::triangle(),
+        const CpuTileSchedulerOptions& schedulerOptions = {}
+    );
+
+    // traces the prebuilt BLASes of a mapped scene file, only the small TLAS is built at startup
+    CpuEngine(
+        uint32_t width,
+        uint32_t height,
+        std::unique_ptr<SceneFile> scene,
+        const CpuTileSchedulerOptions& schedulerOptions = {}
+    );
+    ~CpuEngine() override = default;
+
+    void cleanup() override;
+
+    void render() override;
+
+    // packet kernel used by render(), CpuTraceKernel::Scalar is the single-ray reference path
+    void setTraceKernel(CpuTraceKernel kernel);
+
+    CpuTraceKernel traceKernel() const
+    {
+        return m_traceKernel;
+    }
+
+    // rounded up to whole packet blocks so a packet never straddles two tiles
+    void setTileSize(uint32_t tileWidth, uint32_t tileHeight);
+
+    // the heatmap modes need a DXR_CPU_TRAVERSAL_STATS build. heatmapScale is the counter value shown as
+    // full red, 0 scales every frame to its own maximum
+    void setRenderMode(CpuRenderMode mode, uint32_t heatmapScale = 0);
+
+    CpuRenderMode renderMode() const
+    {
+        return m_renderMode;
+    }
+
+    // traversal counters of the last render(), all zero unless built with DXR_CPU_TRAVERSAL_STATS.
+    // a stats build traces every ray alone: a packet kernel's boxes and triangles are tested once for the
+    // whole packet, so its work cannot be told apart per ray
+    const CpuTraversalTotals& traversalStats() const
+    {
+        return m_traversalStats;
+    }
+
+    // the same per tile of the last render(), row-major with tileGridWidth() tiles per row
+    std::span<const CpuTraversalTotals> tileTraversalStats() const
+    {
+        return m_tileTraversalStats;
+    }
+
+    uint32_t tileGridWidth() const
+    {
+        return (m_width + m_scheduler->tileWidth() - 1) / m_scheduler->tileWidth();
+    }
+
+    // quantizes the mesh BLAS (see CpuBlas::compress) and rebuilds the TLAS over it, returns the bytes saved.
+    // scene file BLASes stay as they are, they are mapped rather than allocated
+    size_t compressBlas();
+
+    // object to world transform of one instance, the TLAS is refit (or rebuilt, see AsUpdatePolicy) before
+    // the next render()
+    void setInstanceTransform(uint32_t instanceIndex, const float transform[3][4]) override;
+
+    // deforms the mesh: vertices replaces the mesh vertices one for one and the BLAS is refit in place.
+    // not available for a scene file or a compressed BLAS
+    void updateMesh(std::span<const Float3> vertices);
+
+    uint32_t instanceCount() const
+    {
+        return static_cast<uint32_t>(m_instanceDescs.size());
+    }
+
+    const AsUpdatePolicyStats& tlasUpdateStats() const
+    {
+        return m_tlas->updatePolicy().stats();
+    }
+
+    // batches and peak memory of building every BLAS of the mesh or scene under the budgets, with the CPU
+    // builder's memory standing in for the prebuild info
+    AsBuildPlan planBlasBuilds(const AsBuildSchedulerOptions& options = {}) const;
+
+    // BVH and triangle memory of the mesh BLAS, 0 for a scene file
+    size_t blasMemoryUsage() const
+    {
+        return m_blas ? m_blas->memoryUsage() : 0;
+    }
+
+    // per-worker busy/idle time of the last render()
+    const CpuDispatchStats& dispatchStats() const
+    {
+        return m_scheduler->stats();
+    }
+
+    uint32_t width() const
+    {
+        return m_width;
+    }
+
+    uint32_t height() const
+    {
+        return m_height;
+    }
+
+    // DXGI_FORMAT_R8G8B8A8_UNORM, row-major
+    const std::vector<uint32_t>& output() const
+    {
+        return m_output;
+    }
+
+private:
+    void createAS();
+    void createTlas();
+    CpuGeometryDesc meshGeometry() const;
+
+    void traceTile(const CpuTile& tile);
+    void traceBlock(uint32_t x, uint32_t y);
+    // one ray per pixel through CpuTlas::traceRay, counting its traversal
+    void traceTileWithStats(const CpuTile& tile);
+    void writeHeatmap();
+
+    uint32_t m_width;
+    uint32_t m_height;
+
+    CpuTraceKernel m_traceKernel;
+    // pixel block traced as one packet
+    uint32_t m_blockWidth = 1;
+    uint32_t m_blockHeight = 1;
+    // requested tile size before rounding to blocks
+    uint32_t m_tileWidth;
+    uint32_t m_tileHeight;
+
+    std::unique_ptr<CpuTileScheduler> m_scheduler;
+
+    Mesh m_mesh;
+    std::unique_ptr<SceneFile> m_scene;
+
+    std::unique_ptr<CpuBlas> m_blas;
+    std::unique_ptr<CpuTlas> m_tlas;
+    std::vector<CpuInstanceDesc> m_instanceDescs;
+    // instances or the BLAS changed since the TLAS was last built or refit
+    bool m_tlasDirty = false;
+
+    std::vector<uint32_t> m_output;
+
+    CpuRenderMode m_renderMode = CpuRenderMode::Shaded;
+    uint32_t m_heatmapScale = 0;
+    // the counter the heatmap shows, per pixel
+    std::vector<uint32_t> m_heatmapValues;
+    CpuTraversalTotals m_traversalStats;
+    std::vector<CpuTraversalTotals> m_tileTraversalStats;
+};
+
+#endif //CPUENGINE_H
@@ -0,0 +1,60 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+bool osSupportsXsave(unsigned long long mask)
+{
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    return osxsave && (_xgetbv(0) & mask) == mask;
+}
+
+bool cpuidLeaf7(int reg, int bit)
+{
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[reg] & (1 << bit)) != 0;
+}
+#endif
+}
+
+bool cpuSupportsAvx2()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    // XMM | YMM state
+    return fma && osSupportsXsave(0x6) && cpuidLeaf7(1, 5);
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+bool cpuSupportsAvx512()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    // XMM | YMM | opmask | ZMM state
+    return osSupportsXsave(0xE6) && cpuidLeaf7(1, 16);
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,8 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+// runtime ISA detection, includes the OS support check for the wider register state
+bool cpuSupportsAvx2();
+bool cpuSupportsAvx512();
+
+#endif //CPUFEATURES_H
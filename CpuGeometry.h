@@ -0,0 +1,62 @@
+#ifndef CPUGEOMETRY_H
+#define CPUGEOMETRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "CpuMath.h"
+
+// DXGI_FORMAT_UNKNOWN / DXGI_FORMAT_R16_UINT / DXGI_FORMAT_R32_UINT
+enum class CpuIndexFormat
+{
+    None,
+    Uint16,
+    Uint32
+};
+
+// mirrors D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC with DXGI_FORMAT_R32G32B32_FLOAT vertices,
+// buffers are CPU pointers instead of GPU virtual addresses
+struct CpuGeometryDesc
+{
+    CpuIndexFormat indexFormat = CpuIndexFormat::None;
+    uint32_t indexCount = 0;
+    uint32_t vertexCount = 0;
+    const void* indexBuffer = nullptr;
+    const void* vertexBuffer = nullptr;
+    size_t vertexStrideInBytes = sizeof(Float3);
+
+    uint32_t triangleCount() const
+    {
+        return (indexFormat == CpuIndexFormat::None ? vertexCount : indexCount) / 3;
+    }
+
+    uint32_t index(uint32_t i) const
+    {
+        switch (indexFormat)
+        {
+        case CpuIndexFormat::Uint16:
+            return static_cast<const uint16_t*>(indexBuffer)[i];
+        case CpuIndexFormat::Uint32:
+            return static_cast<const uint32_t*>(indexBuffer)[i];
+        default:
+            return i;
+        }
+    }
+
+    Float3 vertex(uint32_t i) const
+    {
+        Float3 v;
+        memcpy(&v, static_cast<const uint8_t*>(vertexBuffer) + i * vertexStrideInBytes, sizeof(Float3));
+        return v;
+    }
+
+    void triangle(uint32_t primitiveIndex, Float3& v0, Float3& v1, Float3& v2) const
+    {
+        v0 = vertex(index(primitiveIndex * 3));
+        v1 = vertex(index(primitiveIndex * 3 + 1));
+        v2 = vertex(index(primitiveIndex * 3 + 2));
+    }
+};
+
+#endif //CPUGEOMETRY_H
@@ -0,0 +1,309 @@
+#include "CpuLbvhBuilder.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <functional>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+constexpr uint32_t RADIX_BITS = 8;
+constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+// smaller inputs are sorted and encoded on the calling thread
+constexpr size_t PARALLEL_CHUNK_SIZE = 16384;
+
+// runs fn(chunk) for chunk in [0, chunkCount), the calling thread takes chunk 0
+void parallelFor(uint32_t chunkCount, const std::function<void(uint32_t)>& fn)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(chunkCount - 1);
+    for (uint32_t chunk = 1; chunk < chunkCount; ++chunk)
+    {
+        threads.emplace_back(fn, chunk);
+    }
+    fn(0);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// spreads the low 10 bits so two zero bits follow each one
+uint32_t expandBits(uint32_t v)
+{
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// same for the low 21 bits
+uint64_t expandBits(uint64_t v)
+{
+    v &= 0x1FFFFF;
+    v = (v | (v << 32)) & 0x001F00000000FFFFull;
+    v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+    v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+    v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+    v = (v | (v << 2)) & 0x1249249249249249ull;
+    return v;
+}
+
+// unit is the centroid normalized to [0, 1] per axis
+template <typename Key>
+Key mortonCode(const Float3& unit)
+{
+    constexpr uint32_t AXIS_BITS = sizeof(Key) == 4 ? 10 : 21;
+    constexpr float AXIS_MAX = static_cast<float>((1u << AXIS_BITS) - 1);
+    Key x = static_cast<Key>(std::clamp(unit.x * AXIS_MAX, 0.0f, AXIS_MAX));
+    Key y = static_cast<Key>(std::clamp(unit.y * AXIS_MAX, 0.0f, AXIS_MAX));
+    Key z = static_cast<Key>(std::clamp(unit.z * AXIS_MAX, 0.0f, AXIS_MAX));
+    return (expandBits(x) << 2) | (expandBits(y) << 1) | expandBits(z);
+}
+
+// LSD radix sort of keys with values riding along. every pass histograms one chunk per thread, scans the
+// histograms digit-major so each chunk knows where its digits go, and scatters the chunks in parallel.
+// passes whose digit is the same for every key are skipped
+template <typename Key>
+void radixSort(std::vector<Key>& keys, std::vector<uint32_t>& values, uint32_t keyBits, uint32_t threadCount)
+{
+    size_t count = keys.size();
+    uint32_t chunkCount = static_cast<uint32_t>(std::clamp<size_t>(count / PARALLEL_CHUNK_SIZE, 1, threadCount));
+    size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    std::vector<Key> keyScratch(count);
+    std::vector<uint32_t> valueScratch(count);
+    std::vector<std::array<size_t, RADIX_SIZE>> offsets(chunkCount);
+
+    for (uint32_t shift = 0; shift < keyBits; shift += RADIX_BITS)
+    {
+        parallelFor(chunkCount, [&](uint32_t chunk) {
+            std::array<size_t, RADIX_SIZE>& histogram = offsets[chunk];
+            histogram.fill(0);
+            size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; ++i)
+            {
+                histogram[(keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+            }
+        });
+
+        size_t offset = 0;
+        bool singleDigit = false;
+        for (uint32_t digit = 0; digit < RADIX_SIZE; ++digit)
+        {
+            size_t digitStart = offset;
+            for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+            {
+                size_t histogramCount = offsets[chunk][digit];
+                offsets[chunk][digit] = offset;
+                offset += histogramCount;
+            }
+            singleDigit = singleDigit || offset - digitStart == count;
+        }
+        if (singleDigit)
+        {
+            continue;
+        }
+
+        parallelFor(chunkCount, [&](uint32_t chunk) {
+            std::array<size_t, RADIX_SIZE>& next = offsets[chunk];
+            size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; ++i)
+            {
+                size_t target = next[(keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+                keyScratch[target] = keys[i];
+                valueScratch[target] = values[i];
+            }
+        });
+        keys.swap(keyScratch);
+        values.swap(valueScratch);
+    }
+}
+
+void atomicMax(std::atomic<uint32_t>& target, uint32_t value)
+{
+    uint32_t current = target.load(std::memory_order_relaxed);
+    while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+// top-down emission over the sorted codes, subtrees above the parallel threshold go to their own thread
+template <typename Key>
+struct HierarchyEmitter
+{
+    const CpuBvhBuildOptions& options;
+    std::span<const CpuAabb> primBounds;
+    std::span<const Key> keys;
+    std::span<const uint32_t> primIndices;
+    std::vector<CpuBvhNode>& nodes;
+
+    std::atomic<uint32_t> nodeCount = 1;
+    std::atomic<uint32_t> leafCount = 0;
+    std::atomic<uint32_t> maxDepth = 0;
+    std::atomic<uint32_t> activeTasks = 0;
+
+    // codes in [begin, end) share every bit above the highest one that differs, so the ones with that bit
+    // clear form a prefix of the range
+    uint32_t split(uint32_t begin, uint32_t end) const
+    {
+        Key first = keys[begin];
+        Key last = keys[end - 1];
+        if (first == last)
+        {
+            return begin + (end - begin) / 2;
+        }
+
+        Key mask = Key(1) << (std::bit_width(static_cast<Key>(first ^ last)) - 1);
+        auto split = std::partition_point(keys.begin() + begin, keys.begin() + end, [&](Key key) {
+            return (key & mask) == 0;
+        });
+        return static_cast<uint32_t>(split - keys.begin());
+    }
+
+    CpuAabb emit(uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth)
+    {
+        atomicMax(maxDepth, depth);
+
+        CpuAabb bounds;
+        uint32_t count = end - begin;
+        if (count <= options.maxLeafSize || depth + 1 >= CpuBvh::MAX_DEPTH)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                bounds.grow(primBounds[primIndices[i]]);
+            }
+            nodes[nodeIndex] = {bounds.min, begin, bounds.max, count};
+            leafCount.fetch_add(1, std::memory_order_relaxed);
+            return bounds;
+        }
+
+        uint32_t mid = split(begin, end);
+        uint32_t leftIndex = nodeCount.fetch_add(2, std::memory_order_relaxed);
+
+        bool spawn = false;
+        if (count >= options.parallelThreshold)
+        {
+            spawn = activeTasks.fetch_add(1, std::memory_order_relaxed) + 1 < options.threadCount;
+            if (!spawn)
+            {
+                activeTasks.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        CpuAabb leftBounds;
+        if (spawn)
+        {
+            std::thread worker([&] {
+                leftBounds = emit(leftIndex, begin, mid, depth + 1);
+            });
+            bounds = emit(leftIndex + 1, mid, end, depth + 1);
+            worker.join();
+            activeTasks.fetch_sub(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            leftBounds = emit(leftIndex, begin, mid, depth + 1);
+            bounds = emit(leftIndex + 1, mid, end, depth + 1);
+        }
+
+        bounds.grow(leftBounds);
+        nodes[nodeIndex] = {bounds.min, leftIndex, bounds.max, 0};
+        return bounds;
+    }
+};
+}
+
+CpuLbvhBuilder::CpuLbvhBuilder(const CpuBvhBuildOptions& options)
+    : m_options(options)
+{
+    m_options.maxLeafSize = std::max(1u, m_options.maxLeafSize);
+    if (m_options.threadCount == 0)
+    {
+        m_options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+CpuBvh CpuLbvhBuilder::build(std::span<const CpuAabb> primBounds)
+{
+    return m_options.mortonBits > 30 ? buildWithKeys<uint64_t>(primBounds) : buildWithKeys<uint32_t>(primBounds);
+}
+
+template <typename Key>
+CpuBvh CpuLbvhBuilder::buildWithKeys(std::span<const CpuAabb> primBounds)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    uint32_t primCount = static_cast<uint32_t>(primBounds.size());
+    uint32_t chunkCount = static_cast<uint32_t>(std::clamp<size_t>(primCount / PARALLEL_CHUNK_SIZE, 1, m_options.threadCount));
+    size_t chunkSize = (static_cast<size_t>(primCount) + chunkCount - 1) / chunkCount;
+
+    // the Morton grid spans the centroids, not the primitives, so no cells are wasted on overhang
+    std::vector<CpuAabb> chunkCentroidBounds(chunkCount);
+    parallelFor(chunkCount, [&](uint32_t chunk) {
+        size_t end = std::min<size_t>(primCount, (chunk + 1) * chunkSize);
+        for (size_t i = chunk * chunkSize; i < end; ++i)
+        {
+            chunkCentroidBounds[chunk].grow(primBounds[i].centroid());
+        }
+    });
+    CpuAabb centroidBounds;
+    for (const CpuAabb& bounds : chunkCentroidBounds)
+    {
+        centroidBounds.grow(bounds);
+    }
+
+    Float3 extent = centroidBounds.max - centroidBounds.min;
+    Float3 scale = {
+        extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+        extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+        extent.z > 0.0f ? 1.0f / extent.z : 0.0f
+    };
+
+    std::vector<Key> keys(primCount);
+    std::vector<uint32_t> primIndices(primCount);
+    parallelFor(chunkCount, [&](uint32_t chunk) {
+        size_t end = std::min<size_t>(primCount, (chunk + 1) * chunkSize);
+        for (size_t i = chunk * chunkSize; i < end; ++i)
+        {
+            keys[i] = mortonCode<Key>((primBounds[i].centroid() - centroidBounds.min) * scale);
+            primIndices[i] = static_cast<uint32_t>(i);
+        }
+    });
+    radixSort(keys, primIndices, sizeof(Key) == 4 ? 30 : 63, m_options.threadCount);
+
+    CpuBvh bvh;
+    uint32_t leafCount = 0;
+    uint32_t maxDepth = 0;
+    if (primCount > 0)
+    {
+        bvh.nodes.resize(primCount * 2 - 1);
+        HierarchyEmitter<Key> emitter = {
+            .options = m_options,
+            .primBounds = primBounds,
+            .keys = keys,
+            .primIndices = primIndices,
+            .nodes = bvh.nodes
+        };
+        emitter.emit(0, 0, primCount, 0);
+        bvh.nodes.resize(emitter.nodeCount);
+        leafCount = emitter.leafCount;
+        maxDepth = emitter.maxDepth;
+    }
+    bvh.primIndices = std::move(primIndices);
+
+    m_stats.nodeCount = static_cast<uint32_t>(bvh.nodes.size());
+    m_stats.leafCount = leafCount;
+    m_stats.maxDepth = maxDepth;
+    m_stats.referenceCount = static_cast<uint32_t>(bvh.primIndices.size());
+    m_stats.sahCost = bvh.sahCost(m_options.traversalCost, m_options.intersectionCost);
+    m_stats.buildTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return bvh;
+}
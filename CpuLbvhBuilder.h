@@ -0,0 +1,33 @@
+#ifndef CPULBVHBUILDER_H
+#define CPULBVHBUILDER_H
+
+#include <span>
+
+#include "CpuBvhBuilder.h"
+
+// linear BVH (Lauterbach et al. 2009): primitives are sorted along a Morton curve over their centroids with a
+// parallel radix sort, and every node splits its range where the highest differing code bit flips. nothing
+// is evaluated per split, so it builds several times faster than CpuBvhBuilder at a higher SAH cost, the
+// trade-off PREFER_FAST_BUILD makes for geometry rebuilt every frame
+class CpuLbvhBuilder
+{
+public:
+    // uses maxLeafSize, parallelThreshold, threadCount, mortonBits and the SAH costs for the stats
+    explicit CpuLbvhBuilder(const CpuBvhBuildOptions& options = {});
+
+    CpuBvh build(std::span<const CpuAabb> primBounds);
+
+    const CpuBvhBuildStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    template <typename Key>
+    CpuBvh buildWithKeys(std::span<const CpuAabb> primBounds);
+
+    CpuBvhBuildOptions m_options;
+    CpuBvhBuildStats m_stats;
+};
+
+#endif //CPULBVHBUILDER_H
@@ -0,0 +1,88 @@
+#ifndef CPUMATH_H
+#define CPUMATH_H
+
+#include <algorithm>
+#include <cmath>
+
+// layout-compatible with DirectX::XMFLOAT2 / XMFLOAT3 / XMFLOAT4 so vertex data can be shared with the D3D12 path
+struct Float2
+{
+    float x;
+    float y;
+};
+
+struct Float3
+{
+    float x;
+    float y;
+    float z;
+
+    float operator[](int axis) const
+    {
+        return axis == 0 ? x : (axis == 1 ? y : z);
+    }
+
+    float& operator[](int axis)
+    {
+        return axis == 0 ? x : (axis == 1 ? y : z);
+    }
+};
+
+struct Float4
+{
+    float x;
+    float y;
+    float z;
+    float w;
+};
+
+inline Float3 operator+(const Float3& a, const Float3& b)
+{
+    return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+inline Float3 operator-(const Float3& a, const Float3& b)
+{
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+inline Float3 operator*(const Float3& a, float s)
+{
+    return {a.x * s, a.y * s, a.z * s};
+}
+
+inline Float3 operator*(const Float3& a, const Float3& b)
+{
+    return {a.x * b.x, a.y * b.y, a.z * b.z};
+}
+
+inline float dot(const Float3& a, const Float3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Float3 cross(const Float3& a, const Float3& b)
+{
+    return {
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x
+    };
+}
+
+inline Float3 normalize(const Float3& v)
+{
+    return v * (1.0f / std::sqrt(dot(v, v)));
+}
+
+inline Float3 min(const Float3& a, const Float3& b)
+{
+    return {std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)};
+}
+
+inline Float3 max(const Float3& a, const Float3& b)
+{
+    return {std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)};
+}
+
+#endif //CPUMATH_H
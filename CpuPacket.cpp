@@ -0,0 +1,141 @@
+#include "CpuPacket.h"
+
+#include "CpuFeatures.h"
+#include "CpuPacketKernel.h"
+
+namespace
+{
+void traceRayPacketScalar(
+    const CpuTlas& tlas,
+    const CpuRayPacket& rays,
+    uint32_t laneCount,
+    uint32_t activeMask,
+    uint32_t rayFlags,
+    uint32_t instanceInclusionMask,
+    CpuHitPacket& hits
+)
+{
+    for (uint32_t lane = 0; lane < laneCount; ++lane)
+    {
+        // hit keeps its no-hit defaults unless traceRay finds something
+        CpuHit hit;
+        if (activeMask & (1u << lane))
+        {
+            tlas.traceRay(rays.get(lane), rayFlags, instanceInclusionMask, hit);
+        }
+
+        hits.t[lane] = hit.t;
+        hits.u[lane] = hit.barycentrics.x;
+        hits.v[lane] = hit.barycentrics.y;
+        hits.primitiveIndex[lane] = hit.primitiveIndex;
+        hits.geometryIndex[lane] = hit.geometryIndex;
+        hits.instanceIndex[lane] = hit.instanceIndex;
+        hits.instanceID[lane] = hit.instanceID;
+        hits.instanceContributionToHitGroupIndex[lane] = hit.instanceContributionToHitGroupIndex;
+    }
+}
+
+CpuPacketScene packetScene(const CpuTlas& tlas, uint32_t rayFlags)
+{
+    CpuPacketScene scene = {
+        .tlasNodes = tlas.bvh().nodes.data(),
+        .tlasNodeCount = static_cast<uint32_t>(tlas.bvh().nodes.size()),
+        .instances = tlas.instances().data(),
+        .cullModes = {}
+    };
+    for (uint32_t flags = 0; flags < 4; ++flags)
+    {
+        scene.cullModes[flags] = triangleCullMode(rayFlags, flags);
+    }
+    return scene;
+}
+}
+
+CpuTraceKernel selectTraceKernel()
+{
+    if (isTraceKernelSupported(CpuTraceKernel::Avx512x16))
+    {
+        return CpuTraceKernel::Avx512x16;
+    }
+    if (isTraceKernelSupported(CpuTraceKernel::Avx2x8))
+    {
+        return CpuTraceKernel::Avx2x8;
+    }
+    return CpuTraceKernel::Scalar;
+}
+
+bool isTraceKernelSupported(CpuTraceKernel kernel)
+{
+    switch (kernel)
+    {
+#ifdef DXR_CPU_X86_KERNELS
+    case CpuTraceKernel::Avx2x8:
+        return cpuSupportsAvx2();
+    case CpuTraceKernel::Avx512x16:
+        return cpuSupportsAvx512();
+#endif
+    case CpuTraceKernel::Scalar:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const char* traceKernelName(CpuTraceKernel kernel)
+{
+    switch (kernel)
+    {
+    case CpuTraceKernel::Avx2x8:
+        return "avx2x8";
+    case CpuTraceKernel::Avx512x16:
+        return "avx512x16";
+    default:
+        return "scalar";
+    }
+}
+
+uint32_t packetWidth(CpuTraceKernel kernel)
+{
+    switch (kernel)
+    {
+    case CpuTraceKernel::Avx2x8:
+        return 8;
+    case CpuTraceKernel::Avx512x16:
+        return 16;
+    default:
+        return 1;
+    }
+}
+
+void traceRayPacket(
+    CpuTraceKernel kernel,
+    const CpuTlas& tlas,
+    const CpuRayPacket& rays,
+    uint32_t activeMask,
+    uint32_t rayFlags,
+    uint32_t instanceInclusionMask,
+    CpuHitPacket& hits
+)
+{
+    // the SIMD kernels read CpuBvhNode arrays, compressed BLASes are traced one lane at a time
+    if (tlas.hasCompressedBlas())
+    {
+        traceRayPacketScalar(tlas, rays, packetWidth(kernel), activeMask, rayFlags, instanceInclusionMask, hits);
+        return;
+    }
+
+    switch (kernel)
+    {
+#ifdef DXR_CPU_X86_KERNELS
+    case CpuTraceKernel::Avx2x8:
+        traceRayPacketAvx2(packetScene(tlas, rayFlags), rays, activeMask, rayFlags, instanceInclusionMask, hits);
+        return;
+    case CpuTraceKernel::Avx512x16:
+        traceRayPacketAvx512(packetScene(tlas, rayFlags), rays, activeMask, rayFlags, instanceInclusionMask, hits);
+        return;
+#endif
+    default:
+        traceRayPacketScalar(tlas, rays, 1, activeMask, rayFlags, instanceInclusionMask, hits);
+        return;
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef CPUPACKET_H
+#define CPUPACKET_H
+
+#include <cstdint>
+
+#include "CpuTlas.h"
+
+constexpr uint32_t MAX_PACKET_WIDTH = 16;
+
+// structure-of-arrays ray packet, lanes beyond the kernel width are ignored
+struct alignas(64) CpuRayPacket
+{
+    float originX[MAX_PACKET_WIDTH];
+    float originY[MAX_PACKET_WIDTH];
+    float originZ[MAX_PACKET_WIDTH];
+    float directionX[MAX_PACKET_WIDTH];
+    float directionY[MAX_PACKET_WIDTH];
+    float directionZ[MAX_PACKET_WIDTH];
+    float tMin[MAX_PACKET_WIDTH];
+    float tMax[MAX_PACKET_WIDTH];
+
+    void set(uint32_t lane, const CpuRay& ray)
+    {
+        originX[lane] = ray.origin.x;
+        originY[lane] = ray.origin.y;
+        originZ[lane] = ray.origin.z;
+        directionX[lane] = ray.direction.x;
+        directionY[lane] = ray.direction.y;
+        directionZ[lane] = ray.direction.z;
+        tMin[lane] = ray.tMin;
+        tMax[lane] = ray.tMax;
+    }
+
+    CpuRay get(uint32_t lane) const
+    {
+        return {
+            .origin = {originX[lane], originY[lane], originZ[lane]},
+            .tMin = tMin[lane],
+            .direction = {directionX[lane], directionY[lane], directionZ[lane]},
+            .tMax = tMax[lane]
+        };
+    }
+};
+
+struct alignas(64) CpuHitPacket
+{
+    float t[MAX_PACKET_WIDTH];
+    float u[MAX_PACKET_WIDTH];
+    float v[MAX_PACKET_WIDTH];
+    uint32_t primitiveIndex[MAX_PACKET_WIDTH];
+    uint32_t geometryIndex[MAX_PACKET_WIDTH];
+    uint32_t instanceIndex[MAX_PACKET_WIDTH];
+    uint32_t instanceID[MAX_PACKET_WIDTH];
+    uint32_t instanceContributionToHitGroupIndex[MAX_PACKET_WIDTH];
+
+    bool hasHit(uint32_t lane) const
+    {
+        return primitiveIndex[lane] != UINT32_MAX;
+    }
+
+    CpuHit get(uint32_t lane) const
+    {
+        return {
+            .t = t[lane],
+            .barycentrics = {u[lane], v[lane]},
+            .primitiveIndex = primitiveIndex[lane],
+            .geometryIndex = geometryIndex[lane],
+            .instanceIndex = instanceIndex[lane],
+            .instanceID = instanceID[lane],
+            .instanceContributionToHitGroupIndex = instanceContributionToHitGroupIndex[lane]
+        };
+    }
+};
+
+enum class CpuTraceKernel
+{
+    Scalar, // one ray at a time through CpuTlas::traceRay, the reference path
+    Avx2x8,
+    Avx512x16
+};
+
+// widest kernel this CPU can run
+CpuTraceKernel selectTraceKernel();
+
+bool isTraceKernelSupported(CpuTraceKernel kernel);
+
+const char* traceKernelName(CpuTraceKernel kernel);
+
+uint32_t packetWidth(CpuTraceKernel kernel);
+
+// TraceRay for the first packetWidth(kernel) lanes of the packet; lanes not in activeMask report no hit.
+// ray flags and the inclusion mask are uniform over the packet, like TraceRay arguments in a wave
+void traceRayPacket(
+    CpuTraceKernel kernel,
+    const CpuTlas& tlas,
+    const CpuRayPacket& rays,
+    uint32_t activeMask,
+    uint32_t rayFlags,
+    uint32_t instanceInclusionMask,
+    CpuHitPacket& hits
+);
+
+#endif //CPUPACKET_H
@@ -0,0 +1,67 @@
+// compiled with AVX2 + FMA enabled, only called after cpuSupportsAvx2()
+#define CPU_PACKET_KERNEL_IMPLEMENTATION
+#include "CpuPacketKernel.h"
+
+#include <immintrin.h>
+
+namespace
+{
+struct SimdAvx2
+{
+    using Float = __m256;
+    using Mask = __m256;
+
+    static constexpr uint32_t WIDTH = 8;
+
+    static Float load(const float* p) { return _mm256_load_ps(p); }
+    static void store(float* p, Float a) { _mm256_store_ps(p, a); }
+    static Float set1(float a) { return _mm256_set1_ps(a); }
+
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm256_div_ps(a, b); }
+    static Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+    static Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+
+    static Mask cmpLt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static Mask cmpLe(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static Mask cmpGt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static Mask cmpGe(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static Mask cmpNeq(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_OQ); }
+
+    static Mask maskAnd(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+    static Mask maskOr(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+    static Mask maskAndNot(Mask a, Mask b) { return _mm256_andnot_ps(a, b); } // ~a & b
+    static Float select(Mask m, Float a, Float b) { return _mm256_blendv_ps(b, a, m); }
+
+    static uint32_t bits(Mask m) { return static_cast<uint32_t>(_mm256_movemask_ps(m)); }
+
+    static Mask fromBits(uint32_t bits)
+    {
+        __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        __m256i selected = _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), laneBits);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(selected, laneBits));
+    }
+
+    static float reduceMin(Float a)
+    {
+        __m128 m = _mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+        m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+        return _mm_cvtss_f32(m);
+    }
+};
+}
+
+void traceRayPacketAvx2(
+    const CpuPacketScene& scene,
+    const CpuRayPacket& rays,
+    uint32_t activeMask,
+    uint32_t rayFlags,
+    uint32_t instanceInclusionMask,
+    CpuHitPacket& hits
+)
+{
+    tracePacket<SimdAvx2>(scene, rays, activeMask, rayFlags, instanceInclusionMask, hits);
+}
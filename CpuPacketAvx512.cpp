@@ -0,0 +1,63 @@
+// compiled with AVX-512F enabled, only called after cpuSupportsAvx512()
+#define CPU_PACKET_KERNEL_IMPLEMENTATION
+#include "CpuPacketKernel.h"
+
+#include <immintrin.h>
+
+namespace
+{
+struct SimdAvx512
+{
+    using Float = __m512;
+    using Mask = __mmask16;
+
+    static constexpr uint32_t WIDTH = 16;
+
+    static Float load(const float* p) { return _mm512_load_ps(p); }
+    static void store(float* p, Float a) { _mm512_store_ps(p, a); }
+    static Float set1(float a) { return _mm512_set1_ps(a); }
+
+    static Float add(Float a, Float b) { return _mm512_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm512_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm512_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm512_div_ps(a, b); }
+    // GCC 12 reports the intentionally undefined passthrough operand of these intrinsics as uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+    static Float min(Float a, Float b) { return _mm512_min_ps(a, b); }
+    static Float max(Float a, Float b) { return _mm512_max_ps(a, b); }
+    static float reduceMin(Float a) { return _mm512_reduce_min_ps(a); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+    static Mask cmpLt(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static Mask cmpLe(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+    static Mask cmpGt(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static Mask cmpGe(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+    static Mask cmpNeq(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_OQ); }
+
+    static Mask maskAnd(Mask a, Mask b) { return static_cast<Mask>(a & b); }
+    static Mask maskOr(Mask a, Mask b) { return static_cast<Mask>(a | b); }
+    static Mask maskAndNot(Mask a, Mask b) { return static_cast<Mask>(~a & b); } // ~a & b
+    static Float select(Mask m, Float a, Float b) { return _mm512_mask_blend_ps(m, b, a); }
+
+    static uint32_t bits(Mask m) { return m; }
+    static Mask fromBits(uint32_t bits) { return static_cast<Mask>(bits); }
+};
+}
+
+void traceRayPacketAvx512(
+    const CpuPacketScene& scene,
+    const CpuRayPacket& rays,
+    uint32_t activeMask,
+    uint32_t rayFlags,
+    uint32_t instanceInclusionMask,
+    CpuHitPacket& hits
+)
+{
+    tracePacket<SimdAvx512>(scene, rays, activeMask, rayFlags, instanceInclusionMask, hits);
+}
@@ -0,0 +1,503 @@
+#ifndef CPUPACKETKERNEL_H
+#define CPUPACKETKERNEL_H
+
+// packet traversal shared by the per-ISA translation units. it is compiled with wider -march flags than the
+// rest of the program, so everything here has internal linkage and avoids inline functions from other headers:
+// the linker could otherwise keep an AVX copy of a shared inline function and run it on a CPU without AVX.
+// the ray transform and triangle test repeat the scalar arithmetic operation for operation and are compiled
+// without FP contraction, and equal distances go to the lower index as in isCloserHit(), so the scalar path is
+// an exact reference for every kernel
+
+#include <cstdint>
+#include <limits>
+
+#include "CpuPacket.h"
+
+struct CpuPacketScene
+{
+    const CpuBvhNode* tlasNodes;
+    uint32_t tlasNodeCount;
+    const CpuTlasInstance* instances;
+    CpuCullMode cullModes[4]; // indexed by instance flags & (CULL_DISABLE | FRONT_COUNTERCLOCKWISE)
+};
+
+void traceRayPacketAvx2(
+    const CpuPacketScene& scene,
+    const CpuRayPacket& rays,
+    uint32_t activeMask,
+    uint32_t rayFlags,
+    uint32_t instanceInclusionMask,
+    CpuHitPacket& hits
+);
+
+void traceRayPacketAvx512(
+    const CpuPacketScene& scene,
+    const CpuRayPacket& rays,
+    uint32_t activeMask,
+    uint32_t rayFlags,
+    uint32_t instanceInclusionMask,
+    CpuHitPacket& hits
+);
+
+#ifdef CPU_PACKET_KERNEL_IMPLEMENTATION
+
+namespace
+{
+constexpr uint32_t PACKET_STACK_SIZE = 64; // CpuBvh::MAX_DEPTH
+constexpr float PACKET_INFINITY = std::numeric_limits<float>::infinity();
+
+// S provides the vector types and operations for one instruction set
+template <typename S>
+struct PacketRays
+{
+    typename S::Float originX;
+    typename S::Float originY;
+    typename S::Float originZ;
+    typename S::Float directionX;
+    typename S::Float directionY;
+    typename S::Float directionZ;
+    typename S::Float invDirectionX;
+    typename S::Float invDirectionY;
+    typename S::Float invDirectionZ;
+};
+
+template <typename S>
+typename S::Mask intersectBoxPacket(
+    const CpuBvhNode& node,
+    const PacketRays<S>& rays,
+    typename S::Float tMin,
+    typename S::Float tMax,
+    typename S::Float& tEntry
+)
+{
+    using Float = typename S::Float;
+
+    Float t0x = S::mul(S::sub(S::set1(node.boundsMin.x), rays.originX), rays.invDirectionX);
+    Float t1x = S::mul(S::sub(S::set1(node.boundsMax.x), rays.originX), rays.invDirectionX);
+    Float t0y = S::mul(S::sub(S::set1(node.boundsMin.y), rays.originY), rays.invDirectionY);
+    Float t1y = S::mul(S::sub(S::set1(node.boundsMax.y), rays.originY), rays.invDirectionY);
+    Float t0z = S::mul(S::sub(S::set1(node.boundsMin.z), rays.originZ), rays.invDirectionZ);
+    Float t1z = S::mul(S::sub(S::set1(node.boundsMax.z), rays.originZ), rays.invDirectionZ);
+
+    // min/max return the second operand on NaN or a tie, std::min(a, b) and std::max(a, b) return a.
+    // the operands are swapped to match intersectAabb() of CpuBvh.h, which puts the accumulator first
+    Float tNear = S::max(S::min(t1x, t0x), tMin);
+    tNear = S::max(S::min(t1y, t0y), tNear);
+    tNear = S::max(S::min(t1z, t0z), tNear);
+    Float tFar = S::min(S::max(t1x, t0x), tMax);
+    tFar = S::min(S::max(t1y, t0y), tFar);
+    tFar = S::min(S::max(t1z, t0z), tFar);
+
+    tEntry = tNear;
+    return S::cmpLe(tNear, tFar);
+}
+
+// dot() of CpuMath.h, same operations in the same order so every lane matches the scalar path bit for bit
+template <typename S>
+typename S::Float dotPacket(
+    typename S::Float ax,
+    typename S::Float ay,
+    typename S::Float az,
+    typename S::Float bx,
+    typename S::Float by,
+    typename S::Float bz
+)
+{
+    return S::add(S::add(S::mul(ax, bx), S::mul(ay, by)), S::mul(az, bz));
+}
+
+// intersectTriangle() of CpuRay.h, a ray on a shared edge must hit or miss in both paths
+template <typename S>
+typename S::Mask intersectTrianglePacket(
+    const CpuTriangle& triangle,
+    const PacketRays<S>& rays,
+    typename S::Float tMin,
+    typename S::Float tMax,
+    CpuCullMode cull,
+    typename S::Float& t,
+    typename S::Float& u,
+    typename S::Float& v
+)
+{
+    using Float = typename S::Float;
+    using Mask = typename S::Mask;
+
+    Float e1x = S::set1(triangle.v1.x - triangle.v0.x);
+    Float e1y = S::set1(triangle.v1.y - triangle.v0.y);
+    Float e1z = S::set1(triangle.v1.z - triangle.v0.z);
+    Float e2x = S::set1(triangle.v2.x - triangle.v0.x);
+    Float e2y = S::set1(triangle.v2.y - triangle.v0.y);
+    Float e2z = S::set1(triangle.v2.z - triangle.v0.z);
+
+    // p = cross(direction, e2)
+    Float px = S::sub(S::mul(rays.directionY, e2z), S::mul(rays.directionZ, e2y));
+    Float py = S::sub(S::mul(rays.directionZ, e2x), S::mul(rays.directionX, e2z));
+    Float pz = S::sub(S::mul(rays.directionX, e2y), S::mul(rays.directionY, e2x));
+    Float det = dotPacket<S>(e1x, e1y, e1z, px, py, pz);
+
+    Float zero = S::set1(0.0f);
+    Mask valid = S::cmpNeq(det, zero);
+    if (cull == CpuCullMode::Clockwise)
+    {
+        valid = S::maskAnd(valid, S::cmpLt(det, zero));
+    }
+    else if (cull == CpuCullMode::CounterClockwise)
+    {
+        valid = S::maskAnd(valid, S::cmpGt(det, zero));
+    }
+
+    Float invDet = S::div(S::set1(1.0f), det);
+    Float sx = S::sub(rays.originX, S::set1(triangle.v0.x));
+    Float sy = S::sub(rays.originY, S::set1(triangle.v0.y));
+    Float sz = S::sub(rays.originZ, S::set1(triangle.v0.z));
+    u = S::mul(dotPacket<S>(sx, sy, sz, px, py, pz), invDet);
+    valid = S::maskAnd(valid, S::maskAnd(S::cmpGe(u, zero), S::cmpLe(u, S::set1(1.0f))));
+
+    // q = cross(s, e1)
+    Float qx = S::sub(S::mul(sy, e1z), S::mul(sz, e1y));
+    Float qy = S::sub(S::mul(sz, e1x), S::mul(sx, e1z));
+    Float qz = S::sub(S::mul(sx, e1y), S::mul(sy, e1x));
+    v = S::mul(dotPacket<S>(rays.directionX, rays.directionY, rays.directionZ, qx, qy, qz), invDet);
+    valid = S::maskAnd(valid, S::maskAnd(S::cmpGe(v, zero), S::cmpLe(S::add(u, v), S::set1(1.0f))));
+
+    t = S::mul(dotPacket<S>(e2x, e2y, e2z, qx, qy, qz), invDet);
+    return S::maskAnd(valid, S::maskAnd(S::cmpGe(t, tMin), S::cmpLe(t, tMax)));
+}
+
+// one row of transformPoint() in CpuTlas.cpp
+template <typename S>
+typename S::Float transformPacket(const float row[4], typename S::Float x, typename S::Float y, typename S::Float z)
+{
+    return S::add(dotPacket<S>(S::set1(row[0]), S::set1(row[1]), S::set1(row[2]), x, y, z), S::set1(row[3]));
+}
+
+// picks which of two hit children to enter first from the nearest entry among their lanes. a lane may then
+// visit them in another order than its scalar trace, which only changes the work: breakTies() settles equal t
+template <typename S>
+bool leftIsNearer(typename S::Mask leftMask, typename S::Float tLeft, typename S::Mask rightMask, typename S::Float tRight)
+{
+    typename S::Float infinity = S::set1(PACKET_INFINITY);
+    return S::reduceMin(S::select(leftMask, tLeft, infinity)) <= S::reduceMin(S::select(rightMask, tRight, infinity));
+}
+
+// isCloserHit() of CpuRay.h for the lanes of hitBits whose t equals their closest hit so far: clears the ones
+// that keep their hit, the lower instance, geometry and primitive index wins the tie
+template <typename S>
+uint32_t breakTies(
+    uint32_t hitBits,
+    typename S::Float t,
+    typename S::Float tMax,
+    uint32_t instanceIndex,
+    const CpuTriangle& triangle,
+    const CpuHitPacket& hits
+)
+{
+    // t passed t <= tMax, so t >= tMax is a tie
+    uint32_t tieBits = hitBits & S::bits(S::cmpGe(t, tMax));
+    for (uint32_t lane = 0; lane < S::WIDTH; ++lane)
+    {
+        if ((tieBits & (1u << lane)) == 0 || hits.primitiveIndex[lane] == UINT32_MAX)
+        {
+            continue;
+        }
+        bool closer = instanceIndex != hits.instanceIndex[lane] ? instanceIndex < hits.instanceIndex[lane]
+            : triangle.geometryIndex != hits.geometryIndex[lane] ? triangle.geometryIndex < hits.geometryIndex[lane]
+            : triangle.primitiveIndex < hits.primitiveIndex[lane];
+        if (!closer)
+        {
+            hitBits &= ~(1u << lane);
+        }
+    }
+    return hitBits;
+}
+
+template <typename S>
+struct PacketStackEntry
+{
+    uint32_t nodeIndex;
+    typename S::Mask lanes;
+    typename S::Float tEntry;
+};
+
+// traverseBvh() of CpuBvh.h for a packet: calls leafFn(firstPrim, primCount, lanes) for every leaf with the
+// lanes whose own box tests reach it, and drops a lane from a subtree wherever traverseBvh would skip it for
+// that ray, so a lane never tests a triangle its scalar trace would not. leafFn may shorten tMax and clear
+// lanes of active, it returns false to stop
+template <typename S, typename LeafFn>
+void traversePacket(
+    const CpuBvhNode* nodes,
+    const PacketRays<S>& rays,
+    typename S::Float tMin,
+    const typename S::Float& tMax,
+    const typename S::Mask& active,
+    LeafFn&& leafFn
+)
+{
+    using Float = typename S::Float;
+    using Mask = typename S::Mask;
+
+    Float tEntry;
+    Mask lanes = S::maskAnd(intersectBoxPacket<S>(nodes[0], rays, tMin, tMax, tEntry), active);
+    if (S::bits(lanes) == 0)
+    {
+        return;
+    }
+
+    PacketStackEntry<S> stack[PACKET_STACK_SIZE];
+    uint32_t stackSize = 0;
+    uint32_t nodeIndex = 0;
+
+    while (true)
+    {
+        const CpuBvhNode& node = nodes[nodeIndex];
+        if (node.primCount != 0)
+        {
+            if (!leafFn(node.leftOrFirst, node.primCount, lanes))
+            {
+                return;
+            }
+        }
+        else
+        {
+            Float tLeft;
+            Float tRight;
+            Mask left = S::maskAnd(intersectBoxPacket<S>(nodes[node.leftOrFirst], rays, tMin, tMax, tLeft), lanes);
+            Mask right = S::maskAnd(intersectBoxPacket<S>(nodes[node.leftOrFirst + 1], rays, tMin, tMax, tRight), lanes);
+            bool hitLeft = S::bits(left) != 0;
+            bool hitRight = S::bits(right) != 0;
+            if (hitLeft && hitRight)
+            {
+                if (leftIsNearer<S>(left, tLeft, right, tRight))
+                {
+                    stack[stackSize++] = {node.leftOrFirst + 1, right, tRight};
+                    nodeIndex = node.leftOrFirst;
+                    lanes = left;
+                }
+                else
+                {
+                    stack[stackSize++] = {node.leftOrFirst, left, tLeft};
+                    nodeIndex = node.leftOrFirst + 1;
+                    lanes = right;
+                }
+                continue;
+            }
+            if (hitLeft || hitRight)
+            {
+                nodeIndex = hitLeft ? node.leftOrFirst : node.leftOrFirst + 1;
+                lanes = hitLeft ? left : right;
+                continue;
+            }
+        }
+
+        // pop, skipping the lanes whose closest hit is now in front of the subtree
+        do
+        {
+            if (stackSize == 0)
+            {
+                return;
+            }
+            --stackSize;
+            lanes = S::maskAnd(S::maskAnd(stack[stackSize].lanes, active), S::cmpLe(stack[stackSize].tEntry, tMax));
+        }
+        while (S::bits(lanes) == 0);
+        nodeIndex = stack[stackSize].nodeIndex;
+    }
+}
+
+// closest-hit traversal of one BLAS traced for instanceIndex, returns the lanes whose hit moved to this BLAS
+template <typename S>
+typename S::Mask traceBlasPacket(
+    const CpuBvhNode* nodes,
+    const CpuTriangle* triangles,
+    uint32_t instanceIndex,
+    const PacketRays<S>& rays,
+    typename S::Float tMin,
+    typename S::Float& tMax,
+    typename S::Float& u,
+    typename S::Float& v,
+    typename S::Mask& active,
+    CpuCullMode cull,
+    bool acceptFirstHit,
+    CpuHitPacket& hits
+)
+{
+    using Float = typename S::Float;
+    using Mask = typename S::Mask;
+
+    Mask hitLanes = S::fromBits(0);
+    traversePacket<S>(nodes, rays, tMin, tMax, active, [&](uint32_t first, uint32_t count, Mask lanes) {
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            Float t;
+            Float triangleU;
+            Float triangleV;
+            Mask hit = S::maskAnd(
+                intersectTrianglePacket<S>(triangles[i], rays, tMin, tMax, cull, t, triangleU, triangleV),
+                lanes
+            );
+            uint32_t hitBits = S::bits(hit);
+            if (hitBits == 0)
+            {
+                continue;
+            }
+            hitBits = breakTies<S>(hitBits, t, tMax, instanceIndex, triangles[i], hits);
+            if (hitBits == 0)
+            {
+                continue;
+            }
+            hit = S::fromBits(hitBits);
+
+            tMax = S::select(hit, t, tMax);
+            u = S::select(hit, triangleU, u);
+            v = S::select(hit, triangleV, v);
+            hitLanes = S::maskOr(hitLanes, hit);
+            for (uint32_t lane = 0; lane < S::WIDTH; ++lane)
+            {
+                if (hitBits & (1u << lane))
+                {
+                    hits.primitiveIndex[lane] = triangles[i].primitiveIndex;
+                    hits.geometryIndex[lane] = triangles[i].geometryIndex;
+                    hits.instanceIndex[lane] = instanceIndex;
+                }
+            }
+
+            if (acceptFirstHit)
+            {
+                active = S::maskAndNot(hit, active);
+                lanes = S::maskAndNot(hit, lanes);
+                if (S::bits(active) == 0)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    });
+    return hitLanes;
+}
+
+template <typename S>
+void tracePacket(
+    const CpuPacketScene& scene,
+    const CpuRayPacket& rays,
+    uint32_t activeMask,
+    uint32_t rayFlags,
+    uint32_t instanceInclusionMask,
+    CpuHitPacket& hits
+)
+{
+    using Float = typename S::Float;
+    using Mask = typename S::Mask;
+
+    for (uint32_t lane = 0; lane < S::WIDTH; ++lane)
+    {
+        hits.t[lane] = PACKET_INFINITY;
+        hits.u[lane] = 0.0f;
+        hits.v[lane] = 0.0f;
+        hits.primitiveIndex[lane] = UINT32_MAX;
+        hits.geometryIndex[lane] = 0;
+        hits.instanceIndex[lane] = 0;
+        hits.instanceID[lane] = 0;
+        hits.instanceContributionToHitGroupIndex[lane] = 0;
+    }
+
+    Mask active = S::fromBits(activeMask & ((1u << S::WIDTH) - 1));
+    if (scene.tlasNodeCount == 0 || S::bits(active) == 0)
+    {
+        return;
+    }
+
+    Float one = S::set1(1.0f);
+    PacketRays<S> worldRays;
+    worldRays.originX = S::load(rays.originX);
+    worldRays.originY = S::load(rays.originY);
+    worldRays.originZ = S::load(rays.originZ);
+    worldRays.directionX = S::load(rays.directionX);
+    worldRays.directionY = S::load(rays.directionY);
+    worldRays.directionZ = S::load(rays.directionZ);
+    worldRays.invDirectionX = S::div(one, worldRays.directionX);
+    worldRays.invDirectionY = S::div(one, worldRays.directionY);
+    worldRays.invDirectionZ = S::div(one, worldRays.directionZ);
+    Float tMin = S::load(rays.tMin);
+    Float tMax = S::load(rays.tMax);
+    Float u = S::set1(0.0f);
+    Float v = S::set1(0.0f);
+    Mask hitLanes = S::fromBits(0);
+
+    bool acceptFirstHit = (rayFlags & CPU_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH) != 0;
+
+    traversePacket<S>(scene.tlasNodes, worldRays, tMin, tMax, active, [&](uint32_t first, uint32_t count, Mask lanes) {
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            const CpuTlasInstance& instance = scene.instances[i];
+            if ((instance.instanceMask & instanceInclusionMask) == 0)
+            {
+                continue;
+            }
+
+            const float (*m)[4] = instance.worldToObject;
+            PacketRays<S> objectRays;
+            objectRays.originX = transformPacket<S>(m[0], worldRays.originX, worldRays.originY, worldRays.originZ);
+            objectRays.originY = transformPacket<S>(m[1], worldRays.originX, worldRays.originY, worldRays.originZ);
+            objectRays.originZ = transformPacket<S>(m[2], worldRays.originX, worldRays.originY, worldRays.originZ);
+            objectRays.directionX = dotPacket<S>(S::set1(m[0][0]), S::set1(m[0][1]), S::set1(m[0][2]), worldRays.directionX, worldRays.directionY, worldRays.directionZ);
+            objectRays.directionY = dotPacket<S>(S::set1(m[1][0]), S::set1(m[1][1]), S::set1(m[1][2]), worldRays.directionX, worldRays.directionY, worldRays.directionZ);
+            objectRays.directionZ = dotPacket<S>(S::set1(m[2][0]), S::set1(m[2][1]), S::set1(m[2][2]), worldRays.directionX, worldRays.directionY, worldRays.directionZ);
+            objectRays.invDirectionX = S::div(one, objectRays.directionX);
+            objectRays.invDirectionY = S::div(one, objectRays.directionY);
+            objectRays.invDirectionZ = S::div(one, objectRays.directionZ);
+
+            // only the lanes that reached this leaf enter the BLAS, the ones it finishes leave the whole trace
+            Mask entering = S::maskAnd(lanes, active);
+            Mask remaining = entering;
+            Mask instanceHits = traceBlasPacket<S>(
+                instance.blasNodes,
+                instance.blasTriangles,
+                instance.instanceIndex,
+                objectRays,
+                tMin,
+                tMax,
+                u,
+                v,
+                remaining,
+                scene.cullModes[instance.flags & 0x3],
+                acceptFirstHit,
+                hits
+            );
+            Mask finished = S::maskAndNot(remaining, entering);
+            active = S::maskAndNot(finished, active);
+            lanes = S::maskAndNot(finished, lanes);
+
+            uint32_t instanceBits = S::bits(instanceHits);
+            if (instanceBits != 0)
+            {
+                hitLanes = S::maskOr(hitLanes, instanceHits);
+                for (uint32_t lane = 0; lane < S::WIDTH; ++lane)
+                {
+                    if (instanceBits & (1u << lane))
+                    {
+                        hits.instanceID[lane] = instance.instanceID;
+                        hits.instanceContributionToHitGroupIndex[lane] = instance.instanceContributionToHitGroupIndex;
+                    }
+                }
+            }
+
+            if (S::bits(active) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    // only lanes that hit report t and barycentrics
+    Float infinity = S::set1(PACKET_INFINITY);
+    S::store(hits.t, S::select(hitLanes, tMax, infinity));
+    S::store(hits.u, u);
+    S::store(hits.v, v);
+}
+}
+
+#endif
+
+#endif //CPUPACKETKERNEL_H
@@ -0,0 +1,137 @@
+#ifndef CPURAY_H
+#define CPURAY_H
+
+#include <cstdint>
+#include <limits>
+
+#include "CpuMath.h"
+
+// mirrors HLSL RayDesc
+struct CpuRay
+{
+    Float3 origin;
+    float tMin;
+    Float3 direction;
+    float tMax;
+};
+
+// HLSL RAY_FLAG values
+enum CpuRayFlag : uint32_t
+{
+    CPU_RAY_FLAG_NONE = 0x00,
+    CPU_RAY_FLAG_FORCE_OPAQUE = 0x01,
+    CPU_RAY_FLAG_FORCE_NON_OPAQUE = 0x02,
+    CPU_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH = 0x04,
+    CPU_RAY_FLAG_SKIP_CLOSEST_HIT_SHADER = 0x08,
+    CPU_RAY_FLAG_CULL_BACK_FACING_TRIANGLES = 0x10,
+    CPU_RAY_FLAG_CULL_FRONT_FACING_TRIANGLES = 0x20,
+    CPU_RAY_FLAG_CULL_OPAQUE = 0x40,
+    CPU_RAY_FLAG_CULL_NON_OPAQUE = 0x80
+};
+
+// winding, as seen from the ray origin, of the triangles a test rejects
+enum class CpuCullMode
+{
+    None,
+    Clockwise,
+    CounterClockwise
+};
+
+// closest hit record, BuiltInTriangleIntersectionAttributes + the system values a hit shader can query
+struct CpuHit
+{
+    float t = std::numeric_limits<float>::infinity();
+    Float2 barycentrics = {0.0f, 0.0f};
+    uint32_t primitiveIndex = UINT32_MAX;
+    uint32_t geometryIndex = 0;
+    uint32_t instanceIndex = 0;
+    uint32_t instanceID = 0;
+    uint32_t instanceContributionToHitGroupIndex = 0;
+
+    bool hasHit() const
+    {
+        return primitiveIndex != UINT32_MAX;
+    }
+
+    // index of the hit group record in the hit group table, as addressed by TraceRay
+    uint32_t hitGroupIndex(
+        uint32_t rayContributionToHitGroupIndex,
+        uint32_t multiplierForGeometryContributionToHitGroupIndex
+    ) const
+    {
+        return rayContributionToHitGroupIndex
+            + multiplierForGeometryContributionToHitGroupIndex * geometryIndex
+            + instanceContributionToHitGroupIndex;
+    }
+};
+
+// whether a hit at t on the given triangle replaces hit. equal distances, e.g. on an edge two triangles
+// share, go to the lower instance, geometry and primitive index, so the closest hit does not depend on the
+// order a traversal visits the triangles in. CpuPacketKernel.h repeats this per lane
+inline bool isCloserHit(float t, uint32_t instanceIndex, uint32_t geometryIndex, uint32_t primitiveIndex, const CpuHit& hit)
+{
+    if (!hit.hasHit() || t != hit.t)
+    {
+        return !hit.hasHit() || t < hit.t;
+    }
+    if (instanceIndex != hit.instanceIndex)
+    {
+        return instanceIndex < hit.instanceIndex;
+    }
+    if (geometryIndex != hit.geometryIndex)
+    {
+        return geometryIndex < hit.geometryIndex;
+    }
+    return primitiveIndex < hit.primitiveIndex;
+}
+
+// Moller-Trumbore, barycentrics follow the DXR convention (x weights v1, y weights v2)
+inline bool intersectTriangle(
+    const CpuRay& ray,
+    const Float3& v0,
+    const Float3& v1,
+    const Float3& v2,
+    float& t,
+    Float2& barycentrics,
+    CpuCullMode cull = CpuCullMode::None
+)
+{
+    Float3 e1 = v1 - v0;
+    Float3 e2 = v2 - v0;
+    Float3 p = cross(ray.direction, e2);
+    float det = dot(e1, p);
+    // det > 0 when the vertices appear clockwise from the ray origin
+    if (det == 0.0f
+        || (cull == CpuCullMode::Clockwise && det > 0.0f)
+        || (cull == CpuCullMode::CounterClockwise && det < 0.0f))
+    {
+        return false;
+    }
+
+    float invDet = 1.0f / det;
+    Float3 s = ray.origin - v0;
+    float u = dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f)
+    {
+        return false;
+    }
+
+    Float3 q = cross(s, e1);
+    float v = dot(ray.direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f)
+    {
+        return false;
+    }
+
+    float hitT = dot(e2, q) * invDet;
+    if (hitT < ray.tMin || hitT > ray.tMax)
+    {
+        return false;
+    }
+
+    t = hitT;
+    barycentrics = {u, v};
+    return true;
+}
+
+#endif //CPURAY_H
@@ -0,0 +1,514 @@
+#include "CpuSbvhBuilder.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+constexpr uint32_t MAX_BIN_COUNT = 64;
+
+struct ObjectBin
+{
+    CpuAabb bounds;
+    uint32_t count = 0;
+};
+
+// a reference starts in one bin and ends in another, the parts in between are clipped to each bin
+struct SpatialBin
+{
+    CpuAabb bounds;
+    uint32_t entries = 0;
+    uint32_t exits = 0;
+};
+
+void atomicMax(std::atomic<uint32_t>& target, uint32_t value)
+{
+    uint32_t current = target.load(std::memory_order_relaxed);
+    while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+CpuAabb intersect(const CpuAabb& a, const CpuAabb& b)
+{
+    return {max(a.min, b.min), min(a.max, b.max)};
+}
+
+uint32_t spatialBin(const CpuAabb& bounds, int axis, float scale, uint32_t binCount, float value)
+{
+    return std::min(binCount - 1, static_cast<uint32_t>(std::max(0.0f, (value - bounds.min[axis]) * scale)));
+}
+}
+
+CpuSbvhBuilder::CpuSbvhBuilder(const CpuBvhBuildOptions& options)
+    : m_options(options)
+{
+    m_options.maxLeafSize = std::max(1u, m_options.maxLeafSize);
+    m_options.binCount = std::clamp(m_options.binCount, 2u, MAX_BIN_COUNT);
+    m_options.spatialSplitGrowth = std::max(1.0f, m_options.spatialSplitGrowth);
+    if (m_options.threadCount == 0)
+    {
+        m_options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+CpuBvh CpuSbvhBuilder::build(std::span<const Float3> triangleVertices)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    m_vertices = triangleVertices;
+    uint32_t primCount = static_cast<uint32_t>(triangleVertices.size() / 3);
+    uint32_t maxReferences = std::max(
+        primCount,
+        static_cast<uint32_t>(static_cast<double>(primCount) * m_options.spatialSplitGrowth)
+    );
+
+    std::vector<Reference> references(primCount);
+    CpuAabb rootBounds;
+    for (uint32_t prim = 0; prim < primCount; ++prim)
+    {
+        Reference& reference = references[prim];
+        reference.prim = prim;
+        reference.bounds.grow(triangleVertices[prim * 3]);
+        reference.bounds.grow(triangleVertices[prim * 3 + 1]);
+        reference.bounds.grow(triangleVertices[prim * 3 + 2]);
+        rootBounds.grow(reference.bounds);
+    }
+    m_rootArea = rootBounds.surfaceArea();
+
+    m_nodeCount = 0;
+    m_referenceCount = 0;
+    m_leafCount = 0;
+    m_maxDepth = 0;
+    m_spatialSplitCount = 0;
+    m_activeTasks = 0;
+
+    if (primCount > 0)
+    {
+        // the budget keeps the references, and so the leaves, below maxReferences
+        m_primIndices.resize(maxReferences);
+        m_nodes.resize(maxReferences * 2 - 1);
+        m_nodeCount = 1;
+        buildNode(0, std::move(references), maxReferences - primCount, 0);
+    }
+
+    CpuBvh bvh;
+    m_nodes.resize(m_nodeCount);
+    m_primIndices.resize(m_referenceCount);
+    bvh.nodes = std::move(m_nodes);
+    bvh.primIndices = std::move(m_primIndices);
+    m_vertices = {};
+
+    m_stats.nodeCount = static_cast<uint32_t>(bvh.nodes.size());
+    m_stats.leafCount = m_leafCount;
+    m_stats.maxDepth = m_maxDepth;
+    m_stats.referenceCount = static_cast<uint32_t>(bvh.primIndices.size());
+    m_stats.spatialSplitCount = m_spatialSplitCount;
+    m_stats.sahCost = bvh.sahCost(m_options.traversalCost, m_options.intersectionCost);
+    m_stats.buildTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return bvh;
+}
+
+void CpuSbvhBuilder::makeLeaf(CpuBvhNode& node, std::span<const Reference> references)
+{
+    uint32_t first = m_referenceCount.fetch_add(static_cast<uint32_t>(references.size()), std::memory_order_relaxed);
+    for (uint32_t i = 0; i < references.size(); ++i)
+    {
+        m_primIndices[first + i] = references[i].prim;
+    }
+    node.leftOrFirst = first;
+    node.primCount = static_cast<uint32_t>(references.size());
+    m_leafCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CpuSbvhBuilder::buildNode(uint32_t nodeIndex, std::vector<Reference> references, uint32_t budget, uint32_t depth)
+{
+    CpuBvhNode& node = m_nodes[nodeIndex];
+    atomicMax(m_maxDepth, depth);
+
+    CpuAabb bounds;
+    CpuAabb centroidBounds;
+    for (const Reference& reference : references)
+    {
+        bounds.grow(reference.bounds);
+        centroidBounds.grow(reference.bounds.centroid());
+    }
+    node.boundsMin = bounds.min;
+    node.boundsMax = bounds.max;
+
+    uint32_t count = static_cast<uint32_t>(references.size());
+    if (count <= 1 || depth + 1 >= CpuBvh::MAX_DEPTH)
+    {
+        makeLeaf(node, references);
+        return;
+    }
+
+    float parentArea = bounds.surfaceArea();
+    ObjectSplit objectSplit = findObjectSplit(references, centroidBounds, parentArea);
+
+    // spatial splits only pay off where the object split leaves the children overlapping
+    SpatialSplit spatialSplit;
+    if (budget > 0
+        && (objectSplit.axis < 0
+            || intersect(objectSplit.leftBounds, objectSplit.rightBounds).surfaceArea()
+                > m_options.spatialSplitOverlap * m_rootArea))
+    {
+        spatialSplit = findSpatialSplit(references, bounds, parentArea, budget);
+    }
+
+    float leafCost = m_options.intersectionCost * count;
+    float bestCost = std::min(objectSplit.cost, spatialSplit.cost);
+    if (count <= m_options.maxLeafSize && bestCost >= leafCost)
+    {
+        makeLeaf(node, references);
+        return;
+    }
+
+    std::vector<Reference> left;
+    std::vector<Reference> right;
+    if (spatialSplit.cost < objectSplit.cost)
+    {
+        splitSpatial(references, spatialSplit, bounds, left, right);
+        if (left.empty() || right.empty())
+        {
+            left.clear();
+            right.clear();
+        }
+        else
+        {
+            m_spatialSplitCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (left.empty() && right.empty())
+    {
+        splitObject(references, objectSplit, centroidBounds, left, right);
+    }
+
+    // children get what is left of the budget in proportion to their references
+    uint32_t childReferences = static_cast<uint32_t>(left.size() + right.size());
+    uint32_t remainingBudget = budget - (childReferences - count);
+    uint32_t leftBudget = static_cast<uint32_t>(static_cast<uint64_t>(remainingBudget) * left.size() / childReferences);
+    uint32_t rightBudget = remainingBudget - leftBudget;
+    std::vector<Reference>().swap(references);
+
+    uint32_t leftIndex = m_nodeCount.fetch_add(2, std::memory_order_relaxed);
+    node.leftOrFirst = leftIndex;
+    node.primCount = 0;
+
+    bool spawn = false;
+    if (count >= m_options.parallelThreshold)
+    {
+        spawn = m_activeTasks.fetch_add(1, std::memory_order_relaxed) + 1 < m_options.threadCount;
+        if (!spawn)
+        {
+            m_activeTasks.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (spawn)
+    {
+        std::thread worker(&CpuSbvhBuilder::buildNode, this, leftIndex, std::move(left), leftBudget, depth + 1);
+        buildNode(leftIndex + 1, std::move(right), rightBudget, depth + 1);
+        worker.join();
+        m_activeTasks.fetch_sub(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        buildNode(leftIndex, std::move(left), leftBudget, depth + 1);
+        buildNode(leftIndex + 1, std::move(right), rightBudget, depth + 1);
+    }
+}
+
+CpuSbvhBuilder::ObjectSplit CpuSbvhBuilder::findObjectSplit(
+    std::span<const Reference> references,
+    const CpuAabb& centroidBounds,
+    float parentArea
+) const
+{
+    ObjectSplit best;
+    uint32_t binCount = m_options.binCount;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+
+        std::array<ObjectBin, MAX_BIN_COUNT> bins = {};
+        float scale = static_cast<float>(binCount) / extent;
+        for (const Reference& reference : references)
+        {
+            uint32_t binIndex = std::min(
+                binCount - 1,
+                static_cast<uint32_t>((reference.bounds.centroid()[axis] - centroidBounds.min[axis]) * scale)
+            );
+            bins[binIndex].count++;
+            bins[binIndex].bounds.grow(reference.bounds);
+        }
+
+        std::array<CpuAabb, MAX_BIN_COUNT> rightBounds = {};
+        std::array<uint32_t, MAX_BIN_COUNT> rightCount = {};
+        CpuAabb accumulated;
+        uint32_t accumulatedCount = 0;
+        for (uint32_t i = binCount - 1; i > 0; --i)
+        {
+            accumulated.grow(bins[i].bounds);
+            accumulatedCount += bins[i].count;
+            rightBounds[i] = accumulated;
+            rightCount[i] = accumulatedCount;
+        }
+
+        accumulated = {};
+        accumulatedCount = 0;
+        for (uint32_t i = 1; i < binCount; ++i)
+        {
+            accumulated.grow(bins[i - 1].bounds);
+            accumulatedCount += bins[i - 1].count;
+            if (accumulatedCount == 0 || rightCount[i] == 0)
+            {
+                continue;
+            }
+
+            float cost = m_options.traversalCost + m_options.intersectionCost
+                * (accumulated.surfaceArea() * accumulatedCount + rightBounds[i].surfaceArea() * rightCount[i]) / parentArea;
+            if (cost < best.cost)
+            {
+                best = {cost, axis, i, accumulated, rightBounds[i]};
+            }
+        }
+    }
+    return best;
+}
+
+CpuSbvhBuilder::SpatialSplit CpuSbvhBuilder::findSpatialSplit(
+    std::span<const Reference> references,
+    const CpuAabb& bounds,
+    float parentArea,
+    uint32_t budget
+) const
+{
+    SpatialSplit best;
+    uint32_t binCount = m_options.binCount;
+    uint32_t count = static_cast<uint32_t>(references.size());
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float extent = bounds.max[axis] - bounds.min[axis];
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+
+        std::array<SpatialBin, MAX_BIN_COUNT> bins = {};
+        float scale = static_cast<float>(binCount) / extent;
+        float binWidth = extent / static_cast<float>(binCount);
+        for (const Reference& reference : references)
+        {
+            uint32_t firstBin = spatialBin(bounds, axis, scale, binCount, reference.bounds.min[axis]);
+            uint32_t lastBin = spatialBin(bounds, axis, scale, binCount, reference.bounds.max[axis]);
+            bins[firstBin].entries++;
+            bins[lastBin].exits++;
+            if (firstBin == lastBin)
+            {
+                bins[firstBin].bounds.grow(reference.bounds);
+                continue;
+            }
+
+            for (uint32_t bin = firstBin; bin <= lastBin; ++bin)
+            {
+                float lo = bin == firstBin ? reference.bounds.min[axis] : bounds.min[axis] + binWidth * bin;
+                float hi = bin == lastBin ? reference.bounds.max[axis] : bounds.min[axis] + binWidth * (bin + 1);
+                CpuAabb clipped = clipReference(reference.prim, reference.bounds, axis, lo, hi);
+                if (clipped.valid())
+                {
+                    bins[bin].bounds.grow(clipped);
+                }
+            }
+        }
+
+        std::array<CpuAabb, MAX_BIN_COUNT> rightBounds = {};
+        std::array<uint32_t, MAX_BIN_COUNT> rightCount = {};
+        CpuAabb accumulated;
+        uint32_t accumulatedCount = 0;
+        for (uint32_t i = binCount - 1; i > 0; --i)
+        {
+            accumulated.grow(bins[i].bounds);
+            accumulatedCount += bins[i].exits;
+            rightBounds[i] = accumulated;
+            rightCount[i] = accumulatedCount;
+        }
+
+        accumulated = {};
+        accumulatedCount = 0;
+        for (uint32_t i = 1; i < binCount; ++i)
+        {
+            accumulated.grow(bins[i - 1].bounds);
+            accumulatedCount += bins[i - 1].entries;
+            if (accumulatedCount == 0 || rightCount[i] == 0 || accumulatedCount + rightCount[i] - count > budget)
+            {
+                continue;
+            }
+
+            float cost = m_options.traversalCost + m_options.intersectionCost
+                * (accumulated.surfaceArea() * accumulatedCount + rightBounds[i].surfaceArea() * rightCount[i]) / parentArea;
+            if (cost < best.cost)
+            {
+                best = {
+                    .cost = cost,
+                    .axis = axis,
+                    .plane = bounds.min[axis] + binWidth * i,
+                    .bin = i,
+                    .leftCount = accumulatedCount,
+                    .rightCount = rightCount[i],
+                    .leftBounds = accumulated,
+                    .rightBounds = rightBounds[i]
+                };
+            }
+        }
+    }
+    return best;
+}
+
+void CpuSbvhBuilder::splitObject(
+    std::span<const Reference> references,
+    const ObjectSplit& split,
+    const CpuAabb& centroidBounds,
+    std::vector<Reference>& left,
+    std::vector<Reference>& right
+) const
+{
+    // without a usable axis every centroid coincides and the references are split in order
+    if (split.axis >= 0)
+    {
+        int axis = split.axis;
+        uint32_t binCount = m_options.binCount;
+        float scale = static_cast<float>(binCount) / (centroidBounds.max[axis] - centroidBounds.min[axis]);
+        for (const Reference& reference : references)
+        {
+            uint32_t binIndex = std::min(
+                binCount - 1,
+                static_cast<uint32_t>((reference.bounds.centroid()[axis] - centroidBounds.min[axis]) * scale)
+            );
+            (binIndex < split.bin ? left : right).push_back(reference);
+        }
+    }
+    if (left.empty() || right.empty())
+    {
+        size_t mid = references.size() / 2;
+        left.assign(references.begin(), references.begin() + mid);
+        right.assign(references.begin() + mid, references.end());
+    }
+}
+
+void CpuSbvhBuilder::splitSpatial(
+    std::span<const Reference> references,
+    const SpatialSplit& split,
+    const CpuAabb& bounds,
+    std::vector<Reference>& left,
+    std::vector<Reference>& right
+) const
+{
+    int axis = split.axis;
+    uint32_t binCount = m_options.binCount;
+    float scale = static_cast<float>(binCount) / (bounds.max[axis] - bounds.min[axis]);
+
+    // the bins decide which side a reference is on, so the split matches the cost findSpatialSplit computed
+    CpuAabb leftBounds = split.leftBounds;
+    CpuAabb rightBounds = split.rightBounds;
+    float leftCount = static_cast<float>(split.leftCount);
+    float rightCount = static_cast<float>(split.rightCount);
+    for (const Reference& reference : references)
+    {
+        uint32_t firstBin = spatialBin(bounds, axis, scale, binCount, reference.bounds.min[axis]);
+        uint32_t lastBin = spatialBin(bounds, axis, scale, binCount, reference.bounds.max[axis]);
+        if (lastBin < split.bin)
+        {
+            left.push_back(reference);
+            continue;
+        }
+        if (firstBin >= split.bin)
+        {
+            right.push_back(reference);
+            continue;
+        }
+
+        Reference leftPart = {clipReference(reference.prim, reference.bounds, axis, reference.bounds.min[axis], split.plane), reference.prim};
+        Reference rightPart = {clipReference(reference.prim, reference.bounds, axis, split.plane, reference.bounds.max[axis]), reference.prim};
+        if (!leftPart.bounds.valid() || !rightPart.bounds.valid())
+        {
+            // the triangle misses one side of the plane inside this box
+            if (leftPart.bounds.valid())
+            {
+                left.push_back(leftPart);
+            }
+            else if (rightPart.bounds.valid())
+            {
+                right.push_back(rightPart);
+            }
+            else
+            {
+                left.push_back(reference);
+            }
+            continue;
+        }
+
+        // reference unsplitting: keep the whole reference on one side when that is cheaper than duplicating it
+        CpuAabb leftUnsplit = leftBounds;
+        leftUnsplit.grow(reference.bounds);
+        CpuAabb rightUnsplit = rightBounds;
+        rightUnsplit.grow(reference.bounds);
+        float duplicateCost = leftBounds.surfaceArea() * leftCount + rightBounds.surfaceArea() * rightCount;
+        float leftOnlyCost = leftUnsplit.surfaceArea() * leftCount + rightBounds.surfaceArea() * (rightCount - 1.0f);
+        float rightOnlyCost = leftBounds.surfaceArea() * (leftCount - 1.0f) + rightUnsplit.surfaceArea() * rightCount;
+        if (leftOnlyCost < duplicateCost && leftOnlyCost <= rightOnlyCost)
+        {
+            left.push_back(reference);
+            leftBounds = leftUnsplit;
+            rightCount -= 1.0f;
+        }
+        else if (rightOnlyCost < duplicateCost)
+        {
+            right.push_back(reference);
+            rightBounds = rightUnsplit;
+            leftCount -= 1.0f;
+        }
+        else
+        {
+            left.push_back(leftPart);
+            right.push_back(rightPart);
+        }
+    }
+}
+
+CpuAabb CpuSbvhBuilder::clipReference(uint32_t prim, const CpuAabb& clip, int axis, float lo, float hi) const
+{
+    // the polygon left of clipping a triangle to a slab is bounded by the vertices inside the slab and the
+    // points where the edges cross its planes
+    CpuAabb bounds;
+    const Float3* vertices = &m_vertices[prim * 3];
+    for (int i = 0; i < 3; ++i)
+    {
+        const Float3& a = vertices[i];
+        const Float3& b = vertices[(i + 1) % 3];
+        if (a[axis] >= lo && a[axis] <= hi)
+        {
+            bounds.grow(a);
+        }
+        for (float plane : {lo, hi})
+        {
+            if ((a[axis] < plane) != (b[axis] < plane))
+            {
+                Float3 crossing = a + (b - a) * ((plane - a[axis]) / (b[axis] - a[axis]));
+                crossing[axis] = plane;
+                bounds.grow(crossing);
+            }
+        }
+    }
+    return intersect(bounds, clip);
+}
@@ -0,0 +1,97 @@
+#ifndef CPUSBVHBUILDER_H
+#define CPUSBVHBUILDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "CpuBvhBuilder.h"
+
+// spatial split BVH (Stich et al. 2009). every node also considers cutting the node box with a plane and
+// clipping the straddling triangles into both children, which removes the overlap long diagonal triangles
+// cause. the duplicated references are bounded by spatialSplitGrowth; each subtree gets a share of the
+// budget proportional to its references, so the tree does not depend on thread timing
+class CpuSbvhBuilder
+{
+public:
+    // uses the SAH options, maxLeafSize, parallelThreshold, threadCount and the spatialSplit options
+    explicit CpuSbvhBuilder(const CpuBvhBuildOptions& options = {});
+
+    // triangleVertices holds v0, v1, v2 of every primitive. primIndices of the result may repeat primitives
+    CpuBvh build(std::span<const Float3> triangleVertices);
+
+    const CpuBvhBuildStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    struct Reference
+    {
+        CpuAabb bounds; // the part of the triangle inside the node, after clipping
+        uint32_t prim;
+    };
+
+    struct ObjectSplit
+    {
+        float cost = std::numeric_limits<float>::infinity();
+        int axis = -1;
+        uint32_t bin = 0;
+        CpuAabb leftBounds = {};
+        CpuAabb rightBounds = {};
+    };
+
+    struct SpatialSplit
+    {
+        float cost = std::numeric_limits<float>::infinity();
+        int axis = -1;
+        float plane = 0.0f;
+        uint32_t bin = 0;
+        uint32_t leftCount = 0;
+        uint32_t rightCount = 0;
+        CpuAabb leftBounds = {};
+        CpuAabb rightBounds = {};
+    };
+
+    void buildNode(uint32_t nodeIndex, std::vector<Reference> references, uint32_t budget, uint32_t depth);
+    void makeLeaf(CpuBvhNode& node, std::span<const Reference> references);
+
+    ObjectSplit findObjectSplit(std::span<const Reference> references, const CpuAabb& centroidBounds, float parentArea) const;
+    SpatialSplit findSpatialSplit(std::span<const Reference> references, const CpuAabb& bounds, float parentArea, uint32_t budget) const;
+    void splitObject(
+        std::span<const Reference> references,
+        const ObjectSplit& split,
+        const CpuAabb& centroidBounds,
+        std::vector<Reference>& left,
+        std::vector<Reference>& right
+    ) const;
+    void splitSpatial(
+        std::span<const Reference> references,
+        const SpatialSplit& split,
+        const CpuAabb& bounds,
+        std::vector<Reference>& left,
+        std::vector<Reference>& right
+    ) const;
+
+    // bounds of the part of prim between lo and hi on axis, limited to clip
+    CpuAabb clipReference(uint32_t prim, const CpuAabb& clip, int axis, float lo, float hi) const;
+
+    CpuBvhBuildOptions m_options;
+    CpuBvhBuildStats m_stats;
+
+    std::span<const Float3> m_vertices;
+    float m_rootArea = 0.0f;
+    std::vector<uint32_t> m_primIndices;
+    std::vector<CpuBvhNode> m_nodes;
+
+    std::atomic<uint32_t> m_nodeCount = 0;
+    std::atomic<uint32_t> m_referenceCount = 0;
+    std::atomic<uint32_t> m_leafCount = 0;
+    std::atomic<uint32_t> m_maxDepth = 0;
+    std::atomic<uint32_t> m_spatialSplitCount = 0;
+    std::atomic<uint32_t> m_activeTasks = 0;
+};
+
+#endif //CPUSBVHBUILDER_H
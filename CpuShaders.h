@@ -0,0 +1,52 @@
+#ifndef CPUSHADERS_H
+#define CPUSHADERS_H
+
+#include <algorithm>
+#include <cstdint>
+
+#include "CpuRay.h"
+
+// C++ counterparts of the entry points in shader.hlsl, keep both in sync
+
+struct CpuPayload
+{
+    Float4 color;
+};
+
+inline CpuRay rayGen(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    float u = (static_cast<float>(x) / static_cast<float>(width)) * 2.0f - 1.0f;
+    float v = (static_cast<float>(y) / static_cast<float>(height)) * 2.0f - 1.0f;
+    v = -v;
+
+    return CpuRay{
+        .origin = {0.0f, 0.0f, -2.0f}, // Camera position
+        .tMin = 0.001f,
+        .direction = normalize(Float3{u, v, 1.0f}),
+        .tMax = 1000.0f
+    };
+}
+
+inline void missShader(CpuPayload& payload)
+{
+    payload.color = {0.0f, 0.2f, 0.8f, 1.0f};
+}
+
+inline void closestHitShader(CpuPayload& payload, const Float2& barycentrics)
+{
+    float u = barycentrics.x;
+    float v = barycentrics.y;
+    float w = 1.0f - u - v;
+    payload.color = {u, v, w, 1.0f};
+}
+
+// RWTexture2D<float4> store into a DXGI_FORMAT_R8G8B8A8_UNORM target
+inline uint32_t packUnorm8(const Float4& color)
+{
+    auto channel = [](float c) {
+        return static_cast<uint32_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+    };
+    return channel(color.x) | (channel(color.y) << 8) | (channel(color.z) << 16) | (channel(color.w) << 24);
+}
+
+#endif //CPUSHADERS_H
@@ -0,0 +1,260 @@
+#include "CpuTileScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#ifndef UNICODE
+#define UNICODE
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+uint64_t packRange(uint32_t begin, uint32_t end)
+{
+    return static_cast<uint64_t>(begin) | (static_cast<uint64_t>(end) << 32);
+}
+
+uint32_t rangeBegin(uint64_t range)
+{
+    return static_cast<uint32_t>(range);
+}
+
+uint32_t rangeEnd(uint64_t range)
+{
+    return static_cast<uint32_t>(range >> 32);
+}
+
+uint32_t spreadBits(uint32_t v)
+{
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+uint32_t morton2D(uint32_t x, uint32_t y)
+{
+    return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+void pinThread(std::thread& thread, uint32_t cpu)
+{
+#ifdef _WIN32
+    SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << (cpu % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu % CPU_SETSIZE, &cpuSet);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpuSet), &cpuSet);
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+}
+
+CpuTileScheduler::CpuTileScheduler(const CpuTileSchedulerOptions& options)
+{
+    setTileSize(options.tileWidth, options.tileHeight);
+
+    uint32_t threadCount = options.threadCount;
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_ranges = std::make_unique<WorkRange[]>(threadCount);
+    m_stats.workers.resize(threadCount);
+
+    m_workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_workers.emplace_back(&CpuTileScheduler::workerMain, this, i);
+        if (!options.cpuAffinity.empty())
+        {
+            pinThread(m_workers.back(), options.cpuAffinity[i % options.cpuAffinity.size()]);
+        }
+    }
+}
+
+CpuTileScheduler::~CpuTileScheduler()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_startCondition.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void CpuTileScheduler::setTileSize(uint32_t tileWidth, uint32_t tileHeight)
+{
+    m_tileWidth = std::max(1u, tileWidth);
+    m_tileHeight = std::max(1u, tileHeight);
+}
+
+void CpuTileScheduler::dispatch(uint32_t width, uint32_t height, const std::function<void(const CpuTile&)>& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    uint32_t tilesX = (width + m_tileWidth - 1) / m_tileWidth;
+    uint32_t tilesY = (height + m_tileHeight - 1) / m_tileHeight;
+
+    // Morton order keeps consecutive tiles, and so each worker's run, spatially close
+    std::vector<std::pair<uint32_t, uint32_t>> order;
+    order.reserve(static_cast<size_t>(tilesX) * tilesY);
+    for (uint32_t ty = 0; ty < tilesY; ++ty)
+    {
+        for (uint32_t tx = 0; tx < tilesX; ++tx)
+        {
+            order.emplace_back(morton2D(tx, ty), ty * tilesX + tx);
+        }
+    }
+    std::ranges::sort(order);
+
+    m_tiles.clear();
+    m_tiles.reserve(order.size());
+    for (const auto& [code, tileIndex] : order)
+    {
+        uint32_t x = (tileIndex % tilesX) * m_tileWidth;
+        uint32_t y = (tileIndex / tilesX) * m_tileHeight;
+        m_tiles.push_back({
+            .x = x,
+            .y = y,
+            .width = std::min(m_tileWidth, width - x),
+            .height = std::min(m_tileHeight, height - y)
+        });
+    }
+
+    uint32_t tileCount = static_cast<uint32_t>(m_tiles.size());
+    uint32_t workerCount = threadCount();
+    uint32_t chunk = (tileCount + workerCount - 1) / workerCount;
+    for (uint32_t i = 0; i < workerCount; ++i)
+    {
+        uint32_t begin = std::min(tileCount, i * chunk);
+        uint32_t end = std::min(tileCount, begin + chunk);
+        m_ranges[i].range.store(packRange(begin, end), std::memory_order_relaxed);
+        m_stats.workers[i] = {};
+    }
+    m_stats.tileCount = tileCount;
+    m_tileFn = &fn;
+
+    {
+        std::unique_lock lock(m_mutex);
+        m_runningWorkers = workerCount;
+        ++m_generation;
+        m_startCondition.notify_all();
+        m_doneCondition.wait(lock, [this] { return m_runningWorkers == 0; });
+    }
+
+    m_tileFn = nullptr;
+    m_stats.wallTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (auto& worker : m_stats.workers)
+    {
+        worker.idleMs = std::max(0.0, m_stats.wallTimeMs - worker.busyMs);
+    }
+}
+
+void CpuTileScheduler::workerMain(uint32_t workerIndex)
+{
+    uint64_t seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            m_startCondition.wait(lock, [&] { return m_shutdown || m_generation != seenGeneration; });
+            if (m_shutdown)
+            {
+                return;
+            }
+            seenGeneration = m_generation;
+        }
+
+        runWorker(workerIndex);
+
+        {
+            std::lock_guard lock(m_mutex);
+            if (--m_runningWorkers == 0)
+            {
+                m_doneCondition.notify_one();
+            }
+        }
+    }
+}
+
+void CpuTileScheduler::runWorker(uint32_t workerIndex)
+{
+    CpuWorkerStats& stats = m_stats.workers[workerIndex];
+
+    uint32_t tileIndex;
+    while (popTile(workerIndex, tileIndex) || (stealTiles(workerIndex) && popTile(workerIndex, tileIndex)))
+    {
+        auto start = std::chrono::steady_clock::now();
+        (*m_tileFn)(m_tiles[tileIndex]);
+        stats.busyMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats.tilesExecuted++;
+    }
+}
+
+bool CpuTileScheduler::popTile(uint32_t workerIndex, uint32_t& tileIndex)
+{
+    std::atomic<uint64_t>& range = m_ranges[workerIndex].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (rangeBegin(current) < rangeEnd(current))
+    {
+        if (range.compare_exchange_weak(
+            current,
+            packRange(rangeBegin(current) + 1, rangeEnd(current)),
+            std::memory_order_acq_rel
+        ))
+        {
+            tileIndex = rangeBegin(current);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CpuTileScheduler::stealTiles(uint32_t workerIndex)
+{
+    uint32_t workerCount = threadCount();
+    for (uint32_t offset = 1; offset < workerCount; ++offset)
+    {
+        std::atomic<uint64_t>& victim = m_ranges[(workerIndex + offset) % workerCount].range;
+        uint64_t current = victim.load(std::memory_order_acquire);
+        while (rangeBegin(current) < rangeEnd(current))
+        {
+            // take the back half, the victim keeps working from the front
+            uint32_t remaining = rangeEnd(current) - rangeBegin(current);
+            uint32_t take = (remaining + 1) / 2;
+            uint32_t splitAt = rangeEnd(current) - take;
+            if (victim.compare_exchange_weak(
+                current,
+                packRange(rangeBegin(current), splitAt),
+                std::memory_order_acq_rel
+            ))
+            {
+                // our own range is empty, so nobody else can be modifying it
+                m_ranges[workerIndex].range.store(packRange(splitAt, splitAt + take), std::memory_order_release);
+                m_stats.workers[workerIndex].tilesStolen += take;
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,112 @@
+#ifndef CPUTILESCHEDULER_H
+#define CPUTILESCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct CpuTile
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct CpuTileSchedulerOptions
+{
+    uint32_t tileWidth = 16;
+    uint32_t tileHeight = 16;
+    uint32_t threadCount = 0; // 0 = hardware concurrency
+    std::vector<uint32_t> cpuAffinity; // worker i runs on cpuAffinity[i % size], empty = left to the OS
+};
+
+struct CpuWorkerStats
+{
+    double busyMs = 0.0;
+    double idleMs = 0.0;
+    uint32_t tilesExecuted = 0;
+    uint32_t tilesStolen = 0;
+};
+
+struct CpuDispatchStats
+{
+    double wallTimeMs = 0.0;
+    uint32_t tileCount = 0;
+    std::vector<CpuWorkerStats> workers;
+};
+
+// persistent worker pool that executes a DispatchRays-sized grid as Morton-ordered tiles.
+// every worker starts on a contiguous run of the Morton order and steals half of another worker's
+// remaining run when it is done, so uneven per-pixel cost does not leave cores idle
+class CpuTileScheduler
+{
+public:
+    explicit CpuTileScheduler(const CpuTileSchedulerOptions& options = {});
+    ~CpuTileScheduler();
+
+    CpuTileScheduler(const CpuTileScheduler&) = delete;
+    CpuTileScheduler& operator=(const CpuTileScheduler&) = delete;
+
+    // blocks until fn has run for every tile of the width x height grid
+    void dispatch(uint32_t width, uint32_t height, const std::function<void(const CpuTile&)>& fn);
+
+    void setTileSize(uint32_t tileWidth, uint32_t tileHeight);
+
+    uint32_t tileWidth() const
+    {
+        return m_tileWidth;
+    }
+
+    uint32_t tileHeight() const
+    {
+        return m_tileHeight;
+    }
+
+    uint32_t threadCount() const
+    {
+        return static_cast<uint32_t>(m_workers.size());
+    }
+
+    // stats of the last dispatch
+    const CpuDispatchStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    // [begin, end) into m_tiles packed as begin | end << 32, one cache line each
+    struct alignas(64) WorkRange
+    {
+        std::atomic<uint64_t> range = 0;
+    };
+
+    void workerMain(uint32_t workerIndex);
+    void runWorker(uint32_t workerIndex);
+    bool popTile(uint32_t workerIndex, uint32_t& tileIndex);
+    bool stealTiles(uint32_t workerIndex);
+
+    uint32_t m_tileWidth;
+    uint32_t m_tileHeight;
+
+    std::vector<std::thread> m_workers;
+    std::unique_ptr<WorkRange[]> m_ranges;
+    std::vector<CpuTile> m_tiles;
+    const std::function<void(const CpuTile&)>* m_tileFn = nullptr;
+
+    std::mutex m_mutex;
+    std::condition_variable m_startCondition;
+    std::condition_variable m_doneCondition;
+    uint64_t m_generation = 0;
+    uint32_t m_runningWorkers = 0;
+    bool m_shutdown = false;
+
+    CpuDispatchStats m_stats;
+};
+
+#endif //CPUTILESCHEDULER_H
@@ -0,0 +1,294 @@
+#include "CpuTlas.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace
+{
+Float3 transformPoint(const float m[3][4], const Float3& p)
+{
+    return {
+        m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+        m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+        m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]
+    };
+}
+
+Float3 transformVector(const float m[3][4], const Float3& v)
+{
+    return {
+        m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+        m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+        m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z
+    };
+}
+
+bool invertAffine(const float m[3][4], float out[3][4])
+{
+    float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    float det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+    if (det == 0.0f || !std::isfinite(det))
+    {
+        return false;
+    }
+
+    float invDet = 1.0f / det;
+    out[0][0] = c00 * invDet;
+    out[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+    out[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+    out[1][0] = c01 * invDet;
+    out[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+    out[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+    out[2][0] = c02 * invDet;
+    out[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+    out[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+
+    for (int row = 0; row < 3; ++row)
+    {
+        out[row][3] = -(out[row][0] * m[0][3] + out[row][1] * m[1][3] + out[row][2] * m[2][3]);
+    }
+    return true;
+}
+
+// fills instance and its world bounds, false if the instance can never be hit
+bool resolveInstance(const CpuInstanceDesc& desc, uint32_t instanceIndex, CpuTlasInstance& instance, CpuAabb& bounds)
+{
+    // like the GPU, instances without geometry or with a zero mask can never be hit
+    if (desc.accelerationStructure == nullptr
+        || desc.instanceMask == 0
+        || !invertAffine(desc.transform, instance.worldToObject))
+    {
+        return false;
+    }
+
+    bounds = transformAabb(desc.transform, desc.accelerationStructure->bounds());
+    if (!bounds.valid())
+    {
+        return false;
+    }
+
+    instance.instanceIndex = instanceIndex;
+    instance.instanceID = desc.instanceID;
+    instance.instanceMask = desc.instanceMask;
+    instance.instanceContributionToHitGroupIndex = desc.instanceContributionToHitGroupIndex;
+    instance.flags = desc.flags;
+    instance.blas = desc.accelerationStructure;
+    instance.blasNodes = desc.accelerationStructure->nodes().data();
+    instance.blasTriangles = desc.accelerationStructure->triangles().data();
+    return true;
+}
+}
+
+CpuAabb transformAabb(const float m[3][4], const CpuAabb& bounds)
+{
+    CpuAabb result;
+    if (!bounds.valid())
+    {
+        return result;
+    }
+
+    float resultMin[3];
+    float resultMax[3];
+    for (int row = 0; row < 3; ++row)
+    {
+        resultMin[row] = m[row][3];
+        resultMax[row] = m[row][3];
+        for (int col = 0; col < 3; ++col)
+        {
+            float a = m[row][col] * bounds.min[col];
+            float b = m[row][col] * bounds.max[col];
+            resultMin[row] += std::min(a, b);
+            resultMax[row] += std::max(a, b);
+        }
+    }
+    result.min = {resultMin[0], resultMin[1], resultMin[2]};
+    result.max = {resultMax[0], resultMax[1], resultMax[2]};
+    return result;
+}
+
+CpuCullMode triangleCullMode(uint32_t rayFlags, uint32_t instanceFlags)
+{
+    if (instanceFlags & CPU_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE)
+    {
+        return CpuCullMode::None;
+    }
+
+    // front faces are clockwise unless the instance says otherwise
+    bool frontCounterClockwise = instanceFlags & CPU_INSTANCE_FLAG_TRIANGLE_FRONT_COUNTERCLOCKWISE;
+    if (rayFlags & CPU_RAY_FLAG_CULL_BACK_FACING_TRIANGLES)
+    {
+        return frontCounterClockwise ? CpuCullMode::Clockwise : CpuCullMode::CounterClockwise;
+    }
+    if (rayFlags & CPU_RAY_FLAG_CULL_FRONT_FACING_TRIANGLES)
+    {
+        return frontCounterClockwise ? CpuCullMode::CounterClockwise : CpuCullMode::Clockwise;
+    }
+    return CpuCullMode::None;
+}
+
+CpuTlas::CpuTlas(std::span<const CpuInstanceDesc> instances, const CpuBvhBuildOptions& options)
+    : m_options(options)
+    , m_updatePolicy(options.updatePolicy)
+{
+    build(instances);
+}
+
+void CpuTlas::build(std::span<const CpuInstanceDesc> instances)
+{
+    std::vector<CpuTlasInstance> validInstances;
+    std::vector<CpuAabb> primBounds;
+    validInstances.reserve(instances.size());
+    primBounds.reserve(instances.size());
+    m_descCount = static_cast<uint32_t>(instances.size());
+    m_skippedInstances.clear();
+    m_hasCompressedBlas = false;
+
+    for (uint32_t i = 0; i < instances.size(); ++i)
+    {
+        CpuTlasInstance instance = {};
+        CpuAabb bounds;
+        if (!resolveInstance(instances[i], i, instance, bounds))
+        {
+            m_skippedInstances.push_back(i);
+            continue;
+        }
+
+        m_hasCompressedBlas = m_hasCompressedBlas || instance.blas->isCompressed();
+        validInstances.push_back(instance);
+        primBounds.push_back(bounds);
+    }
+
+    m_bvh = buildBvh(primBounds, m_options, m_buildStats);
+    m_updatePolicy.built(m_buildStats.sahCost);
+
+    m_instances.clear();
+    m_instances.reserve(m_bvh.primIndices.size());
+    for (uint32_t prim : m_bvh.primIndices)
+    {
+        m_instances.push_back(validInstances[prim]);
+    }
+
+    // leaves now index m_instances directly
+    m_bvh.primIndices.clear();
+    m_bvh.primIndices.shrink_to_fit();
+}
+
+bool CpuTlas::update(std::span<const CpuInstanceDesc> instances)
+{
+    // a different set of hittable instances needs a different tree
+    bool rebuild = instances.size() != m_descCount;
+    for (uint32_t i = 0; i < m_skippedInstances.size() && !rebuild; ++i)
+    {
+        CpuTlasInstance instance = {};
+        CpuAabb bounds;
+        rebuild = resolveInstance(instances[m_skippedInstances[i]], m_skippedInstances[i], instance, bounds);
+    }
+    if (rebuild)
+    {
+        build(instances);
+        return true;
+    }
+
+    std::atomic<bool> lostInstance = false;
+    CpuBvhRefitter refitter(m_options);
+    refitter.refit(m_bvh.nodes, [&](uint32_t first, uint32_t count) {
+        CpuAabb leafBounds;
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            CpuTlasInstance& instance = m_instances[i];
+            CpuAabb bounds;
+            if (!resolveInstance(instances[instance.instanceIndex], instance.instanceIndex, instance, bounds))
+            {
+                lostInstance.store(true, std::memory_order_relaxed);
+                continue;
+            }
+            leafBounds.grow(bounds);
+        }
+        return leafBounds;
+    });
+    m_refitStats = refitter.stats();
+
+    if (lostInstance.load(std::memory_order_relaxed))
+    {
+        build(instances);
+        return true;
+    }
+
+    m_hasCompressedBlas = std::any_of(m_instances.begin(), m_instances.end(), [](const CpuTlasInstance& instance) {
+        return instance.blas->isCompressed();
+    });
+    if (!m_updatePolicy.updated(m_refitStats.sahCost))
+    {
+        return false;
+    }
+    build(instances);
+    return true;
+}
+
+bool CpuTlas::traceRay(
+    const CpuRay& ray,
+    uint32_t rayFlags,
+    uint32_t instanceInclusionMask,
+    CpuHit& hit,
+    CpuTraversalStats* stats
+) const
+{
+    CpuRay clipped = ray;
+    clipped.tMax = std::min(ray.tMax, hit.t);
+
+    bool acceptFirstHit = rayFlags & CPU_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH;
+    bool found = false;
+    m_bvh.traverse(clipped, [&](uint32_t first, uint32_t count, float tMax) {
+        clipped.tMax = tMax;
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            const CpuTlasInstance& instance = m_instances[i];
+            if ((instance.instanceMask & instanceInclusionMask) == 0)
+            {
+                continue;
+            }
+
+            // the transform is affine, so t is the same in object and world space
+            CpuRay objectRay = {
+                .origin = transformPoint(instance.worldToObject, clipped.origin),
+                .tMin = clipped.tMin,
+                .direction = transformVector(instance.worldToObject, clipped.direction),
+                .tMax = clipped.tMax
+            };
+            countInstanceTransition(stats);
+            // the BLAS breaks ties between its own triangles, a tie with another instance's hit is broken here
+            CpuHit instanceHit = {.instanceIndex = instance.instanceIndex};
+            if (instance.blas->intersect(objectRay, instanceHit, triangleCullMode(rayFlags, instance.flags), acceptFirstHit, stats))
+            {
+                if (isCloserHit(instanceHit.t, instance.instanceIndex, instanceHit.geometryIndex, instanceHit.primitiveIndex, hit))
+                {
+                    instanceHit.instanceID = instance.instanceID;
+                    instanceHit.instanceContributionToHitGroupIndex = instance.instanceContributionToHitGroupIndex;
+                    hit = instanceHit;
+                    clipped.tMax = hit.t;
+                    found = true;
+                }
+                if (acceptFirstHit)
+                {
+                    return -1.0f;
+                }
+            }
+        }
+        return clipped.tMax;
+    }, stats);
+
+    return found;
+}
+
+CpuAabb CpuTlas::bounds() const
+{
+    return m_bvh.nodes.empty() ? CpuAabb{} : m_bvh.nodes[0].bounds();
+}
+
+size_t CpuTlas::memoryUsage() const
+{
+    return m_bvh.nodes.size() * sizeof(CpuBvhNode) + m_instances.size() * sizeof(CpuTlasInstance);
+}
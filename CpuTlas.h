@@ -0,0 +1,138 @@
+#ifndef CPUTLAS_H
+#define CPUTLAS_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "AsUpdatePolicy.h"
+#include "CpuBlas.h"
+#include "CpuBvhRefitter.h"
+
+// D3D12_RAYTRACING_INSTANCE_FLAGS
+enum CpuInstanceFlag : uint32_t
+{
+    CPU_INSTANCE_FLAG_NONE = 0x0,
+    CPU_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE = 0x1,
+    CPU_INSTANCE_FLAG_TRIANGLE_FRONT_COUNTERCLOCKWISE = 0x2,
+    CPU_INSTANCE_FLAG_FORCE_OPAQUE = 0x4,
+    CPU_INSTANCE_FLAG_FORCE_NON_OPAQUE = 0x8
+};
+
+// mirrors D3D12_RAYTRACING_INSTANCE_DESC, the BLAS is referenced by pointer instead of GPU virtual address.
+// the CPU backend has no any-hit stage, so the opaque flags are accepted but change nothing
+struct CpuInstanceDesc
+{
+    float transform[3][4]; // object to world, row-major 3x4 like XMFLOAT3X4
+    uint32_t instanceID : 24;
+    uint32_t instanceMask : 8;
+    uint32_t instanceContributionToHitGroupIndex : 24;
+    uint32_t flags : 8;
+    const CpuBlas* accelerationStructure;
+};
+
+// Arvo's method: world bounds of a transformed box without transforming all eight corners
+CpuAabb transformAabb(const float m[3][4], const CpuAabb& bounds);
+
+// which winding TraceRay rejects for one instance, from RAY_FLAG_CULL_* and the instance cull flags
+CpuCullMode triangleCullMode(uint32_t rayFlags, uint32_t instanceFlags);
+
+// resolved instance as stored in the TLAS leaves
+struct CpuTlasInstance
+{
+    float worldToObject[3][4];
+    uint32_t instanceIndex;
+    uint32_t instanceID;
+    uint32_t instanceMask;
+    uint32_t instanceContributionToHitGroupIndex;
+    uint32_t flags;
+    const CpuBlas* blas;
+    // raw BLAS data for the packet kernels, blasNodes is null for a compressed BLAS
+    const CpuBvhNode* blasNodes;
+    const CpuTriangle* blasTriangles;
+};
+
+// CPU counterpart of a D3D12 top-level acceleration structure. instances only reference their BLAS,
+// so a mesh instanced many times is stored once
+class CpuTlas
+{
+public:
+    explicit CpuTlas(
+        std::span<const CpuInstanceDesc> instances,
+        const CpuBvhBuildOptions& options = {.maxLeafSize = 1}
+    );
+
+    // TraceRay against the whole scene, hit.t bounds the search on entry. stats, when given, receives the
+    // ray's work in the TLAS and every BLAS it enters
+    bool traceRay(
+        const CpuRay& ray,
+        uint32_t rayFlags,
+        uint32_t instanceInclusionMask,
+        CpuHit& hit,
+        CpuTraversalStats* stats = nullptr
+    ) const;
+
+    CpuAabb bounds() const;
+
+    // PERFORM_UPDATE with new transforms, or after BLASes were updated. instances must be the descs the TLAS
+    // was built from in the same order; when instances were added, removed or became (un)hittable, or the refit
+    // SAH cost passes the update policy, the TLAS is rebuilt instead and true is returned
+    bool update(std::span<const CpuInstanceDesc> instances);
+
+    const AsUpdatePolicy& updatePolicy() const
+    {
+        return m_updatePolicy;
+    }
+
+    // stats of the last refit
+    const CpuBvhRefitStats& refitStats() const
+    {
+        return m_refitStats;
+    }
+
+    // the SIMD packet kernels cannot traverse compressed BLASes
+    bool hasCompressedBlas() const
+    {
+        return m_hasCompressedBlas;
+    }
+
+    uint32_t instanceCount() const
+    {
+        return static_cast<uint32_t>(m_instances.size());
+    }
+
+    size_t memoryUsage() const;
+
+    const CpuBvhBuildStats& buildStats() const
+    {
+        return m_buildStats;
+    }
+
+    const CpuBvh& bvh() const
+    {
+        return m_bvh;
+    }
+
+    // stored in BVH leaf order
+    const std::vector<CpuTlasInstance>& instances() const
+    {
+        return m_instances;
+    }
+
+private:
+    void build(std::span<const CpuInstanceDesc> instances);
+
+    CpuBvhBuildOptions m_options;
+    AsUpdatePolicy m_updatePolicy;
+    CpuBvhRefitStats m_refitStats;
+    // descs the TLAS was built from, and the ones among them that can never be hit
+    uint32_t m_descCount = 0;
+    std::vector<uint32_t> m_skippedInstances;
+
+    CpuBvh m_bvh;
+    CpuBvhBuildStats m_buildStats;
+    std::vector<CpuTlasInstance> m_instances;
+    bool m_hasCompressedBlas = false;
+};
+
+#endif //CPUTLAS_H
@@ -0,0 +1,107 @@
+#ifndef CPUTRAVERSALSTATS_H
+#define CPUTRAVERSALSTATS_H
+
+#include <algorithm>
+#include <cstdint>
+
+// DXR_CPU_TRAVERSAL_STATS compiles the counters in. without it the count functions are empty and the
+// traversal code is the same as if they did not exist
+#ifdef DXR_CPU_TRAVERSAL_STATS
+constexpr bool CPU_TRAVERSAL_STATS_ENABLED = true;
+#else
+constexpr bool CPU_TRAVERSAL_STATS_ENABLED = false;
+#endif
+
+// work of one ray through the TLAS and the BLASes it entered
+struct CpuTraversalStats
+{
+    uint32_t nodesVisited = 0; // TLAS and BLAS nodes, inner and leaf
+    uint32_t trianglesTested = 0;
+    uint32_t instanceTransitions = 0; // BLASes entered from a TLAS leaf
+    uint32_t maxStackDepth = 0; // deepest stack of any one BVH traversal
+};
+
+// sum over the rays of a tile or a frame
+struct CpuTraversalTotals
+{
+    uint64_t rayCount = 0;
+    uint64_t nodesVisited = 0;
+    uint64_t trianglesTested = 0;
+    uint64_t instanceTransitions = 0;
+    uint32_t maxStackDepth = 0;
+
+    void add(const CpuTraversalStats& ray)
+    {
+        ++rayCount;
+        nodesVisited += ray.nodesVisited;
+        trianglesTested += ray.trianglesTested;
+        instanceTransitions += ray.instanceTransitions;
+        maxStackDepth = std::max(maxStackDepth, ray.maxStackDepth);
+    }
+
+    void add(const CpuTraversalTotals& other)
+    {
+        rayCount += other.rayCount;
+        nodesVisited += other.nodesVisited;
+        trianglesTested += other.trianglesTested;
+        instanceTransitions += other.instanceTransitions;
+        maxStackDepth = std::max(maxStackDepth, other.maxStackDepth);
+    }
+
+    double nodesPerRay() const
+    {
+        return rayCount != 0 ? static_cast<double>(nodesVisited) / static_cast<double>(rayCount) : 0.0;
+    }
+
+    double trianglesPerRay() const
+    {
+        return rayCount != 0 ? static_cast<double>(trianglesTested) / static_cast<double>(rayCount) : 0.0;
+    }
+};
+
+// the traversal functions take an optional CpuTraversalStats*, null when the caller does not count
+inline void countNodeVisit(CpuTraversalStats* stats)
+{
+    if constexpr (CPU_TRAVERSAL_STATS_ENABLED)
+    {
+        if (stats)
+        {
+            ++stats->nodesVisited;
+        }
+    }
+}
+
+inline void countTriangleTest(CpuTraversalStats* stats)
+{
+    if constexpr (CPU_TRAVERSAL_STATS_ENABLED)
+    {
+        if (stats)
+        {
+            ++stats->trianglesTested;
+        }
+    }
+}
+
+inline void countInstanceTransition(CpuTraversalStats* stats)
+{
+    if constexpr (CPU_TRAVERSAL_STATS_ENABLED)
+    {
+        if (stats)
+        {
+            ++stats->instanceTransitions;
+        }
+    }
+}
+
+inline void countStackDepth(CpuTraversalStats* stats, uint32_t depth)
+{
+    if constexpr (CPU_TRAVERSAL_STATS_ENABLED)
+    {
+        if (stats)
+        {
+            stats->maxStackDepth = std::max(stats->maxStackDepth, depth);
+        }
+    }
+}
+
+#endif //CPUTRAVERSALSTATS_H
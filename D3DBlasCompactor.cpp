@@ -0,0 +1,146 @@
+#include "D3DBlasCompactor.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+// one D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC per BLAS
+constexpr uint64_t COMPACTED_SIZE_STRIDE = sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+}
+
+D3DBlasCompactor::D3DBlasCompactor(D3DHeapAllocator& heapAllocator)
+    : m_heapAllocator(heapAllocator)
+{
+}
+
+void D3DBlasCompactor::begin(uint32_t blasCount)
+{
+    if (!m_tracked.empty() || !m_originals.empty())
+    {
+        throw std::logic_error("Previous BLAS compaction batch not finished.");
+    }
+
+    if (blasCount > m_capacity)
+    {
+        m_sizeBuffer = m_heapAllocator.createBuffer(
+            blasCount * COMPACTED_SIZE_STRIDE,
+            D3D12_HEAP_TYPE_DEFAULT,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS
+        );
+        m_readbackBuffer = m_heapAllocator.createBuffer(
+            blasCount * COMPACTED_SIZE_STRIDE,
+            D3D12_HEAP_TYPE_READBACK,
+            D3D12_RESOURCE_FLAG_NONE,
+            D3D12_RESOURCE_STATE_COPY_DEST
+        );
+        m_capacity = blasCount;
+    }
+}
+
+D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC D3DBlasCompactor::track(D3DBuffer& blas)
+{
+    if (m_tracked.size() >= m_capacity)
+    {
+        throw std::runtime_error("Too many BLASes in compaction batch.");
+    }
+
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuildInfo = {
+        .DestBuffer = m_sizeBuffer->GetGPUVirtualAddress() + m_tracked.size() * COMPACTED_SIZE_STRIDE,
+        .InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE
+    };
+    m_tracked.push_back(&blas);
+    return postbuildInfo;
+}
+
+void D3DBlasCompactor::recordReadback(ID3D12GraphicsCommandList* commandList)
+{
+    if (m_tracked.empty())
+    {
+        return;
+    }
+
+    D3D12_RESOURCE_BARRIER barrier = {
+        .Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .Transition = {
+            .pResource = m_sizeBuffer.Get(),
+            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            .StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+            .StateAfter = D3D12_RESOURCE_STATE_COPY_SOURCE
+        }
+    };
+    commandList->ResourceBarrier(1, &barrier);
+
+    commandList->CopyBufferRegion(
+        m_readbackBuffer.Get(),
+        0,
+        m_sizeBuffer.Get(),
+        0,
+        m_tracked.size() * COMPACTED_SIZE_STRIDE
+    );
+
+    // back to the state the next batch writes its sizes in
+    std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
+    commandList->ResourceBarrier(1, &barrier);
+}
+
+void D3DBlasCompactor::recordCompaction(ID3D12GraphicsCommandList4* commandList)
+{
+    if (m_tracked.empty())
+    {
+        return;
+    }
+
+    D3D12_RANGE readRange = {0, m_tracked.size() * COMPACTED_SIZE_STRIDE};
+    void* data = nullptr;
+    HRESULT hr = m_readbackBuffer->Map(0, &readRange, &data);
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to map compacted size readback buffer.");
+    }
+    auto* sizes = static_cast<const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC*>(data);
+
+    for (size_t i = 0; i < m_tracked.size(); ++i)
+    {
+        D3DBuffer& blas = *m_tracked[i];
+        D3DBuffer compacted = m_heapAllocator.createBuffer(
+            sizes[i].CompactedSizeInBytes,
+            D3D12_HEAP_TYPE_DEFAULT,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+            D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE
+        );
+        commandList->CopyRaytracingAccelerationStructure(
+            compacted->GetGPUVirtualAddress(),
+            blas->GetGPUVirtualAddress(),
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT
+        );
+
+        m_stats.blasCount++;
+        m_stats.originalBytes += blas->GetDesc().Width;
+        m_stats.compactedBytes += sizes[i].CompactedSizeInBytes;
+
+        m_originals.push_back(std::move(blas));
+        blas = std::move(compacted);
+    }
+
+    D3D12_RANGE writeRange = {0, 0};
+    m_readbackBuffer->Unmap(0, &writeRange);
+    m_tracked.clear();
+
+    // a null UAV barrier waits for every copy of the batch at once
+    D3D12_RESOURCE_BARRIER barrier = {
+        .Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .UAV = {
+            .pResource = nullptr
+        }
+    };
+    commandList->ResourceBarrier(1, &barrier);
+}
+
+void D3DBlasCompactor::finish()
+{
+    m_originals.clear();
+}
@@ -0,0 +1,55 @@
+#ifndef D3DBLASCOMPACTOR_H
+#define D3DBLASCOMPACTOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "D3DHeapAllocator.h"
+
+struct D3DBlasCompactorStats
+{
+    uint32_t blasCount = 0;
+    uint64_t originalBytes = 0;
+    uint64_t compactedBytes = 0;
+};
+
+// compacts a batch of BLASes built with ALLOW_COMPACTION. the compacted sizes are only known once the builds
+// have run, so the work spans two command lists: builds and size readback, then the copies into smaller buffers
+class D3DBlasCompactor
+{
+public:
+    explicit D3DBlasCompactor(D3DHeapAllocator& heapAllocator);
+
+    D3DBlasCompactor(const D3DBlasCompactor&) = delete;
+    D3DBlasCompactor& operator=(const D3DBlasCompactor&) = delete;
+
+    // starts a batch of at most blasCount BLASes
+    void begin(uint32_t blasCount);
+    // postbuild info to pass to the build of blas, blas is swapped for its compacted copy by recordCompaction
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC track(D3DBuffer& blas);
+    // call after the builds of the batch, copies the compacted sizes to the CPU
+    void recordReadback(ID3D12GraphicsCommandList* commandList);
+    // call once the readback command list has finished, records one copy per BLAS and a single barrier
+    void recordCompaction(ID3D12GraphicsCommandList4* commandList);
+    // call once the compaction command list has finished, frees the original BLASes
+    void finish();
+
+    const D3DBlasCompactorStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    D3DHeapAllocator& m_heapAllocator;
+    D3DBuffer m_sizeBuffer;
+    D3DBuffer m_readbackBuffer;
+    uint32_t m_capacity = 0;
+
+    std::vector<D3DBuffer*> m_tracked;
+    // still referenced by the copies until finish
+    std::vector<D3DBuffer> m_originals;
+
+    D3DBlasCompactorStats m_stats;
+};
+
+#endif //D3DBLASCOMPACTOR_H
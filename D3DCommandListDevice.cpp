@@ -0,0 +1,73 @@
+#include "D3DCommandListDevice.h"
+
+#include <stdexcept>
+
+D3DCommandListDevice::D3DCommandListDevice(ID3D12Device4* device, ID3D12CommandQueue* commandQueue)
+    : m_device(device)
+    , m_commandQueue(commandQueue)
+    , m_type(commandQueue->GetDesc().Type)
+{
+}
+
+uint32_t D3DCommandListDevice::createAllocator()
+{
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+    HRESULT hr = m_device->CreateCommandAllocator(m_type, IID_PPV_ARGS(&allocator));
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to create command allocator.");
+    }
+    m_allocators.push_back(allocator);
+    return static_cast<uint32_t>(m_allocators.size() - 1);
+}
+
+void D3DCommandListDevice::resetAllocator(uint32_t allocator)
+{
+    HRESULT hr = m_allocators[allocator]->Reset();
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to reset command allocator.");
+    }
+}
+
+uint32_t D3DCommandListDevice::createCommandList()
+{
+    // CreateCommandList1 creates the list closed and without an allocator
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> commandList;
+    HRESULT hr = m_device->CreateCommandList1(0, m_type, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(&commandList));
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to create command list.");
+    }
+    m_commandLists.push_back(commandList);
+    return static_cast<uint32_t>(m_commandLists.size() - 1);
+}
+
+void D3DCommandListDevice::beginCommandList(uint32_t commandList, uint32_t allocator)
+{
+    HRESULT hr = m_commandLists[commandList]->Reset(m_allocators[allocator].Get(), nullptr);
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to reset command list.");
+    }
+}
+
+void D3DCommandListDevice::closeCommandList(uint32_t commandList)
+{
+    HRESULT hr = m_commandLists[commandList]->Close();
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to close command list.");
+    }
+}
+
+void D3DCommandListDevice::executeCommandLists(std::span<const uint32_t> commandLists)
+{
+    std::vector<ID3D12CommandList*> lists;
+    lists.reserve(commandLists.size());
+    for (uint32_t commandList : commandLists)
+    {
+        lists.push_back(m_commandLists[commandList].Get());
+    }
+    m_commandQueue->ExecuteCommandLists(static_cast<UINT>(lists.size()), lists.data());
+}
@@ -0,0 +1,51 @@
+#ifndef D3DCOMMANDLISTDEVICE_H
+#define D3DCOMMANDLISTDEVICE_H
+
+#ifndef UNICODE
+#define UNICODE
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include <vector>
+
+#include "CommandRecorder.h"
+
+// CommandListDevice over an ID3D12CommandQueue, the handles index the allocators and lists created here
+class D3DCommandListDevice : public CommandListDevice
+{
+public:
+    D3DCommandListDevice(ID3D12Device4* device, ID3D12CommandQueue* commandQueue);
+
+    D3DCommandListDevice(const D3DCommandListDevice&) = delete;
+    D3DCommandListDevice& operator=(const D3DCommandListDevice&) = delete;
+
+    uint32_t createAllocator() override;
+    void resetAllocator(uint32_t allocator) override;
+    uint32_t createCommandList() override;
+    void beginCommandList(uint32_t commandList, uint32_t allocator) override;
+    void closeCommandList(uint32_t commandList) override;
+    void executeCommandLists(std::span<const uint32_t> commandLists) override;
+
+    // what a job records into
+    ID3D12GraphicsCommandList4* commandList(uint32_t commandList) const
+    {
+        return m_commandLists[commandList].Get();
+    }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device4> m_device;
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
+    D3D12_COMMAND_LIST_TYPE m_type;
+
+    // only grown by the thread calling CommandRecorder::submit, before the workers start
+    std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> m_allocators;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4>> m_commandLists;
+};
+
+#endif //D3DCOMMANDLISTDEVICE_H
@@ -1,8 +1,18 @@
 #include "D3DEngine.h"
 
-#include <dxcapi.h>
-
+#include <algorithm>
 #include <iostream>
+#include <span>
+
+#include "CpuTlas.h"
+#include "D3DCommandListDevice.h"
+#include "Profiler.h"
+
+#ifdef DXR_EMBEDDED_SHADERS
+#include "ShaderLibrary.h"
+#else
+#include "ShaderCompiler.h"
+#endif
 
 namespace
 {
@@ -23,55 +33,61 @@ void enableDebugLayer()
     std::cout << "D3D12 debug layer enabled." << std::endl;
 }
 
-void createBuffer(
-    ID3D12Device* device,
-    ID3D12Resource** buffer,
-    size_t size,
-    D3D12_HEAP_TYPE heapType,
-    D3D12_RESOURCE_FLAGS resourceFlags,
-    D3D12_RESOURCE_STATES initialState
+D3D12_GPU_VIRTUAL_ADDRESS_RANGE_AND_STRIDE shaderTableRange(
+    D3D12_GPU_VIRTUAL_ADDRESS shaderTableAddress,
+    const ShaderTableRange& range
 )
 {
-    D3D12_HEAP_PROPERTIES heapProps = {
-        .Type = heapType,
-        .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-        .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
-        .CreationNodeMask = 1,
-        .VisibleNodeMask = 1
+    return {
+        .StartAddress = range.size > 0 ? shaderTableAddress + range.offset : 0,
+        .SizeInBytes = range.size,
+        .StrideInBytes = range.stride
     };
-    D3D12_RESOURCE_DESC resourceDesc = {
-        .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
-        .Alignment = 0,
-        .Width = size,
-        .Height = 1,
-        .DepthOrArraySize = 1,
-        .MipLevels = 1,
-        .Format = DXGI_FORMAT_UNKNOWN,
-        .SampleDesc = {1, 0},
-        .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-        .Flags = resourceFlags
+}
+
+D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc(
+    D3D12_GPU_VIRTUAL_ADDRESS shaderTableAddress,
+    const ShaderTableLayout& layout,
+    uint32_t rayGenIndex,
+    UINT width,
+    UINT height
+)
+{
+    ShaderTableRange rayGen = layout.rayGenRecord(rayGenIndex);
+    return {
+        .RayGenerationShaderRecord = {
+            .StartAddress = shaderTableAddress + rayGen.offset,
+            .SizeInBytes = rayGen.size
+        },
+        .MissShaderTable = shaderTableRange(shaderTableAddress, layout.table(ShaderTableKind::Miss)),
+        .HitGroupTable = shaderTableRange(shaderTableAddress, layout.table(ShaderTableKind::HitGroup)),
+        .CallableShaderTable = shaderTableRange(shaderTableAddress, layout.table(ShaderTableKind::Callable)),
+        .Width = width,
+        .Height = height,
+        .Depth = 1
     };
-    HRESULT hr = device->CreateCommittedResource(
-        &heapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &resourceDesc,
-        initialState,
-        nullptr,
-        IID_PPV_ARGS(buffer)
-    );
-    if (FAILED(hr))
-    {
-        throw std::runtime_error("Failed to create buffer.");
-    }
 }
 
-UINT align(UINT value, UINT alignment)
+// the driver's TLAS is opaque, so the SAH cost of a tree with one leaf per instance stands in for it: the
+// instance boxes relative to their union, which grows as a refit keeps boxes of moving instances overlapping.
+// the engine has a single instance, whose box is the union, so the cost stays 1 and only the update limit of
+// m_tlasUpdatePolicy ever asks for a rebuild. CpuTlas runs the same policy on real multi-instance trees
+float tlasCost(std::span<const CpuAabb> instanceBounds)
 {
-    return (value + alignment - 1) & ~(alignment - 1);
+    CpuAabb rootBounds;
+    float leafArea = 0.0f;
+    for (const CpuAabb& bounds : instanceBounds)
+    {
+        rootBounds.grow(bounds);
+        leafArea += bounds.surfaceArea();
+    }
+    float rootArea = rootBounds.surfaceArea();
+    return rootArea > 0.0f ? leafArea / rootArea : 0.0f;
 }
 }
 
-D3DEngine::D3DEngine(HWND hwnd)
+D3DEngine::D3DEngine(HWND hwnd, Mesh mesh)
+    : m_mesh(std::move(mesh))
 {
 #ifdef DEBUG
     enableDebugLayer();
@@ -79,42 +95,79 @@ D3DEngine::D3DEngine(HWND hwnd)
 
     GetClientRect(hwnd, &m_windowRect);
 
-    createDXGIFactory();
-    createDevice();
-    createCommandResources();
-    createSwapChain(hwnd);
-    createSwapChainResources();
-    createFence();
-    createVertexBuffer();
+    {
+        ProfileScope scope("createDevice");
+        createDXGIFactory();
+        createDevice();
+        createCommandResources();
+        createSwapChain(hwnd);
+        createSwapChainResources();
+        createFence();
+    }
+    {
+        ProfileScope scope("createGeometry");
+        createVertexBuffer();
+        createIndexBuffer();
+    }
 
     createAS();
     createRaytracingPipelineState();
-    createRaytracingResources();
-    createShaderTable();
+    {
+        ProfileScope scope("createResources");
+        createRaytracingResources();
+        createShaderTable();
+    }
+
+    D3DHeapAllocatorStats heapStats = m_heapAllocator->stats();
+    std::cout << "Placed " << heapStats.allocationCount << " buffers and " << heapStats.uploadRangeCount
+        << " upload ranges in " << heapStats.heapCount << " heaps, "
+        << heapStats.usedBytes / 1024 << " / " << heapStats.reservedBytes / 1024 << " KB used, fragmentation "
+        << heapStats.fragmentation << std::endl;
 }
 
 void D3DEngine::cleanup()
 {
-    for (int i = 0; i < FRAME_COUNT; ++i)
+    if (m_computePacer)
     {
-        waitForFence(i);
+        m_computePacer->flush();
     }
-
-    for (auto& fenceEvent : m_fenceEvents)
+    if (m_framePacer)
+    {
+        m_framePacer->flush();
+    }
+    // every slot has finished after the flush, record the scopes of the last frames
+    for (D3DGpuProfiler* gpuProfiler : {m_gpuProfiler.get(), m_computeGpuProfiler.get()})
     {
-        if (fenceEvent)
+        if (gpuProfiler)
         {
-            CloseHandle(fenceEvent);
-            fenceEvent = nullptr;
+            for (UINT slot = 0; slot < FRAME_COUNT; ++slot)
+            {
+                gpuProfiler->beginSlot(slot);
+            }
         }
     }
-
-    for (auto& fence : m_fences)
+    m_computePacer.reset();
+    m_computeFrameQueue.reset();
+    m_computeGpuProfiler.reset();
+    m_framePacer.reset();
+    m_frameQueue.reset();
+    m_gpuProfiler.reset();
+
+    for (auto& commandList : m_computeCommandLists)
+    {
+        commandList.Reset();
+    }
+    for (auto& commandAllocator : m_computeCommandAllocators)
     {
-        fence.Reset();
+        commandAllocator.Reset();
     }
+    m_computeQueue.Reset();
 
     m_commandList.Reset();
+    for (auto& commandList : m_commandLists)
+    {
+        commandList.Reset();
+    }
     m_rtvHeap.Reset();
     for (auto& backBuffer : m_backBuffers)
     {
@@ -134,11 +187,65 @@ void D3DEngine::cleanup()
 
 void D3DEngine::render()
 {
+    ProfileScope scope("render");
+
+    // only blocks while the GPU still executes the frame that last recorded into this slot
+    UINT slot = 0;
+    {
+        ProfileScope waitScope("waitForFrame");
+        slot = m_framePacer->beginFrame();
+        // both pacers start one frame per render, so they hand out the same slot
+        m_computePacer->beginFrame();
+    }
+    // a removed device reports UINT64_MAX as completed, the tracker only knows the values that were signaled
+    m_dependencyTracker.cpuWait(m_directQueueId,
+        std::min(m_frameQueue->completedValue(), m_framePacer->lastSignaledValue()));
+    m_dependencyTracker.cpuWait(m_computeQueueId,
+        std::min(m_computeFrameQueue->completedValue(), m_computePacer->lastSignaledValue()));
+    // the slot's previous frame has finished, so its timestamps are ready
+    m_gpuProfiler->beginSlot(slot);
+    m_computeGpuProfiler->beginSlot(slot);
+    resetCommandList(slot);
+
+    // this frame traces the TLAS the previous frame built, while the compute queue builds the next one
+    UINT tlasIndex = m_latestTlas;
+    uint64_t tlasValue = m_latestTlasValue;
+
     UINT frameIndex = m_swapchain->GetCurrentBackBufferIndex();
+    {
+        ProfileScope recordScope("recordCommands");
+        updateTlas(slot);
+        beginFrame(frameIndex);
+        recordCommands(frameIndex, tlasIndex);
+    }
+
+    // the frame's command list waits for the build on the GPU, the CPU never does
+    if (tlasValue != 0)
+    {
+        m_frameQueue->gpuWait(*m_computeFrameQueue, tlasValue);
+        m_dependencyTracker.gpuWait(m_directQueueId, m_computeQueueId, tlasValue);
+    }
+    m_dependencyTracker.read(m_directQueueId, m_tlasResources[tlasIndex]);
+    m_tlasReadValues[tlasIndex] = m_framePacer->lastSignaledValue() + 1;
 
-    beginFrame(frameIndex);
-    recordCommands(frameIndex);
     endFrame(frameIndex);
+    m_dependencyTracker.signal(m_directQueueId, m_framePacer->lastSignaledValue());
+}
+
+void D3DEngine::resetCommandList(UINT slot)
+{
+    HRESULT hr = m_commandAllocators[slot]->Reset();
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to reset command allocator.");
+    }
+
+    m_commandList = m_commandLists[slot];
+    hr = m_commandList->Reset(m_commandAllocators[slot].Get(), nullptr);
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to reset command list.");
+    }
 }
 
 void D3DEngine::createDXGIFactory()
@@ -270,6 +377,11 @@ void D3DEngine::createDevice()
     {
         throw std::runtime_error("Failed to create D3D12 device.");
     }
+
+    m_heapAllocator = std::make_unique<D3DHeapAllocator>(m_device.Get());
+    m_scratchPool = std::make_unique<D3DScratchPool>(*m_heapAllocator);
+    m_computeScratchPool = std::make_unique<D3DScratchPool>(*m_heapAllocator);
+    m_blasCompactor = std::make_unique<D3DBlasCompactor>(*m_heapAllocator);
 }
 
 void D3DEngine::createCommandResources()
@@ -286,17 +398,27 @@ void D3DEngine::createCommandResources()
         }
     }
 
-    HRESULT hr = m_device->CreateCommandList(
-        0,
-        D3D12_COMMAND_LIST_TYPE_DIRECT,
-        m_commandAllocators[0].Get(),
-        nullptr,
-        IID_PPV_ARGS(&m_commandList)
-    );
-    if (FAILED(hr))
+    for (UINT i = 0; i < FRAME_COUNT; ++i)
     {
-        throw std::runtime_error("Failed to create command list.");
+        HRESULT hr = m_device->CreateCommandList(
+            0,
+            D3D12_COMMAND_LIST_TYPE_DIRECT,
+            m_commandAllocators[i].Get(),
+            nullptr,
+            IID_PPV_ARGS(&m_commandLists[i])
+        );
+        if (FAILED(hr))
+        {
+            throw std::runtime_error("Failed to create command list.");
+        }
+
+        // render() resets a slot's list before recording, slot 0 stays open for the initial uploads
+        if (i != 0)
+        {
+            m_commandLists[i]->Close();
+        }
     }
+    m_commandList = m_commandLists[0];
 
     D3D12_COMMAND_QUEUE_DESC queueDesc = {
         .Type = D3D12_COMMAND_LIST_TYPE_DIRECT,
@@ -304,11 +426,57 @@ void D3DEngine::createCommandResources()
         .Flags = D3D12_COMMAND_QUEUE_FLAG_NONE,
         .NodeMask = 0
     };
-    hr = m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue));
+    HRESULT hr = m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue));
     if (FAILED(hr))
     {
         throw std::runtime_error("Failed to create command queue.");
     }
+
+    m_gpuProfiler = std::make_unique<D3DGpuProfiler>(m_device.Get(), m_commandQueue.Get(), *m_heapAllocator, FRAME_COUNT);
+
+    D3D12_COMMAND_QUEUE_DESC computeQueueDesc = {
+        .Type = D3D12_COMMAND_LIST_TYPE_COMPUTE,
+        .Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL,
+        .Flags = D3D12_COMMAND_QUEUE_FLAG_NONE,
+        .NodeMask = 0
+    };
+    hr = m_device->CreateCommandQueue(&computeQueueDesc, IID_PPV_ARGS(&m_computeQueue));
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to create compute command queue.");
+    }
+
+    for (UINT i = 0; i < FRAME_COUNT; ++i)
+    {
+        hr = m_device->CreateCommandAllocator(
+            D3D12_COMMAND_LIST_TYPE_COMPUTE,
+            IID_PPV_ARGS(&m_computeCommandAllocators[i])
+        );
+        if (FAILED(hr))
+        {
+            throw std::runtime_error("Failed to create compute command allocator.");
+        }
+
+        // created closed, updateTlas resets the slot's list before recording
+        hr = m_device->CreateCommandList1(
+            0,
+            D3D12_COMMAND_LIST_TYPE_COMPUTE,
+            D3D12_COMMAND_LIST_FLAG_NONE,
+            IID_PPV_ARGS(&m_computeCommandLists[i])
+        );
+        if (FAILED(hr))
+        {
+            throw std::runtime_error("Failed to create compute command list.");
+        }
+    }
+
+    m_computeGpuProfiler = std::make_unique<D3DGpuProfiler>(
+        m_device.Get(),
+        m_computeQueue.Get(),
+        *m_heapAllocator,
+        FRAME_COUNT,
+        "GPU compute queue"
+    );
 }
 
 void D3DEngine::createSwapChain(HWND hwnd)
@@ -380,29 +548,28 @@ void D3DEngine::createSwapChainResources()
 
 void D3DEngine::createFence()
 {
+    m_frameQueue = std::make_unique<D3DFrameQueue>(m_device.Get(), m_commandQueue.Get());
+    m_framePacer = std::make_unique<FramePacer>(*m_frameQueue, FRAME_COUNT);
+    m_computeFrameQueue = std::make_unique<D3DFrameQueue>(m_device.Get(), m_computeQueue.Get());
+    m_computePacer = std::make_unique<FramePacer>(*m_computeFrameQueue, FRAME_COUNT);
+
+    m_directQueueId = m_dependencyTracker.addQueue("direct queue");
+    m_computeQueueId = m_dependencyTracker.addQueue("compute queue");
+    m_blasResource = m_dependencyTracker.addResource("BLAS");
+    for (UINT i = 0; i < TLAS_BUFFER_COUNT; ++i)
+    {
+        m_tlasResources[i] = m_dependencyTracker.addResource("TLAS " + std::to_string(i));
+    }
     for (UINT i = 0; i < FRAME_COUNT; ++i)
     {
-        HRESULT hr = m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fences[i]));
-        if (FAILED(hr))
-        {
-            throw std::runtime_error("Failed to create fence.");
-        }
-        m_fenceValues[i] = 0;
-
-        m_fenceEvents[i] = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-        if (m_fenceEvents[i] == nullptr)
-        {
-            throw std::runtime_error("Failed to create fence event.");
-        }
+        m_instanceDescResources[i] = m_dependencyTracker.addResource("instance descs " + std::to_string(i));
     }
 }
 
 void D3DEngine::createVertexBuffer()
 {
-    createBuffer(
-        m_device.Get(),
-        &m_vertexBuffer,
-        sizeof(DirectX::XMFLOAT3) * m_vertices.size(),
+    m_vertexBuffer = m_heapAllocator->createBuffer(
+        sizeof(DirectX::XMFLOAT3) * m_mesh.vertices.size(),
         D3D12_HEAP_TYPE_UPLOAD,
         D3D12_RESOURCE_FLAG_NONE,
         D3D12_RESOURCE_STATE_GENERIC_READ
@@ -414,10 +581,30 @@ void D3DEngine::createVertexBuffer()
     {
         throw std::runtime_error("Failed to map vertex buffer.");
     }
-    std::ranges::copy(m_vertices, mappedData);
+    // Float3 has the layout of XMFLOAT3
+    memcpy(mappedData, m_mesh.vertices.data(), sizeof(DirectX::XMFLOAT3) * m_mesh.vertices.size());
     m_vertexBuffer->Unmap(0, nullptr);
 }
 
+void D3DEngine::createIndexBuffer()
+{
+    m_indexBuffer = m_heapAllocator->createBuffer(
+        sizeof(uint32_t) * m_mesh.indices.size(),
+        D3D12_HEAP_TYPE_UPLOAD,
+        D3D12_RESOURCE_FLAG_NONE,
+        D3D12_RESOURCE_STATE_GENERIC_READ
+    );
+
+    uint32_t* mappedData = nullptr;
+    HRESULT hr = m_indexBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mappedData));
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to map index buffer.");
+    }
+    memcpy(mappedData, m_mesh.indices.data(), sizeof(uint32_t) * m_mesh.indices.size());
+    m_indexBuffer->Unmap(0, nullptr);
+}
+
 void D3DEngine::beginFrame(UINT frameIndex)
 {
     D3D12_RESOURCE_BARRIER barrier = {
@@ -433,35 +620,27 @@ void D3DEngine::beginFrame(UINT frameIndex)
     m_commandList->ResourceBarrier(1, &barrier);
 }
 
-void D3DEngine::recordCommands(UINT frameIndex) const
+void D3DEngine::recordCommands(UINT frameIndex, UINT tlasIndex) const
 {
     std::array descHeaps = { m_descHeap.Get() };
     m_commandList->SetDescriptorHeaps(descHeaps.size(), descHeaps.data());
 
-    D3D12_DISPATCH_RAYS_DESC dispatchDesc = {
-        .RayGenerationShaderRecord = {
-            .StartAddress = m_shaderTable->GetGPUVirtualAddress(),
-            .SizeInBytes = m_shaderRecordSize
-        },
-        .MissShaderTable = {
-            .StartAddress = m_shaderTable->GetGPUVirtualAddress() + m_shaderRecordSize,
-            .SizeInBytes = m_shaderRecordSize,
-            .StrideInBytes = m_shaderRecordSize
-        },
-        .HitGroupTable = {
-            .StartAddress = m_shaderTable->GetGPUVirtualAddress() + m_shaderRecordSize * 2,
-            .SizeInBytes = m_shaderRecordSize,
-            .StrideInBytes = m_shaderRecordSize
-        },
-        .Width = static_cast<UINT>(m_windowRect.right - m_windowRect.left),
-        .Height = static_cast<UINT>(m_windowRect.bottom - m_windowRect.top),
-        .Depth = 1
-    };
+    // raygen record i binds the descriptor table of TLAS buffer i
+    D3D12_DISPATCH_RAYS_DESC dispatchDesc = dispatchRaysDesc(
+        m_shaderTable.gpuAddress(),
+        m_shaderTableLayout,
+        tlasIndex,
+        static_cast<UINT>(m_windowRect.right - m_windowRect.left),
+        static_cast<UINT>(m_windowRect.bottom - m_windowRect.top)
+    );
 
     m_commandList->SetComputeRootSignature(m_globalRootSignature.Get());
     m_commandList->SetPipelineState1(m_raytracingPipelineState.Get());
 
-    m_commandList->DispatchRays(&dispatchDesc);
+    {
+        D3DGpuScope gpuScope(*m_gpuProfiler, m_commandList.Get(), "dispatchRays");
+        m_commandList->DispatchRays(&dispatchDesc);
+    }
 
     std::array barriers = {
         D3D12_RESOURCE_BARRIER{
@@ -486,6 +665,7 @@ void D3DEngine::recordCommands(UINT frameIndex) const
         }
     };
 
+    D3DGpuScope gpuScope(*m_gpuProfiler, m_commandList.Get(), "copyToBackBuffer");
     m_commandList->ResourceBarrier(barriers.size(), barriers.data());
 
     m_commandList->CopyResource(m_backBuffers[frameIndex].Get(), m_raytracingOutput.Get());
@@ -505,8 +685,13 @@ void D3DEngine::endFrame(UINT frameIndex)
     };
     m_commandList->ResourceBarrier(1, &barrier);
 
-    executeCommand(frameIndex);
+    {
+        ProfileScope scope("executeCommands");
+        executeCommand();
+        m_framePacer->endFrame();
+    }
 
+    ProfileScope scope("present");
     HRESULT hr = m_swapchain->Present(1, 0);
     if (FAILED(hr))
     {
@@ -515,8 +700,9 @@ void D3DEngine::endFrame(UINT frameIndex)
     }
 }
 
-void D3DEngine::executeCommand(UINT frameIndex)
+void D3DEngine::executeCommand()
 {
+    m_gpuProfiler->resolve(m_commandList.Get());
     HRESULT hr = m_commandList->Close();
     if (FAILED(hr))
     {
@@ -526,56 +712,22 @@ void D3DEngine::executeCommand(UINT frameIndex)
 
     std::array<ID3D12CommandList*, 1> commandLists = { m_commandList.Get() };
     m_commandQueue->ExecuteCommandLists(commandLists.size(), commandLists.data());
-
-    waitForFence(frameIndex);
-
-    hr = m_commandAllocators[frameIndex]->Reset();
-    if (FAILED(hr))
-    {
-        std::cerr << "Failed to reset command allocator." << std::endl;
-        return;
-    }
-
-    hr = m_commandList->Reset(m_commandAllocators[frameIndex].Get(), nullptr);
-    if (FAILED(hr))
-    {
-        std::cerr << "Failed to reset command list." << std::endl;
-        return;
-    }
-}
-
-void D3DEngine::waitForFence(UINT frameIndex)
-{
-    m_fenceValues[frameIndex]++;
-    UINT64 fenceValue = m_fenceValues[frameIndex];
-    HRESULT hr = m_commandQueue->Signal(m_fences[frameIndex].Get(), fenceValue);
-    if (FAILED(hr))
-    {
-        std::cerr << "Failed to signal command queue." << std::endl;
-        return;
-    }
-
-    if (m_fences[frameIndex]->GetCompletedValue() < fenceValue)
-    {
-        hr = m_fences[frameIndex]->SetEventOnCompletion(fenceValue, m_fenceEvents[frameIndex]);
-        if (FAILED(hr))
-        {
-            std::cerr << "Failed to set event on fence completion." << std::endl;
-            return;
-        }
-        WaitForSingleObject(m_fenceEvents[frameIndex], INFINITE);
-    }
 }
 
 void D3DEngine::createAS()
 {
+    ProfileScope scope("createAS");
+
     // blas
     D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = {
         .Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES,
         .Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE,
         .Triangles = {
+            .IndexFormat = DXGI_FORMAT_R32_UINT,
             .VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT,
-            .VertexCount = static_cast<UINT>(m_vertices.size()),
+            .IndexCount = static_cast<UINT>(m_mesh.indices.size()),
+            .VertexCount = static_cast<UINT>(m_mesh.vertices.size()),
+            .IndexBuffer = m_indexBuffer->GetGPUVirtualAddress(),
             .VertexBuffer = {
                 .StartAddress = m_vertexBuffer->GetGPUVirtualAddress(),
                 .StrideInBytes = sizeof(DirectX::XMFLOAT3)
@@ -583,215 +735,384 @@ void D3DEngine::createAS()
         }
     };
 
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS asInputs = {
-        .Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL,
-        .Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE,
-        .NumDescs = 1,
-        .DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY,
-        .pGeometryDescs = &geometryDesc
-    };
+    // one BLAS per mesh, the sample has one
+    std::array blasTargets = {&m_blas};
+    std::array geometryDescs = {geometryDesc};
+    bool compact = m_blasScheduler.options().compact;
 
-    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO asPrebuildInfo = {};
-    m_device->GetRaytracingAccelerationStructurePrebuildInfo(&asInputs, &asPrebuildInfo);
+    std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS> blasInputs;
+    std::vector<D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO> blasPrebuildInfos;
+    std::vector<AsBuildRequest> blasRequests;
+    for (const D3D12_RAYTRACING_GEOMETRY_DESC& desc : geometryDescs)
+    {
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& inputs = blasInputs.emplace_back();
+        inputs = {
+            .Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL,
+            .Flags = (m_mesh.buildPreference == CpuBvhBuildPreference::FastBuild
+                    ? D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD
+                    : D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE)
+                | (compact
+                    ? D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION
+                    : D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE),
+            .NumDescs = 1,
+            .DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY,
+            .pGeometryDescs = &desc
+        };
+
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO& prebuildInfo = blasPrebuildInfos.emplace_back();
+        m_device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &prebuildInfo);
+        blasRequests.push_back({
+            .scratchSize = prebuildInfo.ScratchDataSizeInBytes,
+            .resultSize = prebuildInfo.ResultDataMaxSizeInBytes
+        });
+    }
+    AsBuildPlan blasPlan = m_blasScheduler.plan(blasRequests);
 
-    Microsoft::WRL::ComPtr<ID3D12Resource> blasScratch;
-    createBuffer(
-        m_device.Get(),
-        &blasScratch,
-        asPrebuildInfo.ScratchDataSizeInBytes,
-        D3D12_HEAP_TYPE_DEFAULT,
-        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
-        D3D12_RESOURCE_STATE_UNORDERED_ACCESS
-    );
-    createBuffer(
-        m_device.Get(),
-        &m_blas,
-        asPrebuildInfo.ResultDataMaxSizeInBytes,
-        D3D12_HEAP_TYPE_DEFAULT,
-        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
-        D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE
-    );
+    // the BLAS builds of a batch are recorded on worker threads, into lists that run before m_commandList
+    D3DCommandListDevice setupDevice(m_device.Get(), m_commandQueue.Get());
+    CommandRecorder setupRecorder(setupDevice, *m_frameQueue);
 
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC blasDesc = {
-        .DestAccelerationStructureData = m_blas->GetGPUVirtualAddress(),
-        .Inputs = asInputs,
-        .ScratchAccelerationStructureData = blasScratch->GetGPUVirtualAddress()
-    };
-    m_commandList->BuildRaytracingAccelerationStructure(&blasDesc, 0, nullptr);
+    m_scratchPool->begin(m_frameQueue->completedValue());
+    m_scratchPool->reserve(blasPlan.stats.scratchCapacity);
+    for (const AsBuildBatch& batch : blasPlan.batches)
+    {
+        if (compact)
+        {
+            m_blasCompactor->begin(static_cast<uint32_t>(batch.requests.size()));
+        }
 
-    D3D12_RESOURCE_BARRIER barrier = {
-        .Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .UAV = {
-            .pResource = m_blas.Get()
+        // buffers, scratch ranges and postbuild info are handed out on this thread, none of them is thread-safe.
+        // reserve and the barrier ending every batch keep allocate from recording a barrier into m_commandList
+        std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC> buildDescs;
+        std::vector<D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC> postbuildInfos;
+        buildDescs.reserve(batch.requests.size());
+        for (uint32_t requestIndex : batch.requests)
+        {
+            D3DBuffer& blas = *blasTargets[requestIndex];
+            blas = m_heapAllocator->createBuffer(
+                blasPrebuildInfos[requestIndex].ResultDataMaxSizeInBytes,
+                D3D12_HEAP_TYPE_DEFAULT,
+                D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+                D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE
+            );
+            buildDescs.push_back({
+                .DestAccelerationStructureData = blas->GetGPUVirtualAddress(),
+                .Inputs = blasInputs[requestIndex],
+                .ScratchAccelerationStructureData = m_scratchPool->allocate(
+                    m_commandList.Get(),
+                    blasPrebuildInfos[requestIndex].ScratchDataSizeInBytes
+                )
+            });
+            if (compact)
+            {
+                postbuildInfos.push_back(m_blasCompactor->track(blas));
+            }
         }
-    };
-    m_commandList->ResourceBarrier(1, &barrier);
 
-    // tlas
+        // the GPU scope starts in the first list of the batch and ends after the barrier in the last
+        uint32_t buildScope = 0;
+        uint32_t beginJob = setupRecorder.addJob("beginBlasBatch", [&](const CommandJobContext& context) {
+            buildScope = m_gpuProfiler->begin(setupDevice.commandList(context.commandList), "buildBlas");
+        });
+
+        std::vector<uint32_t> buildJobs;
+        for (size_t first = 0; first < buildDescs.size(); first += BLAS_BUILDS_PER_JOB)
+        {
+            size_t last = std::min(first + BLAS_BUILDS_PER_JOB, buildDescs.size());
+            uint32_t buildJob = setupRecorder.addJob("recordBlasBuilds", [&, first, last](const CommandJobContext& context) {
+                ID3D12GraphicsCommandList4* commandList = setupDevice.commandList(context.commandList);
+                // no barriers in between, every build of the batch has its own scratch range
+                for (size_t i = first; i < last; ++i)
+                {
+                    commandList->BuildRaytracingAccelerationStructure(
+                        &buildDescs[i],
+                        compact ? 1 : 0,
+                        compact ? &postbuildInfos[i] : nullptr
+                    );
+                }
+            });
+            setupRecorder.addDependency(buildJob, beginJob);
+            buildJobs.push_back(buildJob);
+        }
+
+        uint32_t barrierJob = setupRecorder.addJob("endBlasBatch", [&](const CommandJobContext& context) {
+            ID3D12GraphicsCommandList4* commandList = setupDevice.commandList(context.commandList);
+            // a null UAV barrier waits for the builds of every earlier list, the next batch reuses the scratch from the start
+            D3D12_RESOURCE_BARRIER barrier = {
+                .Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
+                .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+                .UAV = {
+                    .pResource = nullptr
+                }
+            };
+            commandList->ResourceBarrier(1, &barrier);
+            m_gpuProfiler->end(commandList, buildScope);
+            if (compact)
+            {
+                // the compacted sizes are read on the CPU, so the builds have to finish before the copies are recorded
+                m_blasCompactor->recordReadback(commandList);
+            }
+        });
+        for (uint32_t buildJob : buildJobs)
+        {
+            setupRecorder.addDependency(barrierJob, buildJob);
+        }
+
+        // the next timeline value is signaled after m_commandList, which runs after these lists
+        setupRecorder.submit(m_framePacer->lastSignaledValue() + 1);
+        m_scratchPool->markBarrier();
+
+        if (compact)
+        {
+            submitAndWait();
+            // the originals are freed before the next batch, which keeps the peak the plan reports
+            {
+                D3DGpuScope compactScope(*m_gpuProfiler, m_commandList.Get(), "compactBlas");
+                m_blasCompactor->recordCompaction(m_commandList.Get());
+            }
+            submitAndWait();
+            m_blasCompactor->finish();
+        }
+    }
+
+    // every BLAS build and copy above ran on the direct queue
+    m_dependencyTracker.write(m_directQueueId, m_blasResource);
+
+    // tlas, updated every frame from then on
     D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS tlasInputs = {
         .Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL,
-        .Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE,
+        .Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE,
         .NumDescs = 1,
         .DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY,
     };
-    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO tlasPrebuildInfo = {};
-    m_device->GetRaytracingAccelerationStructurePrebuildInfo(&tlasInputs, &tlasPrebuildInfo);
-
-    Microsoft::WRL::ComPtr<ID3D12Resource> tlasScratch;
-    Microsoft::WRL::ComPtr<ID3D12Resource> instanceDescBuffer;
-    createBuffer(
-        m_device.Get(),
-        tlasScratch.GetAddressOf(),
-        tlasPrebuildInfo.ScratchDataSizeInBytes,
-        D3D12_HEAP_TYPE_DEFAULT,
-        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
-        D3D12_RESOURCE_STATE_UNORDERED_ACCESS
-    );
-    createBuffer(
-        m_device.Get(),
-        m_tlas.GetAddressOf(),
-        tlasPrebuildInfo.ResultDataMaxSizeInBytes,
-        D3D12_HEAP_TYPE_DEFAULT,
-        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
-        D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE
-    );
-    createBuffer(
-        m_device.Get(),
-        instanceDescBuffer.GetAddressOf(),
-        sizeof(D3D12_RAYTRACING_INSTANCE_DESC),
-        D3D12_HEAP_TYPE_UPLOAD,
-        D3D12_RESOURCE_FLAG_NONE,
-        D3D12_RESOURCE_STATE_GENERIC_READ
-    );
+    m_device->GetRaytracingAccelerationStructurePrebuildInfo(&tlasInputs, &m_tlasPrebuildInfo);
+    for (D3DBuffer& tlas : m_tlasBuffers)
+    {
+        tlas = m_heapAllocator->createBuffer(
+            m_tlasPrebuildInfo.ResultDataMaxSizeInBytes,
+            D3D12_HEAP_TYPE_DEFAULT,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+            D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE
+        );
+    }
 
-    D3D12_RAYTRACING_INSTANCE_DESC* instanceDesc = nullptr;
-    HRESULT hr = instanceDescBuffer->Map(0, nullptr, reinterpret_cast<void**>(&instanceDesc));
-    if (FAILED(hr))
+    // the CPU writes a frame's instance descs while the GPU may still build from the previous frame's
+    for (D3DUploadRange& instanceDescBuffer : m_instanceDescBuffers)
     {
-        throw std::runtime_error("Failed to map instance descriptor buffer.");
+        instanceDescBuffer = m_heapAllocator->allocateUpload(sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
     }
-    instanceDesc[0].InstanceID = 0;
-    instanceDesc[0].InstanceMask = 0xFF;
-    instanceDesc[0].InstanceContributionToHitGroupIndex = 0;
-    instanceDesc[0].Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-    instanceDesc[0].AccelerationStructure = m_blas->GetGPUVirtualAddress();
-    DirectX::XMFLOAT3X4 transformMatrix;
-    DirectX::XMStoreFloat3x4(&transformMatrix, DirectX::XMMatrixIdentity());
-    memcpy(instanceDesc[0].Transform, &transformMatrix, sizeof(transformMatrix));
-    instanceDescBuffer->Unmap(0, nullptr);
+    // fit the mesh into the view of the fixed RayGen camera, identity for the default triangle
+    m_mesh.fitTransform(m_instanceTransform);
+    m_meshBounds = m_mesh.bounds();
+
+    // the first TLAS is built on the direct queue with the rest of the setup, the first frame traces it
+    writeInstanceDescs(0, m_instanceTransform);
+    recordTlasBuild({m_commandList.Get(), *m_scratchPool, *m_gpuProfiler, m_directQueueId}, 0, 0, std::nullopt);
+    CpuAabb instanceBounds = transformAabb(m_instanceTransform, m_meshBounds);
+    m_tlasUpdatePolicy.built(tlasCost(std::span(&instanceBounds, 1)));
+
+    // flush() signals the next timeline value after this command list
+    m_scratchPool->end(m_framePacer->lastSignaledValue() + 1);
+    executeCommand();
+    m_framePacer->flush();
+    trackDirectFlush();
+    m_gpuProfiler->beginSlot(0);
+
+    std::cout << "Built " << blasRequests.size() << " BLAS in " << blasPlan.stats.batchCount << " batches, "
+        << blasPlan.stats.scratchCapacity / 1024 << " KB scratch, planned peak "
+        << blasPlan.stats.peakMemory / 1024 << " KB" << std::endl;
+    const CommandRecorderStats& recorderStats = setupRecorder.stats();
+    std::cout << "Recorded " << recorderStats.jobCount << " setup jobs on " << setupRecorder.workerCount()
+        << " threads into " << recorderStats.commandListCount << " command lists and "
+        << recorderStats.allocatorCount << " allocators" << std::endl;
+    if (compact)
+    {
+        const D3DBlasCompactorStats& compactorStats = m_blasCompactor->stats();
+        std::cout << "Compacted " << compactorStats.blasCount << " BLAS: " << compactorStats.originalBytes / 1024
+            << " KB -> " << compactorStats.compactedBytes / 1024 << " KB" << std::endl;
+    }
+}
 
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC tlasDesc = {
-        .DestAccelerationStructureData = m_tlas->GetGPUVirtualAddress(),
-        .Inputs = tlasInputs,
-        .ScratchAccelerationStructureData = tlasScratch->GetGPUVirtualAddress()
-    };
-    tlasDesc.Inputs.InstanceDescs = instanceDescBuffer->GetGPUVirtualAddress();
+void D3DEngine::submitAndWait()
+{
+    // the list is submitted as its own timeline value
+    m_scratchPool->end(m_framePacer->lastSignaledValue() + 1);
+    executeCommand();
+    m_framePacer->flush();
+    trackDirectFlush();
+    m_gpuProfiler->beginSlot(0);
+    resetCommandList(0);
+    m_scratchPool->begin(m_frameQueue->completedValue());
+}
 
-    m_commandList->BuildRaytracingAccelerationStructure(&tlasDesc, 0, nullptr);
+void D3DEngine::trackDirectFlush()
+{
+    m_dependencyTracker.signal(m_directQueueId, m_framePacer->lastSignaledValue());
+    m_dependencyTracker.cpuWait(m_directQueueId, m_framePacer->lastSignaledValue());
+}
 
-    D3D12_RESOURCE_BARRIER tlasBarrier = {
-        .Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .UAV = {
-            .pResource = m_tlas.Get()
-        }
-    };
-    m_commandList->ResourceBarrier(1, &tlasBarrier);
+void D3DEngine::setInstanceTransform(uint32_t instanceIndex, const float transform[3][4])
+{
+    if (instanceIndex != 0)
+    {
+        throw std::out_of_range("Instance index out of range.");
+    }
 
-    executeCommand(0);
+    std::copy_n(&transform[0][0], 12, &m_instanceTransform[0][0]);
 }
 
-void D3DEngine::createRaytracingPipelineState()
+void D3DEngine::updateTlas(UINT slot)
 {
-    std::array<D3D12_STATE_SUBOBJECT, 10> subobjects = {};
-    int subobjectIndex = 0;
+    writeInstanceDescs(slot, m_instanceTransform);
+    CpuAabb instanceBounds = transformAabb(m_instanceTransform, m_meshBounds);
 
-    // dxil library
-    Microsoft::WRL::ComPtr<IDxcCompiler3> compiler;
-    Microsoft::WRL::ComPtr<IDxcUtils> utils;
-    HRESULT hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
+    // the compute pacer waited for the build that last recorded into this slot
+    HRESULT hr = m_computeCommandAllocators[slot]->Reset();
     if (FAILED(hr))
     {
-        throw std::runtime_error("Failed to create DXC compiler instance.");
+        throw std::runtime_error("Failed to reset compute command allocator.");
     }
-    hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils));
+    ID3D12GraphicsCommandList4* commandList = m_computeCommandLists[slot].Get();
+    hr = commandList->Reset(m_computeCommandAllocators[slot].Get(), nullptr);
     if (FAILED(hr))
     {
-        throw std::runtime_error("Failed to create DXC utils instance.");
+        throw std::runtime_error("Failed to reset compute command list.");
     }
 
-    Microsoft::WRL::ComPtr<IDxcIncludeHandler> includeHandler;
-    hr = utils->CreateDefaultIncludeHandler(&includeHandler);
-    if (FAILED(hr))
+    // the buffer after the latest one. the frame that traced it last is usually done, the GPU wait covers
+    // the case where it is not
+    UINT target = (m_latestTlas + 1) % TLAS_BUFFER_COUNT;
+    if (m_tlasReadValues[target] != 0)
     {
-        throw std::runtime_error("Failed to create default include handler.");
+        m_computeFrameQueue->gpuWait(*m_frameQueue, m_tlasReadValues[target]);
+        m_dependencyTracker.gpuWait(m_computeQueueId, m_directQueueId, m_tlasReadValues[target]);
     }
 
-    std::array args = {
-        SHADER_FILE.c_str(),
-        L"-T", L"lib_6_3",
-    };
+    // the build signals the compute queue's next timeline value once its command list is submitted
+    m_computeScratchPool->begin(m_computeFrameQueue->completedValue());
+    bool rebuild = m_tlasUpdatePolicy.rebuildPending();
+    recordTlasBuild(
+        {commandList, *m_computeScratchPool, *m_computeGpuProfiler, m_computeQueueId},
+        slot,
+        target,
+        rebuild ? std::nullopt : std::optional(m_latestTlas)
+    );
+    m_computeScratchPool->end(m_computePacer->lastSignaledValue() + 1);
 
-    Microsoft::WRL::ComPtr<IDxcBlobEncoding> sourceBlob;
-    hr = utils->LoadFile(SHADER_FILE.c_str(), nullptr, &sourceBlob);
+    m_computeGpuProfiler->resolve(commandList);
+    hr = commandList->Close();
     if (FAILED(hr))
     {
-        throw std::runtime_error("Failed to load shader file.");
+        throw std::runtime_error("Failed to close compute command list.");
+    }
+    std::array<ID3D12CommandList*, 1> commandLists = {commandList};
+    m_computeQueue->ExecuteCommandLists(commandLists.size(), commandLists.data());
+    m_latestTlas = target;
+    m_latestTlasValue = m_computePacer->endFrame();
+    m_dependencyTracker.signal(m_computeQueueId, m_latestTlasValue);
+
+    if (rebuild)
+    {
+        m_tlasUpdatePolicy.built(tlasCost(std::span(&instanceBounds, 1)));
+    }
+    else
+    {
+        m_tlasUpdatePolicy.updated(tlasCost(std::span(&instanceBounds, 1)));
     }
+}
+
+void D3DEngine::writeInstanceDescs(UINT slot, const float transform[3][4])
+{
+    m_dependencyTracker.write(QueueDependencyTracker::CPU_QUEUE, m_instanceDescResources[slot]);
+
+    auto* instanceDesc = reinterpret_cast<D3D12_RAYTRACING_INSTANCE_DESC*>(m_instanceDescBuffers[slot].data());
+    instanceDesc[0].InstanceID = 0;
+    instanceDesc[0].InstanceMask = 0xFF;
+    instanceDesc[0].InstanceContributionToHitGroupIndex = 0;
+    instanceDesc[0].Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+    instanceDesc[0].AccelerationStructure = m_blas->GetGPUVirtualAddress();
+    std::copy_n(&transform[0][0], 12, &instanceDesc[0].Transform[0][0]);
+}
 
-    DxcBuffer sourceBuffer = {
-        .Ptr = sourceBlob->GetBufferPointer(),
-        .Size = sourceBlob->GetBufferSize(),
-        .Encoding = DXC_CP_ACP
+void D3DEngine::recordTlasBuild(const AsBuildQueue& queue, UINT slot, UINT target, std::optional<UINT> source)
+{
+    bool performUpdate = source.has_value();
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS tlasInputs = {
+        .Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL,
+        .Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE
+            | (performUpdate
+                ? D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE
+                : D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE),
+        .NumDescs = 1,
+        .DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY,
+        .InstanceDescs = m_instanceDescBuffers[slot].gpuAddress()
     };
 
-    Microsoft::WRL::ComPtr<IDxcResult> result;
-    hr = compiler->Compile(
-        &sourceBuffer,
-        args.data(),
-        args.size(),
-        includeHandler.Get(),
-        IID_PPV_ARGS(&result)
-    );
-    if (FAILED(hr))
+    m_dependencyTracker.read(queue.trackedQueue, m_instanceDescResources[slot]);
+    m_dependencyTracker.read(queue.trackedQueue, m_blasResource);
+    if (performUpdate)
     {
-        throw std::runtime_error("Failed to compile shader.");
+        m_dependencyTracker.read(queue.trackedQueue, m_tlasResources[*source]);
     }
+    m_dependencyTracker.write(queue.trackedQueue, m_tlasResources[target]);
 
-    Microsoft::WRL::ComPtr<IDxcBlobUtf8> errors;
-    hr = result->GetOutput(
-        DXC_OUT_ERRORS,
-        IID_PPV_ARGS(&errors),
-        nullptr
+    // the barrier below is inside the scope, so its end timestamp waits for the build
+    D3DGpuScope gpuScope(queue.gpuProfiler, queue.commandList, performUpdate ? "updateTlas" : "buildTlas");
+    D3D12_GPU_VIRTUAL_ADDRESS tlasScratch = queue.scratchPool.allocate(
+        queue.commandList,
+        performUpdate ? m_tlasPrebuildInfo.UpdateScratchDataSizeInBytes : m_tlasPrebuildInfo.ScratchDataSizeInBytes
     );
-    if (FAILED(hr) || (errors && errors->GetStringLength() > 0))
-    {
-        std::cerr << "Shader compilation failed with error code: " << hr << std::endl;
-        if (errors)
-        {
-            std::cerr << static_cast<const char*>(errors->GetBufferPointer()) << std::endl;
+
+    // an update may write a different buffer than it reads, every TLAS buffer has the size of a full build
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC tlasDesc = {
+        .DestAccelerationStructureData = m_tlasBuffers[target]->GetGPUVirtualAddress(),
+        .Inputs = tlasInputs,
+        .SourceAccelerationStructureData = performUpdate ? m_tlasBuffers[*source]->GetGPUVirtualAddress() : 0,
+        .ScratchAccelerationStructureData = tlasScratch
+    };
+    queue.commandList->BuildRaytracingAccelerationStructure(&tlasDesc, 0, nullptr);
+
+    // the next build refits from this one, on the same queue
+    D3D12_RESOURCE_BARRIER tlasBarrier = {
+        .Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .UAV = {
+            .pResource = m_tlasBuffers[target].Get()
         }
-        throw std::runtime_error("Shader compilation failed.");
-    }
+    };
+    queue.commandList->ResourceBarrier(1, &tlasBarrier);
+}
 
-    result->GetStatus(&hr);
-    if (FAILED(hr))
+void D3DEngine::createRaytracingPipelineState()
+{
+    ProfileScope scope("createPipeline");
+    std::array<D3D12_STATE_SUBOBJECT, 10> subobjects = {};
+    int subobjectIndex = 0;
+
+    // dxil library
+#ifdef DXR_EMBEDDED_SHADERS
+    // compiled by the dxr-shaders target at build time, no file I/O and no DXC at runtime
+    std::span<const std::byte> shaderLibrary = std::as_bytes(std::span(SHADER_LIBRARY_DXIL, SHADER_LIBRARY_DXIL_SIZE));
+    // dxc checked SHADER_LIBRARY_EXPORTS against shader.hlsl, this catches a name changed only here
+    for (const std::wstring& name : {RAYGEN_SHADER, MISS_SHADER, CLOSEST_HIT_SHADER})
     {
-        throw std::runtime_error("Shader compilation failed with unknown error.");
+        if (std::find(std::begin(SHADER_LIBRARY_EXPORTS), std::end(SHADER_LIBRARY_EXPORTS), name) == std::end(SHADER_LIBRARY_EXPORTS))
+        {
+            throw std::runtime_error("Embedded shader library does not export a shader D3DEngine uses, check SHADER_EXPORTS in CMakeLists.txt.");
+        }
     }
-
-    Microsoft::WRL::ComPtr<IDxcBlob> shaderBlob;
-    Microsoft::WRL::ComPtr<IDxcBlobUtf16> shaderName;
-    hr = result->GetOutput(
-        DXC_OUT_OBJECT,
-        IID_PPV_ARGS(&shaderBlob),
-        &shaderName
-    );
-    if (FAILED(hr) || !shaderBlob)
+#else
+    ShaderCompiler shaderCompiler({
+        .cacheDirectory = SHADER_CACHE_DIRECTORY
+    });
+    std::vector<std::byte> shaderLibrary;
     {
-        throw std::runtime_error("Failed to get compiled shader object.");
+        ProfileScope compileScope("compileShaders");
+        shaderLibrary = shaderCompiler.compile(SHADER_FILE);
     }
+    std::cout << "Shader library " << (shaderCompiler.stats().cacheHit ? "loaded from cache" : "compiled")
+        << " in " << shaderCompiler.stats().timeMs << " ms" << std::endl;
+#endif
 
     std::array exportDescs = {
         D3D12_EXPORT_DESC{
@@ -813,8 +1134,8 @@ void D3DEngine::createRaytracingPipelineState()
 
     D3D12_DXIL_LIBRARY_DESC dxilLibraryDesc = {
         .DXILLibrary = {
-            .pShaderBytecode = shaderBlob->GetBufferPointer(),
-            .BytecodeLength = shaderBlob->GetBufferSize()
+            .pShaderBytecode = shaderLibrary.data(),
+            .BytecodeLength = shaderLibrary.size()
         },
         .NumExports = static_cast<UINT>(exportDescs.size()),
         .pExports = exportDescs.data()
@@ -883,7 +1204,7 @@ void D3DEngine::createRaytracingPipelineState()
     };
     Microsoft::WRL::ComPtr<ID3DBlob> signatureBlob;
     Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
-    hr = D3D12SerializeRootSignature(
+    HRESULT hr = D3D12SerializeRootSignature(
         &rootSignatureDesc,
         D3D_ROOT_SIGNATURE_VERSION_1,
         &signatureBlob,
@@ -1065,7 +1386,7 @@ void D3DEngine::createRaytracingResources()
 {
     D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {
         .Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-        .NumDescriptors = 2, // | tlas | output texture |
+        .NumDescriptors = 2 * TLAS_BUFFER_COUNT, // | tlas 0 | output texture | tlas 1 | output texture | ...
         .Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
         .NodeMask = 0
     };
@@ -1107,28 +1428,34 @@ void D3DEngine::createRaytracingResources()
         throw std::runtime_error("Failed to create raytracing output resource.");
     }
 
+    // one descriptor table per TLAS buffer, the frame picks it through the raygen record
     D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_descHeap->GetCPUDescriptorHandleForHeapStart();
+    UINT descriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    for (const D3DBuffer& tlas : m_tlasBuffers)
+    {
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc ={
+            .Format = DXGI_FORMAT_UNKNOWN,
+            .ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE,
+            .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+            .RaytracingAccelerationStructure = {
+                .Location = tlas->GetGPUVirtualAddress()
+            }
+        };
+        m_device->CreateShaderResourceView(nullptr, &srvDesc, srvHandle);
 
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc ={
-        .Format = DXGI_FORMAT_UNKNOWN,
-        .ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE,
-        .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
-        .RaytracingAccelerationStructure = {
-            .Location = m_tlas->GetGPUVirtualAddress()
-        }
-    };
-    m_device->CreateShaderResourceView(nullptr, &srvDesc, srvHandle);
+        srvHandle.ptr += descriptorSize;
 
-    srvHandle.ptr += m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {
+            .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
+            .ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D,
+            .Texture2D = {
+                .MipSlice = 0,
+            }
+        };
+        m_device->CreateUnorderedAccessView(m_raytracingOutput.Get(), nullptr, &uavDesc, srvHandle);
 
-    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {
-        .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
-        .ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D,
-        .Texture2D = {
-            .MipSlice = 0,
-        }
-    };
-    m_device->CreateUnorderedAccessView(m_raytracingOutput.Get(), nullptr, &uavDesc, srvHandle);
+        srvHandle.ptr += descriptorSize;
+    }
 }
 
 void D3DEngine::createShaderTable()
@@ -1140,41 +1467,28 @@ void D3DEngine::createShaderTable()
         throw std::runtime_error("Failed to get state object properties.");
     }
 
-    m_shaderRecordSize = align(
-        D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + sizeof(D3D12_GPU_DESCRIPTOR_HANDLE),
-        D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT
-    );
-    UINT totalSize = m_shaderRecordSize * 3; // raygen, miss, hitgroup
-
-    createBuffer(
-        m_device.Get(),
-        &m_shaderTable,
-        totalSize,
-        D3D12_HEAP_TYPE_UPLOAD,
-        D3D12_RESOURCE_FLAG_NONE,
-        D3D12_RESOURCE_STATE_GENERIC_READ
-    );
-
-    uint8_t* mappedData = nullptr;
-    hr = m_shaderTable->Map(0, nullptr, reinterpret_cast<void**>(&mappedData));
-    if (FAILED(hr))
+    // the raygen record's local root argument is the descriptor table of the TLAS SRV and the output UAV,
+    // record i for TLAS buffer i
+    ShaderTableBuilder shaderTableBuilder;
+    D3D12_GPU_DESCRIPTOR_HANDLE tableHandle = m_descHeap->GetGPUDescriptorHandleForHeapStart();
+    UINT descriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    for (UINT i = 0; i < TLAS_BUFFER_COUNT; ++i)
     {
-        throw std::runtime_error("Failed to map shader table.");
+        shaderTableBuilder.add(ShaderTableKind::RayGen, RAYGEN_SHADER, tableHandle);
+        tableHandle.ptr += 2 * descriptorSize;
     }
+    shaderTableBuilder.add(ShaderTableKind::Miss, MISS_SHADER);
+    shaderTableBuilder.add(ShaderTableKind::HitGroup, HIT_GROUP);
+    m_shaderTableLayout = shaderTableBuilder.layout();
 
-    // raygen
-    memcpy(mappedData, stateObjectProps->GetShaderIdentifier(RAYGEN_SHADER.c_str()), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-    UINT64 descHeapAddress = m_descHeap->GetGPUDescriptorHandleForHeapStart().ptr;
-    memcpy(mappedData + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, &descHeapAddress, sizeof(D3D12_GPU_DESCRIPTOR_HANDLE));
-    mappedData += m_shaderRecordSize;
-
-    // miss
-    memcpy(mappedData, stateObjectProps->GetShaderIdentifier(MISS_SHADER.c_str()), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-    mappedData += m_shaderRecordSize;
+    // the 256-byte upload class covers the 64-byte shader table alignment
+    m_shaderTable = m_heapAllocator->allocateUpload(m_shaderTableLayout.totalSize);
 
-    // hitgroup
-    memcpy(mappedData, stateObjectProps->GetShaderIdentifier(HIT_GROUP.c_str()), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-    mappedData += m_shaderRecordSize;
-
-    m_shaderTable->Unmap(0, nullptr);
+    shaderTableBuilder.write(
+        std::span(m_shaderTable.data(), m_shaderTableLayout.totalSize),
+        [&stateObjectProps](const std::wstring& name)
+        {
+            return static_cast<const void*>(stateObjectProps->GetShaderIdentifier(name.c_str()));
+        }
+    );
 }
@@ -4,6 +4,10 @@
 #ifndef UNICODE
 #define UNICODE
 #endif
+// the Cpu* headers define min/max functions
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 
 #include <d3d12.h>
@@ -12,18 +16,37 @@
 #include <DirectXMath.h>
 
 #include <array>
+#include <memory>
+#include <optional>
 #include <vector>
 #include <string>
 
-class D3DEngine
+#include "AsBuildScheduler.h"
+#include "AsUpdatePolicy.h"
+#include "D3DBlasCompactor.h"
+#include "D3DFrameQueue.h"
+#include "D3DGpuProfiler.h"
+#include "D3DHeapAllocator.h"
+#include "D3DScratchPool.h"
+#include "Engine.h"
+#include "FramePacer.h"
+#include "MeshLoader.h"
+#include "QueueDependencyTracker.h"
+#include "ShaderTable.h"
+
+class D3DEngine : public Engine
 {
 public:
-    explicit D3DEngine(HWND hwnd);
-    ~D3DEngine() = default;
+    explicit D3DEngine(HWND hwnd, Mesh mesh = Mesh::triangle());
+    ~D3DEngine() override = default;
+
+    void cleanup() override;
 
-    void cleanup();
+    void render() override;
 
-    void render();
+    // object to world transform of the mesh instance, the only one, written with the next frame's TLAS update.
+    // starts as the fit into the camera view
+    void setInstanceTransform(uint32_t instanceIndex, const float transform[3][4]) override;
 
 private:
     void createDXGIFactory();
@@ -35,62 +58,128 @@ private:
     void createFence();
 
     void createVertexBuffer();
+    void createIndexBuffer();
 
     void beginFrame(UINT frameIndex);
-    void recordCommands(UINT frameIndex) const;
+    // traces m_tlasBuffers[tlasIndex]
+    void recordCommands(UINT frameIndex, UINT tlasIndex) const;
     void endFrame(UINT frameIndex);
 
-    void executeCommand(UINT frameIndex);
-    void waitForFence(UINT frameIndex);
+    void executeCommand();
+    // slot's allocator must no longer be in use by the GPU
+    void resetCommandList(UINT slot);
+    // runs what slot 0 recorded so far and reopens it, only while creating resources
+    void submitAndWait();
+    // after a flush of the direct queue, which signaled its last value
+    void trackDirectFlush();
+
+    // where recordTlasBuild records: the direct queue in createAS, the compute queue every frame after
+    struct AsBuildQueue
+    {
+        ID3D12GraphicsCommandList4* commandList;
+        D3DScratchPool& scratchPool;
+        D3DGpuProfiler& gpuProfiler;
+        uint32_t trackedQueue;
+    };
 
     void createAS();
+    // writes the current instance transform and submits a TLAS update, or a rebuild when the policy asks, to
+    // the compute queue. it writes the TLAS buffer after the latest one, the frame traces the latest
+    void updateTlas(UINT slot);
+    void writeInstanceDescs(UINT slot, const float transform[3][4]);
+    // builds m_tlasBuffers[target], an update refits source into it and a rebuild has no source
+    void recordTlasBuild(const AsBuildQueue& queue, UINT slot, UINT target, std::optional<UINT> source);
     void createRaytracingPipelineState();
     void createRaytracingResources();
     void createShaderTable();
 
     static constexpr UINT FRAME_COUNT = 2;
+    // the frame builds one TLAS buffer while the one before it is traced. one more than the frames in flight,
+    // so the buffer a build overwrites was traced by a frame FramePacer already waited for
+    static constexpr UINT TLAS_BUFFER_COUNT = FRAME_COUNT + 1;
 
     Microsoft::WRL::ComPtr<IDXGIFactory7> m_dxgiFactory;
     Microsoft::WRL::ComPtr<ID3D12Device5> m_device;
+    // declared before every buffer placed in its heaps
+    std::unique_ptr<D3DHeapAllocator> m_heapAllocator;
+    std::unique_ptr<D3DScratchPool> m_scratchPool;
+    // the TLAS builds of the compute queue, its fence decides when scratch can be reused
+    std::unique_ptr<D3DScratchPool> m_computeScratchPool;
+    std::unique_ptr<D3DBlasCompactor> m_blasCompactor;
+    AsBuildScheduler m_blasScheduler;
     std::array<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>, FRAME_COUNT> m_commandAllocators;
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
+    std::array<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4>, FRAME_COUNT> m_commandLists;
+    // list of the slot being recorded
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> m_commandList;
 
+    // TLAS builds and refits, they overlap the DispatchRays of the frame before
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_computeQueue;
+    std::array<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>, FRAME_COUNT> m_computeCommandAllocators;
+    std::array<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4>, FRAME_COUNT> m_computeCommandLists;
+
     Microsoft::WRL::ComPtr<IDXGISwapChain4> m_swapchain;
     std::array<Microsoft::WRL::ComPtr<ID3D12Resource>, FRAME_COUNT> m_backBuffers;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
     std::array<float, 4> m_clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
 
-    std::array<Microsoft::WRL::ComPtr<ID3D12Fence>, FRAME_COUNT> m_fences;
-    std::array<UINT64, FRAME_COUNT> m_fenceValues = {};
-    std::array<HANDLE, FRAME_COUNT> m_fenceEvents = {};
-
-    const std::vector<DirectX::XMFLOAT3> m_vertices = {
-        {0.0, 0.5f, 0.0f},
-        {0.5f, -0.5f, 0.0f},
-        {-0.5f, -0.5f, 0.0f}
-    };
+    std::unique_ptr<D3DFrameQueue> m_frameQueue;
+    std::unique_ptr<FramePacer> m_framePacer;
+    // timestamps of the direct queue, one query range per frame slot
+    std::unique_ptr<D3DGpuProfiler> m_gpuProfiler;
+    // the compute queue's own timeline, paced like the direct queue with the same slots
+    std::unique_ptr<D3DFrameQueue> m_computeFrameQueue;
+    std::unique_ptr<FramePacer> m_computePacer;
+    std::unique_ptr<D3DGpuProfiler> m_computeGpuProfiler;
+
+    // mirrors every access to the acceleration structures and instance descs, and every fence signal and
+    // wait of both queues, throws if a frame could read what a build still writes or the other way around
+    QueueDependencyTracker m_dependencyTracker;
+    uint32_t m_directQueueId = 0;
+    uint32_t m_computeQueueId = 0;
+    uint32_t m_blasResource = 0;
+    std::array<uint32_t, TLAS_BUFFER_COUNT> m_tlasResources = {};
+    std::array<uint32_t, FRAME_COUNT> m_instanceDescResources = {};
+
+    Mesh m_mesh;
 
     D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView = {};
 
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_vertexBuffer;
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_blas;
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_tlas;
+    D3DBuffer m_vertexBuffer;
+    D3DBuffer m_indexBuffer;
+    D3DBuffer m_blas;
+    std::array<D3DBuffer, TLAS_BUFFER_COUNT> m_tlasBuffers;
+    // the newest TLAS, built after the compute queue signals m_latestTlasValue. 0 for the one createAS built
+    UINT m_latestTlas = 0;
+    uint64_t m_latestTlasValue = 0;
+    // direct queue value signaled after the last frame that traced each TLAS buffer
+    std::array<uint64_t, TLAS_BUFFER_COUNT> m_tlasReadValues = {};
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO m_tlasPrebuildInfo = {};
+    std::array<D3DUploadRange, FRAME_COUNT> m_instanceDescBuffers;
+    float m_instanceTransform[3][4] = {};
+    CpuAabb m_meshBounds;
+    // the cost only sees instance boxes, the update limit also bounds degradation inside the driver's tree.
+    // with the single instance the limit is all that triggers a rebuild, see tlasCost
+    AsUpdatePolicy m_tlasUpdatePolicy{{.maxCostRatio = 1.5f, .maxUpdateCount = 1024}};
 
     Microsoft::WRL::ComPtr<ID3D12StateObject> m_raytracingPipelineState;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> m_globalRootSignature;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_descHeap;
     Microsoft::WRL::ComPtr<ID3D12Resource> m_raytracingOutput;
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_shaderTable;
-    UINT m_shaderRecordSize = 0;
+    D3DUploadRange m_shaderTable;
+    ShaderTableLayout m_shaderTableLayout;
 
     RECT m_windowRect = {};
 
     const std::wstring SHADER_FILE = L"shader.hlsl";
+    // compiled DXIL keyed by source, includes, arguments and DXC build, shared by every process started here
+    const std::wstring SHADER_CACHE_DIRECTORY = L"shader_cache";
     const std::wstring RAYGEN_SHADER = L"RayGen";
     const std::wstring MISS_SHADER = L"MissShader";
     const std::wstring CLOSEST_HIT_SHADER = L"ClosestHitShader";
     const std::wstring HIT_GROUP = L"HitGroup";
+    // BLAS builds per recording job, enough to keep the recording cost above the cost of a command list
+    static constexpr size_t BLAS_BUILDS_PER_JOB = 32;
 
     struct RaytracingPayload
     {
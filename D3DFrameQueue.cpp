@@ -0,0 +1,65 @@
+#include "D3DFrameQueue.h"
+
+#include <stdexcept>
+
+D3DFrameQueue::D3DFrameQueue(ID3D12Device* device, ID3D12CommandQueue* commandQueue)
+    : m_commandQueue(commandQueue)
+{
+    HRESULT hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to create fence.");
+    }
+
+    m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (m_fenceEvent == nullptr)
+    {
+        throw std::runtime_error("Failed to create fence event.");
+    }
+}
+
+D3DFrameQueue::~D3DFrameQueue()
+{
+    if (m_fenceEvent)
+    {
+        CloseHandle(m_fenceEvent);
+    }
+}
+
+void D3DFrameQueue::signal(uint64_t value)
+{
+    HRESULT hr = m_commandQueue->Signal(m_fence.Get(), value);
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to signal command queue.");
+    }
+}
+
+uint64_t D3DFrameQueue::completedValue() const
+{
+    return m_fence->GetCompletedValue();
+}
+
+void D3DFrameQueue::wait(uint64_t value)
+{
+    if (m_fence->GetCompletedValue() >= value)
+    {
+        return;
+    }
+
+    HRESULT hr = m_fence->SetEventOnCompletion(value, m_fenceEvent);
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to set event on fence completion.");
+    }
+    WaitForSingleObject(m_fenceEvent, INFINITE);
+}
+
+void D3DFrameQueue::gpuWait(const D3DFrameQueue& signaler, uint64_t value)
+{
+    HRESULT hr = m_commandQueue->Wait(signaler.m_fence.Get(), value);
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to wait for another command queue.");
+    }
+}
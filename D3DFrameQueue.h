@@ -0,0 +1,41 @@
+#ifndef D3DFRAMEQUEUE_H
+#define D3DFRAMEQUEUE_H
+
+#ifndef UNICODE
+#define UNICODE
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include "FramePacer.h"
+
+// FrameQueue over an ID3D12CommandQueue and a single fence used as a timeline
+class D3DFrameQueue : public FrameQueue
+{
+public:
+    D3DFrameQueue(ID3D12Device* device, ID3D12CommandQueue* commandQueue);
+    ~D3DFrameQueue() override;
+
+    D3DFrameQueue(const D3DFrameQueue&) = delete;
+    D3DFrameQueue& operator=(const D3DFrameQueue&) = delete;
+
+    void signal(uint64_t value) override;
+    uint64_t completedValue() const override;
+    void wait(uint64_t value) override;
+
+    // work submitted to this queue from now on waits on the GPU until signaler's fence reaches value,
+    // the CPU does not block
+    void gpuWait(const D3DFrameQueue& signaler, uint64_t value);
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
+    Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+    HANDLE m_fenceEvent = nullptr;
+};
+
+#endif //D3DFRAMEQUEUE_H
@@ -0,0 +1,143 @@
+#include "D3DGpuProfiler.h"
+
+#include <stdexcept>
+#include <utility>
+
+D3DGpuProfiler::D3DGpuProfiler(
+    ID3D12Device* device,
+    ID3D12CommandQueue* queue,
+    D3DHeapAllocator& heapAllocator,
+    uint32_t slotCount,
+    std::string trackName,
+    Profiler& profiler
+)
+    : m_queue(queue)
+    , m_profiler(profiler)
+    , m_track(profiler.addTrack(std::move(trackName)))
+    , m_slotScopes(slotCount)
+    , m_resolvedCounts(slotCount, 0)
+{
+    HRESULT hr = m_queue->GetTimestampFrequency(&m_timestampFrequency);
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to get GPU timestamp frequency.");
+    }
+
+    // a begin and an end timestamp per scope
+    D3D12_QUERY_HEAP_DESC queryHeapDesc = {
+        .Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP,
+        .Count = slotCount * MAX_SCOPES_PER_SLOT * 2,
+        .NodeMask = 0
+    };
+    hr = device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_queryHeap));
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to create timestamp query heap.");
+    }
+
+    m_readbackBuffer = heapAllocator.createBuffer(
+        queryHeapDesc.Count * sizeof(uint64_t),
+        D3D12_HEAP_TYPE_READBACK,
+        D3D12_RESOURCE_FLAG_NONE,
+        D3D12_RESOURCE_STATE_COPY_DEST
+    );
+}
+
+void D3DGpuProfiler::beginSlot(uint32_t slot)
+{
+    m_slot = slot;
+    std::vector<const char*>& scopes = m_slotScopes[slot];
+    uint32_t resolvedCount = m_resolvedCounts[slot];
+    m_resolvedCounts[slot] = 0;
+    if (resolvedCount == 0)
+    {
+        scopes.clear();
+        return;
+    }
+
+    // the GPU timestamp and the QPC value of the same instant, QPC is then related to the profiler clock
+    UINT64 gpuCalibration = 0;
+    UINT64 cpuCalibration = 0;
+    HRESULT hr = m_queue->GetClockCalibration(&gpuCalibration, &cpuCalibration);
+    uint64_t profilerNow = m_profiler.now();
+    LARGE_INTEGER qpcNow = {};
+    LARGE_INTEGER qpcFrequency = {};
+    QueryPerformanceCounter(&qpcNow);
+    QueryPerformanceFrequency(&qpcFrequency);
+    if (FAILED(hr))
+    {
+        scopes.clear();
+        return;
+    }
+    double calibrationNs = static_cast<double>(profilerNow)
+        - static_cast<double>(qpcNow.QuadPart - static_cast<LONGLONG>(cpuCalibration)) * 1e9 / static_cast<double>(qpcFrequency.QuadPart);
+    double nsPerTick = 1e9 / static_cast<double>(m_timestampFrequency);
+    auto toProfilerNs = [&](uint64_t timestamp) {
+        double ns = calibrationNs + static_cast<double>(static_cast<int64_t>(timestamp - gpuCalibration)) * nsPerTick;
+        return ns > 0.0 ? static_cast<uint64_t>(ns) : 0;
+    };
+
+    uint32_t firstQuery = queryIndex(slot, 0);
+    D3D12_RANGE readRange = {firstQuery * sizeof(uint64_t), (firstQuery + resolvedCount * 2) * sizeof(uint64_t)};
+    void* data = nullptr;
+    hr = m_readbackBuffer->Map(0, &readRange, &data);
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to map timestamp readback buffer.");
+    }
+    auto* timestamps = static_cast<const uint64_t*>(data);
+
+    for (uint32_t scope = 0; scope < resolvedCount; ++scope)
+    {
+        uint32_t query = queryIndex(slot, scope);
+        m_profiler.record(scopes[scope], toProfilerNs(timestamps[query]), toProfilerNs(timestamps[query + 1]), m_track);
+    }
+
+    D3D12_RANGE writeRange = {0, 0};
+    m_readbackBuffer->Unmap(0, &writeRange);
+    scopes.clear();
+}
+
+uint32_t D3DGpuProfiler::begin(ID3D12GraphicsCommandList* commandList, const char* name)
+{
+    std::vector<const char*>& scopes = m_slotScopes[m_slot];
+    if (!m_profiler.enabled() || scopes.size() >= MAX_SCOPES_PER_SLOT)
+    {
+        return NO_SCOPE;
+    }
+
+    uint32_t scope = static_cast<uint32_t>(scopes.size());
+    scopes.push_back(name);
+    commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, queryIndex(m_slot, scope));
+    return scope;
+}
+
+void D3DGpuProfiler::end(ID3D12GraphicsCommandList* commandList, uint32_t scope)
+{
+    if (scope == NO_SCOPE)
+    {
+        return;
+    }
+    commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, queryIndex(m_slot, scope) + 1);
+}
+
+void D3DGpuProfiler::resolve(ID3D12GraphicsCommandList* commandList)
+{
+    // every scope of the slot has ended by now, an open one would resolve an end timestamp never written
+    uint32_t count = static_cast<uint32_t>(m_slotScopes[m_slot].size()) - m_resolvedCounts[m_slot];
+    if (count == 0)
+    {
+        return;
+    }
+
+    uint32_t firstQuery = queryIndex(m_slot, m_resolvedCounts[m_slot]);
+    commandList->ResolveQueryData(
+        m_queryHeap.Get(),
+        D3D12_QUERY_TYPE_TIMESTAMP,
+        firstQuery,
+        count * 2,
+        m_readbackBuffer.Get(),
+        firstQuery * sizeof(uint64_t)
+    );
+    m_resolvedCounts[m_slot] += count;
+}
@@ -0,0 +1,87 @@
+#ifndef D3DGPUPROFILER_H
+#define D3DGPUPROFILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "D3DHeapAllocator.h"
+#include "Profiler.h"
+
+// GPU side of the Profiler: timestamp queries around ranges of a command list, placed on a track of their
+// own once the list has finished. the GPU clock is mapped onto the profiler's timeline with
+// GetClockCalibration, so GPU scopes line up with the CPU scopes that recorded them
+class D3DGpuProfiler
+{
+public:
+    D3DGpuProfiler(
+        ID3D12Device* device,
+        ID3D12CommandQueue* queue,
+        D3DHeapAllocator& heapAllocator,
+        uint32_t slotCount,
+        std::string trackName = "GPU direct queue",
+        Profiler& profiler = Profiler::instance()
+    );
+
+    D3DGpuProfiler(const D3DGpuProfiler&) = delete;
+    D3DGpuProfiler& operator=(const D3DGpuProfiler&) = delete;
+
+    // call once the GPU finished the command list slot recorded last: records its scopes into the
+    // profiler, then begin and end write into slot
+    void beginSlot(uint32_t slot);
+    // returns the scope to pass to end. nothing is recorded while the profiler is disabled
+    uint32_t begin(ID3D12GraphicsCommandList* commandList, const char* name);
+    void end(ID3D12GraphicsCommandList* commandList, uint32_t scope);
+    // call last before closing the slot's command list, copies its timestamps to the readback buffer
+    void resolve(ID3D12GraphicsCommandList* commandList);
+
+private:
+    static constexpr uint32_t MAX_SCOPES_PER_SLOT = 64;
+    static constexpr uint32_t NO_SCOPE = UINT32_MAX;
+
+    uint32_t queryIndex(uint32_t slot, uint32_t scope) const
+    {
+        return (slot * MAX_SCOPES_PER_SLOT + scope) * 2;
+    }
+
+    ID3D12CommandQueue* m_queue;
+    Profiler& m_profiler;
+    uint32_t m_track;
+    uint64_t m_timestampFrequency = 0;
+
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_queryHeap;
+    D3DBuffer m_readbackBuffer;
+
+    // scope names per slot, the scope index picks the query pair
+    std::vector<std::vector<const char*>> m_slotScopes;
+    // scopes resolved by the slot's last command list, read back in beginSlot
+    std::vector<uint32_t> m_resolvedCounts;
+    uint32_t m_slot = 0;
+};
+
+// begin/end of a D3DGpuProfiler scope tied to a C++ scope
+class D3DGpuScope
+{
+public:
+    D3DGpuScope(D3DGpuProfiler& profiler, ID3D12GraphicsCommandList* commandList, const char* name)
+        : m_profiler(profiler)
+        , m_commandList(commandList)
+        , m_scope(profiler.begin(commandList, name))
+    {
+    }
+
+    ~D3DGpuScope()
+    {
+        m_profiler.end(m_commandList, m_scope);
+    }
+
+    D3DGpuScope(const D3DGpuScope&) = delete;
+    D3DGpuScope& operator=(const D3DGpuScope&) = delete;
+
+private:
+    D3DGpuProfiler& m_profiler;
+    ID3D12GraphicsCommandList* m_commandList;
+    uint32_t m_scope;
+};
+
+#endif //D3DGPUPROFILER_H
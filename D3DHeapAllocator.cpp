@@ -0,0 +1,264 @@
+#include "D3DHeapAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+D3DBuffer::~D3DBuffer()
+{
+    Reset();
+}
+
+D3DBuffer::D3DBuffer(D3DBuffer&& other) noexcept
+    : m_allocator(std::exchange(other.m_allocator, nullptr))
+    , m_resource(std::move(other.m_resource))
+    , m_heapIndex(other.m_heapIndex)
+    , m_allocation(other.m_allocation)
+{
+}
+
+D3DBuffer& D3DBuffer::operator=(D3DBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        Reset();
+        m_allocator = std::exchange(other.m_allocator, nullptr);
+        m_resource = std::move(other.m_resource);
+        m_heapIndex = other.m_heapIndex;
+        m_allocation = other.m_allocation;
+    }
+    return *this;
+}
+
+void D3DBuffer::Reset()
+{
+    m_resource.Reset();
+    if (m_allocator)
+    {
+        m_allocator->free(m_heapIndex, m_allocation);
+        m_allocator = nullptr;
+    }
+}
+
+D3DUploadRange::~D3DUploadRange()
+{
+    Reset();
+}
+
+D3DUploadRange::D3DUploadRange(D3DUploadRange&& other) noexcept
+    : m_allocator(std::exchange(other.m_allocator, nullptr))
+    , m_pageIndex(other.m_pageIndex)
+    , m_allocation(other.m_allocation)
+    , m_gpuAddress(other.m_gpuAddress)
+    , m_data(other.m_data)
+{
+}
+
+D3DUploadRange& D3DUploadRange::operator=(D3DUploadRange&& other) noexcept
+{
+    if (this != &other)
+    {
+        Reset();
+        m_allocator = std::exchange(other.m_allocator, nullptr);
+        m_pageIndex = other.m_pageIndex;
+        m_allocation = other.m_allocation;
+        m_gpuAddress = other.m_gpuAddress;
+        m_data = other.m_data;
+    }
+    return *this;
+}
+
+void D3DUploadRange::Reset()
+{
+    if (m_allocator)
+    {
+        m_allocator->freeUpload(m_pageIndex, m_allocation);
+        m_allocator = nullptr;
+    }
+    m_gpuAddress = 0;
+    m_data = nullptr;
+}
+
+D3DHeapAllocator::D3DHeapAllocator(ID3D12Device* device, uint64_t heapSize)
+    : m_device(device)
+    , m_heapSize(heapSize)
+{
+}
+
+D3DHeapAllocator::~D3DHeapAllocator()
+{
+    // the pages are buffers in m_heaps
+    m_uploadPages.clear();
+}
+
+D3DBuffer D3DHeapAllocator::createBuffer(
+    uint64_t size,
+    D3D12_HEAP_TYPE heapType,
+    D3D12_RESOURCE_FLAGS resourceFlags,
+    D3D12_RESOURCE_STATES initialState
+)
+{
+    D3D12_RESOURCE_DESC resourceDesc = {
+        .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
+        .Alignment = 0,
+        .Width = size,
+        .Height = 1,
+        .DepthOrArraySize = 1,
+        .MipLevels = 1,
+        .Format = DXGI_FORMAT_UNKNOWN,
+        .SampleDesc = {1, 0},
+        .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+        .Flags = resourceFlags
+    };
+    D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_device->GetResourceAllocationInfo(0, 1, &resourceDesc);
+
+    uint32_t heapIndex = 0;
+    std::optional<TlsfAllocation> allocation;
+    for (; heapIndex < m_heaps.size(); ++heapIndex)
+    {
+        if (m_heaps[heapIndex].type == heapType)
+        {
+            allocation = m_heaps[heapIndex].allocator.allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+            if (allocation)
+            {
+                break;
+            }
+        }
+    }
+
+    if (!allocation)
+    {
+        // buffers larger than a heap get a heap of their own size
+        D3D12_HEAP_DESC heapDesc = {
+            .SizeInBytes = std::max(m_heapSize, allocationInfo.SizeInBytes),
+            .Properties = {
+                .Type = heapType,
+                .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+                .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+                .CreationNodeMask = 1,
+                .VisibleNodeMask = 1
+            },
+            .Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS
+        };
+        Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+        HRESULT hr = m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap));
+        if (FAILED(hr))
+        {
+            throw std::runtime_error("Failed to create heap.");
+        }
+
+        heapIndex = static_cast<uint32_t>(m_heaps.size());
+        m_heaps.push_back({heapType, std::move(heap), TlsfAllocator(heapDesc.SizeInBytes)});
+        allocation = m_heaps.back().allocator.allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+        if (!allocation)
+        {
+            throw std::runtime_error("Failed to allocate buffer from a new heap.");
+        }
+    }
+
+    D3DBuffer buffer;
+    HRESULT hr = m_device->CreatePlacedResource(
+        m_heaps[heapIndex].heap.Get(),
+        allocation->offset,
+        &resourceDesc,
+        initialState,
+        nullptr,
+        IID_PPV_ARGS(&buffer.m_resource)
+    );
+    if (FAILED(hr))
+    {
+        m_heaps[heapIndex].allocator.free(*allocation);
+        throw std::runtime_error("Failed to create buffer.");
+    }
+    buffer.m_allocator = this;
+    buffer.m_heapIndex = heapIndex;
+    buffer.m_allocation = *allocation;
+    return buffer;
+}
+
+D3DUploadRange D3DHeapAllocator::allocateUpload(uint64_t size, uint64_t alignment)
+{
+    uint32_t pageIndex = 0;
+    std::optional<TlsfAllocation> allocation;
+    for (; pageIndex < m_uploadPages.size(); ++pageIndex)
+    {
+        allocation = m_uploadPages[pageIndex].allocator.allocate(size, alignment);
+        if (allocation)
+        {
+            break;
+        }
+    }
+
+    if (!allocation)
+    {
+        uint64_t pageSize = std::max(UPLOAD_PAGE_SIZE, (size + alignment + TLSF_GRANULARITY - 1) & ~(TLSF_GRANULARITY - 1));
+        D3DBuffer buffer = createBuffer(
+            pageSize,
+            D3D12_HEAP_TYPE_UPLOAD,
+            D3D12_RESOURCE_FLAG_NONE,
+            D3D12_RESOURCE_STATE_GENERIC_READ
+        );
+
+        // upload heaps can stay mapped for their whole lifetime
+        void* data = nullptr;
+        HRESULT hr = buffer->Map(0, nullptr, &data);
+        if (FAILED(hr))
+        {
+            throw std::runtime_error("Failed to map upload page.");
+        }
+
+        pageIndex = static_cast<uint32_t>(m_uploadPages.size());
+        m_uploadPages.push_back({std::move(buffer), static_cast<std::byte*>(data), TlsfAllocator(pageSize)});
+        allocation = m_uploadPages.back().allocator.allocate(size, alignment);
+        if (!allocation)
+        {
+            throw std::runtime_error("Failed to allocate upload range from a new page.");
+        }
+    }
+
+    const UploadPage& page = m_uploadPages[pageIndex];
+    D3DUploadRange range;
+    range.m_allocator = this;
+    range.m_pageIndex = pageIndex;
+    range.m_allocation = *allocation;
+    range.m_gpuAddress = page.buffer->GetGPUVirtualAddress() + allocation->offset;
+    range.m_data = page.data + allocation->offset;
+    m_uploadRangeCount++;
+    return range;
+}
+
+D3DHeapAllocatorStats D3DHeapAllocator::stats() const
+{
+    D3DHeapAllocatorStats stats = {
+        .heapCount = static_cast<uint32_t>(m_heaps.size()),
+        .uploadRangeCount = m_uploadRangeCount
+    };
+    uint64_t freeBytes = 0;
+    for (const Heap& heap : m_heaps)
+    {
+        TlsfAllocatorStats heapStats = heap.allocator.stats();
+        stats.reservedBytes += heapStats.capacity;
+        stats.usedBytes += heapStats.usedBytes;
+        stats.allocationCount += heapStats.allocationCount;
+        stats.freeBlockCount += heapStats.freeBlockCount;
+        stats.largestFreeBlock = std::max(stats.largestFreeBlock, heapStats.largestFreeBlock);
+        freeBytes += heapStats.freeBytes;
+    }
+    if (freeBytes > 0)
+    {
+        stats.fragmentation = 1.0 - static_cast<double>(stats.largestFreeBlock) / static_cast<double>(freeBytes);
+    }
+    return stats;
+}
+
+void D3DHeapAllocator::free(uint32_t heapIndex, const TlsfAllocation& allocation)
+{
+    m_heaps[heapIndex].allocator.free(allocation);
+}
+
+void D3DHeapAllocator::freeUpload(uint32_t pageIndex, const TlsfAllocation& allocation)
+{
+    m_uploadPages[pageIndex].allocator.free(allocation);
+    m_uploadRangeCount--;
+}
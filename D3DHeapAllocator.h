@@ -0,0 +1,173 @@
+#ifndef D3DHEAPALLOCATOR_H
+#define D3DHEAPALLOCATOR_H
+
+#ifndef UNICODE
+#define UNICODE
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TlsfAllocator.h"
+
+class D3DHeapAllocator;
+
+// placed buffer that hands its heap range back when released, used like a ComPtr<ID3D12Resource>
+class D3DBuffer
+{
+public:
+    D3DBuffer() = default;
+    ~D3DBuffer();
+
+    D3DBuffer(D3DBuffer&& other) noexcept;
+    D3DBuffer& operator=(D3DBuffer&& other) noexcept;
+    D3DBuffer(const D3DBuffer&) = delete;
+    D3DBuffer& operator=(const D3DBuffer&) = delete;
+
+    ID3D12Resource* Get() const
+    {
+        return m_resource.Get();
+    }
+
+    ID3D12Resource* operator->() const
+    {
+        return m_resource.Get();
+    }
+
+    explicit operator bool() const
+    {
+        return m_resource != nullptr;
+    }
+
+    void Reset();
+
+private:
+    friend class D3DHeapAllocator;
+
+    D3DHeapAllocator* m_allocator = nullptr;
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_resource;
+    uint32_t m_heapIndex = 0;
+    TlsfAllocation m_allocation;
+};
+
+// range of a persistently mapped upload buffer shared with other small allocations
+class D3DUploadRange
+{
+public:
+    D3DUploadRange() = default;
+    ~D3DUploadRange();
+
+    D3DUploadRange(D3DUploadRange&& other) noexcept;
+    D3DUploadRange& operator=(D3DUploadRange&& other) noexcept;
+    D3DUploadRange(const D3DUploadRange&) = delete;
+    D3DUploadRange& operator=(const D3DUploadRange&) = delete;
+
+    D3D12_GPU_VIRTUAL_ADDRESS gpuAddress() const
+    {
+        return m_gpuAddress;
+    }
+
+    std::byte* data() const
+    {
+        return m_data;
+    }
+
+    uint64_t size() const
+    {
+        return m_allocation.size;
+    }
+
+    explicit operator bool() const
+    {
+        return m_allocator != nullptr;
+    }
+
+    void Reset();
+
+private:
+    friend class D3DHeapAllocator;
+
+    D3DHeapAllocator* m_allocator = nullptr;
+    uint32_t m_pageIndex = 0;
+    TlsfAllocation m_allocation;
+    D3D12_GPU_VIRTUAL_ADDRESS m_gpuAddress = 0;
+    std::byte* m_data = nullptr;
+};
+
+struct D3DHeapAllocatorStats
+{
+    uint32_t heapCount = 0;
+    uint64_t reservedBytes = 0;
+    uint64_t usedBytes = 0;
+    uint32_t allocationCount = 0;
+    uint32_t uploadRangeCount = 0;
+    uint32_t freeBlockCount = 0;
+    uint64_t largestFreeBlock = 0;
+    // 1 - largestFreeBlock / free bytes over all heaps
+    double fragmentation = 0.0;
+};
+
+// places buffers in a few large ID3D12Heaps per heap type instead of one committed resource each.
+// buffers take the 64KB placement alignment class; small upload data (instance descs, shader tables)
+// takes the 256-byte class inside shared upload pages, so it does not round up to 64KB
+class D3DHeapAllocator
+{
+public:
+    static constexpr uint64_t DEFAULT_HEAP_SIZE = 64ull << 20;
+    static constexpr uint64_t UPLOAD_PAGE_SIZE = 2ull << 20;
+
+    explicit D3DHeapAllocator(ID3D12Device* device, uint64_t heapSize = DEFAULT_HEAP_SIZE);
+    ~D3DHeapAllocator();
+
+    D3DHeapAllocator(const D3DHeapAllocator&) = delete;
+    D3DHeapAllocator& operator=(const D3DHeapAllocator&) = delete;
+
+    D3DBuffer createBuffer(
+        uint64_t size,
+        D3D12_HEAP_TYPE heapType,
+        D3D12_RESOURCE_FLAGS resourceFlags,
+        D3D12_RESOURCE_STATES initialState
+    );
+
+    // alignment is a power of two, at least TLSF_GRANULARITY is used
+    D3DUploadRange allocateUpload(uint64_t size, uint64_t alignment = TLSF_GRANULARITY);
+
+    D3DHeapAllocatorStats stats() const;
+
+private:
+    friend class D3DBuffer;
+    friend class D3DUploadRange;
+
+    struct Heap
+    {
+        D3D12_HEAP_TYPE type;
+        Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+        TlsfAllocator allocator;
+    };
+
+    struct UploadPage
+    {
+        D3DBuffer buffer;
+        std::byte* data;
+        TlsfAllocator allocator;
+    };
+
+    void free(uint32_t heapIndex, const TlsfAllocation& allocation);
+    void freeUpload(uint32_t pageIndex, const TlsfAllocation& allocation);
+
+    Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+    uint64_t m_heapSize;
+    std::vector<Heap> m_heaps;
+    std::vector<UploadPage> m_uploadPages;
+    uint32_t m_uploadRangeCount = 0;
+};
+
+#endif //D3DHEAPALLOCATOR_H
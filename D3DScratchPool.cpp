@@ -0,0 +1,91 @@
+#include "D3DScratchPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+D3DScratchPool::D3DScratchPool(D3DHeapAllocator& heapAllocator)
+    : m_heapAllocator(heapAllocator)
+{
+}
+
+void D3DScratchPool::begin(uint64_t completedValue)
+{
+    std::erase_if(m_retired, [&](const auto& retired) { return retired.first <= completedValue; });
+
+    // grow between command lists to what the last ones needed without wrapping
+    uint64_t capacity = std::max(m_allocator.stats().highWaterMark, m_allocator.stats().capacity);
+    if (capacity > m_allocator.stats().capacity)
+    {
+        replaceBuffer(capacity);
+    }
+    m_allocator.begin(capacity);
+}
+
+void D3DScratchPool::reserve(uint64_t capacity)
+{
+    capacity = (capacity + SCRATCH_ALIGNMENT - 1) / SCRATCH_ALIGNMENT * SCRATCH_ALIGNMENT;
+    if (capacity > m_allocator.stats().capacity)
+    {
+        replaceBuffer(capacity);
+        m_allocator.grow(capacity);
+    }
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS D3DScratchPool::allocate(ID3D12GraphicsCommandList* commandList, uint64_t size)
+{
+    std::optional<ScratchRange> range = m_allocator.allocate(size);
+    if (!range)
+    {
+        // a fresh buffer has no earlier builds to wait for
+        replaceBuffer(m_allocator.stats().highWaterMark);
+        m_allocator.grow(m_allocator.stats().highWaterMark);
+        range = m_allocator.allocate(size);
+        if (!range)
+        {
+            throw std::runtime_error("Failed to allocate scratch memory.");
+        }
+    }
+
+    if (range->needsBarrier)
+    {
+        D3D12_RESOURCE_BARRIER barrier = {
+            .Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
+            .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+            .UAV = {
+                .pResource = m_buffer.Get()
+            }
+        };
+        commandList->ResourceBarrier(1, &barrier);
+    }
+
+    return m_buffer->GetGPUVirtualAddress() + range->offset;
+}
+
+void D3DScratchPool::markBarrier()
+{
+    m_allocator.markBarrier();
+}
+
+void D3DScratchPool::end(uint64_t fenceValue)
+{
+    for (D3DBuffer& buffer : m_replaced)
+    {
+        m_retired.emplace_back(fenceValue, std::move(buffer));
+    }
+    m_replaced.clear();
+}
+
+void D3DScratchPool::replaceBuffer(uint64_t capacity)
+{
+    if (m_buffer)
+    {
+        m_replaced.push_back(std::move(m_buffer));
+    }
+    m_buffer = m_heapAllocator.createBuffer(
+        capacity,
+        D3D12_HEAP_TYPE_DEFAULT,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS
+    );
+    m_bufferCount++;
+}
@@ -0,0 +1,57 @@
+#ifndef D3DSCRATCHPOOL_H
+#define D3DSCRATCHPOOL_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "D3DHeapAllocator.h"
+#include "ScratchAllocator.h"
+
+// scratch memory for acceleration structure builds. one buffer is kept at the high-water mark of earlier
+// command lists, so rebuilding the same geometry every frame allocates nothing and records no barriers
+class D3DScratchPool
+{
+public:
+    explicit D3DScratchPool(D3DHeapAllocator& heapAllocator);
+
+    D3DScratchPool(const D3DScratchPool&) = delete;
+    D3DScratchPool& operator=(const D3DScratchPool&) = delete;
+
+    // call before recording builds into a command list, completedValue is the queue's completed fence value
+    void begin(uint64_t completedValue);
+    // call right after begin, so the builds between two barriers never wrap as long as they need at most capacity
+    void reserve(uint64_t capacity);
+    // records a UAV barrier on the scratch buffer first if the range was used by an earlier build
+    D3D12_GPU_VIRTUAL_ADDRESS allocate(ID3D12GraphicsCommandList* commandList, uint64_t size);
+    // the caller recorded a barrier that waits for all earlier builds
+    void markBarrier();
+    // fenceValue is signaled after the command list, buffers replaced by growing are freed once it completes
+    void end(uint64_t fenceValue);
+
+    const ScratchAllocatorStats& stats() const
+    {
+        return m_allocator.stats();
+    }
+
+    // scratch buffers created, including the replacements when a command list needed more
+    uint32_t bufferCount() const
+    {
+        return m_bufferCount;
+    }
+
+private:
+    void replaceBuffer(uint64_t capacity);
+
+    D3DHeapAllocator& m_heapAllocator;
+    ScratchAllocator m_allocator;
+    D3DBuffer m_buffer;
+    uint32_t m_bufferCount = 0;
+
+    // replaced during the current command list, it may still reference them
+    std::vector<D3DBuffer> m_replaced;
+    // replaced buffers with the fence value after which the GPU no longer uses them
+    std::vector<std::pair<uint64_t, D3DBuffer>> m_retired;
+};
+
+#endif //D3DSCRATCHPOOL_H
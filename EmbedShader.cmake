@@ -0,0 +1,55 @@
+# writes the DXIL library produced by DXC and the names it exports into a C++ header.
+# run with cmake -P and -D DXIL=... -D OUTPUT=... -D SOURCE=... -D EXPORTS=a,b
+
+function(bytes_to_array FILE VARIABLE SIZE_VARIABLE)
+    file(READ ${FILE} hex HEX)
+    string(LENGTH "${hex}" hex_length)
+    math(EXPR size "${hex_length} / 2")
+    if (size EQUAL 0)
+        # arrays cannot be empty, the size constant stays 0
+        set(hex "00")
+    endif ()
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    # 16 bytes per line
+    string(REGEX REPLACE "((0x[0-9a-f][0-9a-f],){16})" "\\1\n    " bytes "${bytes}")
+    set(${VARIABLE} "${bytes}" PARENT_SCOPE)
+    set(${SIZE_VARIABLE} ${size} PARENT_SCOPE)
+endfunction()
+
+function(names_to_array NAMES VARIABLE)
+    set(result "")
+    foreach (name IN LISTS NAMES)
+        string(APPEND result "L\"${name}\", ")
+    endforeach ()
+    set(${VARIABLE} "${result}" PARENT_SCOPE)
+endfunction()
+
+string(REPLACE "," ";" EXPORTS "${EXPORTS}")
+
+bytes_to_array(${DXIL} dxil_bytes dxil_size)
+names_to_array("${EXPORTS}" export_names)
+
+get_filename_component(source_name ${SOURCE} NAME)
+
+file(WRITE ${OUTPUT}.tmp "\
+// generated by EmbedShader.cmake from ${source_name}, do not edit
+#ifndef SHADERLIBRARY_H
+#define SHADERLIBRARY_H
+
+#include <cstddef>
+
+// DXIL library container, reflection stripped
+alignas(4) inline constexpr unsigned char SHADER_LIBRARY_DXIL[] = {
+    ${dxil_bytes}
+};
+inline constexpr size_t SHADER_LIBRARY_DXIL_SIZE = ${dxil_size};
+
+// the library was compiled with dxc -exports for exactly these names
+inline constexpr const wchar_t* SHADER_LIBRARY_EXPORTS[] = {${export_names}};
+
+#endif //SHADERLIBRARY_H
+")
+
+# keeps the timestamp, and with it the rebuild of everything including the header, when nothing changed
+file(COPY_FILE ${OUTPUT}.tmp ${OUTPUT} ONLY_IF_DIFFERENT)
+file(REMOVE ${OUTPUT}.tmp)
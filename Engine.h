@@ -0,0 +1,20 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <cstdint>
+
+class Engine
+{
+public:
+    virtual ~Engine() = default;
+
+    virtual void cleanup() = 0;
+
+    virtual void render() = 0;
+
+    // object to world transform of one instance, row-major 3x4 like a D3D12 instance desc, used from the
+    // next render()
+    virtual void setInstanceTransform(uint32_t instanceIndex, const float transform[3][4]) = 0;
+};
+
+#endif //ENGINE_H
@@ -0,0 +1,71 @@
+#include "FramePacer.h"
+
+#include <chrono>
+#include <stdexcept>
+
+FramePacer::FramePacer(FrameQueue& queue, uint32_t framesInFlight)
+    : m_queue(queue)
+    , m_slotValues(framesInFlight, 0)
+{
+    if (framesInFlight == 0)
+    {
+        throw std::invalid_argument("FramePacer needs at least one frame in flight.");
+    }
+}
+
+uint32_t FramePacer::beginFrame()
+{
+    if (m_inFrame)
+    {
+        throw std::logic_error("beginFrame called twice without endFrame.");
+    }
+
+    m_currentSlot = static_cast<uint32_t>(m_stats.frameCount % m_slotValues.size());
+    uint64_t slotValue = m_slotValues[m_currentSlot];
+    if (m_queue.completedValue() < slotValue)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        m_queue.wait(slotValue);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        m_stats.stallCount++;
+        m_stats.stallMs += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    m_inFrame = true;
+    return m_currentSlot;
+}
+
+uint64_t FramePacer::endFrame()
+{
+    if (!m_inFrame)
+    {
+        throw std::logic_error("endFrame called without beginFrame.");
+    }
+
+    m_queue.signal(++m_lastSignaledValue);
+    m_slotValues[m_currentSlot] = m_lastSignaledValue;
+    m_stats.frameCount++;
+    m_inFrame = false;
+    return m_lastSignaledValue;
+}
+
+void FramePacer::flush()
+{
+    m_queue.signal(++m_lastSignaledValue);
+    m_queue.wait(m_lastSignaledValue);
+}
+
+uint64_t FramePacer::pendingFrames() const
+{
+    uint64_t completed = m_queue.completedValue();
+    uint64_t pending = 0;
+    for (uint64_t value : m_slotValues)
+    {
+        if (value > completed)
+        {
+            pending++;
+        }
+    }
+    return pending;
+}
@@ -0,0 +1,75 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <cstdint>
+#include <vector>
+
+// a command queue together with one timeline fence. signal() enqueues a fence signal behind all work
+// submitted so far, so completedValue() >= value means that work has finished on the GPU
+class FrameQueue
+{
+public:
+    virtual ~FrameQueue() = default;
+
+    virtual void signal(uint64_t value) = 0;
+    virtual uint64_t completedValue() const = 0;
+    // blocks the calling thread until completedValue() >= value
+    virtual void wait(uint64_t value) = 0;
+};
+
+struct FramePacerStats
+{
+    uint64_t frameCount = 0;
+    // beginFrame calls that had to wait for the GPU, and how long they waited
+    uint64_t stallCount = 0;
+    double stallMs = 0.0;
+};
+
+// keeps up to framesInFlight frames queued on the GPU. every frame records into the command
+// allocator/list of its slot and signals the next timeline value when it is submitted; the CPU only
+// waits when a slot comes around again while the GPU is still executing the frame that last used it
+class FramePacer
+{
+public:
+    FramePacer(FrameQueue& queue, uint32_t framesInFlight);
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // returns the slot of the next frame, its allocator and command list can be reset once this returns
+    uint32_t beginFrame();
+    // call after the slot's command lists were submitted, returns the timeline value of the frame
+    uint64_t endFrame();
+    // waits until everything submitted to the queue has finished, e.g. before releasing resources
+    void flush();
+
+    uint32_t framesInFlight() const
+    {
+        return static_cast<uint32_t>(m_slotValues.size());
+    }
+
+    // frames submitted but not finished on the GPU
+    uint64_t pendingFrames() const;
+
+    uint64_t lastSignaledValue() const
+    {
+        return m_lastSignaledValue;
+    }
+
+    const FramePacerStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    FrameQueue& m_queue;
+    // timeline value that was signaled after the last frame recorded in each slot
+    std::vector<uint64_t> m_slotValues;
+    uint64_t m_lastSignaledValue = 0;
+    uint32_t m_currentSlot = 0;
+    bool m_inFrame = false;
+
+    FramePacerStats m_stats;
+};
+
+#endif //FRAMEPACER_H
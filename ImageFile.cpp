@@ -0,0 +1,157 @@
+#include "ImageFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+uint32_t channel(uint32_t pixel, int index)
+{
+    return (pixel >> (index * 8)) & 0xFF;
+}
+
+// PPM header fields are separated by whitespace, with # comments up to the end of the line
+uint32_t readHeaderValue(std::ifstream& stream)
+{
+    stream >> std::ws;
+    while (stream.peek() == '#')
+    {
+        std::string comment;
+        std::getline(stream, comment);
+        stream >> std::ws;
+    }
+    uint32_t value = 0;
+    stream >> value;
+    return value;
+}
+}
+
+void writeImage(const std::filesystem::path& path, uint32_t width, uint32_t height, std::span<const uint32_t> pixels)
+{
+    if (pixels.size() != static_cast<size_t>(width) * height)
+    {
+        throw std::invalid_argument("Image pixel count does not match its size.");
+    }
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream)
+    {
+        throw std::runtime_error("Failed to open image for writing: " + path.string());
+    }
+
+    stream << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<char> row(static_cast<size_t>(width) * 3);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint32_t pixel = pixels[static_cast<size_t>(y) * width + x];
+            for (int c = 0; c < 3; ++c)
+            {
+                row[x * 3 + c] = static_cast<char>(channel(pixel, c));
+            }
+        }
+        stream.write(row.data(), static_cast<std::streamsize>(row.size()));
+    }
+
+    stream.close();
+    if (!stream)
+    {
+        throw std::runtime_error("Failed to write image: " + path.string());
+    }
+}
+
+Image readImage(const std::filesystem::path& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+    {
+        throw std::runtime_error("Failed to open image: " + path.string());
+    }
+
+    std::string magic;
+    stream >> magic;
+    if (magic != "P6")
+    {
+        throw std::runtime_error("Image is not a binary PPM: " + path.string());
+    }
+    Image image;
+    image.width = readHeaderValue(stream);
+    image.height = readHeaderValue(stream);
+    uint32_t maxValue = readHeaderValue(stream);
+    if (!stream || image.width == 0 || image.height == 0 || maxValue != 255)
+    {
+        throw std::runtime_error("Unsupported PPM header: " + path.string());
+    }
+    // exactly one whitespace character separates the header from the pixels
+    stream.get();
+
+    std::vector<unsigned char> data(static_cast<size_t>(image.width) * image.height * 3);
+    stream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!stream)
+    {
+        throw std::runtime_error("Image is truncated: " + path.string());
+    }
+
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height);
+    for (size_t i = 0; i < image.pixels.size(); ++i)
+    {
+        image.pixels[i] = data[i * 3] | (data[i * 3 + 1] << 8) | (data[i * 3 + 2] << 16) | (0xFFu << 24);
+    }
+    return image;
+}
+
+ImageComparison compareImages(const Image& a, const Image& b, uint32_t threshold)
+{
+    if (a.width != b.width || a.height != b.height)
+    {
+        throw std::invalid_argument("Compared images differ in size.");
+    }
+
+    ImageComparison comparison;
+    for (size_t i = 0; i < a.pixels.size(); ++i)
+    {
+        uint32_t pixelDifference = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            uint32_t difference = static_cast<uint32_t>(std::abs(
+                static_cast<int>(channel(a.pixels[i], c)) - static_cast<int>(channel(b.pixels[i], c))
+            ));
+            pixelDifference = std::max(pixelDifference, difference);
+        }
+        comparison.maxDifference = std::max(comparison.maxDifference, pixelDifference);
+        comparison.differingPixels += pixelDifference > threshold ? 1 : 0;
+    }
+    comparison.differingFraction = a.pixels.empty()
+        ? 0.0
+        : static_cast<double>(comparison.differingPixels) / static_cast<double>(a.pixels.size());
+    return comparison;
+}
+
+Image differenceImage(const Image& a, const Image& b)
+{
+    if (a.width != b.width || a.height != b.height)
+    {
+        throw std::invalid_argument("Compared images differ in size.");
+    }
+
+    Image difference = {
+        .width = a.width,
+        .height = a.height,
+        .pixels = std::vector<uint32_t>(a.pixels.size())
+    };
+    for (size_t i = 0; i < a.pixels.size(); ++i)
+    {
+        uint32_t pixel = 0xFFu << 24;
+        for (int c = 0; c < 3; ++c)
+        {
+            int value = std::abs(static_cast<int>(channel(a.pixels[i], c)) - static_cast<int>(channel(b.pixels[i], c)));
+            pixel |= static_cast<uint32_t>(std::min(value * 16, 255)) << (c * 8);
+        }
+        difference.pixels[i] = pixel;
+    }
+    return difference;
+}
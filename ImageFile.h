@@ -0,0 +1,36 @@
+#ifndef IMAGEFILE_H
+#define IMAGEFILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+// DXGI_FORMAT_R8G8B8A8_UNORM pixels, row-major, the layout CpuEngine renders into
+struct Image
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint32_t> pixels;
+};
+
+// binary PPM (P6): no dependencies and every image tool reads it. alpha is not stored
+void writeImage(const std::filesystem::path& path, uint32_t width, uint32_t height, std::span<const uint32_t> pixels);
+
+// reads what writeImage writes, alpha comes back as 255
+Image readImage(const std::filesystem::path& path);
+
+struct ImageComparison
+{
+    uint32_t maxDifference = 0; // largest difference of one color channel
+    uint64_t differingPixels = 0; // pixels with a channel differing by more than the threshold
+    double differingFraction = 0.0;
+};
+
+// compares the color channels, the images must have the same size
+ImageComparison compareImages(const Image& a, const Image& b, uint32_t threshold);
+
+// per-channel absolute difference, scaled so small differences stay visible
+Image differenceImage(const Image& a, const Image& b);
+
+#endif //IMAGEFILE_H
@@ -0,0 +1,45 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+// read-only memory mapping of a whole file, the pages are faulted in on first access
+class MappedFile
+{
+public:
+    // sequential hints the OS to read ahead aggressively, for files parsed front to back
+    explicit MappedFile(const std::filesystem::path& path, bool sequential = false);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const std::byte* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    std::span<const std::byte> bytes() const
+    {
+        return {m_data, m_size};
+    }
+
+private:
+    const std::byte* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+#endif //MAPPEDFILE_H
@@ -0,0 +1,1087 @@
+#include "MeshLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "MappedFile.h"
+
+namespace
+{
+// runs fn(0..count-1) on up to threadCount threads, the first exception is rethrown on the caller
+void parallelFor(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t)>& fn)
+{
+    std::atomic<uint32_t> next = 0;
+    std::exception_ptr error;
+    std::atomic_flag errorSet;
+
+    auto worker = [&] {
+        for (uint32_t i = next++; i < count; i = next++)
+        {
+            try
+            {
+                fn(i);
+            }
+            catch (...)
+            {
+                if (!errorSet.test_and_set())
+                {
+                    error = std::current_exception();
+                }
+                next = count;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    uint32_t workerCount = std::min(threadCount, count);
+    for (uint32_t i = 1; i < workerCount; ++i)
+    {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+// both formats are right-handed, D3D and the RayGen camera are left-handed
+Float3 toLeftHanded(const Float3& p)
+{
+    return {p.x, p.y, -p.z};
+}
+
+// ---- obj ----
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* skipSpaces(const char* p, const char* end)
+{
+    while (p < end && isSpace(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+const char* tokenEnd(const char* p, const char* end)
+{
+    while (p < end && !isSpace(*p) && *p != '\n')
+    {
+        ++p;
+    }
+    return p;
+}
+
+const char* nextLine(const char* p, const char* end)
+{
+    const void* newline = std::memchr(p, '\n', end - p);
+    return newline ? static_cast<const char*>(newline) + 1 : end;
+}
+
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+
+    // filled by the counting pass
+    uint32_t vertexCount = 0;
+    size_t triangleCount = 0;
+
+    // prefix sums over the previous chunks
+    uint32_t vertexOffset = 0;
+    size_t triangleOffset = 0;
+};
+
+float parseObjFloat(const char*& p, const char* end)
+{
+    p = skipSpaces(p, end);
+    // from_chars does not take a leading plus
+    if (p < end && *p == '+')
+    {
+        ++p;
+    }
+
+    float value = 0.0f;
+    auto [ptr, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc())
+    {
+        throw std::runtime_error("Invalid vertex position in OBJ file.");
+    }
+    p = ptr;
+    return value;
+}
+
+uint32_t resolveObjIndex(const char* token, const char* end, uint32_t currentVertexCount, uint32_t totalVertexCount)
+{
+    int64_t value = 0;
+    auto [ptr, ec] = std::from_chars(token, end, value);
+    if (ec != std::errc() || value == 0)
+    {
+        throw std::runtime_error("Invalid face index in OBJ file.");
+    }
+
+    // negative indices count back from the last vertex defined so far
+    int64_t index = value > 0 ? value - 1 : static_cast<int64_t>(currentVertexCount) + value;
+    if (index < 0 || index >= totalVertexCount)
+    {
+        throw std::runtime_error("Face index out of range in OBJ file.");
+    }
+    return static_cast<uint32_t>(index);
+}
+
+// Emit = false only counts vertices and triangles, Emit = true writes them at the chunk's offsets
+template<bool Emit>
+void parseObjChunk(ObjChunk& chunk, Mesh* mesh, uint32_t totalVertexCount)
+{
+    uint32_t vertexCount = 0;
+    size_t triangleCount = 0;
+
+    for (const char* line = chunk.begin; line < chunk.end; line = nextLine(line, chunk.end))
+    {
+        const char* p = skipSpaces(line, chunk.end);
+        if (p + 1 >= chunk.end || !isSpace(p[1]))
+        {
+            continue;
+        }
+
+        if (*p == 'v')
+        {
+            if constexpr (Emit)
+            {
+                p += 1;
+                float x = parseObjFloat(p, chunk.end);
+                float y = parseObjFloat(p, chunk.end);
+                float z = parseObjFloat(p, chunk.end);
+                mesh->vertices[chunk.vertexOffset + vertexCount] = toLeftHanded({x, y, z});
+            }
+            ++vertexCount;
+        }
+        else if (*p == 'f')
+        {
+            // v, v/vt, v//vn and v/vt/vn all start with the position index
+            uint32_t refCount = 0;
+            uint32_t first = 0;
+            uint32_t previous = 0;
+            for (p = skipSpaces(p + 1, chunk.end); p < chunk.end && *p != '\n'; p = skipSpaces(p, chunk.end))
+            {
+                const char* end = tokenEnd(p, chunk.end);
+                if constexpr (Emit)
+                {
+                    uint32_t index = resolveObjIndex(p, end, chunk.vertexOffset + vertexCount, totalVertexCount);
+                    if (refCount == 0)
+                    {
+                        first = index;
+                    }
+                    else if (refCount >= 2)
+                    {
+                        // fan, with the winding flipped along with the handedness
+                        uint32_t* triangle = &mesh->indices[(chunk.triangleOffset + triangleCount) * 3];
+                        triangle[0] = first;
+                        triangle[1] = index;
+                        triangle[2] = previous;
+                        ++triangleCount;
+                    }
+                    previous = index;
+                }
+                else if (refCount >= 2)
+                {
+                    ++triangleCount;
+                }
+                ++refCount;
+                p = end;
+            }
+        }
+    }
+
+    if constexpr (!Emit)
+    {
+        chunk.vertexCount = vertexCount;
+        chunk.triangleCount = triangleCount;
+    }
+}
+
+Mesh loadObj(const MappedFile& file, uint32_t threadCount)
+{
+    const char* begin = reinterpret_cast<const char*>(file.data());
+    const char* end = begin + file.size();
+
+    // several chunks per thread so a chunk full of faces does not hold everyone up
+    constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+    size_t chunkCount = std::clamp<size_t>(file.size() / MIN_CHUNK_SIZE, 1, static_cast<size_t>(threadCount) * 4);
+    size_t chunkSize = file.size() / chunkCount;
+
+    std::vector<ObjChunk> chunks;
+    chunks.reserve(chunkCount);
+    const char* chunkBegin = begin;
+    for (size_t i = 1; i <= chunkCount && chunkBegin < end; ++i)
+    {
+        // chunks end on line boundaries
+        const char* chunkEnd = i == chunkCount ? end : nextLine(std::max(chunkBegin, begin + i * chunkSize), end);
+        chunks.push_back({.begin = chunkBegin, .end = chunkEnd});
+        chunkBegin = chunkEnd;
+    }
+
+    uint32_t parallelChunks = static_cast<uint32_t>(chunks.size());
+    parallelFor(parallelChunks, threadCount, [&](uint32_t i) {
+        parseObjChunk<false>(chunks[i], nullptr, 0);
+    });
+
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    for (auto& chunk : chunks)
+    {
+        chunk.vertexOffset = static_cast<uint32_t>(vertexCount);
+        chunk.triangleOffset = triangleCount;
+        vertexCount += chunk.vertexCount;
+        triangleCount += chunk.triangleCount;
+        if (vertexCount > UINT32_MAX)
+        {
+            throw std::runtime_error("OBJ file has too many vertices.");
+        }
+    }
+
+    Mesh mesh;
+    mesh.vertices.resize(vertexCount);
+    mesh.indices.resize(triangleCount * 3);
+    parallelFor(parallelChunks, threadCount, [&](uint32_t i) {
+        parseObjChunk<true>(chunks[i], &mesh, static_cast<uint32_t>(vertexCount));
+    });
+    return mesh;
+}
+
+// ---- glb ----
+
+struct JsonValue
+{
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    // array elements, or object values in the order of keys
+    std::vector<JsonValue> elements;
+    std::vector<std::string> keys;
+
+    const JsonValue* find(std::string_view key) const
+    {
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (keys[i] == key)
+            {
+                return &elements[i];
+            }
+        }
+        return nullptr;
+    }
+
+    double numberOr(std::string_view key, double fallback) const
+    {
+        const JsonValue* value = find(key);
+        return value && value->type == Type::Number ? value->number : fallback;
+    }
+
+    const JsonValue& at(std::string_view key) const
+    {
+        const JsonValue* value = find(key);
+        if (!value)
+        {
+            throw std::runtime_error("glTF is missing \"" + std::string(key) + "\".");
+        }
+        return *value;
+    }
+
+    const JsonValue& operator[](size_t index) const
+    {
+        if (type != Type::Array || index >= elements.size())
+        {
+            throw std::runtime_error("glTF index out of range.");
+        }
+        return elements[index];
+    }
+};
+
+// just enough JSON for the glTF header chunk
+class JsonParser
+{
+public:
+    explicit JsonParser(std::string_view text)
+        : m_text(text)
+    {
+    }
+
+    JsonValue parse()
+    {
+        JsonValue value = parseValue(0);
+        skipWhitespace();
+        if (m_pos != m_text.size())
+        {
+            fail();
+        }
+        return value;
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 128;
+
+    [[noreturn]] void fail() const
+    {
+        throw std::runtime_error("Invalid JSON in glTF at offset " + std::to_string(m_pos) + ".");
+    }
+
+    void skipWhitespace()
+    {
+        while (m_pos < m_text.size()
+            && (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' || m_text[m_pos] == '\n' || m_text[m_pos] == '\r'))
+        {
+            ++m_pos;
+        }
+    }
+
+    char peek()
+    {
+        skipWhitespace();
+        return m_pos < m_text.size() ? m_text[m_pos] : '\0';
+    }
+
+    void expect(char c)
+    {
+        if (peek() != c)
+        {
+            fail();
+        }
+        ++m_pos;
+    }
+
+    bool consume(std::string_view literal)
+    {
+        if (m_text.substr(m_pos, literal.size()) != literal)
+        {
+            return false;
+        }
+        m_pos += literal.size();
+        return true;
+    }
+
+    JsonValue parseValue(int depth)
+    {
+        if (depth > MAX_DEPTH)
+        {
+            fail();
+        }
+
+        JsonValue value;
+        char c = peek();
+        if (c == '{')
+        {
+            value.type = JsonValue::Type::Object;
+            ++m_pos;
+            if (peek() == '}')
+            {
+                ++m_pos;
+                return value;
+            }
+            while (true)
+            {
+                if (peek() != '"')
+                {
+                    fail();
+                }
+                value.keys.push_back(parseString());
+                expect(':');
+                value.elements.push_back(parseValue(depth + 1));
+                if (peek() != ',')
+                {
+                    break;
+                }
+                ++m_pos;
+            }
+            expect('}');
+        }
+        else if (c == '[')
+        {
+            value.type = JsonValue::Type::Array;
+            ++m_pos;
+            if (peek() == ']')
+            {
+                ++m_pos;
+                return value;
+            }
+            while (true)
+            {
+                value.elements.push_back(parseValue(depth + 1));
+                if (peek() != ',')
+                {
+                    break;
+                }
+                ++m_pos;
+            }
+            expect(']');
+        }
+        else if (c == '"')
+        {
+            value.type = JsonValue::Type::String;
+            value.string = parseString();
+        }
+        else if (consume("true"))
+        {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+        }
+        else if (consume("false"))
+        {
+            value.type = JsonValue::Type::Bool;
+        }
+        else if (consume("null"))
+        {
+            value.type = JsonValue::Type::Null;
+        }
+        else
+        {
+            value.type = JsonValue::Type::Number;
+            const char* begin = m_text.data() + m_pos;
+            auto [ptr, ec] = std::from_chars(begin, m_text.data() + m_text.size(), value.number);
+            if (ec != std::errc())
+            {
+                fail();
+            }
+            m_pos += ptr - begin;
+        }
+        return value;
+    }
+
+    std::string parseString()
+    {
+        // caller has checked the opening quote
+        ++m_pos;
+        std::string result;
+        while (m_pos < m_text.size() && m_text[m_pos] != '"')
+        {
+            char c = m_text[m_pos++];
+            if (c != '\\')
+            {
+                result += c;
+                continue;
+            }
+            if (m_pos >= m_text.size())
+            {
+                fail();
+            }
+
+            char escape = m_text[m_pos++];
+            switch (escape)
+            {
+            case 'b':
+                result += '\b';
+                break;
+            case 'f':
+                result += '\f';
+                break;
+            case 'n':
+                result += '\n';
+                break;
+            case 'r':
+                result += '\r';
+                break;
+            case 't':
+                result += '\t';
+                break;
+            case 'u':
+            {
+                uint32_t code = 0;
+                auto [ptr, ec] = std::from_chars(m_text.data() + m_pos, m_text.data() + std::min(m_pos + 4, m_text.size()), code, 16);
+                if (ec != std::errc() || ptr != m_text.data() + m_pos + 4)
+                {
+                    fail();
+                }
+                m_pos += 4;
+                // names only matter for lookups, so surrogate pairs are not recombined
+                if (code < 0x80)
+                {
+                    result += static_cast<char>(code);
+                }
+                else if (code < 0x800)
+                {
+                    result += static_cast<char>(0xC0 | (code >> 6));
+                    result += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                else
+                {
+                    result += static_cast<char>(0xE0 | (code >> 12));
+                    result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    result += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                result += escape;
+                break;
+            }
+        }
+        expect('"');
+        return result;
+    }
+
+    std::string_view m_text;
+    size_t m_pos = 0;
+};
+
+constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+constexpr uint32_t GLTF_FLOAT = 5126;
+constexpr uint32_t GLTF_UNSIGNED_BYTE = 5121;
+constexpr uint32_t GLTF_UNSIGNED_SHORT = 5123;
+constexpr uint32_t GLTF_UNSIGNED_INT = 5125;
+constexpr uint32_t GLTF_MODE_TRIANGLES = 4;
+
+uint32_t readUint32(const std::byte* p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+struct GltfAccessor
+{
+    const std::byte* data = nullptr;
+    uint32_t stride = 0;
+    uint32_t count = 0;
+};
+
+GltfAccessor gltfAccessor(
+    const JsonValue& gltf,
+    std::span<const std::byte> bin,
+    size_t accessorIndex,
+    std::string_view expectedType,
+    uint32_t elementSize
+)
+{
+    const JsonValue& accessor = gltf.at("accessors")[accessorIndex];
+    if (accessor.find("sparse"))
+    {
+        throw std::runtime_error("Sparse glTF accessors are not supported.");
+    }
+    if (accessor.at("type").string != expectedType)
+    {
+        throw std::runtime_error("Unexpected glTF accessor type " + accessor.at("type").string + ".");
+    }
+
+    const JsonValue& view = gltf.at("bufferViews")[static_cast<size_t>(accessor.at("bufferView").number)];
+    if (view.numberOr("buffer", 0) != 0)
+    {
+        throw std::runtime_error("Only the embedded glb buffer is supported.");
+    }
+
+    size_t viewOffset = static_cast<size_t>(view.numberOr("byteOffset", 0));
+    size_t viewLength = static_cast<size_t>(view.at("byteLength").number);
+    size_t accessorOffset = static_cast<size_t>(accessor.numberOr("byteOffset", 0));
+    GltfAccessor result = {
+        .stride = static_cast<uint32_t>(view.numberOr("byteStride", elementSize)),
+        .count = static_cast<uint32_t>(accessor.at("count").number)
+    };
+
+    size_t lastByte = result.count == 0
+        ? accessorOffset
+        : accessorOffset + static_cast<size_t>(result.count - 1) * result.stride + elementSize;
+    if (viewOffset + viewLength > bin.size() || lastByte > viewLength || result.stride < elementSize)
+    {
+        throw std::runtime_error("glTF accessor is out of bounds of its buffer.");
+    }
+    result.data = bin.data() + viewOffset + accessorOffset;
+    return result;
+}
+
+struct GltfDraw
+{
+    GltfAccessor positions;
+    GltfAccessor indices; // data == nullptr means non-indexed
+    uint32_t indexSize = 0;
+    float transform[3][4];
+    // negative determinant: the node mirrors the mesh, which turns the winding around
+    bool mirrored = false;
+
+    uint32_t vertexOffset = 0;
+    size_t indexOffset = 0;
+
+    size_t indexCount() const
+    {
+        return indices.data ? indices.count : positions.count;
+    }
+};
+
+void identity(float m[3][4])
+{
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            m[row][col] = row == col ? 1.0f : 0.0f;
+        }
+    }
+}
+
+void multiply(const float a[3][4], const float b[3][4], float out[3][4])
+{
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            out[row][col] = a[row][0] * b[0][col] + a[row][1] * b[1][col] + a[row][2] * b[2][col]
+                + (col == 3 ? a[row][3] : 0.0f);
+        }
+    }
+}
+
+float determinant3x3(const float m[3][4])
+{
+    return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+        - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+        + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+void nodeTransform(const JsonValue& node, float m[3][4])
+{
+    if (const JsonValue* matrix = node.find("matrix"))
+    {
+        // column-major 4x4
+        for (int row = 0; row < 3; ++row)
+        {
+            for (int col = 0; col < 4; ++col)
+            {
+                m[row][col] = static_cast<float>((*matrix)[col * 4 + row].number);
+            }
+        }
+        return;
+    }
+
+    float t[3] = {0.0f, 0.0f, 0.0f};
+    float r[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    float s[3] = {1.0f, 1.0f, 1.0f};
+    if (const JsonValue* translation = node.find("translation"))
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            t[i] = static_cast<float>((*translation)[i].number);
+        }
+    }
+    if (const JsonValue* rotation = node.find("rotation"))
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            r[i] = static_cast<float>((*rotation)[i].number);
+        }
+    }
+    if (const JsonValue* scale = node.find("scale"))
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            s[i] = static_cast<float>((*scale)[i].number);
+        }
+    }
+
+    // T * R * S, r is the quaternion (x, y, z, w)
+    float x = r[0], y = r[1], z = r[2], w = r[3];
+    float rotationMatrix[3][3] = {
+        {1 - 2 * (y * y + z * z), 2 * (x * y - z * w), 2 * (x * z + y * w)},
+        {2 * (x * y + z * w), 1 - 2 * (x * x + z * z), 2 * (y * z - x * w)},
+        {2 * (x * z - y * w), 2 * (y * z + x * w), 1 - 2 * (x * x + y * y)}
+    };
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 3; ++col)
+        {
+            m[row][col] = rotationMatrix[row][col] * s[col];
+        }
+        m[row][3] = t[row];
+    }
+}
+
+void collectMeshDraws(
+    const JsonValue& gltf,
+    std::span<const std::byte> bin,
+    size_t meshIndex,
+    const float transform[3][4],
+    std::vector<GltfDraw>& draws
+)
+{
+    const JsonValue& primitives = gltf.at("meshes")[meshIndex].at("primitives");
+    for (const JsonValue& primitive : primitives.elements)
+    {
+        if (primitive.numberOr("mode", GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES)
+        {
+            std::cerr << "Skipping non-triangle glTF primitive." << std::endl;
+            continue;
+        }
+
+        const JsonValue& positionAccessor = gltf.at("accessors")[static_cast<size_t>(primitive.at("attributes").at("POSITION").number)];
+        if (positionAccessor.at("componentType").number != GLTF_FLOAT)
+        {
+            throw std::runtime_error("glTF positions must be floats.");
+        }
+
+        GltfDraw draw = {};
+        draw.positions = gltfAccessor(gltf, bin, static_cast<size_t>(primitive.at("attributes").at("POSITION").number), "VEC3", sizeof(Float3));
+        if (const JsonValue* indices = primitive.find("indices"))
+        {
+            size_t indexAccessor = static_cast<size_t>(indices->number);
+            switch (static_cast<uint32_t>(gltf.at("accessors")[indexAccessor].at("componentType").number))
+            {
+            case GLTF_UNSIGNED_BYTE:
+                draw.indexSize = 1;
+                break;
+            case GLTF_UNSIGNED_SHORT:
+                draw.indexSize = 2;
+                break;
+            case GLTF_UNSIGNED_INT:
+                draw.indexSize = 4;
+                break;
+            default:
+                throw std::runtime_error("Unsupported glTF index type.");
+            }
+            draw.indices = gltfAccessor(gltf, bin, indexAccessor, "SCALAR", draw.indexSize);
+        }
+        std::memcpy(draw.transform, transform, sizeof(draw.transform));
+        draw.mirrored = determinant3x3(transform) < 0.0f;
+        draws.push_back(draw);
+    }
+}
+
+void collectNodeDraws(
+    const JsonValue& gltf,
+    std::span<const std::byte> bin,
+    size_t nodeIndex,
+    const float parent[3][4],
+    int depth,
+    std::vector<GltfDraw>& draws
+)
+{
+    // the node graph is a forest, the limit only stops malformed files with cycles
+    if (depth > 64)
+    {
+        throw std::runtime_error("glTF node hierarchy is too deep.");
+    }
+
+    const JsonValue& node = gltf.at("nodes")[nodeIndex];
+    float local[3][4];
+    float world[3][4];
+    nodeTransform(node, local);
+    multiply(parent, local, world);
+
+    if (const JsonValue* mesh = node.find("mesh"))
+    {
+        collectMeshDraws(gltf, bin, static_cast<size_t>(mesh->number), world, draws);
+    }
+    if (const JsonValue* children = node.find("children"))
+    {
+        for (const JsonValue& child : children->elements)
+        {
+            collectNodeDraws(gltf, bin, static_cast<size_t>(child.number), world, depth + 1, draws);
+        }
+    }
+}
+
+Mesh loadGlb(const MappedFile& file, uint32_t threadCount)
+{
+    const std::byte* data = file.data();
+    if (file.size() < 20 || readUint32(data) != GLB_MAGIC || readUint32(data + 4) != 2)
+    {
+        throw std::runtime_error("Not a glTF 2.0 binary file.");
+    }
+
+    size_t length = std::min<size_t>(readUint32(data + 8), file.size());
+    std::string_view json;
+    std::span<const std::byte> bin;
+    for (size_t offset = 12; offset + 8 <= length;)
+    {
+        size_t chunkLength = readUint32(data + offset);
+        uint32_t chunkType = readUint32(data + offset + 4);
+        offset += 8;
+        if (chunkLength > length - offset)
+        {
+            throw std::runtime_error("Truncated glb chunk.");
+        }
+        if (chunkType == GLB_CHUNK_JSON && json.empty())
+        {
+            json = {reinterpret_cast<const char*>(data + offset), chunkLength};
+        }
+        else if (chunkType == GLB_CHUNK_BIN && bin.empty())
+        {
+            bin = {data + offset, chunkLength};
+        }
+        // chunks are 4-byte aligned
+        offset += (chunkLength + 3) & ~size_t(3);
+    }
+
+    JsonValue gltf = JsonParser(json).parse();
+
+    std::vector<GltfDraw> draws;
+    float root[3][4];
+    identity(root);
+    if (const JsonValue* nodes = gltf.find("nodes"))
+    {
+        const JsonValue* scenes = gltf.find("scenes");
+        if (scenes && !scenes->elements.empty())
+        {
+            const JsonValue& scene = (*scenes)[static_cast<size_t>(gltf.numberOr("scene", 0))];
+            if (const JsonValue* sceneNodes = scene.find("nodes"))
+            {
+                for (const JsonValue& node : sceneNodes->elements)
+                {
+                    collectNodeDraws(gltf, bin, static_cast<size_t>(node.number), root, 0, draws);
+                }
+            }
+        }
+        else
+        {
+            // no scene: every node that is nobody's child is a root
+            std::vector<bool> isChild(nodes->elements.size());
+            for (const JsonValue& node : nodes->elements)
+            {
+                if (const JsonValue* children = node.find("children"))
+                {
+                    for (const JsonValue& child : children->elements)
+                    {
+                        isChild.at(static_cast<size_t>(child.number)) = true;
+                    }
+                }
+            }
+            for (size_t i = 0; i < isChild.size(); ++i)
+            {
+                if (!isChild[i])
+                {
+                    collectNodeDraws(gltf, bin, i, root, 0, draws);
+                }
+            }
+        }
+    }
+    else if (const JsonValue* meshes = gltf.find("meshes"))
+    {
+        for (size_t i = 0; i < meshes->elements.size(); ++i)
+        {
+            collectMeshDraws(gltf, bin, i, root, draws);
+        }
+    }
+
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    for (auto& draw : draws)
+    {
+        draw.vertexOffset = static_cast<uint32_t>(vertexCount);
+        draw.indexOffset = indexCount;
+        vertexCount += draw.positions.count;
+        indexCount += draw.indexCount() / 3 * 3;
+        if (vertexCount > UINT32_MAX)
+        {
+            throw std::runtime_error("glTF file has too many vertices.");
+        }
+    }
+
+    Mesh mesh;
+    mesh.vertices.resize(vertexCount);
+    mesh.indices.resize(indexCount);
+
+    // split big primitives so a single huge mesh still spreads over all threads
+    constexpr uint32_t BATCH_SIZE = 1 << 16;
+    struct Batch
+    {
+        uint32_t draw;
+        bool indices;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<Batch> batches;
+    for (uint32_t i = 0; i < draws.size(); ++i)
+    {
+        for (size_t begin = 0; begin < draws[i].positions.count; begin += BATCH_SIZE)
+        {
+            batches.push_back({i, false, begin, std::min<size_t>(begin + BATCH_SIZE, draws[i].positions.count)});
+        }
+        size_t triangles = draws[i].indexCount() / 3;
+        for (size_t begin = 0; begin < triangles; begin += BATCH_SIZE)
+        {
+            batches.push_back({i, true, begin, std::min<size_t>(begin + BATCH_SIZE, triangles)});
+        }
+    }
+
+    parallelFor(static_cast<uint32_t>(batches.size()), threadCount, [&](uint32_t b) {
+        const Batch& batch = batches[b];
+        const GltfDraw& draw = draws[batch.draw];
+
+        if (!batch.indices)
+        {
+            for (size_t i = batch.begin; i < batch.end; ++i)
+            {
+                Float3 p;
+                std::memcpy(&p, draw.positions.data + i * draw.positions.stride, sizeof(p));
+                const auto& m = draw.transform;
+                mesh.vertices[draw.vertexOffset + i] = toLeftHanded({
+                    m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+                    m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+                    m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]
+                });
+            }
+            return;
+        }
+
+        auto index = [&](size_t i) -> uint32_t {
+            if (!draw.indices.data)
+            {
+                return draw.vertexOffset + static_cast<uint32_t>(i);
+            }
+            const std::byte* p = draw.indices.data + i * draw.indices.stride;
+            uint32_t value = 0;
+            switch (draw.indexSize)
+            {
+            case 1:
+                value = static_cast<uint8_t>(*p);
+                break;
+            case 2:
+            {
+                uint16_t value16;
+                std::memcpy(&value16, p, sizeof(value16));
+                value = value16;
+                break;
+            }
+            default:
+                std::memcpy(&value, p, sizeof(value));
+                break;
+            }
+            if (value >= draw.positions.count)
+            {
+                throw std::runtime_error("glTF index out of range.");
+            }
+            return draw.vertexOffset + value;
+        };
+
+        for (size_t triangle = batch.begin; triangle < batch.end; ++triangle)
+        {
+            // winding flipped along with the handedness, and once more for a mirroring node as glTF requires
+            uint32_t* out = &mesh.indices[draw.indexOffset + triangle * 3];
+            out[0] = index(triangle * 3);
+            out[1] = index(triangle * 3 + (draw.mirrored ? 1 : 2));
+            out[2] = index(triangle * 3 + (draw.mirrored ? 2 : 1));
+        }
+    });
+
+    return mesh;
+}
+}
+
+CpuAabb Mesh::bounds() const
+{
+    CpuAabb result;
+    for (const Float3& vertex : vertices)
+    {
+        result.grow(vertex);
+    }
+    return result;
+}
+
+void Mesh::fitTransform(float transform[3][4]) const
+{
+    CpuAabb box = bounds();
+    float extent = 0.0f;
+    Float3 center = {0.0f, 0.0f, 0.0f};
+    if (box.valid())
+    {
+        Float3 size = box.max - box.min;
+        extent = std::max({size.x, size.y, size.z});
+        center = box.centroid();
+    }
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 3; ++col)
+        {
+            transform[row][col] = row == col ? scale : 0.0f;
+        }
+        transform[row][3] = -center[row] * scale;
+    }
+}
+
+Mesh Mesh::triangle()
+{
+    return {
+        .vertices = {
+            {0.0f, 0.5f, 0.0f},
+            {0.5f, -0.5f, 0.0f},
+            {-0.5f, -0.5f, 0.0f}
+        },
+        .indices = {0, 1, 2}
+    };
+}
+
+MeshLoader::MeshLoader(const MeshLoaderOptions& options)
+    : m_threadCount(options.threadCount)
+{
+    if (m_threadCount == 0)
+    {
+        m_threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+Mesh MeshLoader::load(const std::filesystem::path& path)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::string extension = path.extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    // both parsers walk the file front to back
+    MappedFile file(path, true);
+    Mesh mesh;
+    if (extension == ".obj")
+    {
+        mesh = loadObj(file, m_threadCount);
+    }
+    else if (extension == ".glb")
+    {
+        mesh = loadGlb(file, m_threadCount);
+    }
+    else
+    {
+        throw std::runtime_error("Unsupported mesh format: " + path.string());
+    }
+
+    m_stats = {
+        .loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+        .fileSize = file.size(),
+        .vertexCount = static_cast<uint32_t>(mesh.vertices.size()),
+        .triangleCount = mesh.triangleCount()
+    };
+    return mesh;
+}
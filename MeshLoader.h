@@ -0,0 +1,67 @@
+#ifndef MESHLOADER_H
+#define MESHLOADER_H
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "CpuBvh.h"
+#include "CpuBvhBuilder.h"
+#include "CpuMath.h"
+
+// indexed triangle list in the left-handed space the RayGen camera looks into
+struct Mesh
+{
+    std::vector<Float3> vertices;
+    std::vector<uint32_t> indices;
+    // FastBuild for meshes that are rebuilt often, e.g. deforming ones past what refitting handles
+    CpuBvhBuildPreference buildPreference = CpuBvhBuildPreference::FastTrace;
+
+    uint32_t triangleCount() const
+    {
+        return static_cast<uint32_t>(indices.size() / 3);
+    }
+
+    CpuAabb bounds() const;
+
+    // row-major 3x4 instance transform that scales and centers the mesh into the [-0.5, 0.5] box the camera frames
+    void fitTransform(float transform[3][4]) const;
+
+    // the triangle the samples have always drawn
+    static Mesh triangle();
+};
+
+struct MeshLoaderOptions
+{
+    uint32_t threadCount = 0; // 0 = hardware concurrency
+};
+
+struct MeshLoadStats
+{
+    double loadTimeMs = 0.0;
+    size_t fileSize = 0;
+    uint32_t vertexCount = 0;
+    uint32_t triangleCount = 0;
+};
+
+// loads Wavefront OBJ (positions and faces, polygons are fanned) and binary glTF 2.0 (.glb with the
+// embedded BIN buffer, node transforms applied).
+// the file is memory-mapped and parsed in parallel chunks straight into the output arrays
+class MeshLoader
+{
+public:
+    explicit MeshLoader(const MeshLoaderOptions& options = {});
+
+    Mesh load(const std::filesystem::path& path);
+
+    const MeshLoadStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    uint32_t m_threadCount;
+    MeshLoadStats m_stats;
+};
+
+#endif //MESHLOADER_H
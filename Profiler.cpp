@@ -0,0 +1,140 @@
+#include "Profiler.h"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+// names are string literals from the code, only quotes and backslashes need escaping
+void writeJsonString(std::ofstream& stream, const char* text)
+{
+    stream << '"';
+    for (const char* c = text; *c != '\0'; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            stream << '\\';
+        }
+        stream << *c;
+    }
+    stream << '"';
+}
+}
+
+Profiler::Profiler()
+    : m_origin(std::chrono::steady_clock::now())
+{
+    static std::atomic<uint64_t> nextId = 0;
+    m_id = nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+uint32_t Profiler::threadTrack()
+{
+    // one entry per profiler the thread recorded into, so switching between profilers finds the track again.
+    // tracks are never removed, so a cached index stays valid for the thread's lifetime
+    struct CachedTrack
+    {
+        uint64_t profilerId;
+        uint32_t track;
+    };
+    thread_local std::vector<CachedTrack> cached;
+    for (const CachedTrack& entry : cached)
+    {
+        if (entry.profilerId == m_id)
+        {
+            return entry.track;
+        }
+    }
+
+    std::lock_guard lock(m_mutex);
+    uint32_t track = static_cast<uint32_t>(m_trackNames.size());
+    m_trackNames.push_back("thread " + std::to_string(m_threadCount++));
+    cached.push_back({m_id, track});
+    return track;
+}
+
+uint32_t Profiler::addTrack(std::string name)
+{
+    std::lock_guard lock(m_mutex);
+    m_trackNames.push_back(std::move(name));
+    return static_cast<uint32_t>(m_trackNames.size() - 1);
+}
+
+void Profiler::record(const char* name, uint64_t startNs, uint64_t endNs, uint32_t track)
+{
+    if (!enabled())
+    {
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_events.push_back({name, startNs, endNs > startNs ? endNs - startNs : 0, track});
+}
+
+void Profiler::clear()
+{
+    std::lock_guard lock(m_mutex);
+    m_events.clear();
+}
+
+std::vector<ProfileEvent> Profiler::events() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_events;
+}
+
+ProfilerStats Profiler::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    return {
+        .eventCount = m_events.size(),
+        .trackCount = static_cast<uint32_t>(m_trackNames.size())
+    };
+}
+
+void Profiler::writeChromeTrace(const std::filesystem::path& path) const
+{
+    std::ofstream stream(path, std::ios::trunc);
+    if (!stream)
+    {
+        throw std::runtime_error("Failed to open trace file for writing: " + path.string());
+    }
+
+    std::lock_guard lock(m_mutex);
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (uint32_t track = 0; track < m_trackNames.size(); ++track)
+    {
+        stream << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track
+            << ",\"args\":{\"name\":";
+        writeJsonString(stream, m_trackNames[track].c_str());
+        stream << "}}";
+        first = false;
+    }
+
+    // microseconds with nanosecond precision, chrome://tracing accepts fractional timestamps
+    stream.setf(std::ios::fixed);
+    stream.precision(3);
+    for (const ProfileEvent& event : m_events)
+    {
+        stream << (first ? "" : ",") << "\n{\"name\":";
+        writeJsonString(stream, event.name);
+        stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.track
+            << ",\"ts\":" << static_cast<double>(event.startNs) / 1000.0
+            << ",\"dur\":" << static_cast<double>(event.durationNs) / 1000.0 << "}";
+        first = false;
+    }
+    stream << "\n]}\n";
+
+    stream.close();
+    if (!stream)
+    {
+        throw std::runtime_error("Failed to write trace file.");
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ProfileEvent
+{
+    // string literal, events store the pointer only
+    const char* name;
+    // nanoseconds since the profiler was created
+    uint64_t startNs;
+    uint64_t durationNs;
+    uint32_t track;
+};
+
+struct ProfilerStats
+{
+    uint64_t eventCount = 0;
+    uint32_t trackCount = 0;
+};
+
+// timeline of CPU scopes and resolved GPU timestamps, exported as Chrome trace JSON (chrome://tracing,
+// Perfetto). every CPU thread records into a track of its own, GPU queues add theirs with addTrack.
+// disabled by default, a disabled profiler records nothing and a ProfileScope costs one relaxed load
+class Profiler
+{
+public:
+    Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // the profiler the engines record into
+    static Profiler& instance();
+
+    void setEnabled(bool enabled)
+    {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool enabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    // nanoseconds since the profiler was created, the timeline every event is placed on
+    uint64_t now() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_origin
+        ).count());
+    }
+
+    // track of the calling thread, named "thread N" in the order threads first record
+    uint32_t threadTrack();
+    // a track for a timeline that is not a CPU thread, e.g. a GPU queue
+    uint32_t addTrack(std::string name);
+
+    // ignored while disabled
+    void record(const char* name, uint64_t startNs, uint64_t endNs, uint32_t track);
+
+    void clear();
+    std::vector<ProfileEvent> events() const;
+    ProfilerStats stats() const;
+
+    // complete ("X") events plus thread_name metadata, timestamps in microseconds
+    void writeChromeTrace(const std::filesystem::path& path) const;
+
+private:
+    std::atomic<bool> m_enabled = false;
+    std::chrono::steady_clock::time_point m_origin;
+    // keys the per-thread track cache, unlike the address it is never reused by a later profiler
+    uint64_t m_id = 0;
+
+    mutable std::mutex m_mutex;
+    std::vector<ProfileEvent> m_events;
+    std::vector<std::string> m_trackNames;
+    uint32_t m_threadCount = 0;
+};
+
+// records the lifetime of the scope as one event on the calling thread's track
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name, Profiler& profiler = Profiler::instance())
+        : m_profiler(profiler.enabled() ? &profiler : nullptr)
+        , m_name(name)
+        , m_startNs(m_profiler ? profiler.now() : 0)
+    {
+    }
+
+    ~ProfileScope()
+    {
+        if (m_profiler)
+        {
+            m_profiler->record(m_name, m_startNs, m_profiler->now(), m_profiler->threadTrack());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler* m_profiler;
+    const char* m_name;
+    uint64_t m_startNs;
+};
+
+#endif //PROFILER_H
@@ -0,0 +1,192 @@
+#include "QueueDependencyTracker.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+QueueDependencyTracker::QueueDependencyTracker()
+{
+    addQueue("cpu");
+}
+
+uint32_t QueueDependencyTracker::addQueue(std::string name)
+{
+    m_queues.push_back({.name = std::move(name)});
+    for (Queue& queue : m_queues)
+    {
+        queue.clock.resize(m_queues.size(), 0);
+    }
+    for (Resource& resource : m_resources)
+    {
+        resource.reads.resize(m_queues.size());
+    }
+    return static_cast<uint32_t>(m_queues.size() - 1);
+}
+
+uint32_t QueueDependencyTracker::addResource(std::string name)
+{
+    m_resources.push_back({
+        .name = std::move(name),
+        .lastWrite = std::nullopt,
+        .reads = std::vector<std::optional<uint64_t>>(m_queues.size())
+    });
+    return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+void QueueDependencyTracker::read(uint32_t queue, uint32_t resource)
+{
+    catchUp(queue);
+    Resource& target = resourceAt(resource);
+    if (target.lastWrite && !isOrdered(queue, *target.lastWrite))
+    {
+        hazard(queue, "reads", target, target.lastWrite->queue);
+    }
+    target.reads[queue] = m_queues[queue].signalCount;
+    m_stats.accessCount++;
+}
+
+void QueueDependencyTracker::write(uint32_t queue, uint32_t resource)
+{
+    catchUp(queue);
+    Resource& target = resourceAt(resource);
+    if (target.lastWrite && !isOrdered(queue, *target.lastWrite))
+    {
+        hazard(queue, "writes", target, target.lastWrite->queue);
+    }
+    for (uint32_t reader = 0; reader < target.reads.size(); ++reader)
+    {
+        if (target.reads[reader] && !isOrdered(queue, {reader, *target.reads[reader]}))
+        {
+            hazard(queue, "writes", target, reader);
+        }
+    }
+
+    target.lastWrite = Access{queue, m_queues[queue].signalCount};
+    std::fill(target.reads.begin(), target.reads.end(), std::nullopt);
+    m_stats.accessCount++;
+}
+
+void QueueDependencyTracker::signal(uint32_t queue, uint64_t value)
+{
+    if (queue == CPU_QUEUE)
+    {
+        throw std::invalid_argument("The CPU has no fence to signal.");
+    }
+    catchUp(queue);
+    Queue& signaler = queueAt(queue);
+    if (value <= signaler.lastValue)
+    {
+        throw std::logic_error("Timeline fence values must increase.");
+    }
+
+    signaler.signalCount++;
+    signaler.lastValue = value;
+    signaler.clock[queue] = signaler.signalCount;
+    signaler.signals.push_back({value, signaler.clock});
+    m_stats.signalCount++;
+}
+
+void QueueDependencyTracker::gpuWait(uint32_t queue, uint32_t signalQueue, uint64_t value)
+{
+    catchUp(queue);
+    merge(queue, signalQueue, value);
+    m_stats.waitCount++;
+}
+
+void QueueDependencyTracker::cpuWait(uint32_t signalQueue, uint64_t value)
+{
+    merge(CPU_QUEUE, signalQueue, value);
+    m_stats.waitCount++;
+}
+
+void QueueDependencyTracker::catchUp(uint32_t queue)
+{
+    std::vector<uint64_t>& clock = queueAt(queue).clock;
+    const std::vector<uint64_t>& cpuClock = m_queues[CPU_QUEUE].clock;
+    for (size_t i = 0; i < clock.size(); ++i)
+    {
+        clock[i] = std::max(clock[i], cpuClock[i]);
+    }
+}
+
+bool QueueDependencyTracker::isOrdered(uint32_t queue, const Access& access) const
+{
+    // the CPU records before it submits, and one queue runs its work in order
+    if (access.queue == CPU_QUEUE || access.queue == queue)
+    {
+        return true;
+    }
+    // the access was recorded before signal number access.index
+    return m_queues[queue].clock[access.queue] > access.index;
+}
+
+void QueueDependencyTracker::merge(uint32_t queue, uint32_t signalQueue, uint64_t value)
+{
+    Queue& signaler = queueAt(signalQueue);
+    if (value > signaler.lastValue)
+    {
+        // the tracker only knows what a signal orders after once it was recorded
+        throw std::logic_error("Waiting for a fence value that was never signaled.");
+    }
+
+    // pruned signals are already part of every other queue's clock
+    std::vector<uint64_t>& clock = queueAt(queue).clock;
+    for (auto it = signaler.signals.rbegin(); it != signaler.signals.rend(); ++it)
+    {
+        if (it->value <= value)
+        {
+            for (size_t i = 0; i < it->clock.size(); ++i)
+            {
+                clock[i] = std::max(clock[i], it->clock[i]);
+            }
+            break;
+        }
+    }
+    prune();
+}
+
+void QueueDependencyTracker::prune()
+{
+    for (uint32_t signalQueue = 0; signalQueue < m_queues.size(); ++signalQueue)
+    {
+        uint64_t known = UINT64_MAX;
+        for (uint32_t queue = 0; queue < m_queues.size(); ++queue)
+        {
+            if (queue != signalQueue)
+            {
+                known = std::min(known, m_queues[queue].clock[signalQueue]);
+            }
+        }
+
+        Queue& signaler = m_queues[signalQueue];
+        while (!signaler.signals.empty() && signaler.firstSignal < known)
+        {
+            signaler.signals.pop_front();
+            signaler.firstSignal++;
+        }
+    }
+}
+
+QueueDependencyTracker::Queue& QueueDependencyTracker::queueAt(uint32_t queue)
+{
+    if (queue >= m_queues.size())
+    {
+        throw std::out_of_range("Unknown queue.");
+    }
+    return m_queues[queue];
+}
+
+QueueDependencyTracker::Resource& QueueDependencyTracker::resourceAt(uint32_t resource)
+{
+    if (resource >= m_resources.size())
+    {
+        throw std::out_of_range("Unknown resource.");
+    }
+    return m_resources[resource];
+}
+
+void QueueDependencyTracker::hazard(uint32_t queue, const char* access, const Resource& resource, uint32_t otherQueue) const
+{
+    throw std::logic_error(
+        m_queues[queue].name + " " + access + " " + resource.name + " without waiting for " + m_queues[otherQueue].name + "."
+    );
+}
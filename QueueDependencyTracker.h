@@ -0,0 +1,102 @@
+#ifndef QUEUEDEPENDENCYTRACKER_H
+#define QUEUEDEPENDENCYTRACKER_H
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct QueueDependencyTrackerStats
+{
+    uint64_t accessCount = 0;
+    uint64_t waitCount = 0;
+    uint64_t signalCount = 0;
+};
+
+// proves on the CPU that work on several GPU queues is ordered: every queue mirrors its resource accesses,
+// fence signals and cross-queue waits here, and an access that is not ordered after a conflicting access of
+// another queue throws std::logic_error. each queue keeps a vector clock of the signals it is known to run
+// after; a wait merges the clock of the signal it waits for, so orderings through a third queue count too.
+// work on one queue is in order, the barriers between it are the recorder's to get right
+class QueueDependencyTracker
+{
+public:
+    // the CPU: its accesses are ordered before every later submission, and it learns of GPU work through
+    // completed fence values
+    static constexpr uint32_t CPU_QUEUE = 0;
+
+    QueueDependencyTracker();
+
+    uint32_t addQueue(std::string name);
+    uint32_t addResource(std::string name);
+
+    void read(uint32_t queue, uint32_t resource);
+    void write(uint32_t queue, uint32_t resource);
+
+    // the work recorded on queue so far is followed by a signal of value, values increase per queue
+    void signal(uint32_t queue, uint64_t value);
+    // work recorded on queue from now on waits for signalQueue's fence to reach value, which was signaled already
+    void gpuWait(uint32_t queue, uint32_t signalQueue, uint64_t value);
+    // the CPU saw signalQueue's fence reach value, by waiting or polling the completed value. the GPU work
+    // submitted afterwards runs after it too
+    void cpuWait(uint32_t signalQueue, uint64_t value);
+
+    const QueueDependencyTrackerStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    struct Signal
+    {
+        uint64_t value;
+        // the signals of every queue known to have completed once this one has
+        std::vector<uint64_t> clock = {};
+    };
+
+    struct Queue
+    {
+        std::string name;
+        // per queue, how many of its signals this queue's next work runs after
+        std::vector<uint64_t> clock = {};
+        uint64_t signalCount = 0;
+        uint64_t lastValue = 0;
+        // signals other queues may still wait for, signals[0] is signal number firstSignal + 1,
+        // numbered from 1 like the clocks
+        std::deque<Signal> signals = {};
+        uint64_t firstSignal = 0;
+    };
+
+    // work of queue before its signal number index, or any CPU access
+    struct Access
+    {
+        uint32_t queue;
+        uint64_t index;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        std::optional<Access> lastWrite;
+        // per queue, the latest read since lastWrite
+        std::vector<std::optional<uint64_t>> reads;
+    };
+
+    // GPU work is submitted by the CPU, so it runs after everything the CPU saw complete
+    void catchUp(uint32_t queue);
+    bool isOrdered(uint32_t queue, const Access& access) const;
+    void merge(uint32_t queue, uint32_t signalQueue, uint64_t value);
+    // drops the signals every other queue already runs after, a wait for them changes nothing
+    void prune();
+    Queue& queueAt(uint32_t queue);
+    Resource& resourceAt(uint32_t resource);
+    [[noreturn]] void hazard(uint32_t queue, const char* access, const Resource& resource, uint32_t otherQueue) const;
+
+    std::vector<Queue> m_queues;
+    std::vector<Resource> m_resources;
+
+    QueueDependencyTrackerStats m_stats;
+};
+
+#endif //QUEUEDEPENDENCYTRACKER_H
@@ -0,0 +1,134 @@
+#include "RunLoop.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+// nearest rank
+double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999);
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+}
+
+RunLoop::RunLoop(Engine& engine, EventSource& events, const RunLoopOptions& options)
+    : m_engine(engine)
+    , m_events(events)
+    , m_options(options)
+{
+    m_options.statsWindow = std::max(1u, m_options.statsWindow);
+    m_samples.reserve(m_options.statsWindow);
+}
+
+void RunLoop::run()
+{
+    using Clock = std::chrono::steady_clock;
+
+    Clock::duration framePeriod = Clock::duration::zero();
+    if (m_options.targetFrameRate > 0.0)
+    {
+        framePeriod = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_options.targetFrameRate));
+    }
+
+    Clock::time_point nextFrame = Clock::now();
+    Clock::time_point previousStart = {};
+    Clock::time_point nextPrint = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(m_options.printIntervalSeconds)
+    );
+    uint64_t firstFrame = m_frameCount;
+
+    while (!m_stopRequested.load(std::memory_order_relaxed))
+    {
+        if (m_options.maxFrames != 0 && m_frameCount - firstFrame >= m_options.maxFrames)
+        {
+            break;
+        }
+        if (!m_events.pumpEvents())
+        {
+            break;
+        }
+
+        if (framePeriod != Clock::duration::zero())
+        {
+            std::this_thread::sleep_until(nextFrame);
+            // a late frame starts the schedule over instead of rendering a burst to catch up
+            nextFrame = std::max(nextFrame + framePeriod, Clock::now());
+        }
+
+        Clock::time_point start = Clock::now();
+        m_engine.render();
+        Clock::time_point end = Clock::now();
+
+        // the first frame has no previous one, its interval is its own render time
+        double intervalMs = m_frameCount == firstFrame ? elapsedMs(start, end) : elapsedMs(previousStart, start);
+        addSample({elapsedMs(start, end), intervalMs});
+        previousStart = start;
+        ++m_frameCount;
+
+        if (m_options.printIntervalSeconds > 0.0 && end >= nextPrint)
+        {
+            printStats();
+            nextPrint = end + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(m_options.printIntervalSeconds)
+            );
+        }
+    }
+}
+
+FrameTimeStats RunLoop::stats() const
+{
+    FrameTimeStats stats;
+    if (m_samples.empty())
+    {
+        return stats;
+    }
+
+    std::vector<double> renderTimes;
+    renderTimes.reserve(m_samples.size());
+    double renderSumMs = 0.0;
+    double intervalSumMs = 0.0;
+    for (const FrameSample& sample : m_samples)
+    {
+        renderTimes.push_back(sample.renderMs);
+        renderSumMs += sample.renderMs;
+        intervalSumMs += sample.intervalMs;
+    }
+    std::sort(renderTimes.begin(), renderTimes.end());
+
+    stats.frameCount = static_cast<uint32_t>(m_samples.size());
+    stats.minMs = renderTimes.front();
+    stats.avgMs = renderSumMs / static_cast<double>(renderTimes.size());
+    stats.p50Ms = percentile(renderTimes, 50.0);
+    stats.p90Ms = percentile(renderTimes, 90.0);
+    stats.p99Ms = percentile(renderTimes, 99.0);
+    stats.maxMs = renderTimes.back();
+    stats.framesPerSecond = intervalSumMs > 0.0 ? static_cast<double>(m_samples.size()) * 1000.0 / intervalSumMs : 0.0;
+    return stats;
+}
+
+void RunLoop::addSample(const FrameSample& sample)
+{
+    if (m_samples.size() < m_options.statsWindow)
+    {
+        m_samples.push_back(sample);
+        return;
+    }
+    m_samples[m_nextSample] = sample;
+    m_nextSample = (m_nextSample + 1) % m_samples.size();
+}
+
+void RunLoop::printStats() const
+{
+    FrameTimeStats frameStats = stats();
+    std::cout << "Frame " << m_frameCount << ": " << frameStats.framesPerSecond << " fps, render ms min "
+        << frameStats.minMs << " / avg " << frameStats.avgMs << " / p99 " << frameStats.p99Ms
+        << " over " << frameStats.frameCount << " frames" << std::endl;
+}
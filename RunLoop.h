@@ -0,0 +1,101 @@
+#ifndef RUNLOOP_H
+#define RUNLOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "Engine.h"
+
+// where the run loop gets its OS events from, e.g. a window's message queue
+class EventSource
+{
+public:
+    virtual ~EventSource() = default;
+
+    // handles every pending event without blocking, returns false once the application should quit
+    virtual bool pumpEvents() = 0;
+};
+
+// no window and no events, for headless runs that end by frame count or requestStop
+class NullEventSource : public EventSource
+{
+public:
+    bool pumpEvents() override
+    {
+        return true;
+    }
+};
+
+struct RunLoopOptions
+{
+    double targetFrameRate = 0.0; // frames per second, 0 renders back-to-back
+    uint32_t maxFrames = 0; // 0 = until the event source quits
+    uint32_t statsWindow = 120; // the most recent frames the statistics cover
+    double printIntervalSeconds = 0.0; // prints the statistics this often, 0 = never
+};
+
+// statistics over the frames of the rolling window. the times are render() calls, the frame rate is
+// measured frame start to frame start, so it includes event handling and pacing
+struct FrameTimeStats
+{
+    uint32_t frameCount = 0;
+    double minMs = 0.0;
+    double avgMs = 0.0;
+    double p50Ms = 0.0;
+    double p90Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+    double framesPerSecond = 0.0;
+};
+
+// drives engine frames and drains the event source in between, instead of rendering only on WM_PAINT
+class RunLoop
+{
+public:
+    RunLoop(Engine& engine, EventSource& events, const RunLoopOptions& options = {});
+
+    RunLoop(const RunLoop&) = delete;
+    RunLoop& operator=(const RunLoop&) = delete;
+
+    // returns when the event source quits, maxFrames were rendered or requestStop was called
+    void run();
+
+    // safe from any thread, the loop stops before its next frame
+    void requestStop()
+    {
+        m_stopRequested.store(true, std::memory_order_relaxed);
+    }
+
+    // frames rendered by run() so far
+    uint64_t frameCount() const
+    {
+        return m_frameCount;
+    }
+
+    FrameTimeStats stats() const;
+
+private:
+    struct FrameSample
+    {
+        double renderMs;
+        double intervalMs; // since the previous frame started
+    };
+
+    void addSample(const FrameSample& sample);
+    void printStats() const;
+
+    Engine& m_engine;
+    EventSource& m_events;
+    RunLoopOptions m_options;
+
+    std::atomic<bool> m_stopRequested = false;
+    uint64_t m_frameCount = 0;
+
+    // ring buffer over the last statsWindow frames
+    std::vector<FrameSample> m_samples;
+    size_t m_nextSample = 0;
+};
+
+#endif //RUNLOOP_H
@@ -0,0 +1,235 @@
+#include "SceneFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + SCENE_FILE_ALIGNMENT - 1) & ~uint64_t(SCENE_FILE_ALIGNMENT - 1);
+}
+
+class SceneWriter
+{
+public:
+    explicit SceneWriter(const std::filesystem::path& path)
+        : m_stream(path, std::ios::binary | std::ios::trunc)
+    {
+        if (!m_stream)
+        {
+            throw std::runtime_error("Failed to open scene file for writing: " + path.string());
+        }
+    }
+
+    template <typename T>
+    void write(std::span<const T> data, uint64_t offset)
+    {
+        // sections are laid out in ascending order, the gap is zero padding
+        static constexpr char ZEROS[SCENE_FILE_ALIGNMENT] = {};
+        while (m_offset < offset)
+        {
+            uint64_t padding = std::min<uint64_t>(offset - m_offset, SCENE_FILE_ALIGNMENT);
+            m_stream.write(ZEROS, static_cast<std::streamsize>(padding));
+            m_offset += padding;
+        }
+        m_stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size_bytes()));
+        m_offset += data.size_bytes();
+    }
+
+    void close()
+    {
+        m_stream.close();
+        if (!m_stream)
+        {
+            throw std::runtime_error("Failed to write scene file.");
+        }
+    }
+
+private:
+    std::ofstream m_stream;
+    uint64_t m_offset = 0;
+};
+}
+
+void writeSceneFile(
+    const std::filesystem::path& path,
+    std::span<const Mesh> meshes,
+    std::span<const SceneInstance> instances,
+    const CpuBvhBuildOptions& options
+)
+{
+    for (const auto& instance : instances)
+    {
+        if (instance.meshIndex >= meshes.size())
+        {
+            throw std::runtime_error("Scene instance references a missing mesh.");
+        }
+    }
+
+    std::vector<CpuBlas> blases;
+    blases.reserve(meshes.size());
+    for (const auto& mesh : meshes)
+    {
+        CpuGeometryDesc geometryDesc = {
+            .indexFormat = CpuIndexFormat::Uint32,
+            .indexCount = static_cast<uint32_t>(mesh.indices.size()),
+            .vertexCount = static_cast<uint32_t>(mesh.vertices.size()),
+            .indexBuffer = mesh.indices.data(),
+            .vertexBuffer = mesh.vertices.data(),
+            .vertexStrideInBytes = sizeof(Float3)
+        };
+        CpuBvhBuildOptions meshOptions = options;
+        meshOptions.preference = mesh.buildPreference;
+        blases.emplace_back(std::span(&geometryDesc, 1), meshOptions);
+    }
+
+    SceneFileHeader header = {
+        .magic = SCENE_FILE_MAGIC,
+        .version = SCENE_FILE_VERSION,
+        .nodeSize = sizeof(CpuBvhNode),
+        .triangleSize = sizeof(CpuTriangle),
+        .fileSize = 0,
+        .meshCount = static_cast<uint32_t>(meshes.size()),
+        .instanceCount = static_cast<uint32_t>(instances.size()),
+        .meshOffset = alignOffset(sizeof(SceneFileHeader)),
+        .instanceOffset = 0
+    };
+    header.instanceOffset = alignOffset(header.meshOffset + sizeof(SceneFileMesh) * meshes.size());
+
+    std::vector<SceneFileMesh> meshRecords(meshes.size());
+    uint64_t offset = header.instanceOffset + sizeof(SceneInstance) * instances.size();
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        SceneFileMesh& record = meshRecords[i];
+        record.vertexCount = static_cast<uint32_t>(meshes[i].vertices.size());
+        record.indexCount = static_cast<uint32_t>(meshes[i].indices.size());
+        record.nodeCount = static_cast<uint32_t>(blases[i].nodes().size());
+        record.triangleCount = blases[i].triangleCount();
+
+        record.vertexOffset = alignOffset(offset);
+        record.indexOffset = alignOffset(record.vertexOffset + sizeof(Float3) * record.vertexCount);
+        record.nodeOffset = alignOffset(record.indexOffset + sizeof(uint32_t) * record.indexCount);
+        record.triangleOffset = alignOffset(record.nodeOffset + sizeof(CpuBvhNode) * record.nodeCount);
+        offset = record.triangleOffset + sizeof(CpuTriangle) * record.triangleCount;
+    }
+    header.fileSize = offset;
+
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        SceneWriter writer(tempPath);
+        writer.write(std::span<const SceneFileHeader>(&header, 1), 0);
+        writer.write(std::span<const SceneFileMesh>(meshRecords), header.meshOffset);
+        writer.write(instances, header.instanceOffset);
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            const SceneFileMesh& record = meshRecords[i];
+            writer.write(std::span<const Float3>(meshes[i].vertices), record.vertexOffset);
+            writer.write(std::span<const uint32_t>(meshes[i].indices), record.indexOffset);
+            writer.write(blases[i].nodes(), record.nodeOffset);
+            writer.write(blases[i].triangles(), record.triangleOffset);
+        }
+        writer.close();
+    }
+    std::filesystem::rename(tempPath, path);
+}
+
+SceneFile::SceneFile(const std::filesystem::path& path)
+    : m_file(path)
+{
+    if (m_file.size() < sizeof(SceneFileHeader))
+    {
+        throw std::runtime_error("Not a scene file: " + path.string());
+    }
+
+    m_header = reinterpret_cast<const SceneFileHeader*>(m_file.data());
+    if (m_header->magic != SCENE_FILE_MAGIC)
+    {
+        throw std::runtime_error("Not a scene file: " + path.string());
+    }
+    if (m_header->version != SCENE_FILE_VERSION)
+    {
+        throw std::runtime_error("Scene file " + path.string() + " has version " + std::to_string(m_header->version)
+            + ", expected " + std::to_string(SCENE_FILE_VERSION) + ". Rewrite it with dxr-headless --write-scene.");
+    }
+    if (m_header->nodeSize != sizeof(CpuBvhNode) || m_header->triangleSize != sizeof(CpuTriangle))
+    {
+        throw std::runtime_error("Scene file " + path.string() + " has " + std::to_string(m_header->nodeSize)
+            + " byte nodes and " + std::to_string(m_header->triangleSize) + " byte triangles, this build expects "
+            + std::to_string(sizeof(CpuBvhNode)) + " and " + std::to_string(sizeof(CpuTriangle))
+            + ". Rewrite it with dxr-headless --write-scene.");
+    }
+    if (m_header->fileSize != m_file.size())
+    {
+        throw std::runtime_error("Scene file is truncated: " + path.string());
+    }
+
+    m_meshes = section<SceneFileMesh>(m_header->meshOffset, m_header->meshCount);
+    m_instances = section<SceneInstance>(m_header->instanceOffset, m_header->instanceCount);
+
+    // only the section bounds are checked, node and triangle contents are trusted as written
+    m_blases.reserve(m_meshes.size());
+    for (const auto& mesh : m_meshes)
+    {
+        section<Float3>(mesh.vertexOffset, mesh.vertexCount);
+        section<uint32_t>(mesh.indexOffset, mesh.indexCount);
+        m_blases.emplace_back(
+            section<CpuBvhNode>(mesh.nodeOffset, mesh.nodeCount),
+            section<CpuTriangle>(mesh.triangleOffset, mesh.triangleCount)
+        );
+    }
+
+    for (const auto& instance : m_instances)
+    {
+        if (instance.meshIndex >= m_meshes.size())
+        {
+            throw std::runtime_error("Scene instance references a missing mesh: " + path.string());
+        }
+    }
+}
+
+std::span<const Float3> SceneFile::vertices(uint32_t meshIndex) const
+{
+    const SceneFileMesh& mesh = m_meshes[meshIndex];
+    return section<Float3>(mesh.vertexOffset, mesh.vertexCount);
+}
+
+std::span<const uint32_t> SceneFile::indices(uint32_t meshIndex) const
+{
+    const SceneFileMesh& mesh = m_meshes[meshIndex];
+    return section<uint32_t>(mesh.indexOffset, mesh.indexCount);
+}
+
+std::vector<CpuInstanceDesc> SceneFile::instanceDescs() const
+{
+    std::vector<CpuInstanceDesc> descs;
+    descs.reserve(m_instances.size());
+    for (const auto& instance : m_instances)
+    {
+        CpuInstanceDesc desc = {};
+        std::memcpy(desc.transform, instance.transform, sizeof(desc.transform));
+        desc.instanceID = instance.instanceID;
+        desc.instanceMask = instance.instanceMask;
+        desc.instanceContributionToHitGroupIndex = instance.instanceContributionToHitGroupIndex;
+        desc.flags = instance.flags;
+        desc.accelerationStructure = &m_blases[instance.meshIndex];
+        descs.push_back(desc);
+    }
+    return descs;
+}
+
+template <typename T>
+std::span<const T> SceneFile::section(uint64_t offset, uint64_t count) const
+{
+    if (offset % SCENE_FILE_ALIGNMENT != 0
+        || offset > m_file.size()
+        || count > (m_file.size() - offset) / sizeof(T))
+    {
+        throw std::runtime_error("Scene file section is out of bounds.");
+    }
+    return {reinterpret_cast<const T*>(m_file.data() + offset), static_cast<size_t>(count)};
+}
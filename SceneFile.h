@@ -0,0 +1,117 @@
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "CpuBlas.h"
+#include "CpuTlas.h"
+#include "MappedFile.h"
+#include "MeshLoader.h"
+
+constexpr uint32_t SCENE_FILE_MAGIC = 0x53525844; // "DXRS"
+constexpr uint32_t SCENE_FILE_VERSION = 1;
+constexpr uint32_t SCENE_FILE_ALIGNMENT = 64;
+
+// flat, pointer-free on-disk layout. offsets are bytes from the start of the file, aligned to
+// SCENE_FILE_ALIGNMENT so every section can be used in place from a mapping
+struct SceneFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    // element sizes at write time, a mismatch means the structs changed without a version bump
+    uint32_t nodeSize;
+    uint32_t triangleSize;
+    uint64_t fileSize;
+    uint32_t meshCount;
+    uint32_t instanceCount;
+    uint64_t meshOffset;
+    uint64_t instanceOffset;
+};
+
+struct SceneFileMesh
+{
+    // geometry for the D3D12 path
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    // prebuilt CpuBlas
+    uint64_t nodeOffset;
+    uint64_t triangleOffset;
+    uint32_t nodeCount;
+    uint32_t triangleCount;
+};
+
+// a CpuInstanceDesc with the BLAS pointer replaced by a mesh index
+struct SceneInstance
+{
+    float transform[3][4];
+    uint32_t instanceID = 0;
+    uint32_t instanceMask = 0xFF;
+    uint32_t instanceContributionToHitGroupIndex = 0;
+    uint32_t flags = CPU_INSTANCE_FLAG_NONE;
+    uint32_t meshIndex = 0;
+    uint32_t padding[3] = {};
+};
+static_assert(sizeof(SceneInstance) == 80);
+
+// builds a BLAS per mesh, with the builder the mesh prefers, and writes everything into one scene file.
+// the file is written next to path and renamed over it, so processes that still map the old file keep a valid view
+void writeSceneFile(
+    const std::filesystem::path& path,
+    std::span<const Mesh> meshes,
+    std::span<const SceneInstance> instances,
+    const CpuBvhBuildOptions& options = {}
+);
+
+// memory-mapped scene file. the BLASes trace straight out of the mapping, loading only checks the header
+// and section bounds, and read-only pages are shared through the page cache by every process mapping the file
+class SceneFile
+{
+public:
+    explicit SceneFile(const std::filesystem::path& path);
+
+    SceneFile(const SceneFile&) = delete;
+    SceneFile& operator=(const SceneFile&) = delete;
+
+    uint32_t meshCount() const
+    {
+        return m_header->meshCount;
+    }
+
+    std::span<const Float3> vertices(uint32_t meshIndex) const;
+    std::span<const uint32_t> indices(uint32_t meshIndex) const;
+
+    const CpuBlas& blas(uint32_t meshIndex) const
+    {
+        return m_blases.at(meshIndex);
+    }
+
+    std::span<const SceneInstance> instances() const
+    {
+        return m_instances;
+    }
+
+    // instances pointing at the mapped BLASes, ready for CpuTlas
+    std::vector<CpuInstanceDesc> instanceDescs() const;
+
+    size_t fileSize() const
+    {
+        return m_file.size();
+    }
+
+private:
+    template <typename T>
+    std::span<const T> section(uint64_t offset, uint64_t count) const;
+
+    MappedFile m_file;
+    const SceneFileHeader* m_header = nullptr;
+    std::span<const SceneFileMesh> m_meshes;
+    std::span<const SceneInstance> m_instances;
+    std::vector<CpuBlas> m_blases;
+};
+
+#endif //SCENEFILE_H
@@ -0,0 +1,56 @@
+#include "ScratchAllocator.h"
+
+#include <algorithm>
+
+namespace
+{
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+}
+
+void ScratchAllocator::begin(uint64_t capacity)
+{
+    m_stats.capacity = capacity;
+    m_head = 0;
+    m_demand = 0;
+}
+
+std::optional<ScratchRange> ScratchAllocator::allocate(uint64_t size)
+{
+    size = alignUp(std::max<uint64_t>(size, 1), SCRATCH_ALIGNMENT);
+    // counted even when it does not fit, so growing to the high-water mark makes the retry fit
+    m_stats.highWaterMark = std::max(m_stats.highWaterMark, m_demand + size);
+    if (size > m_stats.capacity)
+    {
+        return std::nullopt;
+    }
+    m_demand += size;
+
+    bool needsBarrier = false;
+    if (m_head + size > m_stats.capacity)
+    {
+        // everything before the barrier has finished, the whole buffer is free again
+        m_head = 0;
+        needsBarrier = true;
+        m_stats.barrierCount++;
+    }
+
+    ScratchRange range = {m_head, size, needsBarrier};
+    m_head += size;
+    m_stats.allocationCount++;
+    return range;
+}
+
+void ScratchAllocator::grow(uint64_t capacity)
+{
+    m_stats.capacity = capacity;
+    m_head = 0;
+}
+
+void ScratchAllocator::markBarrier()
+{
+    m_head = 0;
+    m_demand = 0;
+}
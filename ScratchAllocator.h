@@ -0,0 +1,56 @@
+#ifndef SCRATCHALLOCATOR_H
+#define SCRATCHALLOCATOR_H
+
+#include <cstdint>
+#include <optional>
+
+// D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, also required for scratch memory
+constexpr uint64_t SCRATCH_ALIGNMENT = 256;
+
+struct ScratchRange
+{
+    uint64_t offset;
+    uint64_t size;
+    // earlier builds may still use these bytes, a UAV barrier on the scratch buffer has to come first
+    bool needsBarrier;
+};
+
+struct ScratchAllocatorStats
+{
+    uint64_t capacity = 0;
+    // most scratch that builds between two barriers needed at once, the capacity that avoids wrapping
+    uint64_t highWaterMark = 0;
+    uint64_t allocationCount = 0;
+    // barriers caused by reusing a range inside one command list
+    uint64_t barrierCount = 0;
+};
+
+// hands out scratch ranges of one buffer to the AS builds of a command list. builds recorded without
+// a barrier in between may run concurrently, so ranges are bumped linearly and only wrap to the start,
+// with a barrier, once the buffer is used up. the buffer itself is owned by the caller
+class ScratchAllocator
+{
+public:
+    // starts a new command list, builds of earlier command lists on the queue have finished by then
+    void begin(uint64_t capacity);
+    // nullopt if size exceeds the capacity, the caller then grows the buffer to at least highWaterMark
+    std::optional<ScratchRange> allocate(uint64_t size);
+    // a new, empty buffer replaces the current one in the middle of a command list
+    void grow(uint64_t capacity);
+    // the caller recorded a barrier covering all earlier builds, e.g. a UAV barrier on every resource
+    void markBarrier();
+
+    const ScratchAllocatorStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    uint64_t m_head = 0;
+    // bytes allocated since the last barrier the caller recorded, ignoring wraps
+    uint64_t m_demand = 0;
+
+    ScratchAllocatorStats m_stats;
+};
+
+#endif //SCRATCHALLOCATOR_H
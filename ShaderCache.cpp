@@ -0,0 +1,312 @@
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+constexpr std::string_view MANIFEST_HEADER = "dxr-shader-cache 1";
+
+// FIPS 180-4 SHA-256, collisions would hand one process another shader's DXIL
+class Sha256
+{
+public:
+    void update(const void* data, size_t size)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        m_length += size;
+        while (size > 0)
+        {
+            size_t chunk = std::min(size, m_block.size() - m_blockSize);
+            std::memcpy(m_block.data() + m_blockSize, bytes, chunk);
+            m_blockSize += chunk;
+            bytes += chunk;
+            size -= chunk;
+            if (m_blockSize == m_block.size())
+            {
+                compress();
+                m_blockSize = 0;
+            }
+        }
+    }
+
+    // length-prefixed so concatenated fields cannot alias each other
+    void field(std::string_view value)
+    {
+        uint64_t size = value.size();
+        update(&size, sizeof(size));
+        update(value.data(), value.size());
+    }
+
+    std::string hex()
+    {
+        uint64_t bitLength = m_length * 8;
+        uint8_t padding = 0x80;
+        update(&padding, 1);
+        uint8_t zero = 0;
+        while (m_blockSize != 56)
+        {
+            update(&zero, 1);
+        }
+        for (int i = 7; i >= 0; --i)
+        {
+            uint8_t byte = static_cast<uint8_t>(bitLength >> (i * 8));
+            update(&byte, 1);
+        }
+
+        static constexpr char DIGITS[] = "0123456789abcdef";
+        std::string result;
+        for (uint32_t word : m_state)
+        {
+            for (int i = 28; i >= 0; i -= 4)
+            {
+                result += DIGITS[(word >> i) & 0xF];
+            }
+        }
+        return result;
+    }
+
+private:
+    static uint32_t rotr(uint32_t x, int n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    void compress()
+    {
+        static constexpr uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i)
+        {
+            w[i] = static_cast<uint32_t>(m_block[i * 4]) << 24
+                | static_cast<uint32_t>(m_block[i * 4 + 1]) << 16
+                | static_cast<uint32_t>(m_block[i * 4 + 2]) << 8
+                | static_cast<uint32_t>(m_block[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; ++i)
+        {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+        uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+        for (int i = 0; i < 64; ++i)
+        {
+            uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + ch + K[i] + w[i];
+            uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+        m_state[4] += e;
+        m_state[5] += f;
+        m_state[6] += g;
+        m_state[7] += h;
+    }
+
+    std::array<uint32_t, 8> m_state = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    std::array<uint8_t, 64> m_block = {};
+    size_t m_blockSize = 0;
+    uint64_t m_length = 0;
+};
+
+std::string primaryKey(const ShaderCacheInputs& inputs)
+{
+    Sha256 hash;
+    hash.field(inputs.compilerIdentity);
+    hash.field(inputs.source);
+    for (const std::wstring& argument : inputs.arguments)
+    {
+        hash.field({reinterpret_cast<const char*>(argument.data()), argument.size() * sizeof(wchar_t)});
+    }
+    return hash.hex();
+}
+
+std::optional<std::string> readFile(const std::filesystem::path& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+    {
+        return std::nullopt;
+    }
+    std::ostringstream contents;
+    contents << stream.rdbuf();
+    return std::move(contents).str();
+}
+
+// manifests store paths as UTF-8 on every platform
+std::string toUtf8(const std::filesystem::path& path)
+{
+    std::u8string utf8 = path.u8string();
+    return {reinterpret_cast<const char*>(utf8.data()), utf8.size()};
+}
+
+std::filesystem::path fromUtf8(std::string_view utf8)
+{
+    return std::u8string(reinterpret_cast<const char8_t*>(utf8.data()), utf8.size());
+}
+
+std::string hashContents(std::string_view contents)
+{
+    Sha256 hash;
+    hash.update(contents.data(), contents.size());
+    return hash.hex();
+}
+
+// the include list and the primary key together decide the DXIL key
+std::string objectKey(std::string_view primary, const std::vector<std::pair<std::string, std::string>>& includes)
+{
+    Sha256 hash;
+    hash.field(primary);
+    for (const auto& [path, contentHash] : includes)
+    {
+        hash.field(path);
+        hash.field(contentHash);
+    }
+    return hash.hex();
+}
+
+// readers only ever see complete files, even with many processes storing the same entry at once
+void writeAtomically(const std::filesystem::path& path, std::string_view contents)
+{
+    std::random_device random;
+    std::filesystem::path tempPath = path;
+    tempPath += "." + std::to_string(random()) + ".tmp";
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        stream.close();
+        if (!stream)
+        {
+            std::filesystem::remove(tempPath);
+            throw std::runtime_error("Failed to write " + tempPath.string());
+        }
+    }
+    std::filesystem::rename(tempPath, path);
+}
+}
+
+ShaderCache::ShaderCache(std::filesystem::path directory)
+    : m_directory(std::move(directory))
+{
+}
+
+std::optional<std::vector<std::byte>> ShaderCache::load(const ShaderCacheInputs& inputs) const
+{
+    std::string primary = primaryKey(inputs);
+    std::optional<std::string> manifest = readFile(m_directory / (primary + ".manifest"));
+    if (!manifest)
+    {
+        return std::nullopt;
+    }
+
+    std::istringstream lines(*manifest);
+    std::string line;
+    if (!std::getline(lines, line) || line != MANIFEST_HEADER)
+    {
+        return std::nullopt;
+    }
+
+    // "include <hash> <path>" per resolved include
+    std::vector<std::pair<std::string, std::string>> includes;
+    while (std::getline(lines, line))
+    {
+        constexpr std::string_view PREFIX = "include ";
+        if (!line.starts_with(PREFIX) || line.size() < PREFIX.size() + 65)
+        {
+            return std::nullopt;
+        }
+        std::string expectedHash = line.substr(PREFIX.size(), 64);
+        std::string path = line.substr(PREFIX.size() + 65);
+
+        std::optional<std::string> contents = readFile(fromUtf8(path));
+        if (!contents || hashContents(*contents) != expectedHash)
+        {
+            return std::nullopt;
+        }
+        includes.emplace_back(std::move(path), std::move(expectedHash));
+    }
+
+    std::optional<std::string> dxil = readFile(m_directory / (objectKey(primary, includes) + ".dxil"));
+    if (!dxil || dxil->empty())
+    {
+        return std::nullopt;
+    }
+
+    std::vector<std::byte> result(dxil->size());
+    std::memcpy(result.data(), dxil->data(), dxil->size());
+    return result;
+}
+
+void ShaderCache::store(
+    const ShaderCacheInputs& inputs,
+    std::span<const std::filesystem::path> includes,
+    std::span<const std::byte> dxil
+) const
+{
+    try
+    {
+        std::filesystem::create_directories(m_directory);
+
+        std::string primary = primaryKey(inputs);
+        std::string manifest = std::string(MANIFEST_HEADER) + "\n";
+        std::vector<std::pair<std::string, std::string>> includeHashes;
+        for (const auto& include : includes)
+        {
+            std::optional<std::string> contents = readFile(include);
+            if (!contents)
+            {
+                throw std::runtime_error("Failed to read include " + include.string());
+            }
+            std::string path = toUtf8(include);
+            includeHashes.emplace_back(path, hashContents(*contents));
+            manifest += "include " + includeHashes.back().second + " " + path + "\n";
+        }
+
+        // DXIL first, so a manifest never points at a missing object
+        writeAtomically(
+            m_directory / (objectKey(primary, includeHashes) + ".dxil"),
+            {reinterpret_cast<const char*>(dxil.data()), dxil.size()}
+        );
+        writeAtomically(m_directory / (primary + ".manifest"), manifest);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to store shader in cache: " << e.what() << std::endl;
+    }
+}
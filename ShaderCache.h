@@ -0,0 +1,50 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// everything known about a compile before the compiler runs
+struct ShaderCacheInputs
+{
+    std::string_view source;
+    std::span<const std::wstring> arguments;
+    // identifies the DXC build, see ShaderCompiler
+    std::string_view compilerIdentity;
+};
+
+// on-disk DXIL cache shared by every process pointing at the same directory.
+// it works in two levels like ccache's direct mode: a manifest keyed by hash(source, arguments, compiler) lists
+// the includes the last compile resolved, and the DXIL is keyed by that hash plus the hashes of those includes.
+// a lookup only re-hashes the listed include files, so a hit never needs the compiler's preprocessor
+class ShaderCache
+{
+public:
+    explicit ShaderCache(std::filesystem::path directory);
+
+    // DXIL of a previous compile with the same inputs and unchanged includes
+    std::optional<std::vector<std::byte>> load(const ShaderCacheInputs& inputs) const;
+
+    // includes are the paths the include handler resolved, as they can be opened from the working directory.
+    // failures are reported and ignored, the cache never fails a compile
+    void store(
+        const ShaderCacheInputs& inputs,
+        std::span<const std::filesystem::path> includes,
+        std::span<const std::byte> dxil
+    ) const;
+
+    const std::filesystem::path& directory() const
+    {
+        return m_directory;
+    }
+
+private:
+    std::filesystem::path m_directory;
+};
+
+#endif //SHADERCACHE_H
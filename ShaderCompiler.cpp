@@ -0,0 +1,316 @@
+#include "ShaderCompiler.h"
+
+#ifdef _WIN32
+#ifndef UNICODE
+#define UNICODE
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include <dxcapi.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+#include "ShaderCache.h"
+
+namespace
+{
+// minimal owning COM pointer, WRL is not available where DXC runs on Linux
+template <typename T>
+class DxcPtr
+{
+public:
+    DxcPtr() = default;
+    DxcPtr(const DxcPtr&) = delete;
+    DxcPtr& operator=(const DxcPtr&) = delete;
+
+    ~DxcPtr()
+    {
+        if (m_ptr)
+        {
+            m_ptr->Release();
+        }
+    }
+
+    T** operator&()
+    {
+        return &m_ptr;
+    }
+
+    T* operator->() const
+    {
+        return m_ptr;
+    }
+
+    T* get() const
+    {
+        return m_ptr;
+    }
+
+    explicit operator bool() const
+    {
+        return m_ptr != nullptr;
+    }
+
+private:
+    T* m_ptr = nullptr;
+};
+
+// forwards to DXC's default handler and remembers every file it resolved, those go into the cache key.
+// it lives on the stack for the duration of one Compile call, so reference counting is a no-op
+class RecordingIncludeHandler : public IDxcIncludeHandler
+{
+public:
+    explicit RecordingIncludeHandler(IDxcIncludeHandler* inner)
+        : m_inner(inner)
+    {
+    }
+
+    HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR filename, IDxcBlob** includeSource) override
+    {
+        HRESULT hr = m_inner->LoadSource(filename, includeSource);
+        if (SUCCEEDED(hr))
+        {
+            m_includes.emplace_back(filename);
+        }
+        return hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+    {
+        if (IsEqualIID(riid, __uuidof(IDxcIncludeHandler)) || IsEqualIID(riid, __uuidof(IUnknown)))
+        {
+            *object = static_cast<IDxcIncludeHandler*>(this);
+            return S_OK;
+        }
+        *object = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return 1;
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        return 1;
+    }
+
+    const std::vector<std::filesystem::path>& includes() const
+    {
+        return m_includes;
+    }
+
+private:
+    IDxcIncludeHandler* m_inner;
+    std::vector<std::filesystem::path> m_includes;
+};
+
+std::string readSource(const std::filesystem::path& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+    {
+        throw std::runtime_error("Failed to load shader file: " + path.string());
+    }
+    std::ostringstream contents;
+    contents << stream.rdbuf();
+    return std::move(contents).str();
+}
+}
+
+std::string dxcCompilerIdentity()
+{
+    std::filesystem::path module;
+#ifdef _WIN32
+    HMODULE handle = nullptr;
+    if (GetModuleHandleExW(
+        GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+        reinterpret_cast<LPCWSTR>(&DxcCreateInstance),
+        &handle
+    ))
+    {
+        wchar_t path[MAX_PATH] = {};
+        DWORD length = GetModuleFileNameW(handle, path, MAX_PATH);
+        module = std::wstring(path, length);
+    }
+#else
+    Dl_info info = {};
+    if (dladdr(reinterpret_cast<void*>(&DxcCreateInstance), &info) && info.dli_fname)
+    {
+        module = info.dli_fname;
+    }
+#endif
+
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(module, error);
+    if (error)
+    {
+        std::cerr << "Failed to identify the DXC library, cached shaders survive a DXC update." << std::endl;
+        size = 0;
+    }
+    auto writeTime = std::filesystem::last_write_time(module, error);
+    return module.string() + "|" + std::to_string(size) + "|" + std::to_string(writeTime.time_since_epoch().count());
+}
+
+ShaderCompiler::ShaderCompiler(const ShaderCompilerOptions& options)
+    : m_options(options)
+{
+}
+
+std::vector<std::byte> ShaderCompiler::compile(const std::filesystem::path& sourcePath)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::string source = readSource(sourcePath);
+
+    // the first argument names the source, includes resolve relative to it
+    std::vector<std::wstring> arguments = {
+        sourcePath.wstring(),
+        L"-T", m_options.target
+    };
+    arguments.insert(arguments.end(), m_options.arguments.begin(), m_options.arguments.end());
+
+    std::string compilerIdentity;
+    std::optional<ShaderCache> cache;
+    std::optional<std::vector<std::byte>> dxil;
+    if (!m_options.cacheDirectory.empty())
+    {
+        compilerIdentity = dxcCompilerIdentity();
+        cache.emplace(m_options.cacheDirectory);
+        dxil = cache->load({
+            .source = source,
+            .arguments = arguments,
+            .compilerIdentity = compilerIdentity
+        });
+    }
+
+    m_stats.cacheHit = dxil.has_value();
+    m_stats.compilerCreated = false;
+    if (!dxil)
+    {
+        std::vector<std::filesystem::path> includes;
+        dxil = compileWithDxc(source, arguments, includes);
+        if (cache)
+        {
+            cache->store(
+                {
+                    .source = source,
+                    .arguments = arguments,
+                    .compilerIdentity = compilerIdentity
+                },
+                includes,
+                *dxil
+            );
+        }
+    }
+
+    m_stats.dxilSize = dxil->size();
+    m_stats.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return std::move(*dxil);
+}
+
+std::vector<std::byte> ShaderCompiler::compileWithDxc(
+    const std::string& source,
+    const std::vector<std::wstring>& arguments,
+    std::vector<std::filesystem::path>& includes
+)
+{
+    DxcPtr<IDxcCompiler3> compiler;
+    DxcPtr<IDxcUtils> utils;
+    HRESULT hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to create DXC compiler instance.");
+    }
+    m_stats.compilerCreated = true;
+    hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils));
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to create DXC utils instance.");
+    }
+
+    DxcPtr<IDxcIncludeHandler> defaultIncludeHandler;
+    hr = utils->CreateDefaultIncludeHandler(&defaultIncludeHandler);
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to create default include handler.");
+    }
+    RecordingIncludeHandler includeHandler(defaultIncludeHandler.get());
+
+    std::vector<LPCWSTR> argumentPointers;
+    for (const auto& argument : arguments)
+    {
+        argumentPointers.push_back(argument.c_str());
+    }
+
+    DxcBuffer sourceBuffer = {
+        .Ptr = source.data(),
+        .Size = source.size(),
+        .Encoding = DXC_CP_ACP
+    };
+
+    DxcPtr<IDxcResult> result;
+    hr = compiler->Compile(
+        &sourceBuffer,
+        argumentPointers.data(),
+        static_cast<UINT32>(argumentPointers.size()),
+        &includeHandler,
+        IID_PPV_ARGS(&result)
+    );
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Failed to compile shader.");
+    }
+
+    DxcPtr<IDxcBlobUtf8> errors;
+    hr = result->GetOutput(
+        DXC_OUT_ERRORS,
+        IID_PPV_ARGS(&errors),
+        nullptr
+    );
+    if (FAILED(hr) || (errors && errors->GetStringLength() > 0))
+    {
+        std::cerr << "Shader compilation failed with error code: " << hr << std::endl;
+        if (errors)
+        {
+            std::cerr << static_cast<const char*>(errors->GetBufferPointer()) << std::endl;
+        }
+        throw std::runtime_error("Shader compilation failed.");
+    }
+
+    result->GetStatus(&hr);
+    if (FAILED(hr))
+    {
+        throw std::runtime_error("Shader compilation failed with unknown error.");
+    }
+
+    DxcPtr<IDxcBlob> shaderBlob;
+    hr = result->GetOutput(
+        DXC_OUT_OBJECT,
+        IID_PPV_ARGS(&shaderBlob),
+        nullptr
+    );
+    if (FAILED(hr) || !shaderBlob)
+    {
+        throw std::runtime_error("Failed to get compiled shader object.");
+    }
+
+    includes = includeHandler.includes();
+
+    std::vector<std::byte> dxil(shaderBlob->GetBufferSize());
+    std::memcpy(dxil.data(), shaderBlob->GetBufferPointer(), dxil.size());
+    return dxil;
+}
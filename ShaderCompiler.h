@@ -0,0 +1,54 @@
+#ifndef SHADERCOMPILER_H
+#define SHADERCOMPILER_H
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct ShaderCompilerOptions
+{
+    std::wstring target = L"lib_6_3";
+    std::vector<std::wstring> arguments; // extra DXC arguments such as -D or -I
+    std::filesystem::path cacheDirectory; // empty disables the ShaderCache
+};
+
+struct ShaderCompileStats
+{
+    double timeMs = 0.0;
+    bool cacheHit = false;
+    // a DXC compiler instance was created, which a hit never does
+    bool compilerCreated = false;
+    size_t dxilSize = 0;
+};
+
+// compiles HLSL into a DXIL container with DXC. with a cache directory the ShaderCache is asked first,
+// and on a hit no DXC object is ever created
+class ShaderCompiler
+{
+public:
+    explicit ShaderCompiler(const ShaderCompilerOptions& options = {});
+
+    std::vector<std::byte> compile(const std::filesystem::path& sourcePath);
+
+    const ShaderCompileStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    std::vector<std::byte> compileWithDxc(
+        const std::string& source,
+        const std::vector<std::wstring>& arguments,
+        std::vector<std::filesystem::path>& includes
+    );
+
+    ShaderCompilerOptions m_options;
+    ShaderCompileStats m_stats;
+};
+
+// path, size and timestamp of the loaded dxcompiler library. it tells DXC builds apart like a version
+// would, but only needs the already loaded module instead of a compiler instance
+std::string dxcCompilerIdentity();
+
+#endif //SHADERCOMPILER_H
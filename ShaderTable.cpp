@@ -0,0 +1,128 @@
+#include "ShaderTable.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::string narrow(const std::wstring& name)
+{
+    std::string result;
+    for (wchar_t c : name)
+    {
+        result += c < 0x80 ? static_cast<char>(c) : '?';
+    }
+    return result;
+}
+}
+
+ShaderTableRange ShaderTableLayout::rayGenRecord(uint32_t index) const
+{
+    const ShaderTableRange& rayGen = table(ShaderTableKind::RayGen);
+    if (index >= rayGen.recordCount)
+    {
+        throw std::out_of_range("Raygen record index out of range.");
+    }
+    return {
+        .offset = rayGen.offset + rayGen.stride * index,
+        .size = rayGen.stride,
+        .stride = rayGen.stride,
+        .recordCount = 1
+    };
+}
+
+uint32_t ShaderTableBuilder::addRecord(
+    ShaderTableKind kind,
+    std::wstring exportName,
+    std::vector<std::byte> localRootArguments
+)
+{
+    if (SHADER_IDENTIFIER_SIZE + localRootArguments.size() > SHADER_RECORD_MAX_STRIDE)
+    {
+        throw std::invalid_argument("Shader record for " + narrow(exportName) + " exceeds the maximum stride.");
+    }
+
+    std::vector<Record>& records = m_records[static_cast<size_t>(kind)];
+    records.push_back({std::move(exportName), std::move(localRootArguments)});
+    return static_cast<uint32_t>(records.size() - 1);
+}
+
+ShaderTableLayout ShaderTableBuilder::layout() const
+{
+    ShaderTableLayout layout;
+    uint64_t offset = 0;
+    for (size_t kind = 0; kind < SHADER_TABLE_KIND_COUNT; ++kind)
+    {
+        const std::vector<Record>& records = m_records[kind];
+        ShaderTableRange& range = layout.tables[kind];
+        if (records.empty())
+        {
+            continue;
+        }
+
+        size_t maxArguments = 0;
+        for (const Record& record : records)
+        {
+            maxArguments = std::max(maxArguments, record.localRootArguments.size());
+        }
+
+        // raygen records are dispatch start addresses, so they need the table alignment
+        uint64_t recordAlignment = kind == static_cast<size_t>(ShaderTableKind::RayGen)
+            ? SHADER_TABLE_ALIGNMENT
+            : SHADER_RECORD_ALIGNMENT;
+
+        offset = alignUp(offset, SHADER_TABLE_ALIGNMENT);
+        range.offset = offset;
+        range.stride = alignUp(SHADER_IDENTIFIER_SIZE + maxArguments, recordAlignment);
+        range.recordCount = static_cast<uint32_t>(records.size());
+        range.size = range.stride * records.size();
+        offset += range.size;
+    }
+    layout.totalSize = offset;
+    return layout;
+}
+
+void ShaderTableBuilder::write(
+    std::span<std::byte> destination,
+    const std::function<const void*(const std::wstring&)>& identifierOf
+) const
+{
+    ShaderTableLayout layout = this->layout();
+    if (destination.size() < layout.totalSize)
+    {
+        throw std::invalid_argument("Shader table destination is smaller than the layout.");
+    }
+
+    // padding is zeroed so the table contents do not depend on what was in the upload heap
+    std::fill(destination.begin(), destination.begin() + static_cast<ptrdiff_t>(layout.totalSize), std::byte{0});
+
+    for (size_t kind = 0; kind < SHADER_TABLE_KIND_COUNT; ++kind)
+    {
+        const ShaderTableRange& range = layout.tables[kind];
+        for (size_t i = 0; i < m_records[kind].size(); ++i)
+        {
+            const Record& record = m_records[kind][i];
+            const void* identifier = identifierOf(record.exportName);
+            if (!identifier)
+            {
+                throw std::runtime_error("No shader identifier for export " + narrow(record.exportName) + ".");
+            }
+
+            std::byte* data = destination.data() + range.offset + range.stride * i;
+            std::memcpy(data, identifier, SHADER_IDENTIFIER_SIZE);
+            if (!record.localRootArguments.empty())
+            {
+                std::memcpy(
+                    data + SHADER_IDENTIFIER_SIZE,
+                    record.localRootArguments.data(),
+                    record.localRootArguments.size()
+                );
+            }
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef SHADERTABLE_H
+#define SHADERTABLE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// D3D12 shader table constants, repeated here so the layout builds without d3d12.h
+constexpr uint32_t SHADER_IDENTIFIER_SIZE = 32; // D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES
+constexpr uint32_t SHADER_RECORD_ALIGNMENT = 32; // D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT
+constexpr uint32_t SHADER_TABLE_ALIGNMENT = 64; // D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT
+constexpr uint32_t SHADER_RECORD_MAX_STRIDE = 4096; // D3D12_RAYTRACING_MAX_SHADER_RECORD_STRIDE
+
+enum class ShaderTableKind : uint32_t
+{
+    RayGen,
+    Miss,
+    HitGroup,
+    Callable
+};
+
+constexpr size_t SHADER_TABLE_KIND_COUNT = 4;
+
+// byte range of one table inside the shader table allocation
+struct ShaderTableRange
+{
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint64_t stride = 0;
+    uint32_t recordCount = 0;
+};
+
+struct ShaderTableLayout
+{
+    std::array<ShaderTableRange, SHADER_TABLE_KIND_COUNT> tables;
+    uint64_t totalSize = 0;
+
+    const ShaderTableRange& table(ShaderTableKind kind) const
+    {
+        return tables[static_cast<size_t>(kind)];
+    }
+
+    // DispatchRays takes a single raygen record, every one of them starts on SHADER_TABLE_ALIGNMENT
+    ShaderTableRange rayGenRecord(uint32_t index) const;
+};
+
+// collects raygen/miss/hit group/callable records and lays them out in one allocation.
+// each table gets the stride of its largest record, so small records only pay for their own table
+class ShaderTableBuilder
+{
+public:
+    // local root arguments are packed in order at their natural alignment, matching the local root
+    // signature's parameter order (root constants 4 bytes, descriptors and descriptor tables 8 bytes).
+    // returns the record's index inside its table, e.g. the hit group index for a geometry
+    template <typename... Args>
+        requires (std::is_trivially_copyable_v<Args> && ...)
+    uint32_t add(ShaderTableKind kind, std::wstring exportName, const Args&... localRootArguments)
+    {
+        std::vector<std::byte> arguments;
+        (appendArgument(arguments, localRootArguments), ...);
+        return addRecord(kind, std::move(exportName), std::move(arguments));
+    }
+
+    uint32_t addRecord(ShaderTableKind kind, std::wstring exportName, std::vector<std::byte> localRootArguments);
+
+    ShaderTableLayout layout() const;
+
+    // destination holds layout().totalSize bytes, identifierOf returns the SHADER_IDENTIFIER_SIZE bytes
+    // of an export (ID3D12StateObjectProperties::GetShaderIdentifier) or nullptr if it does not exist
+    void write(
+        std::span<std::byte> destination,
+        const std::function<const void*(const std::wstring&)>& identifierOf
+    ) const;
+
+    uint32_t recordCount(ShaderTableKind kind) const
+    {
+        return static_cast<uint32_t>(m_records[static_cast<size_t>(kind)].size());
+    }
+
+private:
+    struct Record
+    {
+        std::wstring exportName;
+        std::vector<std::byte> localRootArguments;
+    };
+
+    template <typename T>
+    static void appendArgument(std::vector<std::byte>& arguments, const T& value)
+    {
+        size_t offset = (arguments.size() + alignof(T) - 1) / alignof(T) * alignof(T);
+        arguments.resize(offset + sizeof(T));
+        std::memcpy(arguments.data() + offset, &value, sizeof(T));
+    }
+
+    std::array<std::vector<Record>, SHADER_TABLE_KIND_COUNT> m_records;
+};
+
+#endif //SHADERTABLE_H
@@ -0,0 +1,300 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace
+{
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity)
+    : m_capacity(capacity & ~(TLSF_GRANULARITY - 1))
+{
+    if (m_capacity == 0)
+    {
+        throw std::invalid_argument("TLSF allocator capacity is smaller than its granularity.");
+    }
+
+    for (auto& lists : m_freeLists)
+    {
+        lists.fill(NONE);
+    }
+    insertFree(createBlock(0, m_capacity));
+}
+
+std::optional<TlsfAllocation> TlsfAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+    if (!std::has_single_bit(alignment))
+    {
+        throw std::invalid_argument("TLSF alignment must be a power of two.");
+    }
+    alignment = std::max(alignment, TLSF_GRANULARITY);
+    size = alignUp(std::max<uint64_t>(size, 1), TLSF_GRANULARITY);
+    if (size > m_capacity)
+    {
+        return std::nullopt;
+    }
+
+    // any block of at least this size can hold the allocation after aligning its offset
+    uint64_t searchSize = size + (alignment - TLSF_GRANULARITY);
+
+    auto fits = [&](uint32_t index)
+    {
+        const Block& block = m_blocks[index];
+        return alignUp(block.offset, alignment) + size <= block.offset + block.size;
+    };
+
+    uint32_t index = NONE;
+    uint32_t fl = 0;
+    uint32_t sl = 0;
+    if (searchSize <= m_capacity && findFreeBlock(searchSize, fl, sl))
+    {
+        index = m_freeLists[fl][sl];
+    }
+    else
+    {
+        // the rounded-up search skips the request's own size class, which matters when the heap is
+        // nearly full or exactly the requested size; walk that class before giving up
+        mapping(size, fl, sl);
+        for (uint32_t candidate = m_freeLists[fl][sl]; candidate != NONE; candidate = m_blocks[candidate].nextFree)
+        {
+            if (fits(candidate))
+            {
+                index = candidate;
+                break;
+            }
+        }
+    }
+    if (index == NONE || !fits(index))
+    {
+        return std::nullopt;
+    }
+
+    removeFree(index);
+
+    // the padding in front of an aligned offset goes back to the free lists
+    uint64_t padding = alignUp(m_blocks[index].offset, alignment) - m_blocks[index].offset;
+    if (padding > 0)
+    {
+        uint32_t front = createBlock(m_blocks[index].offset, padding);
+        m_blocks[front].prevPhysical = m_blocks[index].prevPhysical;
+        m_blocks[front].nextPhysical = index;
+        if (m_blocks[index].prevPhysical != NONE)
+        {
+            m_blocks[m_blocks[index].prevPhysical].nextPhysical = front;
+        }
+        m_blocks[index].prevPhysical = front;
+        m_blocks[index].offset += padding;
+        m_blocks[index].size -= padding;
+        insertFree(front);
+    }
+
+    splitTail(index, size);
+
+    Block& block = m_blocks[index];
+    block.free = false;
+    m_usedBytes += block.size;
+    m_allocationCount++;
+    return TlsfAllocation{block.offset, block.size, index};
+}
+
+void TlsfAllocator::free(const TlsfAllocation& allocation)
+{
+    if (allocation.block >= m_blocks.size()
+        || m_blocks[allocation.block].free
+        || m_blocks[allocation.block].size == 0
+        || m_blocks[allocation.block].offset != allocation.offset)
+    {
+        throw std::invalid_argument("Freeing an allocation that is not live.");
+    }
+
+    uint32_t index = allocation.block;
+    m_blocks[index].free = true;
+    m_usedBytes -= m_blocks[index].size;
+    m_allocationCount--;
+
+    uint32_t prev = m_blocks[index].prevPhysical;
+    if (prev != NONE && m_blocks[prev].free)
+    {
+        removeFree(prev);
+        index = mergeWithNext(prev);
+    }
+    uint32_t next = m_blocks[index].nextPhysical;
+    if (next != NONE && m_blocks[next].free)
+    {
+        removeFree(next);
+        index = mergeWithNext(index);
+    }
+    insertFree(index);
+}
+
+TlsfAllocatorStats TlsfAllocator::stats() const
+{
+    TlsfAllocatorStats stats = {
+        .capacity = m_capacity,
+        .usedBytes = m_usedBytes,
+        .freeBytes = m_capacity - m_usedBytes,
+        .allocationCount = m_allocationCount,
+        .freeBlockCount = m_freeBlockCount
+    };
+
+    // the largest free block is in the highest non-empty size class
+    if (m_flBitmap != 0)
+    {
+        uint32_t fl = 63 - std::countl_zero(m_flBitmap);
+        uint32_t sl = 31 - std::countl_zero(m_slBitmaps[fl]);
+        for (uint32_t index = m_freeLists[fl][sl]; index != NONE; index = m_blocks[index].nextFree)
+        {
+            stats.largestFreeBlock = std::max(stats.largestFreeBlock, m_blocks[index].size);
+        }
+    }
+    if (stats.freeBytes > 0)
+    {
+        stats.fragmentation = 1.0 - static_cast<double>(stats.largestFreeBlock) / static_cast<double>(stats.freeBytes);
+    }
+    return stats;
+}
+
+void TlsfAllocator::mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+    // size >= TLSF_GRANULARITY, so fl >= SL_LOG2
+    fl = static_cast<uint32_t>(std::bit_width(size) - 1);
+    sl = static_cast<uint32_t>(size >> (fl - SL_LOG2)) & (SL_COUNT - 1);
+}
+
+bool TlsfAllocator::findFreeBlock(uint64_t size, uint32_t& fl, uint32_t& sl) const
+{
+    // round up to the next subclass so every block found is large enough
+    mapping(size, fl, sl);
+    size += (uint64_t(1) << (fl - SL_LOG2)) - 1;
+    mapping(size, fl, sl);
+
+    uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+    if (slMap == 0)
+    {
+        uint64_t flMap = fl + 1 < FL_COUNT ? m_flBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+        if (flMap == 0)
+        {
+            return false;
+        }
+        fl = static_cast<uint32_t>(std::countr_zero(flMap));
+        slMap = m_slBitmaps[fl];
+    }
+    sl = static_cast<uint32_t>(std::countr_zero(slMap));
+    return true;
+}
+
+uint32_t TlsfAllocator::createBlock(uint64_t offset, uint64_t size)
+{
+    uint32_t index;
+    if (!m_unusedBlocks.empty())
+    {
+        index = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+    }
+    else
+    {
+        index = static_cast<uint32_t>(m_blocks.size());
+        m_blocks.emplace_back();
+    }
+    m_blocks[index] = Block{.offset = offset, .size = size};
+    return index;
+}
+
+void TlsfAllocator::releaseBlock(uint32_t index)
+{
+    // size 0 marks the slot as unused, so stale handles fail the check in free()
+    m_blocks[index] = Block{};
+    m_unusedBlocks.push_back(index);
+}
+
+void TlsfAllocator::insertFree(uint32_t index)
+{
+    uint32_t fl;
+    uint32_t sl;
+    mapping(m_blocks[index].size, fl, sl);
+
+    Block& block = m_blocks[index];
+    block.free = true;
+    block.prevFree = NONE;
+    block.nextFree = m_freeLists[fl][sl];
+    if (block.nextFree != NONE)
+    {
+        m_blocks[block.nextFree].prevFree = index;
+    }
+    m_freeLists[fl][sl] = index;
+    m_flBitmap |= uint64_t(1) << fl;
+    m_slBitmaps[fl] |= 1u << sl;
+    m_freeBlockCount++;
+}
+
+void TlsfAllocator::removeFree(uint32_t index)
+{
+    uint32_t fl;
+    uint32_t sl;
+    mapping(m_blocks[index].size, fl, sl);
+
+    Block& block = m_blocks[index];
+    if (block.prevFree != NONE)
+    {
+        m_blocks[block.prevFree].nextFree = block.nextFree;
+    }
+    else
+    {
+        m_freeLists[fl][sl] = block.nextFree;
+    }
+    if (block.nextFree != NONE)
+    {
+        m_blocks[block.nextFree].prevFree = block.prevFree;
+    }
+    block.prevFree = NONE;
+    block.nextFree = NONE;
+
+    if (m_freeLists[fl][sl] == NONE)
+    {
+        m_slBitmaps[fl] &= ~(1u << sl);
+        if (m_slBitmaps[fl] == 0)
+        {
+            m_flBitmap &= ~(uint64_t(1) << fl);
+        }
+    }
+    m_freeBlockCount--;
+}
+
+void TlsfAllocator::splitTail(uint32_t index, uint64_t size)
+{
+    uint64_t remaining = m_blocks[index].size - size;
+    if (remaining < TLSF_GRANULARITY)
+    {
+        return;
+    }
+
+    uint32_t tail = createBlock(m_blocks[index].offset + size, remaining);
+    m_blocks[tail].prevPhysical = index;
+    m_blocks[tail].nextPhysical = m_blocks[index].nextPhysical;
+    if (m_blocks[index].nextPhysical != NONE)
+    {
+        m_blocks[m_blocks[index].nextPhysical].prevPhysical = tail;
+    }
+    m_blocks[index].nextPhysical = tail;
+    m_blocks[index].size = size;
+    insertFree(tail);
+}
+
+uint32_t TlsfAllocator::mergeWithNext(uint32_t index)
+{
+    uint32_t next = m_blocks[index].nextPhysical;
+    m_blocks[index].size += m_blocks[next].size;
+    m_blocks[index].nextPhysical = m_blocks[next].nextPhysical;
+    if (m_blocks[next].nextPhysical != NONE)
+    {
+        m_blocks[m_blocks[next].nextPhysical].prevPhysical = index;
+    }
+    releaseBlock(next);
+    return index;
+}
@@ -0,0 +1,99 @@
+#ifndef TLSFALLOCATOR_H
+#define TLSFALLOCATOR_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// smallest block and offset granularity, also the alignment of constant buffer views
+constexpr uint64_t TLSF_GRANULARITY = 256;
+
+struct TlsfAllocation
+{
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint32_t block = UINT32_MAX; // handle for free()
+};
+
+struct TlsfAllocatorStats
+{
+    uint64_t capacity = 0;
+    uint64_t usedBytes = 0;
+    uint64_t freeBytes = 0;
+    uint32_t allocationCount = 0;
+    uint32_t freeBlockCount = 0;
+    uint64_t largestFreeBlock = 0;
+    // 1 - largestFreeBlock / freeBytes, 0 when all free space is one block
+    double fragmentation = 0.0;
+};
+
+// two-level segregated fit allocator over the offset range [0, capacity). it only does bookkeeping, the
+// memory itself lives elsewhere: D3DHeapAllocator keeps one per placed-resource heap and upload page.
+// allocate and free are O(1): a first-level bitmap of power-of-two size classes, each split into
+// SL_COUNT linear subclasses, finds a free block that is guaranteed to fit without walking lists
+class TlsfAllocator
+{
+public:
+    explicit TlsfAllocator(uint64_t capacity);
+
+    // alignment is a power of two, sizes and offsets are rounded to TLSF_GRANULARITY
+    std::optional<TlsfAllocation> allocate(uint64_t size, uint64_t alignment = TLSF_GRANULARITY);
+    void free(const TlsfAllocation& allocation);
+
+    uint64_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    bool empty() const
+    {
+        return m_allocationCount == 0;
+    }
+
+    TlsfAllocatorStats stats() const;
+
+private:
+    static constexpr uint32_t SL_LOG2 = 4;
+    static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+    static constexpr uint32_t FL_COUNT = 64;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Block
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        // neighbours in address order
+        uint32_t prevPhysical = NONE;
+        uint32_t nextPhysical = NONE;
+        // neighbours in the free list of the block's size class
+        uint32_t prevFree = NONE;
+        uint32_t nextFree = NONE;
+        bool free = false;
+    };
+
+    static void mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+    bool findFreeBlock(uint64_t size, uint32_t& fl, uint32_t& sl) const;
+
+    uint32_t createBlock(uint64_t offset, uint64_t size);
+    void releaseBlock(uint32_t index);
+    void insertFree(uint32_t index);
+    void removeFree(uint32_t index);
+    // splits the tail of a block beyond size into a new free block
+    void splitTail(uint32_t index, uint64_t size);
+    uint32_t mergeWithNext(uint32_t index);
+
+    uint64_t m_capacity;
+    uint64_t m_usedBytes = 0;
+    uint32_t m_allocationCount = 0;
+    uint32_t m_freeBlockCount = 0;
+
+    std::vector<Block> m_blocks;
+    std::vector<uint32_t> m_unusedBlocks;
+
+    uint64_t m_flBitmap = 0;
+    std::array<uint32_t, FL_COUNT> m_slBitmaps = {};
+    std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> m_freeLists;
+};
+
+#endif //TLSFALLOCATOR_H
@@ -0,0 +1,700 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "CpuPacket.h"
+#include "CpuShaders.h"
+#include "MeshLoader.h"
+#include "TlsfAllocator.h"
+
+namespace
+{
+struct BenchmarkOptions
+{
+    std::filesystem::path outputPath; // empty = stdout
+    std::vector<std::filesystem::path> meshPaths;
+    std::string label; // stored as is, e.g. the commit the numbers belong to
+    bool quick = false; // small procedural scenes only
+    uint32_t repeats = 3; // every measurement keeps its fastest run
+    uint32_t imageSize = 512; // primary rays per frame = imageSize^2
+};
+
+struct BenchmarkScene
+{
+    std::string name;
+    Mesh mesh;
+};
+
+
+enum class RayType
+{
+    Primary, // camera rays, coherent within a packet
+    Incoherent, // random directions from the primary hit points, like a diffuse bounce
+    Shadow // primary hit points to a point light, any hit ends the search
+};
+
+struct RayResult
+{
+    CpuBvhBuildPreference preference;
+    CpuTraceKernel kernel;
+    RayType type;
+    uint64_t rayCount = 0;
+    uint64_t hitCount = 0;
+    double raysPerSecond = 0.0;
+    // scalar kernel of a DXR_CPU_TRAVERSAL_STATS build only, counted in a pass of its own
+    CpuTraversalTotals traversal = {};
+};
+
+struct BuildResult
+{
+    CpuBvhBuildPreference preference;
+    double buildTimeMs = 0.0;
+    CpuBvhBuildStats stats;
+    double bytesPerTriangle = 0.0;
+    double compressedBytesPerTriangle = 0.0;
+    // primary rays through the compressed BLAS, one per kernel. the packet kernels trace it one lane at a time
+    std::vector<RayResult> compressedRays = {};
+};
+
+struct AllocatorResult
+{
+    uint64_t operations = 0;
+    uint64_t failedAllocations = 0;
+    double nsPerOperation = 0.0;
+    uint32_t liveAllocations = 0; // at the end of the run
+    double fragmentation = 0.0; // at the end of the run
+};
+
+struct SceneResult
+{
+    std::string name;
+    uint32_t triangleCount = 0;
+    std::vector<BuildResult> builds;
+    std::vector<RayResult> rays;
+};
+
+constexpr CpuBvhBuildPreference BUILD_PREFERENCES[] = {
+    CpuBvhBuildPreference::FastTrace,
+    CpuBvhBuildPreference::FastBuild,
+    CpuBvhBuildPreference::HighQuality
+};
+
+constexpr CpuTraceKernel TRACE_KERNELS[] = {
+    CpuTraceKernel::Scalar,
+    CpuTraceKernel::Avx2x8,
+    CpuTraceKernel::Avx512x16
+};
+
+constexpr RayType RAY_TYPES[] = {
+    RayType::Primary,
+    RayType::Incoherent,
+    RayType::Shadow
+};
+
+const char* preferenceName(CpuBvhBuildPreference preference)
+{
+    switch (preference)
+    {
+    case CpuBvhBuildPreference::FastTrace:
+        return "sah";
+    case CpuBvhBuildPreference::FastBuild:
+        return "lbvh";
+    case CpuBvhBuildPreference::HighQuality:
+        return "sbvh";
+    }
+    return "unknown";
+}
+
+const char* rayTypeName(RayType type)
+{
+    switch (type)
+    {
+    case RayType::Primary:
+        return "primary";
+    case RayType::Incoherent:
+        return "incoherent";
+    case RayType::Shadow:
+        return "shadow";
+    }
+    return "unknown";
+}
+
+// UV sphere, uniform triangles with a well-behaved BVH
+Mesh sphereMesh(uint32_t rings, uint32_t segments)
+{
+    constexpr float PI = 3.14159265f;
+    Mesh mesh;
+    for (uint32_t ring = 0; ring <= rings; ++ring)
+    {
+        float theta = PI * static_cast<float>(ring) / static_cast<float>(rings);
+        for (uint32_t segment = 0; segment <= segments; ++segment)
+        {
+            float phi = 2.0f * PI * static_cast<float>(segment) / static_cast<float>(segments);
+            mesh.vertices.push_back({std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)});
+        }
+    }
+    for (uint32_t ring = 0; ring < rings; ++ring)
+    {
+        for (uint32_t segment = 0; segment < segments; ++segment)
+        {
+            uint32_t i0 = ring * (segments + 1) + segment;
+            uint32_t i1 = i0 + segments + 1;
+            mesh.indices.insert(mesh.indices.end(), {i0, i1, i0 + 1, i0 + 1, i1, i1 + 1});
+        }
+    }
+    return mesh;
+}
+
+// rolling terrain seen from above at an angle, the camera rays hit almost everywhere
+Mesh heightFieldMesh(uint32_t size)
+{
+    Mesh mesh;
+    for (uint32_t z = 0; z <= size; ++z)
+    {
+        for (uint32_t x = 0; x <= size; ++x)
+        {
+            float fx = static_cast<float>(x) / static_cast<float>(size);
+            float fz = static_cast<float>(z) / static_cast<float>(size);
+            float height = 0.05f * std::sin(fx * 25.0f) * std::cos(fz * 17.0f) + 0.02f * std::sin((fx + fz) * 60.0f);
+            // tilted towards the camera, which looks down +z
+            mesh.vertices.push_back({fx - 0.5f, height + (fz - 0.5f) * 0.7f, fz - 0.5f});
+        }
+    }
+    for (uint32_t z = 0; z < size; ++z)
+    {
+        for (uint32_t x = 0; x < size; ++x)
+        {
+            uint32_t i0 = z * (size + 1) + x;
+            uint32_t i1 = i0 + size + 1;
+            mesh.indices.insert(mesh.indices.end(), {i0, i1, i0 + 1, i0 + 1, i1, i1 + 1});
+        }
+    }
+    return mesh;
+}
+
+// small triangles at random positions and orientations, no spatial coherence for the builders to exploit
+Mesh triangleSoupMesh(uint32_t triangleCount, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-0.5f, 0.5f);
+    std::uniform_real_distribution<float> offset(-0.02f, 0.02f);
+    Mesh mesh;
+    for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        Float3 center = {position(random), position(random), position(random)};
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            mesh.indices.push_back(static_cast<uint32_t>(mesh.vertices.size()));
+            mesh.vertices.push_back(center + Float3{offset(random), offset(random), offset(random)});
+        }
+    }
+    return mesh;
+}
+
+std::vector<BenchmarkScene> createScenes(const BenchmarkOptions& options)
+{
+    std::vector<BenchmarkScene> scenes;
+    scenes.push_back({"sphere-16k", sphereMesh(64, 128)});
+    scenes.push_back({"terrain-32k", heightFieldMesh(128)});
+    scenes.push_back({"soup-16k", triangleSoupMesh(16384, 1)});
+    if (!options.quick)
+    {
+        scenes.push_back({"sphere-262k", sphereMesh(256, 512)});
+        scenes.push_back({"terrain-524k", heightFieldMesh(512)});
+        scenes.push_back({"soup-262k", triangleSoupMesh(262144, 1)});
+    }
+
+    for (const std::filesystem::path& path : options.meshPaths)
+    {
+        MeshLoader loader;
+        scenes.push_back({path.filename().string(), loader.load(path)});
+    }
+    return scenes;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// rays in the order the kernel traces them: blocks of packet width pixels, like CpuEngine's dispatch
+std::vector<CpuRay> primaryRays(uint32_t imageSize, CpuTraceKernel kernel)
+{
+    uint32_t blockWidth = 1;
+    uint32_t blockHeight = 1;
+    if (packetWidth(kernel) == 16)
+    {
+        blockWidth = 4;
+        blockHeight = 4;
+    }
+    else if (packetWidth(kernel) == 8)
+    {
+        blockWidth = 4;
+        blockHeight = 2;
+    }
+
+    std::vector<CpuRay> rays;
+    rays.reserve(static_cast<size_t>(imageSize) * imageSize);
+    for (uint32_t y = 0; y < imageSize; y += blockHeight)
+    {
+        for (uint32_t x = 0; x < imageSize; x += blockWidth)
+        {
+            for (uint32_t lane = 0; lane < blockWidth * blockHeight; ++lane)
+            {
+                rays.push_back(rayGen(x + lane % blockWidth, y + lane / blockWidth, imageSize, imageSize));
+            }
+        }
+    }
+    return rays;
+}
+
+// shared by every kernel of a ray type, so the kernels trace the same rays and report the same hits
+struct SecondaryRays
+{
+    std::vector<CpuRay> incoherent;
+    std::vector<CpuRay> shadow;
+};
+
+SecondaryRays secondaryRays(const CpuTlas& tlas, uint32_t imageSize)
+{
+    constexpr Float3 LIGHT_POSITION = {1.0f, 2.0f, -2.0f};
+    // the scene is fitted into the unit box, this is well above the float error there
+    constexpr float SURFACE_OFFSET = 1e-4f;
+
+    std::mt19937 random(7);
+    std::normal_distribution<float> gaussian;
+    SecondaryRays rays;
+    for (const CpuRay& ray : primaryRays(imageSize, CpuTraceKernel::Scalar))
+    {
+        CpuHit hit;
+        if (!tlas.traceRay(ray, CPU_RAY_FLAG_NONE, 0xFF, hit))
+        {
+            continue;
+        }
+        Float3 position = ray.origin + ray.direction * hit.t;
+
+        // normalized gaussian vectors are uniform on the sphere
+        Float3 direction = normalize({gaussian(random), gaussian(random), gaussian(random)});
+        rays.incoherent.push_back({
+            .origin = position,
+            .tMin = SURFACE_OFFSET,
+            .direction = direction,
+            .tMax = 1000.0f
+        });
+
+        Float3 toLight = LIGHT_POSITION - position;
+        float distance = std::sqrt(dot(toLight, toLight));
+        rays.shadow.push_back({
+            .origin = position,
+            .tMin = SURFACE_OFFSET,
+            .direction = toLight * (1.0f / distance),
+            .tMax = distance
+        });
+    }
+    return rays;
+}
+
+uint64_t traceRays(CpuTraceKernel kernel, const CpuTlas& tlas, std::span<const CpuRay> rays, uint32_t rayFlags)
+{
+    uint64_t hitCount = 0;
+    if (kernel == CpuTraceKernel::Scalar)
+    {
+        for (const CpuRay& ray : rays)
+        {
+            CpuHit hit;
+            hitCount += tlas.traceRay(ray, rayFlags, 0xFF, hit) ? 1 : 0;
+        }
+        return hitCount;
+    }
+
+    uint32_t width = packetWidth(kernel);
+    CpuRayPacket packet;
+    CpuHitPacket hits;
+    for (size_t first = 0; first < rays.size(); first += width)
+    {
+        uint32_t count = static_cast<uint32_t>(std::min<size_t>(width, rays.size() - first));
+        for (uint32_t lane = 0; lane < width; ++lane)
+        {
+            // idle lanes still need valid rays
+            packet.set(lane, rays[first + std::min(lane, count - 1)]);
+        }
+        uint32_t activeMask = (1u << count) - 1;
+        traceRayPacket(kernel, tlas, packet, activeMask, rayFlags, 0xFF, hits);
+        for (uint32_t lane = 0; lane < count; ++lane)
+        {
+            hitCount += hits.hasHit(lane) ? 1 : 0;
+        }
+    }
+    return hitCount;
+}
+
+// single-threaded, so the rates compare kernels rather than the machine's core count
+RayResult measureRays(
+    CpuBvhBuildPreference preference,
+    CpuTraceKernel kernel,
+    RayType type,
+    const CpuTlas& tlas,
+    std::span<const CpuRay> rays,
+    uint32_t repeats
+)
+{
+    uint32_t rayFlags = type == RayType::Shadow
+        ? CPU_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | CPU_RAY_FLAG_SKIP_CLOSEST_HIT_SHADER
+        : CPU_RAY_FLAG_NONE;
+
+    RayResult result = {
+        .preference = preference,
+        .kernel = kernel,
+        .type = type,
+        .rayCount = rays.size()
+    };
+    double bestMs = std::numeric_limits<double>::infinity();
+    for (uint32_t run = 0; run < repeats; ++run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        result.hitCount = traceRays(kernel, tlas, rays, rayFlags);
+        bestMs = std::min(bestMs, elapsedMs(start));
+    }
+    result.raysPerSecond = bestMs > 0.0 ? static_cast<double>(rays.size()) / (bestMs / 1000.0) : 0.0;
+
+    if (CPU_TRAVERSAL_STATS_ENABLED && kernel == CpuTraceKernel::Scalar)
+    {
+        for (const CpuRay& ray : rays)
+        {
+            CpuHit hit;
+            CpuTraversalStats stats;
+            tlas.traceRay(ray, rayFlags, 0xFF, hit, &stats);
+            result.traversal.add(stats);
+        }
+    }
+    return result;
+}
+
+SceneResult benchmarkScene(const BenchmarkScene& scene, const BenchmarkOptions& options)
+{
+    SceneResult result;
+    result.name = scene.name;
+    result.triangleCount = scene.mesh.triangleCount();
+
+    CpuGeometryDesc geometryDesc = {
+        .indexFormat = CpuIndexFormat::Uint32,
+        .indexCount = static_cast<uint32_t>(scene.mesh.indices.size()),
+        .vertexCount = static_cast<uint32_t>(scene.mesh.vertices.size()),
+        .indexBuffer = scene.mesh.indices.data(),
+        .vertexBuffer = scene.mesh.vertices.data(),
+        .vertexStrideInBytes = sizeof(Float3)
+    };
+
+    for (CpuBvhBuildPreference preference : BUILD_PREFERENCES)
+    {
+        CpuBvhBuildOptions buildOptions = {
+            .preference = preference
+        };
+
+        // whole BLAS builds, triangle staging included, the way an application pays for them
+        std::unique_ptr<CpuBlas> blas;
+        double bestMs = std::numeric_limits<double>::infinity();
+        for (uint32_t run = 0; run < options.repeats; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            blas = std::make_unique<CpuBlas>(std::span(&geometryDesc, 1), buildOptions);
+            bestMs = std::min(bestMs, elapsedMs(start));
+        }
+
+        BuildResult build = {
+            .preference = preference,
+            .buildTimeMs = bestMs,
+            .stats = blas->buildStats(),
+            .bytesPerTriangle = static_cast<double>(blas->memoryUsage()) / static_cast<double>(result.triangleCount)
+        };
+
+        // same camera fit as both engines
+        CpuInstanceDesc instanceDesc = {
+            .transform = {},
+            .instanceID = 0,
+            .instanceMask = 0xFF,
+            .instanceContributionToHitGroupIndex = 0,
+            .flags = CPU_INSTANCE_FLAG_NONE,
+            .accelerationStructure = blas.get()
+        };
+        scene.mesh.fitTransform(instanceDesc.transform);
+        {
+            CpuTlas tlas(std::span(&instanceDesc, 1));
+            SecondaryRays secondary = secondaryRays(tlas, options.imageSize);
+            for (CpuTraceKernel kernel : TRACE_KERNELS)
+            {
+                if (!isTraceKernelSupported(kernel))
+                {
+                    continue;
+                }
+                std::vector<CpuRay> primary = primaryRays(options.imageSize, kernel);
+                for (RayType type : RAY_TYPES)
+                {
+                    std::span<const CpuRay> rays = type == RayType::Primary
+                        ? std::span<const CpuRay>(primary)
+                        : type == RayType::Incoherent ? secondary.incoherent : secondary.shadow;
+                    result.rays.push_back(measureRays(preference, kernel, type, tlas, rays, options.repeats));
+                }
+            }
+        }
+
+        blas->compress();
+        build.compressedBytesPerTriangle = static_cast<double>(blas->memoryUsage()) / static_cast<double>(result.triangleCount);
+        {
+            // a new TLAS, the instance caches the node pointer the BLAS had before compress()
+            CpuTlas tlas(std::span(&instanceDesc, 1));
+            for (CpuTraceKernel kernel : TRACE_KERNELS)
+            {
+                if (isTraceKernelSupported(kernel))
+                {
+                    std::vector<CpuRay> primary = primaryRays(options.imageSize, kernel);
+                    build.compressedRays.push_back(
+                        measureRays(preference, kernel, RayType::Primary, tlas, primary, options.repeats));
+                }
+            }
+        }
+        result.builds.push_back(build);
+
+        std::cerr << scene.name << " " << preferenceName(preference) << ": built in " << build.buildTimeMs << " ms" << std::endl;
+    }
+    return result;
+}
+
+// the TLSF allocator alone, sized like the D3D heaps: a working set of small upload ranges and constant
+// buffers with the occasional 64KB aligned placed buffer, replaced one random allocation at a time
+AllocatorResult benchmarkAllocator(const BenchmarkOptions& options)
+{
+    constexpr uint64_t CAPACITY = 1ull << 30;
+    constexpr uint32_t LIVE_ALLOCATIONS = 50000;
+    const uint64_t operationCount = options.quick ? 200000 : 2000000;
+
+    AllocatorResult result;
+    double bestMs = std::numeric_limits<double>::infinity();
+    for (uint32_t run = 0; run < options.repeats; ++run)
+    {
+        // every run replays the same sequence
+        std::mt19937 random(1);
+        TlsfAllocator allocator(CAPACITY);
+        std::vector<TlsfAllocation> live;
+        live.reserve(LIVE_ALLOCATIONS);
+        uint64_t failedAllocations = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t operation = 0; operation < operationCount; ++operation)
+        {
+            if (live.size() >= LIVE_ALLOCATIONS)
+            {
+                size_t index = random() % live.size();
+                allocator.free(live[index]);
+                live[index] = live.back();
+                live.pop_back();
+                continue;
+            }
+
+            bool placed = random() % 64 == 0;
+            uint64_t size = placed ? 65536 + random() % (1u << 20) : random() % 8192 + 1;
+            std::optional<TlsfAllocation> allocation = allocator.allocate(size, placed ? 65536 : 256);
+            if (allocation)
+            {
+                live.push_back(*allocation);
+            }
+            else
+            {
+                failedAllocations++;
+            }
+        }
+        bestMs = std::min(bestMs, elapsedMs(start));
+
+        result.failedAllocations = failedAllocations;
+        result.liveAllocations = allocator.stats().allocationCount;
+        result.fragmentation = allocator.stats().fragmentation;
+    }
+    result.operations = operationCount;
+    result.nsPerOperation = bestMs * 1e6 / static_cast<double>(operationCount);
+
+    std::cerr << "tlsf allocator: " << result.nsPerOperation << " ns per operation" << std::endl;
+    return result;
+}
+
+void writeJsonString(std::ostream& stream, const std::string& text)
+{
+    stream << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            stream << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            stream << ' ';
+        }
+        else
+        {
+            stream << c;
+        }
+    }
+    stream << '"';
+}
+
+// one object per line in the arrays, so results diff well between commits
+void writeJson(
+    std::ostream& stream,
+    const BenchmarkOptions& options,
+    std::span<const SceneResult> scenes,
+    const AllocatorResult& allocator
+)
+{
+    stream << "{\n  \"label\": ";
+    writeJsonString(stream, options.label);
+    stream << ",\n  \"imageSize\": " << options.imageSize
+        << ",\n  \"repeats\": " << options.repeats
+        << ",\n  \"buildThreads\": " << std::max(1u, std::thread::hardware_concurrency())
+        << ",\n  \"avx2\": " << (cpuSupportsAvx2() ? "true" : "false")
+        << ",\n  \"avx512\": " << (cpuSupportsAvx512() ? "true" : "false")
+        << ",\n  \"scenes\": [";
+
+    for (size_t sceneIndex = 0; sceneIndex < scenes.size(); ++sceneIndex)
+    {
+        const SceneResult& scene = scenes[sceneIndex];
+        stream << (sceneIndex == 0 ? "" : ",") << "\n    {\n      \"name\": ";
+        writeJsonString(stream, scene.name);
+        stream << ",\n      \"triangles\": " << scene.triangleCount << ",\n      \"builds\": [";
+        for (size_t i = 0; i < scene.builds.size(); ++i)
+        {
+            const BuildResult& build = scene.builds[i];
+            stream << (i == 0 ? "" : ",") << "\n        {\"builder\": \"" << preferenceName(build.preference) << "\""
+                << ", \"buildMs\": " << build.buildTimeMs
+                << ", \"sahCost\": " << build.stats.sahCost
+                << ", \"nodes\": " << build.stats.nodeCount
+                << ", \"references\": " << build.stats.referenceCount
+                << ", \"maxDepth\": " << build.stats.maxDepth
+                << ", \"bytesPerTriangle\": " << build.bytesPerTriangle
+                << ", \"compressedBytesPerTriangle\": " << build.compressedBytesPerTriangle
+                << ", \"compressedRaysPerSecond\": {";
+            for (size_t k = 0; k < build.compressedRays.size(); ++k)
+            {
+                const RayResult& rays = build.compressedRays[k];
+                stream << (k == 0 ? "" : ", ") << "\"" << traceKernelName(rays.kernel) << "\": "
+                    << static_cast<uint64_t>(rays.raysPerSecond);
+            }
+            stream << "}}";
+        }
+        stream << "\n      ],\n      \"rays\": [";
+        for (size_t i = 0; i < scene.rays.size(); ++i)
+        {
+            const RayResult& rays = scene.rays[i];
+            stream << (i == 0 ? "" : ",") << "\n        {\"builder\": \"" << preferenceName(rays.preference) << "\""
+                << ", \"kernel\": \"" << traceKernelName(rays.kernel) << "\""
+                << ", \"width\": " << packetWidth(rays.kernel)
+                << ", \"type\": \"" << rayTypeName(rays.type) << "\""
+                << ", \"rays\": " << rays.rayCount
+                << ", \"hits\": " << rays.hitCount
+                << ", \"raysPerSecond\": " << static_cast<uint64_t>(rays.raysPerSecond);
+            if (rays.traversal.rayCount != 0)
+            {
+                stream << ", \"nodesPerRay\": " << rays.traversal.nodesPerRay()
+                    << ", \"trianglesPerRay\": " << rays.traversal.trianglesPerRay()
+                    << ", \"maxStackDepth\": " << rays.traversal.maxStackDepth;
+            }
+            stream << "}";
+        }
+        stream << "\n      ]\n    }";
+    }
+    stream << "\n  ],\n  \"allocator\": {\"operations\": " << allocator.operations
+        << ", \"nsPerOperation\": " << allocator.nsPerOperation
+        << ", \"failedAllocations\": " << allocator.failedAllocations
+        << ", \"liveAllocations\": " << allocator.liveAllocations
+        << ", \"fragmentation\": " << allocator.fragmentation << "}\n}\n";
+}
+
+BenchmarkOptions parseOptions(int argc, char* argv[])
+{
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--output" && hasValue)
+        {
+            options.outputPath = argv[++i];
+        }
+        else if (argument == "--label" && hasValue)
+        {
+            options.label = argv[++i];
+        }
+        else if (argument == "--repeats" && hasValue)
+        {
+            options.repeats = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (argument == "--image-size" && hasValue)
+        {
+            // a multiple of the 4x4 packet block
+            options.imageSize = (std::max(4, std::stoi(argv[++i])) + 3) / 4 * 4;
+        }
+        else if (argument == "--quick")
+        {
+            options.quick = true;
+        }
+        else if (argument.starts_with("--"))
+        {
+            throw std::runtime_error("Unknown benchmark option: " + argument + ".");
+        }
+        else
+        {
+            options.meshPaths.emplace_back(argument);
+        }
+    }
+    return options;
+}
+}
+
+// dxr-benchmark [--output results.json] [--label name] [--repeats n] [--image-size n] [--quick] [mesh.obj|.glb ...]
+// builds every scene with each builder, then traces primary, incoherent and shadow rays with each kernel the
+// CPU supports and primary rays once more through the compressed BLAS, and times the TLSF heap allocator on
+// its own. progress goes to stderr, the JSON results to stdout or the output file
+int main(int argc, char* argv[])
+{
+    try
+    {
+        BenchmarkOptions options = parseOptions(argc, argv);
+
+        std::vector<SceneResult> results;
+        for (const BenchmarkScene& scene : createScenes(options))
+        {
+            results.push_back(benchmarkScene(scene, options));
+        }
+        AllocatorResult allocator = benchmarkAllocator(options);
+
+        if (options.outputPath.empty())
+        {
+            writeJson(std::cout, options, results, allocator);
+        }
+        else
+        {
+            std::ofstream stream(options.outputPath, std::ios::trunc);
+            writeJson(stream, options, results, allocator);
+            if (!stream)
+            {
+                throw std::runtime_error("Failed to write benchmark results: " + options.outputPath.string());
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
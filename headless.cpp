@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CpuEngine.h"
+#include "ImageFile.h"
+#include "MeshLoader.h"
+#include "Profiler.h"
+#include "RunLoop.h"
+#include "SceneFile.h"
+
+namespace
+{
+struct HeadlessOptions
+{
+    std::filesystem::path scenePath; // .obj, .glb or .dxrs, empty renders the default triangle
+    uint32_t width = 800;
+    uint32_t height = 600;
+    uint32_t frames = 100;
+    uint32_t warmupFrames = 3; // rendered first and left out of the timings
+    double targetFrameRate = 0.0; // 0 renders back-to-back
+    CpuTraceKernel kernel = selectTraceKernel();
+    std::filesystem::path outputPath; // the last frame
+    std::filesystem::path goldenPath;
+    std::filesystem::path diffPath; // written when the golden comparison fails
+    std::filesystem::path tracePath;
+    std::filesystem::path writeScenePath; // packs the scene into a .dxrs file instead of rendering it
+    bool compress = false; // renders through the quantized BLAS, see CpuEngine::compressBlas
+    CpuRenderMode renderMode = CpuRenderMode::Shaded; // the heatmaps need a DXR_CPU_TRAVERSAL_STATS build
+    uint32_t heatmapScale = 0; // counter value shown as full red, 0 scales every frame to its own maximum
+    bool updateGolden = false; // writes the last frame as the golden image instead of comparing
+    uint32_t tolerance = 2; // per-channel difference a pixel may have
+    double maxDifferingFraction = 0.0; // pixels allowed past the tolerance
+};
+
+// exit codes, so scripts can tell a regression from a broken invocation
+constexpr int EXIT_GOLDEN_MISMATCH = 2;
+// a --kernel this CPU cannot run, ctest skips the golden tests of that kernel
+constexpr int EXIT_KERNEL_UNSUPPORTED = 3;
+
+struct UnsupportedKernelError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+CpuTraceKernel parseKernel(const std::string& name)
+{
+    for (CpuTraceKernel kernel : {CpuTraceKernel::Scalar, CpuTraceKernel::Avx2x8, CpuTraceKernel::Avx512x16})
+    {
+        if (name == traceKernelName(kernel))
+        {
+            if (!isTraceKernelSupported(kernel))
+            {
+                throw UnsupportedKernelError("Trace kernel is not supported by this CPU: " + name + ".");
+            }
+            return kernel;
+        }
+    }
+    throw std::runtime_error("Unknown trace kernel: " + name + ".");
+}
+
+CpuRenderMode parseRenderMode(const std::string& name)
+{
+    if (name == "shaded")
+    {
+        return CpuRenderMode::Shaded;
+    }
+    if (name == "nodes")
+    {
+        return CpuRenderMode::NodeHeatmap;
+    }
+    if (name == "triangles")
+    {
+        return CpuRenderMode::TriangleHeatmap;
+    }
+    if (name == "instances")
+    {
+        return CpuRenderMode::InstanceHeatmap;
+    }
+    if (name == "stack-depth")
+    {
+        return CpuRenderMode::StackDepthHeatmap;
+    }
+    throw std::runtime_error("Unknown render mode: " + name + ".");
+}
+
+HeadlessOptions parseOptions(int argc, char* argv[])
+{
+    HeadlessOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--width" && hasValue)
+        {
+            options.width = static_cast<uint32_t>(std::max(1, std::stoi(argv[++i])));
+        }
+        else if (argument == "--height" && hasValue)
+        {
+            options.height = static_cast<uint32_t>(std::max(1, std::stoi(argv[++i])));
+        }
+        else if (argument == "--frames" && hasValue)
+        {
+            options.frames = static_cast<uint32_t>(std::max(1, std::stoi(argv[++i])));
+        }
+        else if (argument == "--warmup" && hasValue)
+        {
+            options.warmupFrames = static_cast<uint32_t>(std::max(0, std::stoi(argv[++i])));
+        }
+        else if (argument == "--target-fps" && hasValue)
+        {
+            options.targetFrameRate = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if (argument == "--kernel" && hasValue)
+        {
+            options.kernel = parseKernel(argv[++i]);
+        }
+        else if (argument == "--output" && hasValue)
+        {
+            options.outputPath = argv[++i];
+        }
+        else if (argument == "--golden" && hasValue)
+        {
+            options.goldenPath = argv[++i];
+        }
+        else if (argument == "--diff" && hasValue)
+        {
+            options.diffPath = argv[++i];
+        }
+        else if (argument == "--trace" && hasValue)
+        {
+            options.tracePath = argv[++i];
+        }
+        else if (argument == "--render-mode" && hasValue)
+        {
+            options.renderMode = parseRenderMode(argv[++i]);
+        }
+        else if (argument == "--heatmap-scale" && hasValue)
+        {
+            options.heatmapScale = static_cast<uint32_t>(std::max(0, std::stoi(argv[++i])));
+        }
+        else if (argument == "--write-scene" && hasValue)
+        {
+            options.writeScenePath = argv[++i];
+        }
+        else if (argument == "--tolerance" && hasValue)
+        {
+            options.tolerance = static_cast<uint32_t>(std::max(0, std::stoi(argv[++i])));
+        }
+        else if (argument == "--max-differing" && hasValue)
+        {
+            options.maxDifferingFraction = std::stod(argv[++i]);
+        }
+        else if (argument == "--update-golden")
+        {
+            options.updateGolden = true;
+        }
+        else if (argument == "--compress")
+        {
+            options.compress = true;
+        }
+        else if (argument.starts_with("--"))
+        {
+            throw std::runtime_error("Unknown option: " + argument + ".");
+        }
+        else
+        {
+            options.scenePath = argument;
+        }
+    }
+
+    if (options.updateGolden && options.goldenPath.empty())
+    {
+        throw std::runtime_error("--update-golden needs --golden.");
+    }
+    if (!options.writeScenePath.empty() && options.scenePath.extension() == ".dxrs")
+    {
+        throw std::runtime_error("--write-scene needs an .obj or .glb scene.");
+    }
+    if (options.compress && options.scenePath.extension() == ".dxrs")
+    {
+        throw std::runtime_error("--compress needs an .obj or .glb scene, scene file BLASes are mapped as they are.");
+    }
+    return options;
+}
+
+Mesh loadMesh(const HeadlessOptions& options)
+{
+    if (options.scenePath.empty())
+    {
+        return Mesh::triangle();
+    }
+
+    ProfileScope scope("loadMesh");
+    MeshLoader loader;
+    Mesh mesh = loader.load(options.scenePath);
+    std::cout << "Loaded " << options.scenePath.string() << ": " << loader.stats().triangleCount
+        << " triangles in " << loader.stats().loadTimeMs << " ms" << std::endl;
+    return mesh;
+}
+
+// one instance with the fit CpuEngine gives a mesh, so the scene file renders the same frame as the mesh
+void writeScene(const HeadlessOptions& options)
+{
+    Mesh mesh = loadMesh(options);
+    SceneInstance instance = {};
+    mesh.fitTransform(instance.transform);
+    writeSceneFile(options.writeScenePath, std::span(&mesh, 1), std::span(&instance, 1));
+    std::cout << "Wrote " << options.writeScenePath.string() << ": " << mesh.triangleCount() << " triangles, "
+        << std::filesystem::file_size(options.writeScenePath) / 1024 << " KB" << std::endl;
+}
+
+std::unique_ptr<CpuEngine> createEngine(const HeadlessOptions& options)
+{
+    if (options.scenePath.extension() == ".dxrs")
+    {
+        return std::make_unique<CpuEngine>(options.width, options.height, std::make_unique<SceneFile>(options.scenePath));
+    }
+    return std::make_unique<CpuEngine>(options.width, options.height, loadMesh(options));
+}
+
+// the traversal counters of the last frame, in total and as nodes per ray of every tile laid out like the image
+void printTraversalStats(const CpuEngine& engine)
+{
+    const CpuTraversalTotals& totals = engine.traversalStats();
+    std::cout << "Traversal: " << totals.rayCount << " rays, " << totals.nodesPerRay() << " nodes and "
+        << totals.trianglesPerRay() << " triangles per ray, " << totals.instanceTransitions
+        << " instance transitions, max stack depth " << totals.maxStackDepth << std::endl;
+
+    std::span<const CpuTraversalTotals> tiles = engine.tileTraversalStats();
+    uint32_t gridWidth = engine.tileGridWidth();
+    std::cout << "Nodes per ray by tile, " << gridWidth << "x" << tiles.size() / gridWidth << " tiles:" << std::endl;
+    std::ostringstream grid;
+    grid << std::fixed << std::setprecision(1);
+    for (size_t tile = 0; tile < tiles.size(); ++tile)
+    {
+        grid << std::setw(7) << tiles[tile].nodesPerRay() << ((tile + 1) % gridWidth == 0 ? "\n" : "");
+    }
+    std::cout << grid.str() << std::flush;
+}
+
+// true when the last frame matches the golden image, or there is none to compare against
+bool checkGolden(const HeadlessOptions& options, const Image& frame)
+{
+    if (options.goldenPath.empty())
+    {
+        return true;
+    }
+    if (options.updateGolden)
+    {
+        writeImage(options.goldenPath, frame.width, frame.height, frame.pixels);
+        std::cout << "Updated golden image " << options.goldenPath.string() << std::endl;
+        return true;
+    }
+
+    Image golden = readImage(options.goldenPath);
+    if (golden.width != frame.width || golden.height != frame.height)
+    {
+        std::cout << "Golden image is " << golden.width << "x" << golden.height << ", the frame is "
+            << frame.width << "x" << frame.height << std::endl;
+        return false;
+    }
+
+    ImageComparison comparison = compareImages(frame, golden, options.tolerance);
+    bool match = comparison.differingFraction <= options.maxDifferingFraction;
+    std::cout << "Golden image " << (match ? "matches" : "MISMATCH") << ": " << comparison.differingPixels
+        << " pixels (" << comparison.differingFraction * 100.0 << "%) differ by more than " << options.tolerance
+        << ", max difference " << comparison.maxDifference << std::endl;
+    if (!match && !options.diffPath.empty())
+    {
+        Image difference = differenceImage(frame, golden);
+        writeImage(options.diffPath, difference.width, difference.height, difference.pixels);
+        std::cout << "Wrote difference image " << options.diffPath.string() << std::endl;
+    }
+    return match;
+}
+}
+
+// dxr-headless [--width w] [--height h] [--frames n] [--warmup n] [--target-fps f] [--kernel scalar|avx2x8|avx512x16]
+//     [--output frame.ppm] [--golden golden.ppm [--update-golden] [--tolerance t] [--max-differing f] [--diff diff.ppm]]
+//     [--trace trace.json] [--compress] [--render-mode shaded|nodes|triangles|instances|stack-depth [--heatmap-scale n]]
+//     [scene.obj|.glb|.dxrs]
+// dxr-headless --write-scene scene.dxrs [scene.obj|.glb]
+// renders offscreen with the CPU backend and reports frame time percentiles and rays/sec. exits with 2 when the
+// last frame does not match the golden image, and with 3 when the CPU cannot run the requested kernel.
+// --compress traces a quantized copy of the mesh BVH, which the packet kernels trace one lane at a time.
+// a DXR_CPU_TRAVERSAL_STATS build prints the traversal counters of the last frame, and only such a build
+// renders the heatmaps of --render-mode.
+// --write-scene packs the mesh and its prebuilt BVH into a scene file and renders nothing
+int main(int argc, char* argv[])
+{
+    try
+    {
+        HeadlessOptions options = parseOptions(argc, argv);
+        if (!options.writeScenePath.empty())
+        {
+            writeScene(options);
+            return 0;
+        }
+        if (!options.tracePath.empty())
+        {
+            Profiler::instance().setEnabled(true);
+        }
+
+        std::unique_ptr<CpuEngine> engine = createEngine(options);
+        engine->setTraceKernel(options.kernel);
+        engine->setRenderMode(options.renderMode, options.heatmapScale);
+        if (options.compress)
+        {
+            size_t uncompressed = engine->blasMemoryUsage();
+            size_t saved = engine->compressBlas();
+            std::cout << "Compressed BLAS from " << uncompressed << " to " << uncompressed - saved << " bytes" << std::endl;
+        }
+
+        NullEventSource events;
+        if (options.warmupFrames != 0)
+        {
+            RunLoop warmup(*engine, events, {.maxFrames = options.warmupFrames});
+            warmup.run();
+        }
+
+        // the statistics window covers every measured frame
+        RunLoop loop(*engine, events, {
+            .targetFrameRate = options.targetFrameRate,
+            .maxFrames = options.frames,
+            .statsWindow = options.frames
+        });
+        loop.run();
+        FrameTimeStats frameStats = loop.stats();
+        // one primary ray per pixel, the shaders trace nothing else
+        double rayCount = static_cast<double>(options.width) * options.height * options.frames;
+        double renderMs = frameStats.avgMs * static_cast<double>(frameStats.frameCount);
+
+        std::cout << options.frames << " frames at " << options.width << "x" << options.height << " with "
+            << traceKernelName(engine->traceKernel()) << " on " << engine->dispatchStats().workers.size() << " threads" << std::endl;
+        std::cout << "Frame time ms: min " << frameStats.minMs
+            << ", p50 " << frameStats.p50Ms
+            << ", p90 " << frameStats.p90Ms
+            << ", p99 " << frameStats.p99Ms
+            << ", max " << frameStats.maxMs
+            << ", mean " << frameStats.avgMs << ", " << frameStats.framesPerSecond << " fps" << std::endl;
+        std::cout << "Rays/sec: " << rayCount / (renderMs / 1000.0) / 1e6 << " M" << std::endl;
+        if constexpr (CPU_TRAVERSAL_STATS_ENABLED)
+        {
+            printTraversalStats(*engine);
+        }
+
+        Image frame = {
+            .width = engine->width(),
+            .height = engine->height(),
+            .pixels = engine->output()
+        };
+        if (!options.outputPath.empty())
+        {
+            writeImage(options.outputPath, frame.width, frame.height, frame.pixels);
+            std::cout << "Wrote " << options.outputPath.string() << std::endl;
+        }
+        bool match = checkGolden(options, frame);
+
+        engine->cleanup();
+        if (!options.tracePath.empty())
+        {
+            Profiler::instance().writeChromeTrace(options.tracePath);
+            std::cout << "Wrote trace with " << Profiler::instance().stats().eventCount << " events to "
+                << options.tracePath.string() << std::endl;
+        }
+
+        return match ? 0 : EXIT_GOLDEN_MISMATCH;
+    }
+    catch (const UnsupportedKernelError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_KERNEL_UNSUPPORTED;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
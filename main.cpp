@@ -1,14 +1,36 @@
+#include <string_view>
+#include <vector>
+
 #include "Application.h"
 
-int main()
+int main(int argc, char* argv[])
 {
-    Application app;
+    // [--animate] then an optional .obj or .glb to render instead of the triangle, then an optional Chrome
+    // trace (.json) to write
+    bool animate = false;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string_view(argv[i]) == "--animate")
+        {
+            animate = true;
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    Application app(paths.size() > 0 ? paths[0] : "", paths.size() > 1 ? paths[1] : "", animate);
     if (app.createWindow() != 0)
     {
         return -1;
     }
 
-    app.run();
+    // frame statistics once a second
+    app.run({
+        .printIntervalSeconds = 1.0
+    });
 
     return 0;
-}
\ No newline at end of file
+}
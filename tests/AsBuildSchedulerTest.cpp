@@ -0,0 +1,200 @@
+#include "AsBuildScheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ScratchAllocator.h"
+#include "Test.h"
+
+namespace
+{
+constexpr AsBuildSchedulerOptions RANDOM_OPTIONS = {
+    .scratchBudget = 4ull << 20,
+    .resultBudget = 16ull << 20
+};
+
+// mostly small BLASes, a few close to a budget and now and then one over it, with unaligned scratch sizes
+std::vector<AsBuildRequest> randomRequests(uint32_t seed, uint32_t count)
+{
+    std::mt19937_64 random(seed);
+    std::vector<AsBuildRequest> requests;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint64_t scale = random() % 16 == 0 ? 8ull << 20 : 512ull << 10;
+        AsBuildRequest request = {
+            .scratchSize = random() % scale,
+            .resultSize = random() % (4 * scale)
+        };
+        request.compactedSize = random() % 2 == 0 ? request.resultSize / 2 : 0;
+        requests.push_back(request);
+    }
+    return requests;
+}
+
+uint64_t alignedScratch(const AsBuildRequest& request)
+{
+    uint64_t size = std::max<uint64_t>(request.scratchSize, 1);
+    return (size + SCRATCH_ALIGNMENT - 1) / SCRATCH_ALIGNMENT * SCRATCH_ALIGNMENT;
+}
+
+bool oversized(const AsBuildRequest& request, const AsBuildSchedulerOptions& options)
+{
+    return alignedScratch(request) > options.scratchBudget || request.resultSize > options.resultBudget;
+}
+
+// runs check on the plans of many random scenes, a failure names the seed
+template <typename Check>
+void forRandomPlans(Check check)
+{
+    for (uint32_t seed = 1; seed <= 100; ++seed)
+    {
+        std::vector<AsBuildRequest> requests = randomRequests(seed, 1 + seed * 5);
+        AsBuildPlan plan = AsBuildScheduler(RANDOM_OPTIONS).plan(requests);
+        try
+        {
+            check(requests, plan);
+        }
+        catch (const TestFailure& failure)
+        {
+            throw TestFailure("seed " + std::to_string(seed) + ": " + failure.what());
+        }
+    }
+}
+}
+
+TEST(everyRequestLandsInExactlyOneBatch)
+{
+    forRandomPlans([](const std::vector<AsBuildRequest>& requests, const AsBuildPlan& plan) {
+        std::vector<uint32_t> placements(requests.size(), 0);
+        for (const AsBuildBatch& batch : plan.batches)
+        {
+            CHECK(!batch.requests.empty());
+            for (uint32_t request : batch.requests)
+            {
+                CHECK(request < requests.size());
+                placements[request]++;
+            }
+        }
+        for (uint32_t count : placements)
+        {
+            CHECK_EQ(count, 1u);
+        }
+    });
+
+    CHECK(AsBuildScheduler().plan({}).batches.empty());
+}
+
+TEST(budgetsHoldInEveryBatch)
+{
+    forRandomPlans([](const std::vector<AsBuildRequest>& requests, const AsBuildPlan& plan) {
+        for (const AsBuildBatch& batch : plan.batches)
+        {
+            uint64_t scratchSize = 0;
+            uint64_t resultSize = 0;
+            for (uint32_t request : batch.requests)
+            {
+                scratchSize += alignedScratch(requests[request]);
+                resultSize += requests[request].resultSize;
+            }
+            // the batch reports what its requests add up to
+            CHECK_EQ(batch.scratchSize, scratchSize);
+            CHECK_EQ(batch.resultSize, resultSize);
+            if (batch.requests.size() > 1)
+            {
+                CHECK(scratchSize <= RANDOM_OPTIONS.scratchBudget);
+                CHECK(resultSize <= RANDOM_OPTIONS.resultBudget);
+            }
+        }
+    });
+}
+
+TEST(oversizedRequestsGetABatchOfTheirOwn)
+{
+    AsBuildSchedulerOptions options = {
+        .scratchBudget = 4096,
+        .resultBudget = 8192
+    };
+    std::vector<AsBuildRequest> requests = {
+        {.scratchSize = 256, .resultSize = 1024},
+        {.scratchSize = 4097, .resultSize = 16}, // over the scratch budget once aligned
+        {.scratchSize = 256, .resultSize = 1024},
+        {.scratchSize = 16, .resultSize = 8193}, // over the result budget
+        {.scratchSize = 4096, .resultSize = 8192} // exactly both budgets still fits alone
+    };
+    AsBuildPlan plan = AsBuildScheduler(options).plan(requests);
+
+    CHECK_EQ(plan.stats.oversizedCount, 2u);
+    for (const AsBuildBatch& batch : plan.batches)
+    {
+        for (uint32_t request : batch.requests)
+        {
+            if (oversized(requests[request], options) || request == 4)
+            {
+                CHECK_EQ(batch.requests.size(), 1u);
+            }
+        }
+    }
+    // the two small requests share the one remaining batch
+    CHECK_EQ(plan.stats.batchCount, 4u);
+    CHECK_EQ(plan.stats.scratchCapacity, 4352u);
+
+    forRandomPlans([](const std::vector<AsBuildRequest>& randomRequests, const AsBuildPlan& randomPlan) {
+        uint32_t oversizedCount = 0;
+        for (const AsBuildBatch& batch : randomPlan.batches)
+        {
+            for (uint32_t request : batch.requests)
+            {
+                if (oversized(randomRequests[request], RANDOM_OPTIONS))
+                {
+                    oversizedCount++;
+                    CHECK_EQ(batch.requests.size(), 1u);
+                }
+            }
+        }
+        CHECK_EQ(randomPlan.stats.oversizedCount, oversizedCount);
+    });
+}
+
+TEST(statsMatchAHandPlannedScene)
+{
+    // shares of the tighter budget 0.6, 0.5, 0.4 and 0.3, so first-fit decreasing places them in order:
+    // 0 and 1 exceed the result budget together, 2 joins 0, 3 no longer fits next to 0 and 2 and joins 1
+    std::vector<AsBuildRequest> requests = {
+        {.scratchSize = 512, .resultSize = 600, .compactedSize = 300},
+        {.scratchSize = 512, .resultSize = 500, .compactedSize = 200},
+        {.scratchSize = 200, .resultSize = 400, .compactedSize = 100},
+        {.scratchSize = 256, .resultSize = 300} // unknown compacted size, planned as the result size
+    };
+    AsBuildSchedulerOptions options = {
+        .scratchBudget = 1024,
+        .resultBudget = 1000
+    };
+    AsBuildPlan plan = AsBuildScheduler(options).plan(requests);
+
+    CHECK_EQ(plan.stats.batchCount, 2u);
+    CHECK_EQ(plan.stats.oversizedCount, 0u);
+    CHECK(plan.batches[0].requests == std::vector<uint32_t>({0, 2}));
+    CHECK(plan.batches[1].requests == std::vector<uint32_t>({1, 3}));
+    CHECK_EQ(plan.batches[0].scratchSize, 768u);
+    CHECK_EQ(plan.batches[0].compactedSize, 400u);
+    CHECK_EQ(plan.batches[1].compactedSize, 500u);
+    CHECK_EQ(plan.stats.scratchCapacity, 768u);
+    CHECK_EQ(plan.stats.retainedSize, 900u);
+    // the second batch's compaction: 400 retained from the first, 800 originals and 500 copies, plus scratch
+    CHECK_EQ(plan.stats.peakMemory, 768u + 1700u);
+
+    // without compaction every result stays, the peak is after the last batch
+    options.compact = false;
+    AsBuildPlan uncompacted = AsBuildScheduler(options).plan(requests);
+    CHECK_EQ(uncompacted.stats.batchCount, 2u);
+    CHECK_EQ(uncompacted.stats.retainedSize, 1800u);
+    CHECK_EQ(uncompacted.stats.peakMemory, 768u + 1800u);
+}
+
+int main()
+{
+    return runTests();
+}
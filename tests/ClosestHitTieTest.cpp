@@ -0,0 +1,200 @@
+#include "CpuPacket.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Test.h"
+
+namespace
+{
+// an 8x8 grid of quads in the z = 0 plane over [-1, 1], two triangles per quad
+struct GridMesh
+{
+    std::vector<Float3> vertices;
+    std::vector<uint32_t> indices;
+
+    GridMesh()
+    {
+        constexpr uint32_t CELLS = 8;
+        for (uint32_t y = 0; y <= CELLS; ++y)
+        {
+            for (uint32_t x = 0; x <= CELLS; ++x)
+            {
+                vertices.push_back({-1.0f + 0.25f * static_cast<float>(x), -1.0f + 0.25f * static_cast<float>(y), 0.0f});
+            }
+        }
+        for (uint32_t y = 0; y < CELLS; ++y)
+        {
+            for (uint32_t x = 0; x < CELLS; ++x)
+            {
+                uint32_t corner = y * (CELLS + 1) + x;
+                indices.insert(indices.end(), {corner, corner + 1, corner + CELLS + 2});
+                indices.insert(indices.end(), {corner, corner + CELLS + 2, corner + CELLS + 1});
+            }
+        }
+    }
+};
+
+CpuGeometryDesc geometryDesc(const std::vector<Float3>& vertices, const std::vector<uint32_t>& indices)
+{
+    return {
+        .indexFormat = CpuIndexFormat::Uint32,
+        .indexCount = static_cast<uint32_t>(indices.size()),
+        .vertexCount = static_cast<uint32_t>(vertices.size()),
+        .indexBuffer = indices.data(),
+        .vertexBuffer = vertices.data(),
+        .vertexStrideInBytes = sizeof(Float3)
+    };
+}
+
+CpuInstanceDesc identityInstance(const CpuBlas& blas)
+{
+    return {
+        .transform = {
+            {1.0f, 0.0f, 0.0f, 0.0f},
+            {0.0f, 1.0f, 0.0f, 0.0f},
+            {0.0f, 0.0f, 1.0f, 0.0f}
+        },
+        .instanceID = 0,
+        .instanceMask = 0xFF,
+        .instanceContributionToHitGroupIndex = 0,
+        .flags = CPU_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE,
+        .accelerationStructure = &blas
+    };
+}
+
+// rays along +z through a 32x32 lattice over [-1, 1], a quarter of them cross the diagonal edge two triangles
+// of the grid share exactly and hit both at the same t. the lattice is off the grid lines: a ray in the plane
+// of a box face gets a NaN slab, and whether that box counts as hit depends on its bounds, so a compressed
+// BVH would see different triangles there
+std::vector<CpuRay> latticeRays()
+{
+    std::vector<CpuRay> rays;
+    for (uint32_t y = 0; y < 32; ++y)
+    {
+        for (uint32_t x = 0; x < 32; ++x)
+        {
+            rays.push_back({
+                .origin = {-0.96875f + 0.0625f * static_cast<float>(x), -0.96875f + 0.0625f * static_cast<float>(y), -2.0f},
+                .tMin = 0.0f,
+                .direction = {0.0f, 0.0f, 1.0f},
+                .tMax = 100.0f
+            });
+        }
+    }
+    return rays;
+}
+
+std::vector<CpuHit> traceAll(CpuTraceKernel kernel, const CpuTlas& tlas, const std::vector<CpuRay>& rays)
+{
+    uint32_t width = packetWidth(kernel);
+    std::vector<CpuHit> hits;
+    for (size_t first = 0; first < rays.size(); first += width)
+    {
+        CpuRayPacket packet = {};
+        uint32_t activeMask = 0;
+        for (uint32_t lane = 0; lane < width && first + lane < rays.size(); ++lane)
+        {
+            packet.set(lane, rays[first + lane]);
+            activeMask |= 1u << lane;
+        }
+        CpuHitPacket hitPacket;
+        traceRayPacket(kernel, tlas, packet, activeMask, CPU_RAY_FLAG_NONE, 0xFF, hitPacket);
+        for (uint32_t lane = 0; lane < width && first + lane < rays.size(); ++lane)
+        {
+            hits.push_back(hitPacket.get(lane));
+        }
+    }
+    return hits;
+}
+
+std::vector<CpuTraceKernel> supportedKernels()
+{
+    std::vector<CpuTraceKernel> kernels;
+    for (CpuTraceKernel kernel : {CpuTraceKernel::Scalar, CpuTraceKernel::Avx2x8, CpuTraceKernel::Avx512x16})
+    {
+        if (isTraceKernelSupported(kernel))
+        {
+            kernels.push_back(kernel);
+        }
+    }
+    return kernels;
+}
+}
+
+TEST(coincidentHitsGoToTheLowestIndex)
+{
+    // the same triangle four times in each of two geometries, and the BLAS instanced three times in place:
+    // every hit ties with eleven others
+    std::vector<Float3> vertices = {{-1.0f, -1.0f, 0.0f}, {1.0f, -1.0f, 0.0f}, {0.0f, 1.0f, 0.0f}};
+    std::vector<uint32_t> indices = {0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2};
+    CpuGeometryDesc geometries[] = {geometryDesc(vertices, indices), geometryDesc(vertices, indices)};
+    CpuBlas blas(geometries);
+    std::vector<CpuInstanceDesc> instances(3, identityInstance(blas));
+    CpuTlas tlas(instances);
+
+    std::vector<CpuRay> rays = latticeRays();
+    for (CpuTraceKernel kernel : supportedKernels())
+    {
+        std::vector<CpuHit> hits = traceAll(kernel, tlas, rays);
+        uint32_t hitCount = 0;
+        for (const CpuHit& hit : hits)
+        {
+            if (!hit.hasHit())
+            {
+                continue;
+            }
+            hitCount++;
+            CHECK_EQ(hit.instanceIndex, 0u);
+            CHECK_EQ(hit.geometryIndex, 0u);
+            CHECK_EQ(hit.primitiveIndex, 0u);
+        }
+        CHECK(hitCount > 0);
+    }
+}
+
+TEST(everyKernelResolvesSharedEdgesLikeTheScalarPath)
+{
+    GridMesh mesh;
+    CpuGeometryDesc geometry = geometryDesc(mesh.vertices, mesh.indices);
+    std::vector<CpuRay> rays = latticeRays();
+
+    // small leaves and a compressed BVH visit the triangles in other orders than the default build
+    for (uint32_t maxLeafSize : {1u, 4u})
+    {
+        CpuBlas blas(std::span(&geometry, 1), {.maxLeafSize = maxLeafSize});
+        std::vector<CpuInstanceDesc> instances(2, identityInstance(blas));
+        CpuTlas tlas(instances);
+        std::vector<CpuHit> reference = traceAll(CpuTraceKernel::Scalar, tlas, rays);
+
+        CpuBlas compressed(std::span(&geometry, 1), {.maxLeafSize = maxLeafSize});
+        compressed.compress();
+        std::vector<CpuInstanceDesc> compressedInstances(2, identityInstance(compressed));
+        CpuTlas compressedTlas(compressedInstances);
+        std::vector<std::vector<CpuHit>> results = {traceAll(CpuTraceKernel::Scalar, compressedTlas, rays)};
+        for (CpuTraceKernel kernel : supportedKernels())
+        {
+            results.push_back(traceAll(kernel, tlas, rays));
+        }
+
+        for (const std::vector<CpuHit>& hits : results)
+        {
+            for (size_t i = 0; i < rays.size(); ++i)
+            {
+                CHECK(reference[i].hasHit());
+                CHECK_EQ(hits[i].t, reference[i].t);
+                CHECK_EQ(hits[i].instanceIndex, 0u);
+                CHECK_EQ(hits[i].primitiveIndex, reference[i].primitiveIndex);
+                CHECK_EQ(hits[i].barycentrics.x, reference[i].barycentrics.x);
+                CHECK_EQ(hits[i].barycentrics.y, reference[i].barycentrics.y);
+            }
+        }
+    }
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,224 @@
+#include "CommandRecorder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "FakeCommandListDevice.h"
+#include "Test.h"
+
+namespace
+{
+// completes fence values only when the test says so, the allocator pool sees exactly what the test set up
+class ManualFrameQueue : public FrameQueue
+{
+public:
+    void signal(uint64_t) override
+    {
+    }
+
+    uint64_t completedValue() const override
+    {
+        return m_completedValue;
+    }
+
+    void wait(uint64_t value) override
+    {
+        if (value > m_completedValue)
+        {
+            throw std::logic_error("Waiting for a value the test never completes.");
+        }
+    }
+
+    void complete(uint64_t value)
+    {
+        m_completedValue = value;
+    }
+
+private:
+    uint64_t m_completedValue = 0;
+};
+
+uint32_t addRecordingJob(CommandRecorder& recorder, FakeCommandListDevice& device, std::string command)
+{
+    return recorder.addJob("job", [&device, command](const CommandJobContext& context) {
+        device.record(context.commandList, command);
+    });
+}
+
+size_t countEvents(const FakeCommandListDevice& device, FakeCommandEventType type)
+{
+    std::vector<FakeCommandEvent> events = device.events();
+    return std::count_if(events.begin(), events.end(), [type](const FakeCommandEvent& event) {
+        return event.type == type;
+    });
+}
+
+// every list that was begun was closed again
+void checkNoOpenLists(const FakeCommandListDevice& device)
+{
+    CHECK_EQ(countEvents(device, FakeCommandEventType::Begin), countEvents(device, FakeCommandEventType::Close));
+}
+}
+
+TEST(submissionFollowsTheDependencyOrder)
+{
+    // a diamond with a tail, and an independent job: a -> b, a -> c, b -> d, c -> d, d -> e, f
+    for (int run = 0; run < 20; ++run)
+    {
+        FakeCommandListDevice device;
+        ManualFrameQueue queue;
+        CommandRecorder recorder(device, queue, 4);
+        std::vector<uint32_t> jobs;
+        for (const char* command : {"a", "b", "c", "d", "e", "f"})
+        {
+            jobs.push_back(addRecordingJob(recorder, device, command));
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> dependencies = {{1, 0}, {2, 0}, {3, 1}, {3, 2}, {4, 3}};
+        for (auto [job, dependency] : dependencies)
+        {
+            recorder.addDependency(jobs[job], jobs[dependency]);
+        }
+        recorder.submit(1);
+
+        // the lists run in an order where every dependency comes first
+        std::vector<std::string> executed = device.executedCommands();
+        CHECK_EQ(executed.size(), 6u);
+        auto position = [&](uint32_t job) {
+            return std::find(executed.begin(), executed.end(), std::string(1, static_cast<char>('a' + job))) - executed.begin();
+        };
+        for (auto [job, dependency] : dependencies)
+        {
+            CHECK(position(dependency) < position(job));
+        }
+        CHECK_EQ(recorder.submissionOrder().size(), 6u);
+        for (size_t i = 0; i < executed.size(); ++i)
+        {
+            CHECK_EQ(executed[i], std::string(1, static_cast<char>('a' + recorder.submissionOrder()[i])));
+        }
+
+        // and a job only began recording once its dependencies closed their lists
+        std::vector<FakeCommandEvent> events = device.events();
+        auto eventIndex = [&](FakeCommandEventType type, uint32_t job) {
+            return std::find_if(events.begin(), events.end(), [&](const FakeCommandEvent& event) {
+                return event.type == type && event.commandList == job;
+            }) - events.begin();
+        };
+        for (auto [job, dependency] : dependencies)
+        {
+            CHECK(eventIndex(FakeCommandEventType::Close, dependency) < eventIndex(FakeCommandEventType::Begin, job));
+        }
+    }
+}
+
+TEST(cyclesAreRejected)
+{
+    FakeCommandListDevice device;
+    ManualFrameQueue queue;
+    CommandRecorder recorder(device, queue, 2);
+    uint32_t a = addRecordingJob(recorder, device, "a");
+    uint32_t b = addRecordingJob(recorder, device, "b");
+    uint32_t c = addRecordingJob(recorder, device, "c");
+    addRecordingJob(recorder, device, "independent");
+    recorder.addDependency(b, a);
+    recorder.addDependency(c, b);
+    recorder.addDependency(a, c);
+    CHECK_THROWS(recorder.addDependency(a, 4), std::out_of_range);
+
+    CHECK_THROWS(recorder.submit(1), std::logic_error);
+    // rejected before anything was recorded
+    CHECK_EQ(countEvents(device, FakeCommandEventType::Begin), 0u);
+    CHECK_EQ(countEvents(device, FakeCommandEventType::Execute), 0u);
+    CHECK_EQ(recorder.stats().allocatorCount, 0u);
+
+    // the jobs were dropped, the recorder takes new ones
+    addRecordingJob(recorder, device, "next");
+    recorder.submit(1);
+    CHECK(device.executedCommands() == std::vector<std::string>({"next"}));
+}
+
+TEST(allocatorsAreReusedOnlyAfterTheirFenceCompletes)
+{
+    FakeCommandListDevice device;
+    ManualFrameQueue queue;
+    CommandRecorder recorder(device, queue, 2);
+    auto submitTwoJobs = [&](uint64_t fenceValue) {
+        addRecordingJob(recorder, device, "first");
+        addRecordingJob(recorder, device, "second");
+        recorder.submit(fenceValue);
+    };
+
+    submitTwoJobs(1);
+    CHECK_EQ(recorder.stats().allocatorCount, 2u);
+
+    // value 1 is still in flight, its two allocators must not be reset
+    submitTwoJobs(2);
+    CHECK_EQ(recorder.stats().allocatorCount, 4u);
+    CHECK_EQ(recorder.stats().allocatorReuseCount, 0u);
+    CHECK_EQ(countEvents(device, FakeCommandEventType::ResetAllocator), 0u);
+
+    // once it completes exactly those two come back, value 2's stay in use
+    queue.complete(1);
+    submitTwoJobs(3);
+    CHECK_EQ(recorder.stats().allocatorCount, 4u);
+    CHECK_EQ(recorder.stats().allocatorReuseCount, 2u);
+    std::vector<uint32_t> resetAllocators;
+    for (const FakeCommandEvent& event : device.events())
+    {
+        if (event.type == FakeCommandEventType::ResetAllocator)
+        {
+            resetAllocators.push_back(event.allocator);
+        }
+    }
+    std::sort(resetAllocators.begin(), resetAllocators.end());
+    CHECK(resetAllocators == std::vector<uint32_t>({0, 1}));
+
+    queue.complete(2);
+    submitTwoJobs(4);
+    CHECK_EQ(recorder.stats().allocatorCount, 4u);
+    CHECK_EQ(recorder.stats().allocatorReuseCount, 4u);
+
+    // a fence value that already completed could never protect the allocators
+    addRecordingJob(recorder, device, "late");
+    CHECK_THROWS(recorder.submit(2), std::invalid_argument);
+}
+
+TEST(aJobExceptionClosesTheListsAndPropagates)
+{
+    FakeCommandListDevice device;
+    ManualFrameQueue queue;
+    CommandRecorder recorder(device, queue, 3);
+    uint32_t failing = recorder.addJob("failing", [&device](const CommandJobContext& context) {
+        device.record(context.commandList, "half");
+        throw std::runtime_error("Recording failed.");
+    });
+    addRecordingJob(recorder, device, "b");
+    addRecordingJob(recorder, device, "c");
+    uint32_t dependent = addRecordingJob(recorder, device, "dependent");
+    recorder.addDependency(dependent, failing);
+
+    CHECK_THROWS(recorder.submit(1), std::runtime_error);
+    checkNoOpenLists(device);
+    CHECK_EQ(countEvents(device, FakeCommandEventType::Execute), 0u);
+    CHECK_EQ(recorder.stats().submitCount, 0u);
+    CHECK_EQ(recorder.stats().allocatorCount, 3u);
+
+    // value 1 is never signaled after the failure, the next submission still gets the same allocators
+    addRecordingJob(recorder, device, "x");
+    addRecordingJob(recorder, device, "y");
+    addRecordingJob(recorder, device, "z");
+    recorder.submit(1);
+    CHECK_EQ(recorder.stats().allocatorCount, 3u);
+    CHECK_EQ(recorder.stats().allocatorReuseCount, 3u);
+    checkNoOpenLists(device);
+    std::vector<std::string> executed = device.executedCommands();
+    std::sort(executed.begin(), executed.end());
+    CHECK(executed == std::vector<std::string>({"x", "y", "z"}));
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,123 @@
+#include "FakeCommandListDevice.h"
+
+#include <stdexcept>
+
+uint32_t FakeCommandListDevice::createAllocator()
+{
+    std::lock_guard lock(m_mutex);
+    uint32_t allocator = static_cast<uint32_t>(m_allocatorsOpen.size());
+    m_allocatorsOpen.push_back(false);
+    m_events.push_back({.type = FakeCommandEventType::CreateAllocator, .allocator = allocator, .thread = std::this_thread::get_id()});
+    return allocator;
+}
+
+void FakeCommandListDevice::resetAllocator(uint32_t allocator)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_allocatorsOpen.at(allocator))
+    {
+        throw std::logic_error("Resetting a command allocator with an open command list.");
+    }
+    m_events.push_back({.type = FakeCommandEventType::ResetAllocator, .allocator = allocator, .thread = std::this_thread::get_id()});
+}
+
+uint32_t FakeCommandListDevice::createCommandList()
+{
+    std::lock_guard lock(m_mutex);
+    uint32_t commandList = static_cast<uint32_t>(m_commandLists.size());
+    m_commandLists.emplace_back();
+    m_events.push_back({.type = FakeCommandEventType::CreateCommandList, .commandList = commandList, .thread = std::this_thread::get_id()});
+    return commandList;
+}
+
+void FakeCommandListDevice::beginCommandList(uint32_t commandList, uint32_t allocator)
+{
+    std::lock_guard lock(m_mutex);
+    CommandList& list = m_commandLists.at(commandList);
+    if (list.open)
+    {
+        throw std::logic_error("Beginning a command list that is already open.");
+    }
+    if (m_allocatorsOpen.at(allocator))
+    {
+        throw std::logic_error("Command allocator already has an open command list.");
+    }
+    list.open = true;
+    list.allocator = allocator;
+    list.commands.clear();
+    m_allocatorsOpen[allocator] = true;
+    m_events.push_back({
+        .type = FakeCommandEventType::Begin,
+        .allocator = allocator,
+        .commandList = commandList,
+        .thread = std::this_thread::get_id()
+    });
+}
+
+void FakeCommandListDevice::closeCommandList(uint32_t commandList)
+{
+    std::lock_guard lock(m_mutex);
+    CommandList& list = m_commandLists.at(commandList);
+    if (!list.open)
+    {
+        throw std::logic_error("Closing a command list that is not open.");
+    }
+    list.open = false;
+    m_allocatorsOpen[list.allocator] = false;
+    m_events.push_back({
+        .type = FakeCommandEventType::Close,
+        .allocator = list.allocator,
+        .commandList = commandList,
+        .thread = std::this_thread::get_id()
+    });
+}
+
+void FakeCommandListDevice::executeCommandLists(std::span<const uint32_t> commandLists)
+{
+    std::lock_guard lock(m_mutex);
+    for (uint32_t commandList : commandLists)
+    {
+        const CommandList& list = m_commandLists.at(commandList);
+        if (list.open)
+        {
+            throw std::logic_error("Executing a command list that is still open.");
+        }
+        m_executedCommands.insert(m_executedCommands.end(), list.commands.begin(), list.commands.end());
+        m_events.push_back({
+            .type = FakeCommandEventType::Execute,
+            .allocator = list.allocator,
+            .commandList = commandList,
+            .thread = std::this_thread::get_id()
+        });
+    }
+}
+
+void FakeCommandListDevice::record(uint32_t commandList, std::string command)
+{
+    std::lock_guard lock(m_mutex);
+    CommandList& list = m_commandLists.at(commandList);
+    if (!list.open)
+    {
+        throw std::logic_error("Recording into a command list that is not open.");
+    }
+    list.commands.push_back(command);
+    m_events.push_back({
+        .type = FakeCommandEventType::Record,
+        .allocator = list.allocator,
+        .commandList = commandList,
+        .thread = std::this_thread::get_id(),
+        .command = std::move(command)
+    });
+}
+
+std::vector<FakeCommandEvent> FakeCommandListDevice::events() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_events;
+}
+
+std::vector<std::string> FakeCommandListDevice::executedCommands() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_executedCommands;
+}
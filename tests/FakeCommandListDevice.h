@@ -0,0 +1,75 @@
+#ifndef FAKECOMMANDLISTDEVICE_H
+#define FAKECOMMANDLISTDEVICE_H
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CommandRecorder.h"
+
+enum class FakeCommandEventType
+{
+    CreateAllocator,
+    ResetAllocator,
+    CreateCommandList,
+    Begin,
+    Record,
+    Close,
+    Execute
+};
+
+struct FakeCommandEvent
+{
+    FakeCommandEventType type;
+    uint32_t allocator = 0;
+    uint32_t commandList = 0;
+    std::thread::id thread = {};
+    std::string command = {}; // Record only
+};
+
+// CommandListDevice without a device: lists are vectors of command strings. it throws on what the D3D12 debug
+// layer reports, a second open list on an allocator, resetting an allocator with an open list, recording into
+// or executing a list that is not in the right state
+class FakeCommandListDevice : public CommandListDevice
+{
+public:
+    FakeCommandListDevice() = default;
+
+    FakeCommandListDevice(const FakeCommandListDevice&) = delete;
+    FakeCommandListDevice& operator=(const FakeCommandListDevice&) = delete;
+
+    uint32_t createAllocator() override;
+    void resetAllocator(uint32_t allocator) override;
+    uint32_t createCommandList() override;
+    void beginCommandList(uint32_t commandList, uint32_t allocator) override;
+    void closeCommandList(uint32_t commandList) override;
+    void executeCommandLists(std::span<const uint32_t> commandLists) override;
+
+    // what a job records, commandList must be open
+    void record(uint32_t commandList, std::string command);
+
+    // every call in the order it happened, Execute has one event per list
+    std::vector<FakeCommandEvent> events() const;
+    // the commands of every executed list, in execution order
+    std::vector<std::string> executedCommands() const;
+
+private:
+    struct CommandList
+    {
+        bool open = false;
+        uint32_t allocator = 0;
+        std::vector<std::string> commands;
+    };
+
+    mutable std::mutex m_mutex;
+    // true while a list recorded into the allocator is open
+    std::vector<bool> m_allocatorsOpen;
+    std::vector<CommandList> m_commandLists;
+    std::vector<FakeCommandEvent> m_events;
+    std::vector<std::string> m_executedCommands;
+};
+
+#endif //FAKECOMMANDLISTDEVICE_H
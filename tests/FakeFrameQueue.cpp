@@ -0,0 +1,80 @@
+#include "FakeFrameQueue.h"
+
+#include <stdexcept>
+
+FakeFrameQueue::FakeFrameQueue(std::chrono::microseconds gpuTime)
+    : m_gpuTime(gpuTime)
+    , m_gpu(&FakeFrameQueue::gpuMain, this)
+{
+}
+
+FakeFrameQueue::~FakeFrameQueue()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_workCondition.notify_all();
+    m_gpu.join();
+}
+
+void FakeFrameQueue::signal(uint64_t value)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        if (value <= m_lastSignaledValue)
+        {
+            throw std::logic_error("Timeline fence values must increase.");
+        }
+        m_lastSignaledValue = value;
+        m_pending.push_back(value);
+        m_events.push_back({FakeQueueEventType::Signal, value});
+    }
+    m_workCondition.notify_one();
+}
+
+uint64_t FakeFrameQueue::completedValue() const
+{
+    return m_completedValue.load(std::memory_order_acquire);
+}
+
+void FakeFrameQueue::wait(uint64_t value)
+{
+    std::unique_lock lock(m_mutex);
+    if (value > m_lastSignaledValue)
+    {
+        // would never complete on a real queue either
+        throw std::logic_error("Waiting for a fence value that was never signaled.");
+    }
+    m_events.push_back({FakeQueueEventType::Wait, value});
+    m_completeCondition.wait(lock, [&] { return m_completedValue.load(std::memory_order_acquire) >= value; });
+}
+
+std::vector<FakeQueueEvent> FakeFrameQueue::events() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_events;
+}
+
+void FakeFrameQueue::gpuMain()
+{
+    std::unique_lock lock(m_mutex);
+    while (true)
+    {
+        m_workCondition.wait(lock, [&] { return m_shutdown || !m_pending.empty(); });
+        if (m_pending.empty())
+        {
+            return;
+        }
+
+        uint64_t value = m_pending.front();
+        lock.unlock();
+        std::this_thread::sleep_for(m_gpuTime);
+        lock.lock();
+
+        m_pending.pop_front();
+        m_completedValue.store(value, std::memory_order_release);
+        m_events.push_back({FakeQueueEventType::Complete, value});
+        m_completeCondition.notify_all();
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef FAKEFRAMEQUEUE_H
+#define FAKEFRAMEQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FramePacer.h"
+
+enum class FakeQueueEventType
+{
+    Signal,
+    Complete,
+    Wait
+};
+
+struct FakeQueueEvent
+{
+    FakeQueueEventType type;
+    uint64_t value;
+};
+
+// in-order GPU stand-in for FramePacer without a device: a worker thread completes each signaled value
+// gpuTime after the previous one finished, which is how a queue drains frames that take gpuTime each
+class FakeFrameQueue : public FrameQueue
+{
+public:
+    explicit FakeFrameQueue(std::chrono::microseconds gpuTime = {});
+    ~FakeFrameQueue() override;
+
+    FakeFrameQueue(const FakeFrameQueue&) = delete;
+    FakeFrameQueue& operator=(const FakeFrameQueue&) = delete;
+
+    // values must increase like on a timeline fence
+    void signal(uint64_t value) override;
+    uint64_t completedValue() const override;
+    void wait(uint64_t value) override;
+
+    // every signal, completion and blocking wait in the order they happened
+    std::vector<FakeQueueEvent> events() const;
+
+private:
+    void gpuMain();
+
+    std::chrono::microseconds m_gpuTime;
+    std::atomic<uint64_t> m_completedValue = 0;
+    uint64_t m_lastSignaledValue = 0;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workCondition;
+    std::condition_variable m_completeCondition;
+    std::deque<uint64_t> m_pending;
+    std::vector<FakeQueueEvent> m_events;
+    bool m_shutdown = false;
+
+    std::thread m_gpu;
+};
+
+#endif //FAKEFRAMEQUEUE_H
@@ -0,0 +1,168 @@
+#include "FramePacer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "FakeFrameQueue.h"
+#include "Test.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+std::vector<uint64_t> eventValues(const FakeFrameQueue& queue, FakeQueueEventType type)
+{
+    std::vector<uint64_t> values;
+    for (const FakeQueueEvent& event : queue.events())
+    {
+        if (event.type == type)
+        {
+            values.push_back(event.value);
+        }
+    }
+    return values;
+}
+}
+
+TEST(framesSignalOneIncreasingTimeline)
+{
+    FakeFrameQueue queue(1ms);
+    FramePacer pacer(queue, 3);
+
+    for (uint64_t frame = 0; frame < 10; ++frame)
+    {
+        CHECK_EQ(pacer.beginFrame(), frame % 3);
+        CHECK_EQ(pacer.endFrame(), frame + 1);
+        CHECK_EQ(pacer.lastSignaledValue(), frame + 1);
+    }
+    pacer.flush();
+
+    // every frame signals the next value, flush one more
+    std::vector<uint64_t> signals = eventValues(queue, FakeQueueEventType::Signal);
+    CHECK_EQ(signals.size(), 11u);
+    for (size_t i = 0; i < signals.size(); ++i)
+    {
+        CHECK_EQ(signals[i], i + 1);
+    }
+    // the queue completes them in order, and flush returns once the last one did
+    CHECK(eventValues(queue, FakeQueueEventType::Complete) == signals);
+    CHECK_EQ(queue.completedValue(), 11u);
+    CHECK_EQ(pacer.pendingFrames(), 0u);
+    CHECK_EQ(pacer.stats().frameCount, 10u);
+}
+
+TEST(waitsOnlyForTheFrameThatLastUsedTheSlot)
+{
+    FakeFrameQueue queue(5ms);
+    FramePacer pacer(queue, 2);
+
+    for (int frame = 0; frame < 6; ++frame)
+    {
+        pacer.beginFrame();
+        pacer.endFrame();
+    }
+
+    // the frame with value v reuses the slot of the frame with value v - 2, anything else would either
+    // overwrite an allocator the GPU still reads or stall for nothing
+    std::vector<FakeQueueEvent> events = queue.events();
+    uint64_t lastSignal = 0;
+    for (const FakeQueueEvent& event : events)
+    {
+        if (event.type == FakeQueueEventType::Signal)
+        {
+            lastSignal = event.value;
+        }
+        else if (event.type == FakeQueueEventType::Wait)
+        {
+            CHECK_EQ(event.value, lastSignal - 1);
+        }
+    }
+    pacer.flush();
+}
+
+TEST(stallsOnceTheQueueIsFramesInFlightDeep)
+{
+    // the GPU takes 20 ms a frame and the CPU records instantly, so the first framesInFlight frames queue
+    // up and every later one waits for the GPU
+    constexpr uint32_t FRAMES_IN_FLIGHT = 3;
+    constexpr uint64_t FRAME_COUNT = 8;
+    FakeFrameQueue queue(20ms);
+    FramePacer pacer(queue, FRAMES_IN_FLIGHT);
+
+    for (uint64_t frame = 0; frame < FRAME_COUNT; ++frame)
+    {
+        pacer.beginFrame();
+        // the slot's previous frame finished, so at most framesInFlight - 1 are still on the GPU
+        CHECK(pacer.pendingFrames() < FRAMES_IN_FLIGHT);
+        CHECK_EQ(pacer.stats().stallCount, frame < FRAMES_IN_FLIGHT ? 0 : frame - FRAMES_IN_FLIGHT + 1);
+        pacer.endFrame();
+        CHECK(pacer.pendingFrames() <= FRAMES_IN_FLIGHT);
+    }
+
+    CHECK_EQ(eventValues(queue, FakeQueueEventType::Wait).size(), FRAME_COUNT - FRAMES_IN_FLIGHT);
+    pacer.flush();
+}
+
+TEST(noStallsWhileTheGpuKeepsUp)
+{
+    FakeFrameQueue queue;
+    FramePacer pacer(queue, 2);
+
+    for (int frame = 0; frame < 5; ++frame)
+    {
+        pacer.beginFrame();
+        // far longer than the instant GPU frame
+        std::this_thread::sleep_for(20ms);
+        pacer.endFrame();
+    }
+
+    CHECK_EQ(pacer.stats().stallCount, 0u);
+    CHECK_EQ(pacer.stats().stallMs, 0.0);
+    CHECK(eventValues(queue, FakeQueueEventType::Wait).empty());
+    pacer.flush();
+}
+
+TEST(stallTimeCoversTheGpuFrameTime)
+{
+    // one frame in flight: every frame after the first waits for the previous one, which has just started
+    // its 30 ms on the GPU
+    FakeFrameQueue queue(30ms);
+    FramePacer pacer(queue, 1);
+
+    for (int frame = 0; frame < 4; ++frame)
+    {
+        pacer.beginFrame();
+        pacer.endFrame();
+    }
+    pacer.flush();
+
+    const FramePacerStats& stats = pacer.stats();
+    CHECK_EQ(stats.frameCount, 4u);
+    CHECK_EQ(stats.stallCount, 3u);
+    // the lower bound only, a loaded machine may stall longer
+    CHECK(stats.stallMs >= 3 * 25.0);
+}
+
+TEST(misuseThrows)
+{
+    FakeFrameQueue queue;
+    CHECK_THROWS(FramePacer(queue, 0), std::invalid_argument);
+
+    FramePacer pacer(queue, 2);
+    CHECK_THROWS(pacer.endFrame(), std::logic_error);
+    pacer.beginFrame();
+    CHECK_THROWS(pacer.beginFrame(), std::logic_error);
+    pacer.endFrame();
+
+    // the fake enforces the timeline rules of a real fence
+    CHECK_THROWS(queue.signal(1), std::logic_error);
+    CHECK_THROWS(queue.wait(2), std::logic_error);
+    pacer.flush();
+}
+
+int main()
+{
+    return runTests();
+}
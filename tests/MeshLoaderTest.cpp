@@ -0,0 +1,99 @@
+#include "MeshLoader.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Test.h"
+
+namespace
+{
+void appendUint32(std::string& out, uint32_t value)
+{
+    char bytes[4];
+    std::memcpy(bytes, &value, sizeof(bytes));
+    out.append(bytes, sizeof(bytes));
+}
+
+// a .glb with one triangle in the z = 0 plane, front face towards +z, drawn once per node listed in the scene
+std::filesystem::path writeGlb(const std::string& name, const std::string& nodes)
+{
+    std::string json = R"({"asset":{"version":"2.0"},"scene":0,"scenes":[{"nodes":[0,1,2]}],"nodes":)" + nodes
+        + R"(,"meshes":[{"primitives":[{"attributes":{"POSITION":0}}]}],)"
+        + R"("accessors":[{"bufferView":0,"componentType":5126,"count":3,"type":"VEC3"}],)"
+        + R"("bufferViews":[{"buffer":0,"byteLength":36}],"buffers":[{"byteLength":36}]})";
+    json.resize((json.size() + 3) & ~size_t(3), ' ');
+    float positions[9] = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+
+    std::string glb;
+    appendUint32(glb, 0x46546C67); // "glTF"
+    appendUint32(glb, 2);
+    appendUint32(glb, static_cast<uint32_t>(12 + 8 + json.size() + 8 + sizeof(positions)));
+    appendUint32(glb, static_cast<uint32_t>(json.size()));
+    appendUint32(glb, 0x4E4F534A); // JSON
+    glb += json;
+    appendUint32(glb, sizeof(positions));
+    appendUint32(glb, 0x004E4942); // BIN
+    glb.append(reinterpret_cast<const char*>(positions), sizeof(positions));
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+    std::ofstream(path, std::ios::binary).write(glb.data(), static_cast<std::streamsize>(glb.size()));
+    return path;
+}
+
+// z of the loaded triangle's normal by its winding, the sign tells which side is the front
+float windingNormalZ(const Mesh& mesh, uint32_t triangle)
+{
+    Float3 v0 = mesh.vertices[mesh.indices[triangle * 3]];
+    Float3 v1 = mesh.vertices[mesh.indices[triangle * 3 + 1]];
+    Float3 v2 = mesh.vertices[mesh.indices[triangle * 3 + 2]];
+    return cross(v1 - v0, v2 - v0).z;
+}
+}
+
+TEST(mirroringNodesKeepTheFrontFace)
+{
+    // plain, mirrored in x by a scale, and mirrored twice through a parent, which cancels out
+    std::filesystem::path path = writeGlb("dxr-mesh-loader-mirrored.glb", R"([
+        {"mesh":0},
+        {"mesh":0,"scale":[-1,1,1]},
+        {"scale":[-1,1,1],"children":[3]},
+        {"mesh":0,"matrix":[1,0,0,0, 0,-1,0,0, 0,0,1,0, 2,0,0,1]}
+    ])");
+    Mesh mesh = MeshLoader().load(path);
+    std::filesystem::remove(path);
+
+    CHECK_EQ(mesh.triangleCount(), 3u);
+    float front = windingNormalZ(mesh, 0);
+    CHECK(front != 0.0f);
+    for (uint32_t triangle = 1; triangle < 3; ++triangle)
+    {
+        CHECK((windingNormalZ(mesh, triangle) > 0.0f) == (front > 0.0f));
+    }
+    // the mirrored copy really is mirrored
+    CHECK(mesh.vertices[mesh.indices[3]].x <= 0.0f && mesh.vertices[mesh.indices[4]].x <= 0.0f);
+}
+
+TEST(aRotationKeepsTheWinding)
+{
+    // half a turn about y turns the triangle around, its front face goes with it
+    std::filesystem::path path = writeGlb("dxr-mesh-loader-rotated.glb", R"([
+        {"mesh":0},
+        {"mesh":0,"rotation":[0,1,0,0]},
+        {"mesh":0,"translation":[0,0,5]}
+    ])");
+    Mesh mesh = MeshLoader().load(path);
+    std::filesystem::remove(path);
+
+    CHECK_EQ(mesh.triangleCount(), 3u);
+    CHECK((windingNormalZ(mesh, 1) > 0.0f) != (windingNormalZ(mesh, 0) > 0.0f));
+    CHECK_EQ(windingNormalZ(mesh, 2), windingNormalZ(mesh, 0));
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,240 @@
+#include "QueueDependencyTracker.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "FramePacer.h"
+#include "Test.h"
+
+namespace
+{
+constexpr uint32_t CPU_QUEUE = QueueDependencyTracker::CPU_QUEUE;
+// as in D3DEngine
+constexpr uint32_t FRAME_COUNT = 2;
+constexpr uint32_t TLAS_BUFFER_COUNT = FRAME_COUNT + 1;
+
+// a GPU that finishes work only once the CPU waits for it, so the CPU learns as little as it can
+class LazyFrameQueue : public FrameQueue
+{
+public:
+    void signal(uint64_t value) override
+    {
+        m_signaledValue = value;
+    }
+
+    uint64_t completedValue() const override
+    {
+        return m_completedValue;
+    }
+
+    void wait(uint64_t value) override
+    {
+        if (value > m_signaledValue)
+        {
+            throw std::logic_error("Waiting for a value that was never signaled.");
+        }
+        m_completedValue = std::max(m_completedValue, value);
+    }
+
+private:
+    uint64_t m_signaledValue = 0;
+    uint64_t m_completedValue = 0;
+};
+
+// the tracker calls of D3DEngine: the setup of createAS, then render and updateTlas for every frame
+class EngineFramePattern
+{
+public:
+    explicit EngineFramePattern(bool cpuWaits = true)
+        : m_cpuWaits(cpuWaits)
+        , m_framePacer(m_frameQueue, FRAME_COUNT)
+        , m_computePacer(m_computeFrameQueue, FRAME_COUNT)
+    {
+        m_directQueue = m_tracker.addQueue("direct queue");
+        m_computeQueue = m_tracker.addQueue("compute queue");
+        m_blas = m_tracker.addResource("BLAS");
+        for (uint32_t i = 0; i < TLAS_BUFFER_COUNT; ++i)
+        {
+            m_tlas[i] = m_tracker.addResource("TLAS " + std::to_string(i));
+        }
+        for (uint32_t i = 0; i < FRAME_COUNT; ++i)
+        {
+            m_instanceDescs[i] = m_tracker.addResource("instance descs " + std::to_string(i));
+        }
+
+        // the BLAS and the first TLAS are built on the direct queue, then the setup is flushed
+        m_tracker.write(m_directQueue, m_blas);
+        m_tracker.write(CPU_QUEUE, m_instanceDescs[0]);
+        recordTlasBuild(m_directQueue, 0, 0, std::nullopt);
+        m_framePacer.flush();
+        m_tracker.signal(m_directQueue, m_framePacer.lastSignaledValue());
+        m_tracker.cpuWait(m_directQueue, m_framePacer.lastSignaledValue());
+    }
+
+    void render()
+    {
+        uint32_t slot = m_framePacer.beginFrame();
+        m_computePacer.beginFrame();
+        if (m_cpuWaits)
+        {
+            m_tracker.cpuWait(m_directQueue, std::min(m_frameQueue.completedValue(), m_framePacer.lastSignaledValue()));
+            m_tracker.cpuWait(m_computeQueue,
+                std::min(m_computeFrameQueue.completedValue(), m_computePacer.lastSignaledValue()));
+        }
+
+        uint32_t tlasIndex = m_latestTlas;
+        uint64_t tlasValue = m_latestTlasValue;
+        updateTlas(slot);
+
+        if (tlasValue != 0)
+        {
+            m_tracker.gpuWait(m_directQueue, m_computeQueue, tlasValue);
+        }
+        m_tracker.read(m_directQueue, m_tlas[tlasIndex]);
+        m_tlasReadValues[tlasIndex] = m_framePacer.lastSignaledValue() + 1;
+        m_framePacer.endFrame();
+        m_tracker.signal(m_directQueue, m_framePacer.lastSignaledValue());
+    }
+
+    const QueueDependencyTracker& tracker() const
+    {
+        return m_tracker;
+    }
+
+private:
+    void updateTlas(uint32_t slot)
+    {
+        m_tracker.write(CPU_QUEUE, m_instanceDescs[slot]);
+        uint32_t target = (m_latestTlas + 1) % TLAS_BUFFER_COUNT;
+        if (m_tlasReadValues[target] != 0)
+        {
+            m_tracker.gpuWait(m_computeQueue, m_directQueue, m_tlasReadValues[target]);
+        }
+        recordTlasBuild(m_computeQueue, slot, target, m_latestTlas);
+        m_latestTlas = target;
+        m_latestTlasValue = m_computePacer.endFrame();
+        m_tracker.signal(m_computeQueue, m_latestTlasValue);
+    }
+
+    void recordTlasBuild(uint32_t queue, uint32_t slot, uint32_t target, std::optional<uint32_t> source)
+    {
+        m_tracker.read(queue, m_instanceDescs[slot]);
+        m_tracker.read(queue, m_blas);
+        if (source)
+        {
+            m_tracker.read(queue, m_tlas[*source]);
+        }
+        m_tracker.write(queue, m_tlas[target]);
+    }
+
+    bool m_cpuWaits;
+    QueueDependencyTracker m_tracker;
+    LazyFrameQueue m_frameQueue;
+    LazyFrameQueue m_computeFrameQueue;
+    FramePacer m_framePacer;
+    FramePacer m_computePacer;
+
+    uint32_t m_directQueue = 0;
+    uint32_t m_computeQueue = 0;
+    uint32_t m_blas = 0;
+    std::array<uint32_t, TLAS_BUFFER_COUNT> m_tlas = {};
+    std::array<uint32_t, FRAME_COUNT> m_instanceDescs = {};
+
+    uint32_t m_latestTlas = 0;
+    uint64_t m_latestTlasValue = 0;
+    std::array<uint64_t, TLAS_BUFFER_COUNT> m_tlasReadValues = {};
+};
+}
+
+TEST(aCrossQueueReadNeedsAGpuWait)
+{
+    QueueDependencyTracker tracker;
+    uint32_t direct = tracker.addQueue("direct queue");
+    uint32_t compute = tracker.addQueue("compute queue");
+    uint32_t tlas = tracker.addResource("TLAS");
+
+    tracker.signal(compute, 1);
+    tracker.write(compute, tlas);
+    tracker.signal(compute, 2);
+    CHECK_THROWS(tracker.read(direct, tlas), std::logic_error);
+    // a signal from before the write orders nothing
+    tracker.gpuWait(direct, compute, 1);
+    CHECK_THROWS(tracker.read(direct, tlas), std::logic_error);
+
+    tracker.gpuWait(direct, compute, 2);
+    tracker.read(direct, tlas);
+    CHECK_EQ(tracker.stats().waitCount, 2u);
+}
+
+TEST(reusingATlasBufferNeedsACpuWait)
+{
+    QueueDependencyTracker tracker;
+    uint32_t direct = tracker.addQueue("direct queue");
+    uint32_t compute = tracker.addQueue("compute queue");
+    uint32_t tlas = tracker.addResource("TLAS");
+    uint32_t instanceDescs = tracker.addResource("instance descs");
+
+    tracker.write(compute, tlas);
+    tracker.signal(compute, 1);
+    tracker.gpuWait(direct, compute, 1);
+    tracker.read(direct, instanceDescs);
+    tracker.read(direct, tlas);
+    tracker.signal(direct, 1);
+
+    // the compute queue rebuilds the buffer the direct queue may still trace, and the CPU rewrites the
+    // instance descs it may still read
+    try
+    {
+        tracker.write(compute, tlas);
+        throw TestFailure("rewriting a TLAS the direct queue reads did not throw");
+    }
+    catch (const std::logic_error& error)
+    {
+        CHECK_EQ(std::string(error.what()), std::string("compute queue writes TLAS without waiting for direct queue."));
+    }
+    CHECK_THROWS(tracker.write(CPU_QUEUE, instanceDescs), std::logic_error);
+
+    // once the CPU saw the frame complete, both the CPU and the work it submits afterwards run after it
+    tracker.cpuWait(direct, 1);
+    tracker.write(CPU_QUEUE, instanceDescs);
+    tracker.write(compute, tlas);
+}
+
+TEST(onlySignaledValuesCanBeWaitedFor)
+{
+    QueueDependencyTracker tracker;
+    uint32_t direct = tracker.addQueue("direct queue");
+    tracker.signal(direct, 3);
+
+    // what a removed device reports as the completed value, D3DEngine clamps it to the last signaled value
+    CHECK_THROWS(tracker.cpuWait(direct, UINT64_MAX), std::logic_error);
+    tracker.cpuWait(direct, std::min<uint64_t>(UINT64_MAX, 3));
+    CHECK_THROWS(tracker.signal(direct, 3), std::logic_error);
+    CHECK_THROWS(tracker.signal(CPU_QUEUE, 1), std::invalid_argument);
+}
+
+TEST(theEngineFramePatternIsOrdered)
+{
+    EngineFramePattern engine;
+    for (int frame = 0; frame < 1000; ++frame)
+    {
+        engine.render();
+    }
+    // setup and every frame signal once per queue
+    CHECK_EQ(engine.tracker().stats().signalCount, 2001u);
+
+    // without learning which frames completed, the CPU rewrites instance descs the compute queue may still read
+    EngineFramePattern blind(false);
+    blind.render();
+    blind.render();
+    CHECK_THROWS(blind.render(), std::logic_error);
+}
+
+int main()
+{
+    return runTests();
+}
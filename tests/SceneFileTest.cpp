@@ -0,0 +1,202 @@
+#include "SceneFile.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Test.h"
+
+namespace
+{
+// random triangles in [-1, 1], sized so the BVH has a few levels
+Mesh randomMesh(uint32_t seed, uint32_t triangleCount)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> offset(-0.1f, 0.1f);
+    Mesh mesh;
+    for (uint32_t i = 0; i < triangleCount; ++i)
+    {
+        Float3 center = {position(random), position(random), position(random)};
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            mesh.indices.push_back(static_cast<uint32_t>(mesh.vertices.size()));
+            mesh.vertices.push_back({center.x + offset(random), center.y + offset(random), center.z + offset(random)});
+        }
+    }
+    return mesh;
+}
+
+SceneInstance instanceAt(uint32_t meshIndex, float x)
+{
+    SceneInstance instance = {
+        .transform = {
+            {1.0f, 0.0f, 0.0f, x},
+            {0.0f, 1.0f, 0.0f, 0.0f},
+            {0.0f, 0.0f, 1.0f, 0.0f}
+        },
+        .instanceID = meshIndex + 10
+    };
+    instance.meshIndex = meshIndex;
+    return instance;
+}
+
+CpuBlas buildBlas(const Mesh& mesh)
+{
+    CpuGeometryDesc geometryDesc = {
+        .indexFormat = CpuIndexFormat::Uint32,
+        .indexCount = static_cast<uint32_t>(mesh.indices.size()),
+        .vertexCount = static_cast<uint32_t>(mesh.vertices.size()),
+        .indexBuffer = mesh.indices.data(),
+        .vertexBuffer = mesh.vertices.data(),
+        .vertexStrideInBytes = sizeof(Float3)
+    };
+    return CpuBlas(std::span(&geometryDesc, 1));
+}
+
+std::filesystem::path scenePath(const std::string& name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+void writeUint32At(const std::filesystem::path& path, std::streamoff offset, uint32_t value)
+{
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// the message SceneFile throws for path
+std::string openError(const std::filesystem::path& path)
+{
+    try
+    {
+        SceneFile scene(path);
+    }
+    catch (const std::runtime_error& error)
+    {
+        return error.what();
+    }
+    throw TestFailure("opening " + path.string() + " did not throw");
+}
+}
+
+TEST(aWrittenSceneReadsBackAndTraces)
+{
+    std::vector<Mesh> meshes = {randomMesh(1, 500), Mesh::triangle()};
+    std::vector<SceneInstance> instances = {instanceAt(0, -2.0f), instanceAt(1, 0.0f), instanceAt(0, 2.0f)};
+    std::filesystem::path path = scenePath("dxr-scene-file-round-trip.dxrs");
+    writeSceneFile(path, meshes, instances);
+
+    {
+        SceneFile scene(path);
+        CHECK_EQ(scene.meshCount(), 2u);
+        CHECK_EQ(scene.fileSize(), static_cast<size_t>(std::filesystem::file_size(path)));
+
+        std::vector<CpuBlas> blases;
+        for (uint32_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex)
+        {
+            const Mesh& mesh = meshes[meshIndex];
+            std::span<const Float3> vertices = scene.vertices(meshIndex);
+            std::span<const uint32_t> indices = scene.indices(meshIndex);
+            CHECK_EQ(vertices.size(), mesh.vertices.size());
+            CHECK_EQ(indices.size(), mesh.indices.size());
+            for (size_t i = 0; i < vertices.size(); ++i)
+            {
+                CHECK(vertices[i].x == mesh.vertices[i].x && vertices[i].y == mesh.vertices[i].y
+                    && vertices[i].z == mesh.vertices[i].z);
+            }
+            CHECK(std::equal(indices.begin(), indices.end(), mesh.indices.begin()));
+
+            // the mapped BVH is the one a build of the mesh produces
+            blases.push_back(buildBlas(mesh));
+            std::span<const CpuBvhNode> expectedNodes = blases.back().nodes();
+            std::span<const CpuBvhNode> nodes = scene.blas(meshIndex).nodes();
+            CHECK_EQ(nodes.size(), expectedNodes.size());
+            CHECK(std::memcmp(nodes.data(), expectedNodes.data(), nodes.size_bytes()) == 0);
+            std::span<const CpuTriangle> expectedTriangles = blases.back().triangles();
+            std::span<const CpuTriangle> triangles = scene.blas(meshIndex).triangles();
+            CHECK_EQ(triangles.size(), expectedTriangles.size());
+            CHECK(std::memcmp(triangles.data(), expectedTriangles.data(), triangles.size_bytes()) == 0);
+        }
+
+        std::vector<CpuInstanceDesc> descs = scene.instanceDescs();
+        CHECK_EQ(descs.size(), instances.size());
+        std::vector<CpuInstanceDesc> expectedDescs = descs;
+        for (size_t i = 0; i < descs.size(); ++i)
+        {
+            CHECK_EQ(descs[i].instanceID, instances[i].instanceID);
+            CHECK_EQ(descs[i].transform[0][3], instances[i].transform[0][3]);
+            CHECK(descs[i].accelerationStructure == &scene.blas(instances[i].meshIndex));
+            expectedDescs[i].accelerationStructure = &blases[instances[i].meshIndex];
+        }
+
+        // rays through the mapped scene find what they find in the scene built in memory
+        CpuTlas tlas(descs);
+        CpuTlas expectedTlas(expectedDescs);
+        uint32_t hitCount = 0;
+        for (int y = 0; y < 40; ++y)
+        {
+            for (int x = 0; x < 120; ++x)
+            {
+                CpuRay ray = {
+                    .origin = {0.0f, 0.0f, -5.0f},
+                    .tMin = 0.0f,
+                    .direction = {-3.5f + 7.0f * (static_cast<float>(x) + 0.5f) / 120.0f, -1.2f + 2.4f * (static_cast<float>(y) + 0.5f) / 40.0f, 5.0f},
+                    .tMax = 100.0f
+                };
+                CpuHit hit;
+                CpuHit expected;
+                CHECK_EQ(tlas.traceRay(ray, CPU_RAY_FLAG_NONE, 0xFF, hit), expectedTlas.traceRay(ray, CPU_RAY_FLAG_NONE, 0xFF, expected));
+                CHECK_EQ(hit.t, expected.t);
+                CHECK_EQ(hit.primitiveIndex, expected.primitiveIndex);
+                CHECK_EQ(hit.instanceIndex, expected.instanceIndex);
+                CHECK_EQ(hit.instanceID, expected.instanceID);
+                hitCount += hit.hasHit() ? 1 : 0;
+            }
+        }
+        CHECK(hitCount > 100);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(aStaleFileNamesWhatChanged)
+{
+    std::vector<Mesh> meshes = {Mesh::triangle()};
+    std::vector<SceneInstance> instances = {instanceAt(0, 0.0f)};
+    std::filesystem::path path = scenePath("dxr-scene-file-stale.dxrs");
+
+    writeSceneFile(path, meshes, instances);
+    writeUint32At(path, offsetof(SceneFileHeader, version), SCENE_FILE_VERSION + 1);
+    std::string error = openError(path);
+    CHECK(error.find("has version " + std::to_string(SCENE_FILE_VERSION + 1)) != std::string::npos);
+
+    // the same version with other struct sizes is a layout change, not a version mismatch
+    writeSceneFile(path, meshes, instances);
+    writeUint32At(path, offsetof(SceneFileHeader, nodeSize), sizeof(CpuBvhNode) + 16);
+    error = openError(path);
+    CHECK(error.find("version") == std::string::npos);
+    CHECK(error.find("48 byte nodes") != std::string::npos);
+
+    writeSceneFile(path, meshes, instances);
+    writeUint32At(path, offsetof(SceneFileHeader, magic), 0);
+    CHECK(openError(path).starts_with("Not a scene file"));
+
+    writeSceneFile(path, meshes, instances);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+    CHECK(openError(path).starts_with("Scene file is truncated"));
+    std::filesystem::remove(path);
+}
+
+int main()
+{
+    return runTests();
+}
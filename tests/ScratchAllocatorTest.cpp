@@ -0,0 +1,131 @@
+#include "ScratchAllocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "Test.h"
+
+namespace
+{
+// one command list of builds as D3DScratchPool records it: begin at the capacity the last ones needed,
+// allocate each build, and replace the buffer when one does not fit
+std::vector<ScratchRange> recordBuilds(ScratchAllocator& allocator, const std::vector<uint64_t>& sizes)
+{
+    allocator.begin(std::max(allocator.stats().highWaterMark, allocator.stats().capacity));
+    std::vector<ScratchRange> ranges;
+    for (uint64_t size : sizes)
+    {
+        std::optional<ScratchRange> range = allocator.allocate(size);
+        if (!range)
+        {
+            allocator.grow(allocator.stats().highWaterMark);
+            range = allocator.allocate(size);
+        }
+        CHECK(range.has_value());
+        ranges.push_back(*range);
+    }
+    return ranges;
+}
+
+size_t barrierCount(const std::vector<ScratchRange>& ranges)
+{
+    return std::count_if(ranges.begin(), ranges.end(), [](const ScratchRange& range) { return range.needsBarrier; });
+}
+}
+
+TEST(noBarrierWhileBuildsFit)
+{
+    ScratchAllocator allocator;
+    allocator.begin(4096);
+    std::optional<ScratchRange> first = allocator.allocate(1000);
+    std::optional<ScratchRange> second = allocator.allocate(1);
+    std::optional<ScratchRange> third = allocator.allocate(2816);
+    CHECK(first && second && third);
+
+    // aligned and back to back, so the builds can run concurrently
+    CHECK_EQ(first->offset, 0u);
+    CHECK_EQ(first->size, 1024u);
+    CHECK_EQ(second->offset, 1024u);
+    CHECK_EQ(second->size, SCRATCH_ALIGNMENT);
+    CHECK_EQ(third->offset, 1280u);
+    CHECK(!first->needsBarrier && !second->needsBarrier && !third->needsBarrier);
+    CHECK_EQ(allocator.stats().barrierCount, 0u);
+    CHECK_EQ(allocator.stats().highWaterMark, 4096u);
+}
+
+TEST(exactlyOneBarrierWhenTheRingWraps)
+{
+    ScratchAllocator allocator;
+    allocator.begin(4096);
+    std::vector<ScratchRange> ranges;
+    for (int i = 0; i < 7; ++i)
+    {
+        std::optional<ScratchRange> range = allocator.allocate(1024);
+        CHECK(range.has_value());
+        ranges.push_back(*range);
+    }
+
+    // the fifth build reuses the start of the buffer behind a barrier, the builds after it follow freely
+    CHECK_EQ(barrierCount(ranges), 1u);
+    CHECK(ranges[4].needsBarrier);
+    CHECK_EQ(ranges[4].offset, 0u);
+    CHECK_EQ(ranges[5].offset, 1024u);
+    CHECK_EQ(ranges[6].offset, 2048u);
+    CHECK_EQ(allocator.stats().barrierCount, 1u);
+    CHECK_EQ(allocator.stats().highWaterMark, 7168u);
+}
+
+TEST(theGrownBufferNeitherWrapsNorGrowsAgain)
+{
+    ScratchAllocator allocator;
+    allocator.begin(2048);
+    std::vector<uint64_t> sizes = {1024, 1024, 512, 1024, 768};
+    std::vector<ScratchRange> first = recordBuilds(allocator, sizes);
+    CHECK(barrierCount(first) > 0);
+    uint64_t highWaterMark = allocator.stats().highWaterMark;
+    CHECK_EQ(highWaterMark, 4352u);
+
+    // begin grows to the high-water mark, after which the same builds fit side by side
+    for (int commandList = 0; commandList < 3; ++commandList)
+    {
+        std::vector<ScratchRange> ranges = recordBuilds(allocator, sizes);
+        CHECK_EQ(barrierCount(ranges), 0u);
+        CHECK_EQ(allocator.stats().capacity, highWaterMark);
+        CHECK_EQ(allocator.stats().highWaterMark, highWaterMark);
+    }
+
+    // a barrier the caller records for its own reasons frees the buffer, demand restarts behind it
+    allocator.begin(allocator.stats().capacity);
+    allocator.allocate(4096);
+    allocator.markBarrier();
+    std::optional<ScratchRange> afterBarrier = allocator.allocate(4096);
+    CHECK(afterBarrier && afterBarrier->offset == 0 && !afterBarrier->needsBarrier);
+    CHECK_EQ(allocator.stats().highWaterMark, highWaterMark);
+}
+
+TEST(anOversizedRequestFitsAfterAGrow)
+{
+    ScratchAllocator allocator;
+    allocator.begin(2048);
+    CHECK(allocator.allocate(1024).has_value());
+    CHECK(!allocator.allocate(4000).has_value());
+    // the failed request counts towards the high-water mark, on top of what the command list already used
+    CHECK_EQ(allocator.stats().highWaterMark, 5120u);
+    CHECK_EQ(allocator.stats().allocationCount, 1u);
+
+    // the replacement buffer has no earlier builds to wait for
+    allocator.grow(allocator.stats().highWaterMark);
+    std::optional<ScratchRange> range = allocator.allocate(4000);
+    CHECK(range.has_value());
+    CHECK_EQ(range->offset, 0u);
+    CHECK_EQ(range->size, 4096u);
+    CHECK(!range->needsBarrier);
+    CHECK_EQ(allocator.stats().barrierCount, 0u);
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,115 @@
+#include "ShaderCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ShaderCompiler.h"
+#include "Test.h"
+
+namespace
+{
+// a fresh directory under the temp directory, removed with the test
+std::filesystem::path emptyDirectory(const std::string& name)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    return path;
+}
+
+// shader.hlsl as an include of a one line source, so the cache has an include to re-hash
+std::filesystem::path writeSources(const std::filesystem::path& directory)
+{
+    std::filesystem::copy_file(DXR_SHADER_SOURCE, directory / "shader.hlsl");
+    std::filesystem::path source = directory / "main.hlsl";
+    std::ofstream(source) << "#include \"shader.hlsl\"\n";
+    return source;
+}
+
+// one compile through the cache, with a new compiler as a new process would have
+ShaderCompileStats compile(
+    const std::filesystem::path& source,
+    const std::filesystem::path& cacheDirectory,
+    const std::vector<std::wstring>& arguments = {}
+)
+{
+    ShaderCompiler compiler({.arguments = arguments, .cacheDirectory = cacheDirectory});
+    std::vector<std::byte> dxil = compiler.compile(source);
+    CHECK(!dxil.empty());
+    CHECK_EQ(compiler.stats().dxilSize, dxil.size());
+    return compiler.stats();
+}
+}
+
+TEST(aSecondCompileHitsWithoutACompiler)
+{
+    std::filesystem::path directory = emptyDirectory("dxr-shader-cache-hit");
+    std::filesystem::path source = writeSources(directory);
+    std::filesystem::path cacheDirectory = directory / "cache";
+
+    ShaderCompileStats cold = compile(source, cacheDirectory);
+    CHECK(!cold.cacheHit);
+    CHECK(cold.compilerCreated);
+
+    ShaderCompileStats warm = compile(source, cacheDirectory);
+    CHECK(warm.cacheHit);
+    CHECK(!warm.compilerCreated);
+    CHECK_EQ(warm.dxilSize, cold.dxilSize);
+
+    std::cout << "shader.hlsl cold " << cold.timeMs << " ms, warm " << warm.timeMs << " ms" << std::endl;
+    std::filesystem::remove_all(directory);
+}
+
+TEST(editingAnIncludeMisses)
+{
+    std::filesystem::path directory = emptyDirectory("dxr-shader-cache-include");
+    std::filesystem::path source = writeSources(directory);
+    std::filesystem::path cacheDirectory = directory / "cache";
+    compile(source, cacheDirectory);
+
+    // the source itself is unchanged, only the include the manifest lists
+    std::ofstream(directory / "shader.hlsl", std::ios::app) << "\nstatic const float UNUSED_CONSTANT = 1.0f;\n";
+    ShaderCompileStats edited = compile(source, cacheDirectory);
+    CHECK(!edited.cacheHit);
+    CHECK(edited.compilerCreated);
+    CHECK(compile(source, cacheDirectory).cacheHit);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(changingAnArgumentMisses)
+{
+    std::filesystem::path directory = emptyDirectory("dxr-shader-cache-arguments");
+    std::filesystem::path source = writeSources(directory);
+    std::filesystem::path cacheDirectory = directory / "cache";
+    compile(source, cacheDirectory);
+
+    std::vector<std::wstring> define = {L"-D", L"UNUSED_DEFINE=1"};
+    CHECK(!compile(source, cacheDirectory, define).cacheHit);
+    CHECK(compile(source, cacheDirectory, define).cacheHit);
+    // both entries live side by side
+    CHECK(compile(source, cacheDirectory).cacheHit);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(anotherCompilerMisses)
+{
+    std::filesystem::path directory = emptyDirectory("dxr-shader-cache-compiler");
+    ShaderCache cache(directory);
+    std::vector<std::wstring> arguments = {L"main.hlsl", L"-T", L"lib_6_3"};
+    std::vector<std::byte> dxil = {std::byte{0x44}, std::byte{0x58}, std::byte{0x42}, std::byte{0x43}};
+
+    // the identity ShaderCompiler computes changes with the path, size or timestamp of the DXC library
+    std::string identity = dxcCompilerIdentity();
+    cache.store({.source = "source", .arguments = arguments, .compilerIdentity = identity}, {}, dxil);
+    CHECK(cache.load({.source = "source", .arguments = arguments, .compilerIdentity = identity}).has_value());
+    CHECK(!cache.load({.source = "source", .arguments = arguments, .compilerIdentity = identity + "|updated"}));
+    std::filesystem::remove_all(directory);
+}
+
+int main()
+{
+    return runTests();
+}
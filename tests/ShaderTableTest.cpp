@@ -0,0 +1,194 @@
+#include "ShaderTable.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "Test.h"
+
+namespace
+{
+// a distinct fake identifier per export, the way GetShaderIdentifier returns one
+class FakeIdentifiers
+{
+public:
+    const void* operator()(const std::wstring& exportName)
+    {
+        auto [it, inserted] = m_identifiers.try_emplace(exportName);
+        if (inserted)
+        {
+            it->second.fill(static_cast<std::byte>(m_identifiers.size()));
+        }
+        return it->second.data();
+    }
+
+private:
+    std::map<std::wstring, std::array<std::byte, SHADER_IDENTIFIER_SIZE>> m_identifiers;
+};
+
+template <typename T>
+T readAt(const std::vector<std::byte>& data, uint64_t offset)
+{
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+}
+
+TEST(strideIsTheLargestRecordPerTable)
+{
+    ShaderTableBuilder builder;
+    builder.add(ShaderTableKind::Miss, L"Miss");
+    builder.add(ShaderTableKind::Miss, L"Shadow", uint64_t{1}, uint64_t{2}, uint64_t{3});
+    builder.add(ShaderTableKind::HitGroup, L"Hit", uint32_t{7});
+
+    ShaderTableLayout layout = builder.layout();
+    // 32 identifier + 24 arguments rounded to the 32 byte record alignment
+    CHECK_EQ(layout.table(ShaderTableKind::Miss).stride, 64u);
+    CHECK_EQ(layout.table(ShaderTableKind::Miss).size, 128u);
+    CHECK_EQ(layout.table(ShaderTableKind::Miss).recordCount, 2u);
+    // the large miss record does not widen the hit group table
+    CHECK_EQ(layout.table(ShaderTableKind::HitGroup).stride, 64u);
+    CHECK_EQ(layout.table(ShaderTableKind::HitGroup).recordCount, 1u);
+
+    ShaderTableBuilder small;
+    small.add(ShaderTableKind::HitGroup, L"Hit");
+    CHECK_EQ(small.layout().table(ShaderTableKind::HitGroup).stride, 32u);
+}
+
+TEST(tablesAndRayGenRecordsAre64ByteAligned)
+{
+    ShaderTableBuilder builder;
+    builder.add(ShaderTableKind::RayGen, L"RayGen", uint64_t{1});
+    builder.add(ShaderTableKind::RayGen, L"RayGen", uint64_t{2});
+    builder.add(ShaderTableKind::Miss, L"Miss");
+    builder.add(ShaderTableKind::HitGroup, L"Hit");
+    builder.add(ShaderTableKind::HitGroup, L"Hit");
+    builder.add(ShaderTableKind::HitGroup, L"Hit");
+    builder.add(ShaderTableKind::Callable, L"Callable", uint32_t{1});
+
+    ShaderTableLayout layout = builder.layout();
+    for (const ShaderTableRange& range : layout.tables)
+    {
+        CHECK_EQ(range.offset % SHADER_TABLE_ALIGNMENT, 0u);
+        CHECK_EQ(range.stride % SHADER_RECORD_ALIGNMENT, 0u);
+    }
+    // 40 bytes would do for a record, raygen records are dispatch start addresses
+    CHECK_EQ(layout.table(ShaderTableKind::RayGen).stride, 64u);
+    CHECK_EQ(layout.rayGenRecord(1).offset, 64u);
+    CHECK_EQ(layout.rayGenRecord(1).size, 64u);
+    CHECK_THROWS(layout.rayGenRecord(2), std::out_of_range);
+
+    // the miss table starts after 128 bytes of raygen records, the hit group table after 32 bytes of miss
+    // records is padded to the next 64 bytes
+    CHECK_EQ(layout.table(ShaderTableKind::Miss).offset, 128u);
+    CHECK_EQ(layout.table(ShaderTableKind::Miss).stride, 32u);
+    CHECK_EQ(layout.table(ShaderTableKind::HitGroup).offset, 192u);
+    CHECK_EQ(layout.table(ShaderTableKind::HitGroup).size, 96u);
+    CHECK_EQ(layout.table(ShaderTableKind::Callable).offset, 320u);
+    CHECK_EQ(layout.totalSize, 384u);
+}
+
+TEST(emptyTablesHaveNoRange)
+{
+    ShaderTableBuilder builder;
+    builder.add(ShaderTableKind::RayGen, L"RayGen");
+
+    ShaderTableLayout layout = builder.layout();
+    for (ShaderTableKind kind : {ShaderTableKind::Miss, ShaderTableKind::HitGroup, ShaderTableKind::Callable})
+    {
+        const ShaderTableRange& range = layout.table(kind);
+        CHECK_EQ(range.size, 0u);
+        CHECK_EQ(range.stride, 0u);
+        CHECK_EQ(range.recordCount, 0u);
+    }
+    CHECK_EQ(layout.totalSize, 64u);
+
+    ShaderTableLayout empty = ShaderTableBuilder().layout();
+    CHECK_EQ(empty.totalSize, 0u);
+    std::vector<std::byte> destination;
+    FakeIdentifiers identifiers;
+    ShaderTableBuilder().write(destination, std::ref(identifiers));
+}
+
+TEST(recordsOverTheMaximumStrideAreRejected)
+{
+    ShaderTableBuilder builder;
+    size_t largest = SHADER_RECORD_MAX_STRIDE - SHADER_IDENTIFIER_SIZE;
+    builder.addRecord(ShaderTableKind::HitGroup, L"Largest", std::vector<std::byte>(largest));
+    CHECK_EQ(builder.layout().table(ShaderTableKind::HitGroup).stride, SHADER_RECORD_MAX_STRIDE);
+
+    CHECK_THROWS(
+        builder.addRecord(ShaderTableKind::HitGroup, L"TooLarge", std::vector<std::byte>(largest + 1)),
+        std::invalid_argument
+    );
+    CHECK_THROWS(
+        builder.add(ShaderTableKind::RayGen, L"TooLarge", std::array<uint64_t, 509>{}),
+        std::invalid_argument
+    );
+    // a rejected record leaves the tables as they were
+    CHECK_EQ(builder.recordCount(ShaderTableKind::HitGroup), 1u);
+    CHECK_EQ(builder.recordCount(ShaderTableKind::RayGen), 0u);
+}
+
+TEST(localRootArgumentsArePackedAtTheirAlignment)
+{
+    ShaderTableBuilder builder;
+    // 4 byte constant, 8 byte descriptor after 4 bytes of padding, another constant
+    builder.add(ShaderTableKind::HitGroup, L"Hit", uint32_t{0x11111111}, uint64_t{0x2222222222222222}, uint32_t{0x33333333});
+    uint32_t second = builder.add(ShaderTableKind::HitGroup, L"Other", uint32_t{0x44444444});
+    CHECK_EQ(second, 1u);
+
+    ShaderTableLayout layout = builder.layout();
+    const ShaderTableRange& hitGroups = layout.table(ShaderTableKind::HitGroup);
+    // 32 identifier + 20 arguments
+    CHECK_EQ(hitGroups.stride, 64u);
+
+    std::vector<std::byte> destination(layout.totalSize, std::byte{0xCD});
+    FakeIdentifiers identifiers;
+    builder.write(destination, std::ref(identifiers));
+
+    uint64_t record = hitGroups.offset;
+    CHECK(std::memcmp(destination.data() + record, identifiers(L"Hit"), SHADER_IDENTIFIER_SIZE) == 0);
+    CHECK_EQ(readAt<uint32_t>(destination, record + 32), 0x11111111u);
+    CHECK_EQ(readAt<uint32_t>(destination, record + 36), 0u);
+    CHECK_EQ(readAt<uint64_t>(destination, record + 40), 0x2222222222222222u);
+    CHECK_EQ(readAt<uint32_t>(destination, record + 48), 0x33333333u);
+    // padding up to the stride is zeroed
+    for (uint64_t offset = record + 52; offset < record + hitGroups.stride; ++offset)
+    {
+        CHECK(destination[offset] == std::byte{0});
+    }
+
+    uint64_t other = hitGroups.offset + hitGroups.stride;
+    CHECK(std::memcmp(destination.data() + other, identifiers(L"Other"), SHADER_IDENTIFIER_SIZE) == 0);
+    CHECK_EQ(readAt<uint32_t>(destination, other + 32), 0x44444444u);
+}
+
+TEST(writeRejectsUnknownExportsAndSmallDestinations)
+{
+    ShaderTableBuilder builder;
+    builder.add(ShaderTableKind::RayGen, L"RayGen");
+    builder.add(ShaderTableKind::Miss, L"Missing");
+
+    std::vector<std::byte> destination(builder.layout().totalSize);
+    CHECK_THROWS(
+        builder.write(destination, [](const std::wstring& name) -> const void* {
+            static const std::array<std::byte, SHADER_IDENTIFIER_SIZE> identifier = {};
+            return name == L"RayGen" ? identifier.data() : nullptr;
+        }),
+        std::runtime_error
+    );
+
+    FakeIdentifiers identifiers;
+    std::vector<std::byte> small(destination.size() - 1);
+    CHECK_THROWS(builder.write(small, std::ref(identifiers)), std::invalid_argument);
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,114 @@
+#ifndef TEST_H
+#define TEST_H
+
+// minimal unit test support for the portable code: every test executable holds TEST cases and calls
+// runTests() from main, ctest runs one executable per test file
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct TestFailure : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+struct TestCase
+{
+    const char* name;
+    std::function<void()> run;
+};
+
+inline std::vector<TestCase>& testCases()
+{
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+inline bool registerTest(const char* name, std::function<void()> run)
+{
+    testCases().push_back({name, std::move(run)});
+    return true;
+}
+
+[[noreturn]] inline void failTest(const char* file, int line, const std::string& message)
+{
+    std::ostringstream stream;
+    stream << file << ":" << line << ": " << message;
+    throw TestFailure(stream.str());
+}
+
+// runs every registered test, returns the process exit code
+inline int runTests()
+{
+    size_t failed = 0;
+    for (const TestCase& test : testCases())
+    {
+        try
+        {
+            test.run();
+            std::cout << "[ OK ] " << test.name << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            failed++;
+            std::cout << "[FAIL] " << test.name << ": " << e.what() << std::endl;
+        }
+    }
+    std::cout << testCases().size() - failed << "/" << testCases().size() << " tests passed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+#define TEST(name) \
+    static void name(); \
+    static const bool name##Registered = registerTest(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            failTest(__FILE__, __LINE__, "CHECK(" #condition ") failed"); \
+        } \
+    } \
+    while (false)
+
+#define CHECK_EQ(actual, expected) \
+    do \
+    { \
+        auto actualValue = (actual); \
+        auto expectedValue = (expected); \
+        if (!(actualValue == expectedValue)) \
+        { \
+            std::ostringstream message; \
+            message << #actual " is " << actualValue << ", expected " << expectedValue; \
+            failTest(__FILE__, __LINE__, message.str()); \
+        } \
+    } \
+    while (false)
+
+// the exception type has to match, a different exception fails the test with its own message
+#define CHECK_THROWS(expression, exceptionType) \
+    do \
+    { \
+        bool thrown = false; \
+        try \
+        { \
+            expression; \
+        } \
+        catch (const exceptionType&) \
+        { \
+            thrown = true; \
+        } \
+        if (!thrown) \
+        { \
+            failTest(__FILE__, __LINE__, #expression " did not throw " #exceptionType); \
+        } \
+    } \
+    while (false)
+
+#endif //TEST_H
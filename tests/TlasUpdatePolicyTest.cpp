@@ -0,0 +1,135 @@
+#include "CpuTlas.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "MeshLoader.h"
+#include "Test.h"
+
+namespace
+{
+constexpr uint32_t INSTANCE_COUNT = 16;
+
+CpuBlas triangleBlas(const Mesh& mesh)
+{
+    CpuGeometryDesc geometryDesc = {
+        .indexFormat = CpuIndexFormat::Uint32,
+        .indexCount = static_cast<uint32_t>(mesh.indices.size()),
+        .vertexCount = static_cast<uint32_t>(mesh.vertices.size()),
+        .indexBuffer = mesh.indices.data(),
+        .vertexBuffer = mesh.vertices.data(),
+        .vertexStrideInBytes = sizeof(Float3)
+    };
+    return CpuBlas(std::span(&geometryDesc, 1));
+}
+
+CpuInstanceDesc instanceAt(const CpuBlas& blas, float x, float y)
+{
+    return {
+        .transform = {
+            {1.0f, 0.0f, 0.0f, x},
+            {0.0f, 1.0f, 0.0f, y},
+            {0.0f, 0.0f, 1.0f, 0.0f}
+        },
+        .instanceID = 0,
+        .instanceMask = 0xFF,
+        .instanceContributionToHitGroupIndex = 0,
+        .flags = CPU_INSTANCE_FLAG_NONE,
+        .accelerationStructure = &blas
+    };
+}
+
+// one instance every 4 units along x, far apart, so the built tree pairs up neighbours
+std::vector<CpuInstanceDesc> instanceRow(const CpuBlas& blas)
+{
+    std::vector<CpuInstanceDesc> instances;
+    for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+    {
+        instances.push_back(instanceAt(blas, 4.0f * static_cast<float>(i), 0.0f));
+    }
+    return instances;
+}
+}
+
+TEST(smallMovesRefit)
+{
+    Mesh mesh = Mesh::triangle();
+    CpuBlas blas = triangleBlas(mesh);
+    std::vector<CpuInstanceDesc> instances = instanceRow(blas);
+    CpuTlas tlas(instances);
+
+    // every instance bobs a little, the tree the build chose still fits
+    for (int frame = 1; frame <= 10; ++frame)
+    {
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+        {
+            instances[i].transform[1][3] = 0.05f * static_cast<float>((frame + i) % 3);
+        }
+        CHECK(!tlas.update(instances));
+    }
+    CHECK_EQ(tlas.updatePolicy().stats().buildCount, 1u);
+    CHECK_EQ(tlas.updatePolicy().stats().updateCount, 10u);
+    CHECK(tlas.updatePolicy().costRatio() < 1.5f);
+}
+
+TEST(shuffledInstancesRebuild)
+{
+    Mesh mesh = Mesh::triangle();
+    CpuBlas blas = triangleBlas(mesh);
+    std::vector<CpuInstanceDesc> instances = instanceRow(blas);
+    CpuTlas tlas(instances);
+
+    // the row reversed: a refit keeps pairing instances that are now at opposite ends, so every node spans
+    // most of the row
+    for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+    {
+        instances[i].transform[0][3] = 4.0f * static_cast<float>(i % 2 == 0 ? i : INSTANCE_COUNT - i);
+    }
+    CHECK(tlas.update(instances));
+    CHECK_EQ(tlas.updatePolicy().stats().buildCount, 2u);
+    CHECK_EQ(tlas.updatePolicy().stats().updatesSinceBuild, 0u);
+    CHECK_EQ(tlas.updatePolicy().costRatio(), 1.0f);
+
+    // the rebuilt tree fits the new positions again
+    CHECK(!tlas.update(instances));
+}
+
+TEST(updateLimitRebuildsWithoutDegradation)
+{
+    Mesh mesh = Mesh::triangle();
+    CpuBlas blas = triangleBlas(mesh);
+    std::vector<CpuInstanceDesc> instances = instanceRow(blas);
+    CpuTlas tlas(instances, {.maxLeafSize = 1, .updatePolicy = {.maxUpdateCount = 4}});
+
+    for (int update = 1; update < 4; ++update)
+    {
+        CHECK(!tlas.update(instances));
+    }
+    CHECK(tlas.update(instances));
+    CHECK_EQ(tlas.updatePolicy().stats().buildCount, 2u);
+    CHECK_EQ(tlas.updatePolicy().stats().updateCount, 4u);
+}
+
+TEST(aSingleInstanceNeverDegrades)
+{
+    // the case of D3DEngine's tlasCost: the only leaf is the root, so the cost cannot grow however the
+    // instance moves and only the update limit asks for a rebuild
+    Mesh mesh = Mesh::triangle();
+    CpuBlas blas = triangleBlas(mesh);
+    CpuInstanceDesc instance = instanceAt(blas, 0.0f, 0.0f);
+    CpuTlas tlas(std::span(&instance, 1));
+
+    for (int frame = 1; frame <= 100; ++frame)
+    {
+        instance.transform[0][3] = 10.0f * static_cast<float>(frame);
+        CHECK(!tlas.update(std::span(&instance, 1)));
+        CHECK_EQ(tlas.updatePolicy().costRatio(), 1.0f);
+    }
+    CHECK_EQ(tlas.updatePolicy().stats().buildCount, 1u);
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,188 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Test.h"
+
+namespace
+{
+constexpr uint32_t SEED_COUNT = 50;
+constexpr uint32_t OPERATION_COUNT = 20000;
+// full coalescing is checked against the model every this many operations, it walks every live allocation
+constexpr uint32_t COALESCING_CHECK_INTERVAL = 500;
+
+// the live allocations by offset, what the allocator's block list has to agree with
+using IntervalModel = std::map<uint64_t, uint64_t>;
+
+void checkPlacement(const IntervalModel& model, const TlsfAllocation& allocation, uint64_t size, uint64_t alignment, uint64_t capacity)
+{
+    CHECK_EQ(allocation.offset % std::max(alignment, TLSF_GRANULARITY), 0u);
+    CHECK_EQ(allocation.size % TLSF_GRANULARITY, 0u);
+    CHECK(allocation.size >= size);
+    CHECK(allocation.offset + allocation.size <= capacity);
+
+    // no overlap with the next or the previous live allocation
+    auto next = model.lower_bound(allocation.offset);
+    if (next != model.end())
+    {
+        CHECK(allocation.offset + allocation.size <= next->first);
+    }
+    if (next != model.begin())
+    {
+        auto previous = std::prev(next);
+        CHECK(previous->first + previous->second <= allocation.offset);
+    }
+}
+
+// with full coalescing every gap between live allocations is exactly one free block
+void checkCoalescing(const TlsfAllocator& allocator, const IntervalModel& model)
+{
+    uint64_t usedBytes = 0;
+    uint32_t gapCount = 0;
+    uint64_t largestGap = 0;
+    uint64_t end = 0;
+    auto addGap = [&](uint64_t gap) {
+        if (gap != 0)
+        {
+            gapCount++;
+            largestGap = std::max(largestGap, gap);
+        }
+    };
+    for (const auto& [offset, size] : model)
+    {
+        addGap(offset - end);
+        usedBytes += size;
+        end = offset + size;
+    }
+    addGap(allocator.capacity() - end);
+
+    TlsfAllocatorStats stats = allocator.stats();
+    CHECK_EQ(stats.usedBytes, usedBytes);
+    CHECK_EQ(stats.freeBytes, allocator.capacity() - usedBytes);
+    CHECK_EQ(stats.allocationCount, model.size());
+    CHECK_EQ(stats.freeBlockCount, gapCount);
+    CHECK_EQ(stats.largestFreeBlock, largestGap);
+}
+
+void runSeed(uint32_t seed)
+{
+    std::mt19937_64 random(seed);
+    // an odd capacity, so the last block is not a power of two
+    uint64_t capacity = (16ull << 20) + (random() % 64) * TLSF_GRANULARITY;
+    TlsfAllocator allocator(capacity);
+
+    IntervalModel model;
+    std::vector<TlsfAllocation> live;
+    for (uint32_t operation = 0; operation < OPERATION_COUNT; ++operation)
+    {
+        if (live.empty() || random() % 100 < 55)
+        {
+            // mostly small ranges, one in four up to 1MB, alignments of an upload range, a constant buffer
+            // and a placed resource
+            uint64_t size = random() % 4 == 0 ? random() % (1u << 20) : random() % 20000 + 1;
+            uint64_t alignment = random() % 3 == 0 ? 65536 : (random() % 2 == 0 ? 256 : 16);
+            std::optional<TlsfAllocation> allocation = allocator.allocate(size, alignment);
+            if (!allocation)
+            {
+                // full is allowed, a failed allocation must not change anything
+                CHECK_EQ(allocator.stats().allocationCount, model.size());
+                continue;
+            }
+            checkPlacement(model, *allocation, size, alignment, capacity);
+            model[allocation->offset] = allocation->size;
+            live.push_back(*allocation);
+        }
+        else
+        {
+            size_t index = random() % live.size();
+            allocator.free(live[index]);
+            model.erase(live[index].offset);
+            live[index] = live.back();
+            live.pop_back();
+        }
+
+        if (operation % COALESCING_CHECK_INTERVAL == 0)
+        {
+            checkCoalescing(allocator, model);
+        }
+    }
+    checkCoalescing(allocator, model);
+
+    // freeing everything in random order leaves the single block the allocator started with
+    std::shuffle(live.begin(), live.end(), random);
+    for (const TlsfAllocation& allocation : live)
+    {
+        allocator.free(allocation);
+    }
+    TlsfAllocatorStats stats = allocator.stats();
+    CHECK(allocator.empty());
+    CHECK_EQ(stats.freeBlockCount, 1u);
+    CHECK_EQ(stats.largestFreeBlock, capacity);
+    CHECK_EQ(stats.fragmentation, 0.0);
+
+    std::optional<TlsfAllocation> whole = allocator.allocate(capacity);
+    CHECK(whole && whole->offset == 0 && whole->size == capacity);
+    CHECK(!allocator.allocate(1));
+    allocator.free(*whole);
+}
+}
+
+TEST(randomAllocateFreeKeepsBlocksDisjointAlignedAndCoalesced)
+{
+    for (uint32_t seed = 1; seed <= SEED_COUNT; ++seed)
+    {
+        try
+        {
+            runSeed(seed);
+        }
+        catch (const TestFailure& failure)
+        {
+            throw TestFailure("seed " + std::to_string(seed) + ": " + failure.what());
+        }
+    }
+}
+
+TEST(neighboursMergeInEitherFreeOrder)
+{
+    TlsfAllocator allocator(4 * TLSF_GRANULARITY);
+    std::vector<TlsfAllocation> blocks;
+    for (int i = 0; i < 4; ++i)
+    {
+        blocks.push_back(*allocator.allocate(TLSF_GRANULARITY));
+    }
+    CHECK(!allocator.allocate(1));
+
+    // middle first, then the left and right neighbours of the free range
+    allocator.free(blocks[1]);
+    allocator.free(blocks[2]);
+    CHECK_EQ(allocator.stats().freeBlockCount, 1u);
+    CHECK_EQ(allocator.stats().largestFreeBlock, 2 * TLSF_GRANULARITY);
+    allocator.free(blocks[0]);
+    allocator.free(blocks[3]);
+    CHECK_EQ(allocator.stats().freeBlockCount, 1u);
+    CHECK_EQ(allocator.stats().largestFreeBlock, 4 * TLSF_GRANULARITY);
+}
+
+TEST(misuseThrows)
+{
+    CHECK_THROWS(TlsfAllocator(TLSF_GRANULARITY - 1), std::invalid_argument);
+
+    TlsfAllocator allocator(1 << 20);
+    CHECK_THROWS(allocator.allocate(256, 3), std::invalid_argument);
+
+    TlsfAllocation allocation = *allocator.allocate(1000);
+    allocator.free(allocation);
+    CHECK_THROWS(allocator.free(allocation), std::invalid_argument);
+    CHECK_THROWS(allocator.free(TlsfAllocation{}), std::invalid_argument);
+}
+
+int main()
+{
+    return runTests();
+}